@@ -1,6 +1,10 @@
 //Include the Wire library and the DS3231_tisc code
 #include <Wire.h>
 #include "DS3231_tisc.h"
+#include "DS3231_temp.h"
+#include "DS3231_sync.h"
+#include "DS3231_journal.h"
+#include "DS3231_trace.h" //timing trace, uncomment DS3231_TRACE in there to turn it on
 #include "colors.h"   //Simply a list of #define color names to hex color codes, 
                       //used for display, like '#define WHITE 0xffff', can omit
                       //and #define what you use in this file instead
@@ -9,10 +13,12 @@
 #include <TouchScreen.h>
 #include <LCDWIKI_GUI.h>
 #include <LCDWIKI_KBV.h>
-#define TS_MINX 906
-#define TS_MAXX 116
-#define TS_MINY 92
-#define TS_MAXY 952
+//Touchscreen calibration. The display is rotated 270 degrees and the touchscreen
+//isn't, so the touchscreen's Y axis is the display's X axis and vice versa
+#define TS_LEFT 100     //raw touch Y at display x = 0
+#define TS_RIGHT 950    //raw touch Y at display x = 480
+#define TS_TOP 180      //raw touch X at display y = 0
+#define TS_BOTTOM 910   //raw touch X at display y = 320
 #define MINPRESSURE 10
 #define MAXPRESSURE 1000
 #define YP A3  // must be an analog pin, use "An" notation!
@@ -23,21 +29,83 @@
 
 //Constants to refer to home screen user buttons
 //You may also use these to refer to hardware buttons
-//used in loop() and check_button_press()
+//used in the button tables below and buttonPressed()
 #define BTN_NO_BUTTON 0
 #define BTN_SET_TIME 1
 #define BTN_SET_ALARM_1 2
 #define BTN_SET_ALARM_2 3
 #define BTN_ALARM_TOGGLE 4
+//and the buttons on the other screens
+#define BTN_UP 5
+#define BTN_DOWN 6
+#define BTN_NEXT 7
+#define BTN_12_HOUR 8
+#define BTN_24_HOUR 9
+#define BTN_AM 10
+#define BTN_PM 11
+#define BTN_CANCEL_ALARM 12
+
+//Button shapes, see drawButton()
+#define SHAPE_ROUND_RECT 0  //filled rounded rectangle with the label in it
+#define SHAPE_UP 1          //triangles filling the button's rectangle, pointing...
+#define SHAPE_DOWN 2
+#define SHAPE_NEXT 3        //...right
+
+//What buttonEvent() is told about a button
+#define TOUCH_PRESS 0       //touched, reported on the first scan that sees it
+#define TOUCH_HOLD 1        //still held - repeats, faster and faster
+#define TOUCH_RELEASE 2     //let go
 
 //References to Arrays for user settings below
-//Used when calling getUserArrayChoice() and
-//in that function
+//Used when calling promptChoice() and uiName(),
+//and in those functions
 #define MONTH_L 0
 #define MONTH_S 1
 #define WEEKDAY_L 2
 #define WEEKDAY_S 3
 #define ALARM_FREQUENCY 4
+#define AM_PM 5
+
+//What's on the screen, i.e. what a touch means. Only SCREEN_HOME shows the time
+#define SCREEN_HOME 0     //time & date, buttons
+#define SCREEN_MODE 1     //12 or 24 hour mode, from promptTimeMode()
+#define SCREEN_NUMBER 2   //number with up/down arrows, from promptNumber()
+#define SCREEN_AMPM 3     //AM or PM, from promptAmPm()
+#define SCREEN_CHOICE 4   //name from one of the arrays below, from promptChoice()
+#define SCREEN_ALARM 5    //an alarm going off, from displayAlarm()
+
+//Which series of prompts the answers are going to
+#define FLOW_NONE 0
+#define FLOW_SET_TIME 1   //enterNewTime()...
+#define FLOW_SET_DATE 2   //...then enterNewDate()
+#define FLOW_SET_ALARM 3  //enterNewAlarm()
+
+//Tasks run by runNextTask(), lowest number first when two are due together
+#define TASK_ALARMS 0     //checks alarm flags - woken by the SQW/!INT interrupt
+#define TASK_CLOCK 1      //updates the time & date on screen
+#define TASK_TOUCH 2      //scans the touchscreen
+#define TASK_FLASH 3      //flashes the screen while an alarm is going off
+#define TASK_TEMP 4       //temperature sampler, with TEMP_SAMPLE_SECONDS
+#define TASK_SYNC 5       //host time sync, with SERIAL_SYNC
+#define TASK_JOURNAL 6    //writes out the event journal, with EVENT_JOURNAL
+#define TASK_COUNT 7
+
+//Task timing, in ms
+#define CLOCK_POLL_MILLIS 100       //without TICK_CLOCK, how often the time is read
+#define TOUCH_SCAN_MILLIS 30        //touch scan rate while touched or in a menu
+#define TOUCH_IDLE_SCAN_MILLIS 100  //and on the home screen, untouched - worst case response time
+#define TOUCH_RELEASE_MILLIS 60     //untouched this long before a press counts as released - the panel's reading drops out now and then
+#define TOUCH_HOLD_MILLIS 500       //held this long before it starts repeating
+#define TOUCH_REPEAT_MILLIS 200     //first repeat interval, shrinks by a quarter each repeat...
+#define TOUCH_REPEAT_MIN_MILLIS 40  //...down to this
+#define ALARM_FLASH_MILLIS 200      //alarm screen flash rate
+
+//Trace event ids for DS3231_TRACE_SCOPE(), after the library's own
+#define TRACE_DISPLAY (TRACE_USER + 0)    //displayTimeDate()
+#define TRACE_TOUCH_SCAN (TRACE_USER + 1) //readTouch()
+#define TRACE_HIT_TEST (TRACE_USER + 2)   //hitTest()
+#define TRACE_ALARM_ISR (TRACE_USER + 3)  //alarmHandler()
+#define TRACE_TICK_ISR (TRACE_USER + 4)   //tickHandler()
 
 //The pin number that DS3231 SQW/!INT is connected to
 //TODO: Change this based on your hardware
@@ -45,12 +113,97 @@
 //https://www.arduino.cc/reference/tr/language/functions/external-interrupts/attachinterrupt/
 #define ALARM_INTERRUPT_PIN 18
 
+//Uncomment this next line to keep time in software from the DS3231's 1 Hz square wave
+//instead of reading the time registers every loop. The SQW/!INT pin then carries the
+//square wave, and the library checks the alarm flags once a second.
+//#define TICK_CLOCK
+//How often, in minutes, the software clock reloads itself from the DS3231
+#define TICK_RESYNC_MINUTES 10
+
+//Uncomment this next line to have the DS3231 measure its temperature this often, in seconds,
+//and keep min/max/mean/average statistics (printed on the Serial port with DEBUG)
+//#define TEMP_SAMPLE_SECONDS 60
+
+//Uncomment this next line to let a host set the clock over the Serial port, to within a
+//few ms, using the binary protocol described in DS3231_sync.h
+//#define SERIAL_SYNC
+
+//Uncomment this next line to keep a journal of alarms going off and the clock being set
+//in the module's AT24C32 EEPROM, see DS3231_journal.h. Without the EEPROM it just stays off
+//#define EVENT_JOURNAL
+
 //Uncomment this next line to see feedback on Serial port, adds 2300 bytes to code size
 //#define DEBUG
 
+//Uncomment this next line to print the I2C cost of each DS3231 library call on the Serial
+//port at startup. It rewrites the time and both alarms while it runs, so only use it on the bench.
+//Needs the library's traffic counters, uncomment DS3231_BUS_STATS in DS3231_tisc.h too
+//#define BUS_BENCHMARK
+
+//Sleeping between tasks - idle mode keeps the timers, serial port and pin interrupts running
+#ifdef __AVR__
+#include <avr/sleep.h>
+#endif
+
 //Global Variables
 boolean twelveHourMode = true; // 12/!24 mode, mirrors DS3231 flag value in time register
-volatile boolean alarmTripped = false; //Set when alarm interrupt happens, cleared in loop when alarm handled
+
+//Cooperative scheduler - see runNextTask()
+class Task {
+  public:
+  void (*run)(void);  //does a little work and returns, calls runTaskIn() if it wants to run again
+  bool armed;         //due is valid
+  uint32_t due;       //millis() to run it at
+};
+//The Arduino IDE only declares functions from the first one down, so the tasks need declaring here
+void alarmTask();
+void clockTask();
+void touchTask();
+void flashTask();
+void tempTask();
+void syncTask();
+void journalTask();
+Task tasks[TASK_COUNT] = {
+  {alarmTask, false, 0},
+  {clockTask, false, 0},
+  {touchTask, false, 0},
+  {flashTask, false, 0},
+  {tempTask, false, 0},
+  {syncTask, false, 0},
+  {journalTask, false, 0}
+};
+volatile uint8_t wokenTasks = 0;  //bit per task, set by wakeTask() from interrupts
+
+//Touch input - see touchTask()
+class TouchInput {
+  public:
+  bool held;              //a press has been reported and not released yet
+  uint8_t button;         //button it started on, BTN_NO_BUTTON for none
+  uint8_t screen;         //screen it started on - a press that changes screens gets no more events
+  int16_t x, y;           //where it is now, display coordinates
+  uint16_t repeats;       //TOUCH_HOLD events so far
+  uint16_t repeatMillis;  //time to the next one after that
+  uint32_t lastSeen;      //millis() it was last seen pressed
+  uint32_t nextRepeat;    //millis() of the next TOUCH_HOLD
+};
+TouchInput touch = {false, BTN_NO_BUTTON, SCREEN_HOME, 0, 0, 0, 0, 0, 0};
+
+//User interface state
+uint8_t screen = SCREEN_HOME;
+uint8_t uiFlow = FLOW_NONE;
+uint8_t uiStep = 0;           //how far into uiFlow we are
+uint8_t pendingAlarms = 0;    //alarms that went off while a menu was up, shown on the way home
+bool flashInverted = false;
+//What the prompt on screen is asking for
+uint8_t promptValue;
+uint8_t promptMin;
+uint8_t promptMax;
+uint8_t promptWhich;          //MONTH_L, WEEKDAY_L or ALARM_FREQUENCY for promptChoice()
+//What the set time and set alarm prompts have collected so far
+DateTime newDateTime;
+AlarmSetting newAlarm;
+AlarmSetting currentAlarm;    //what the alarm was set to before
+uint8_t newAlarmNumber;
 
 //--next 4 uncommented lines for LCD & touchscreen
 //TODO: Update for your hardware - instantiate any global objects needed and set any global display vars
@@ -59,19 +212,116 @@ TouchScreen ts = TouchScreen(XP, YP, XM, YM, 300);
 int w = 0; //display width
 int h = 0; //display height
 
-//Arrays used in setting time, date, and alarms
-String weekdays_l[7] = {"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"};
-String month_l[12] = {"January", "February", "March", "April", "May", "June", "July", "August", "September", "October", "November", "December"};
-uint8_t days_per_month[12] = {31,29,31,30,31,30,31,31,30,31,30,31};
-char ampm[2][3] = {"AM","PM"};
-String alarmFreqOptions[3] = {"Every Day", "On Date", "On Weekday"};
+//Everything you can touch. The same table draws a screen's buttons (drawScreenButtons())
+//and finds which one a touch is on (hitTest()), so the two can't disagree
+//TODO: Update for your display
+class Button {
+  public:
+  int16_t x1, y1, x2, y2; //display coordinates, x1 < x2 and y1 < y2
+  uint8_t id;             //BTN_...
+  uint8_t shape;          //SHAPE_...
+  uint16_t color;
+  uint16_t textColor;
+  uint8_t textSize;
+  const char *label;      //in PROGMEM, lines separated by '\n', centered in the button
+};
+//The tables and their labels are in flash (PROGMEM), read with memcpy_P()
+const char labelSetTime[] PROGMEM = "Set\nTime";
+const char labelSetAlarm1[] PROGMEM = "Set\nAlarm\n1";
+const char labelSetAlarm2[] PROGMEM = "Set\nAlarm\n2";
+const char labelAlarmToggle[] PROGMEM = "Alarm\nOn/Off";
+const char label12Hour[] PROGMEM = "12 Hour - ex:  4:00 PM";
+const char label24Hour[] PROGMEM = "24 Hour - ex: 16:00";
+const char labelAm[] PROGMEM = "AM";
+const char labelPm[] PROGMEM = "PM";
+const char labelCancelAlarm[] PROGMEM = "Cancel\nAlarm";
+const char labelNone[] PROGMEM = "";
+const Button homeButtons[] PROGMEM = {
+  {400,   0, 480,  80, BTN_SET_TIME,     SHAPE_ROUND_RECT, GREEN,  BLACK, 2, labelSetTime},
+  {400,  80, 480, 160, BTN_SET_ALARM_1,  SHAPE_ROUND_RECT, RED,    WHITE, 2, labelSetAlarm1},
+  {400, 160, 480, 240, BTN_SET_ALARM_2,  SHAPE_ROUND_RECT, BLUE,   WHITE, 2, labelSetAlarm2},
+  {400, 240, 480, 320, BTN_ALARM_TOGGLE, SHAPE_ROUND_RECT, YELLOW, BLACK, 2, labelAlarmToggle}
+};
+const Button timeModeButtons[] PROGMEM = {
+  {40,  80, 440, 140, BTN_12_HOUR, SHAPE_ROUND_RECT, RED, WHITE, 3, label12Hour},
+  {40, 190, 440, 250, BTN_24_HOUR, SHAPE_ROUND_RECT, RED, WHITE, 3, label24Hour}
+};
+//promptNumber() and promptChoice()
+const Button stepperButtons[] PROGMEM = {
+  {210,  55, 290, 105, BTN_UP,   SHAPE_UP,   GREEN, WHITE, 0, labelNone},
+  {210, 185, 290, 235, BTN_DOWN, SHAPE_DOWN, RED,   WHITE, 0, labelNone},
+  {375, 120, 435, 180, BTN_NEXT, SHAPE_NEXT, BLUE,  WHITE, 0, labelNone}
+};
+const Button amPmButtons[] PROGMEM = {
+  { 70, 95, 190, 175, BTN_AM, SHAPE_ROUND_RECT, RED, WHITE, 5, labelAm},
+  {295, 95, 415, 175, BTN_PM, SHAPE_ROUND_RECT, RED, WHITE, 5, labelPm}
+};
+const Button alarmButtons[] PROGMEM = {
+  {100, 100, 380, 200, BTN_CANCEL_ALARM, SHAPE_ROUND_RECT, WHITE, BLUE, 4, labelCancelAlarm}
+};
+//Which table goes with each screen, in SCREEN_... order
+class ButtonTable {
+  public:
+  const Button *buttons;
+  uint8_t count;
+};
+const ButtonTable screenButtons[] PROGMEM = {
+  {homeButtons, 4},       //SCREEN_HOME
+  {timeModeButtons, 2},   //SCREEN_MODE
+  {stepperButtons, 3},    //SCREEN_NUMBER
+  {amPmButtons, 2},       //SCREEN_AMPM
+  {stepperButtons, 3},    //SCREEN_CHOICE
+  {alarmButtons, 1}       //SCREEN_ALARM
+};
 
-//If you want to use short strings for your display, uncomment this next array and swap weekdays_l 
-//for weekdays_s - find & replace throughout this file
-//String weekdays_s[7] = {"SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT"};
-//If you want to use short strings for your display, uncomment this next array and swap month_l 
-//for month_s - find & replace throughout this file
-//String month_s[12] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+//What displayTimeDate() last put on screen, so it only redraws characters that changed.
+//Each is padded with spaces to the longest it can be. All zeros = nothing drawn yet
+#define WEEKDAY_CHARS 9   //"Wednesday"
+#define TIME_CHARS 11     //"12:00:00 PM"
+#define DATE_CHARS 18     //"September 30, 2099"
+#define ALARM_CHARS 21    //"12:00 PM On Wednesday", from formatAlarm()
+char shownWeekday[WEEKDAY_CHARS];
+char shownTime[TIME_CHARS];
+char shownDate[DATE_CHARS];
+uint16_t frameGlyphs = 0;   //characters drawn by the last displayTimeDate() call
+uint32_t framePixels = 0;   //pixels those characters covered
+
+//Names used in displaying and setting time, date, and alarms. They're in flash (PROGMEM)
+//and stay there - uiName() copies the one you want into a buffer of yours.
+//Nothing in this sketch uses String or malloc(), so it doesn't fragment the heap. What
+//the display and touch libraries do isn't up to us - with DEBUG, freeRam() is printed
+//once a minute, and a number that keeps falling means something is
+const char nameSun[] PROGMEM = "Sunday";
+const char nameMon[] PROGMEM = "Monday";
+const char nameTue[] PROGMEM = "Tuesday";
+const char nameWed[] PROGMEM = "Wednesday";
+const char nameThu[] PROGMEM = "Thursday";
+const char nameFri[] PROGMEM = "Friday";
+const char nameSat[] PROGMEM = "Saturday";
+const char *const weekdayNames[7] PROGMEM = {nameSun, nameMon, nameTue, nameWed, nameThu, nameFri, nameSat};
+const char nameJan[] PROGMEM = "January";
+const char nameFeb[] PROGMEM = "February";
+const char nameMar[] PROGMEM = "March";
+const char nameApr[] PROGMEM = "April";
+const char nameMay[] PROGMEM = "May";
+const char nameJun[] PROGMEM = "June";
+const char nameJul[] PROGMEM = "July";
+const char nameAug[] PROGMEM = "August";
+const char nameSep[] PROGMEM = "September";
+const char nameOct[] PROGMEM = "October";
+const char nameNov[] PROGMEM = "November";
+const char nameDec[] PROGMEM = "December";
+const char *const monthNames[12] PROGMEM = {nameJan, nameFeb, nameMar, nameApr, nameMay, nameJun,
+                                            nameJul, nameAug, nameSep, nameOct, nameNov, nameDec};
+const char nameEveryDay[] PROGMEM = "Every Day";
+const char nameOnDate[] PROGMEM = "On Date";
+const char nameOnWeekday[] PROGMEM = "On Weekday";
+const char *const alarmFreqNames[3] PROGMEM = {nameEveryDay, nameOnDate, nameOnWeekday};
+const char nameAm[] PROGMEM = "AM";
+const char namePm[] PROGMEM = "PM";
+const char *const ampmNames[2] PROGMEM = {nameAm, namePm};
+//If you want to use short strings for your display, use WEEKDAY_S and MONTH_S instead of 
+//WEEKDAY_L and MONTH_L - find & replace throughout this file. They're the first 3 letters
 
 ////////////////////////////////////
 // setup()
@@ -79,7 +329,7 @@ String alarmFreqOptions[3] = {"Every Day", "On Date", "On Weekday"};
 void setup() {
   //DS3231 Interrupt pin is open-drain so needs a pullup
   pinMode(ALARM_INTERRUPT_PIN, INPUT_PULLUP);
-  #ifdef DEBUG
+  #if defined(DEBUG) || defined(BUS_BENCHMARK) || defined(SERIAL_SYNC) || defined(DS3231_TRACE)
   Serial.begin(9600);       //Init serial port
   while(!Serial){;}         //Wait for serial port connection
   #endif
@@ -88,530 +338,946 @@ void setup() {
   //Initialize LCD, draw buttons
   initializeDisplay();    
 
+  //Only this sketch talks to the DS3231, so let the library keep shadow copies
+  //of the CONTROL/STATUS registers instead of re-reading them on every call
+  useRegisterCache(true);
   //Initialize the DS3231 
   initializeDS3231();
+  #ifdef EVENT_JOURNAL
+  //Picks up where the journal left off, and logs every alarm and clock change from here on
+  if(journalBegin())
+    runTaskIn(TASK_JOURNAL, 1000);
+  #ifdef DEBUG
+  printJournal(8);
+  #endif
+  #endif
+  #ifdef BUS_BENCHMARK
+  busBenchmark();
+  #endif
+  #ifdef TEMP_SAMPLE_SECONDS
+  startTemperatureSampler(TEMP_SAMPLE_SECONDS);
+  #endif
+  #ifdef TICK_CLOCK
+  //Switch SQW/!INT to a 1 Hz square wave and load the software clock.
+  //The seconds register increments on each falling edge, so tickHandler() counts those
+  startTickClock(TICK_RESYNC_MINUTES);
+  attachInterrupt(digitalPinToInterrupt(ALARM_INTERRUPT_PIN), tickHandler, FALLING);
+  #else
   //'alarmHandler' is the routine called when an interrupt happens (interrupt service routine / ISR)
   //Trigger interrupt on falling edge, otherwise the Arduino gets stuck when the pin stays low. 
   attachInterrupt(digitalPinToInterrupt(ALARM_INTERRUPT_PIN), alarmHandler, FALLING);
+  #endif
+  //Start the tasks off - the others are started by what they're for
+  runTaskIn(TASK_ALARMS, 0);    //anything that went off while we were powered down
+  runTaskIn(TASK_CLOCK, 0);
+  runTaskIn(TASK_TOUCH, 0);
+  #ifdef TEMP_SAMPLE_SECONDS
+  runTaskIn(TASK_TEMP, 0);
+  #endif
+  #ifdef DEBUG
+  Serial.print(F("setup: free RAM: ")); Serial.println(freeRam());
+  #endif
 }
 ////////////////////////////////////
 // loop()
+// Runs whichever task is due soonest. When none is due the
+// MCU sleeps until an interrupt - the SQW/!INT pin, a serial
+// byte, or the millis() timer, which wakes it each ms to
+// check the deadlines again
 ////////////////////////////////////
 void loop() {
-  uint8_t button;
-  uint8_t whichAlarmTripped;
-  //Get the time & date - see DS3231_TISC.h for definitions of Date and Time classes
-  Date d = readDate();
-  Time t = readTime();
-  //Update the display of date & time
-  displayTimeDate(t, d);
-  delay(100);
-  //Check for user input - returns 0 if no button
-  button = check_button_press();
-  if(button) { //if non-zero, a button was pressed
-    switch(button) {
-      case BTN_SET_TIME:      //Calls enterNewTime which gets settings from user and returns Time object, 
-                              //that object gets passed to setTime() which writes the time values to the DS3231
-                              setTime(enterNewTime()); 
-                              //Calls enterNewDate which gets settings from user and returns Date object, 
-                              //that object gets passed to setDate() which writes the date values to the DS3231
-                              setDate(enterNewDate());
-                              //leave the switch statement
-                              break;
-                              
-      case BTN_SET_ALARM_1:   //Calls enterNewAlarm with parameter of alarm number,gets settings from user and returns 
-                              //an AlarmSetting object, that object gets passed to setAlarm() which writes the alarm
-                              //values to the DS3231
-                              setAlarm(enterNewAlarm(1));
-                              //User has configured alarm settings, so I'll turn on that alarm
-                              turnAlarmOn(1);
-                              //Alarm on/off status has changed, so update the display of alarm status
-                              showAlarmStatus(getAlarmStatus());
-                              break;
-                              
-      case BTN_SET_ALARM_2:   setAlarm(enterNewAlarm(2));
-                              turnAlarmOn(2);
-                              showAlarmStatus(getAlarmStatus());
-                              break;
-                              
-      case BTN_ALARM_TOGGLE:  //toggleAlarms() turns interrupt enable flags for Alarm 1 & 2 on and off
-                              //in a cycle (Both off, 1 only, 2 only, both on) and returns the state
-                              //of the flags. showAlarmStatus upates the UI to match the new settings
-                              showAlarmStatus(toggleAlarms());
-                              break;
-                              
-      default:                //button was non-zero but not a predefined value - ?!
-                              #ifdef DEBUG
-                              Serial.print("loop: ERROR: Button value returned but not defined - value was: "); Serial.println(button);
-                              #endif
-                              break;
-    }//end switch
-  } //end if(button)
-  
-  //Check to see the alarm interrupt was triggered
-  if(alarmTripped) {
-    //Figure out which alarm was tripped, and clear it's flag in the DS3231
-    //serviceAlarms() returns 0 for none, 1 for alarm 1, 2 for alarm 2, 3 for both
-    whichAlarmTripped = serviceAlarms();
-    if(whichAlarmTripped & 1) {
+  #ifdef SERIAL_SYNC
+  //The sync's accuracy is how soon the last byte of the host's frame is seen. With
+  //DS3231_TRACE too, trace commands come framed and syncFromHost() answers them
+  if(Serial.available())
+    runTaskIn(TASK_SYNC, 0);
+  #else
+  #ifdef DS3231_TRACE
+  if(Serial.available())
+    traceCommand(Serial.read());
+  #endif
+  #endif
+  if(!runNextTask())
+    sleepUntilInterrupt();
+}//end loop()
+
+/////////////////////////////////////////////////////////////////////////
+// runTaskIn(task, ms) - runs task once, ms from now. Replaces any time
+// it was already due. Tasks that run periodically call this for
+// themselves each time they run
+/////////////////////////////////////////////////////////////////////////
+void runTaskIn(uint8_t task, uint32_t ms) {
+  tasks[task].due = millis() + ms;
+  tasks[task].armed = true;
+}
+void stopTask(uint8_t task) {
+  tasks[task].armed = false;
+}
+/////////////////////////////////////////////////////////////////////////
+// wakeTask(task) - runTaskIn(task, 0) for interrupt handlers
+/////////////////////////////////////////////////////////////////////////
+void wakeTask(uint8_t task) {
+  wokenTasks |= 1 << task;
+}
+/////////////////////////////////////////////////////////////////////////
+// bool runNextTask() - called from loop()
+// Runs the one task that's been due longest, lowest number on a tie.
+// A task runs to completion - none of them wait for anything, so the
+// others are never more than one task's run time late.
+// Returns false if none is due
+/////////////////////////////////////////////////////////////////////////
+bool runNextTask() {
+  uint8_t i;
+  uint8_t next = TASK_COUNT;
+  uint8_t woken;
+  uint32_t now = millis();
+  noInterrupts();
+  woken = wokenTasks;
+  wokenTasks = 0;
+  interrupts();
+  for(i = 0; i < TASK_COUNT; i++) {
+    if(woken & (1 << i)) {
+      tasks[i].due = now;
+      tasks[i].armed = true;
+    }
+    if(!tasks[i].armed || (int32_t)(tasks[i].due - now) > 0)
+      continue;
+    if(next == TASK_COUNT || (int32_t)(tasks[i].due - tasks[next].due) < 0)
+      next = i;
+  }
+  if(next == TASK_COUNT)
+    return false;
+  tasks[next].armed = false;
+  tasks[next].run();
+  return true;
+}
+/////////////////////////////////////////////////////////////////////////
+// sleepUntilInterrupt() - called from loop() when no task is due
+// Idle sleep: the CPU stops, but millis(), the serial port and the
+// pin interrupts keep going, and any of them wakes it up.
+// TODO: Other boards have their own way to do this, or leave it empty
+/////////////////////////////////////////////////////////////////////////
+void sleepUntilInterrupt() {
+  #ifdef __AVR__
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  noInterrupts();
+  if(!wokenTasks) {   //an interrupt since runNextTask() looked has work for us
+    sleep_enable();
+    interrupts();     //the instruction after this one always runs, so no interrupt can sneak in before the sleep
+    sleep_cpu();
+    sleep_disable();
+  }
+  interrupts();
+  #endif
+}
+
+/////////////////////////////////////////////////////////////////////////
+// alarmTask() - woken by the SQW/!INT interrupt
+// Shows any alarm that went off, once the user is back on the home screen
+/////////////////////////////////////////////////////////////////////////
+void alarmTask() {
+  #ifdef TICK_CLOCK
+  //Resyncs with the DS3231 when due and checks alarm flags, at most once a second
+  //Returns 0 for none, 1 for alarm 1, 2 for alarm 2, 3 for both
+  pendingAlarms |= tickClockService();
+  #else
+  //Collect every alarm interrupt queued by alarmHandler() since last time.
+  //Only talks to the DS3231 if there was at least one.
+  //Each event's .alarms is 1 for alarm 1, 2 for alarm 2, 3 for both
+  AlarmEvent events[4];
+  uint8_t eventCount = serviceAlarms(events, 4);
+  for(uint8_t i = 0; i < eventCount; i++) {
+    pendingAlarms |= events[i].alarms;
     #ifdef DEBUG
-    Serial.println("Alarm 1 Tripped");
+    Serial.print(F("alarmTask: alarm event #")); Serial.print(events[i].sequence);
+    Serial.print(F(" flags ")); Serial.print(events[i].alarms);
+    Serial.print(F(" waited us: ")); Serial.println(events[i].latencyMicros);
     #endif
-    displayAlarm(1);
-    }
-    if(whichAlarmTripped & 2) {
+  }
+  #endif
+  if(screen == SCREEN_HOME)
+    showPendingAlarm();
+}
+/////////////////////////////////////////////////////////////////////////
+// clockTask() - updates the time & date on the home screen
+/////////////////////////////////////////////////////////////////////////
+void clockTask() {
+  #ifdef DEBUG
+  static uint8_t lastRamReport = 60;    //polled every 100 ms, so only once per minute
+  #endif
+  #ifdef TICK_CLOCK
+  //Get the time & date from the software clock - no I2C traffic.
+  //Each tick wakes this, the timer is only in case one goes missing
+  DateTime now = tickClockNow();
+  runTaskIn(TASK_CLOCK, 1100);
+  #else
+  //Get the time & date in one read - see DS3231_TISC.h for definitions of DateTime, Date and Time classes
+  DateTime now = readDateTime();
+  runTaskIn(TASK_CLOCK, CLOCK_POLL_MILLIS);
+  if(ds3231LastError() != DS3231_OK) {
+    //That's the last good time, not now - leave the screen as it is until a read works
+    #ifdef DEBUG
+    Serial.print(F("clockTask: read failed, error ")); Serial.println(ds3231LastError());
+    #endif
+    return;
+  }
+  #endif
+  if(screen == SCREEN_HOME)
+    displayTimeDate(now.t, now.d);
+  #ifdef DEBUG
+  if(now.t.second == 0 && now.t.minute != lastRamReport) {
+    lastRamReport = now.t.minute;
+    Serial.print(F("clockTask: free RAM: ")); Serial.println(freeRam());
+  }
+  #endif
+}
+/////////////////////////////////////////////////////////////////////////
+// touchTask() - scans the touchscreen and turns what it sees into
+// button events for buttonEvent():
+//   TOUCH_PRESS on the first scan that sees a touch
+//   TOUCH_HOLD after TOUCH_HOLD_MILLIS, then again and again, each
+//     interval a quarter shorter, down to TOUCH_REPEAT_MIN_MILLIS
+//   TOUCH_RELEASE once it's been untouched for TOUCH_RELEASE_MILLIS -
+//     the panel's reading drops out now and then while pressed, this
+//     is the debounce, no delay() needed
+// Holds only repeat while the touch is still on its button. If the
+// press changed the screen, the rest of that touch is ignored
+/////////////////////////////////////////////////////////////////////////
+void touchTask() {
+  TSPoint p;
+  uint32_t now = millis();
+  if(readTouch(&p)) {
+    touch.lastSeen = now;
+    touch.x = p.x;
+    touch.y = p.y;
+    if(!touch.held) {
+      touch.held = true;
+      touch.screen = screen;
+      touch.button = hitTest(p.x, p.y);
+      touch.repeats = 0;
+      touch.repeatMillis = TOUCH_REPEAT_MILLIS;
+      touch.nextRepeat = now + TOUCH_HOLD_MILLIS;
       #ifdef DEBUG
-      Serial.println("Alarm 2 Tripped");
+      Serial.print(F("touchTask: Pressed at X: ")); Serial.print(p.x); Serial.print(F("\tY: ")); Serial.print(p.y);
+      Serial.print(F("\tZ: ")); Serial.print(p.z); Serial.print(F("\tbutton: ")); Serial.println(touch.button);
       #endif
-      displayAlarm(2);
+      if(touch.button)
+        buttonEvent(TOUCH_PRESS, touch.button);
     }
-    //clear the global flag set by the interrupt service routine
-    alarmTripped = false;
-  }//end if(alarmTripped) 
-}//end loop()
+    else if(touch.button && touch.screen == screen && (int32_t)(now - touch.nextRepeat) >= 0) {
+      if(hitTest(p.x, p.y) == touch.button) {
+        touch.repeats++;
+        buttonEvent(TOUCH_HOLD, touch.button);
+      }
+      touch.nextRepeat = now + touch.repeatMillis;
+      touch.repeatMillis -= touch.repeatMillis / 4;
+      if(touch.repeatMillis < TOUCH_REPEAT_MIN_MILLIS)
+        touch.repeatMillis = TOUCH_REPEAT_MIN_MILLIS;
+    }
+  }
+  else if(touch.held && now - touch.lastSeen >= TOUCH_RELEASE_MILLIS) {
+    touch.held = false;
+    if(touch.button && touch.screen == screen)
+      buttonEvent(TOUCH_RELEASE, touch.button);
+  }
+  runTaskIn(TASK_TOUCH, touch.held || screen != SCREEN_HOME ? TOUCH_SCAN_MILLIS : TOUCH_IDLE_SCAN_MILLIS);
+}
+/////////////////////////////////////////////////////////////////////////
+// flashTask() - flashes the screen while an alarm is going off
+/////////////////////////////////////////////////////////////////////////
+void flashTask() {
+  lcd.Invert_Display(flashInverted);
+  flashInverted = !flashInverted;
+  runTaskIn(TASK_FLASH, ALARM_FLASH_MILLIS);
+}
+/////////////////////////////////////////////////////////////////////////
+// tempTask() - with TEMP_SAMPLE_SECONDS, starts a conversion when one is
+// due, and picks up the result without waiting for it
+/////////////////////////////////////////////////////////////////////////
+void tempTask() {
+  #ifdef TEMP_SAMPLE_SECONDS
+  uint8_t state = temperatureService();
+  #ifdef DEBUG
+  if(state == TEMP_READY) {
+    TemperatureStats temp = getTemperatureStats();
+    Serial.print(F("tempTask: temperature (C x4) ")); Serial.print(temp.last);
+    Serial.print(F(" min ")); Serial.print(temp.min);
+    Serial.print(F(" max ")); Serial.print(temp.max);
+    Serial.print(F(" mean ")); Serial.print(temp.mean);
+    Serial.print(F(" ewma ")); Serial.println(temp.ewma);
+  }
+  #endif
+  runTaskIn(TASK_TEMP, state == TEMP_CONVERTING ? TEMP_POLL_MILLIS : 1000);
+  #endif
+}
+/////////////////////////////////////////////////////////////////////////
+// syncTask() - with SERIAL_SYNC, answers the host. loop() runs it as
+// soon as a byte arrives. Once the host has sent a new time, it runs
+// every ms until the time is written on the second
+/////////////////////////////////////////////////////////////////////////
+void syncTask() {
+  #ifdef SERIAL_SYNC
+  uint8_t sync = syncFromHost(Serial);
+  if(sync == SYNC_WAITING)
+    runTaskIn(TASK_SYNC, 1);    //syncFromHost() spins through the last 2 ms itself
+  if(sync == SYNC_SET_DONE) {
+    runTaskIn(TASK_CLOCK, 0);
+    #ifdef DEBUG
+    Serial.print(F("syncTask: clock set by host, us late: ")); Serial.println(syncLastLateMicros());
+    #endif
+  }
+  #endif
+}
+
+/////////////////////////////////////////////////////////////////////////
+// journalTask() - with EVENT_JOURNAL, writes records that have been
+// waiting in RAM for JOURNAL_FLUSH_MILLIS. Full pages go out as they fill
+/////////////////////////////////////////////////////////////////////////
+void journalTask() {
+  #ifdef EVENT_JOURNAL
+  journalService();
+  runTaskIn(TASK_JOURNAL, 1000);
+  #endif
+}
+#if defined(EVENT_JOURNAL) && defined(DEBUG)
+/////////////////////////////////////////////////////////////////////////
+// printJournal(n) - called from setup() with DEBUG, prints the newest
+// n journal records, newest first
+/////////////////////////////////////////////////////////////////////////
+void printJournal(uint8_t n) {
+  JournalRecord rec;
+  DateTime dt;
+  char disp[DATE_CHARS + 1];
+  JournalStats stats = getJournalStats();
+  Serial.print(F("printJournal: present: ")); Serial.print(stats.present);
+  Serial.print(F(" head page: ")); Serial.print(stats.head);
+  Serial.print(F(" sequence: ")); Serial.println(stats.sequence);
+  for(uint8_t i = 0; i < n && journalRead(i, &rec); i++) {
+    dt = epochToDateTime(rec.epoch);
+    Serial.print(F("  event ")); Serial.print(rec.event);
+    Serial.print(F(" data ")); Serial.print(rec.data); Serial.print(F(" "));
+    Serial.print(formatDate(disp, sizeof(disp), dt.d)); Serial.print(F(" "));
+    Serial.println(formatTime(disp, sizeof(disp), dt.t, true));
+  }
+}
+#endif
+
+#ifdef DS3231_TRACE
+/////////////////////////////////////////////////////////////////////////
+// traceCommand(c) - with DS3231_TRACE, loop() passes on what's typed in
+// the Serial monitor: 'd' dumps the trace records, 's' prints a table
+// of count/min/mean/max and a latency histogram for each event, 'c'
+// clears them. 'b' sends them in binary for host/ds3231_trace. With
+// SERIAL_SYNC the host owns the port - ds3231_trace sends its commands
+// as SYNC_MSG_TRACE frames then, and syncTask() answers them
+/////////////////////////////////////////////////////////////////////////
+void traceCommand(int c) {
+  if(c == 'd')
+    traceDump(Serial);
+  else if(c == 's')
+    traceSummary(Serial);
+  else if(c == TRACE_CMD_DUMP)
+    traceDumpBinary(Serial);
+  else if(c == TRACE_CMD_CLEAR)
+    traceClear();
+}
+#endif
+
+#ifdef BUS_BENCHMARK
+/////////////////////////////////////////////////////////////////////////////
+// busBenchmark() - called from setup() when BUS_BENCHMARK is defined
+// Calls each DS3231 library function and prints the I2C traffic it caused:
+// transactions, bytes, START/STOPs and modelled bus time at 100 kHz and
+// 400 kHz. Runs once with the register cache off and once with it on.
+/////////////////////////////////////////////////////////////////////////////
+#define BENCH(name, call) { BusStats before = getBusStats(); call; printBusCost(name, busStatsSince(before)); }
+void busBenchmark(void) {
+  DateTime now;
+  AlarmSetting a;
+  uint8_t pass;
+  a.t.hour12 = a.t.hour24 = 6; a.t.minute = 30; a.t.second = 1; a.t.pm = false;
+  a.date = 1; a.weekday = 1;
+  for(pass = 0; pass < 2; pass++) {
+    useRegisterCache(pass == 1);
+    if(pass == 1)
+      refreshRegisterCache();   //start warm, so the numbers show steady-state cost
+    Serial.println(pass ? F("--- register cache ON ---") : F("--- register cache OFF ---"));
+    Serial.println(F("call\ttxns\twrote\tread\tSTART\tSTOP\tus@100k\tus@400k"));
+    BENCH("readDateTime", now = readDateTime());
+    BENCH("readTime", readTime());
+    BENCH("readDate", readDate());
+    BENCH("setTime", setTime(now.t));
+    BENCH("setDate", setDate(now.d));
+    BENCH("setDateTime", setDateTime(now));
+    a.alarm_mask = ALARM1_MATCH_HOURS;
+    BENCH("setAlarm(1)", setAlarm(a));
+    a.alarm_mask = ALARM2_MATCH_HOURS;
+    BENCH("setAlarm(2)", setAlarm(a));
+    BENCH("turnAlarmOn", turnAlarmOn(3));
+    BENCH("getAlarmStatus", getAlarmStatus());
+    BENCH("serviceAlarms", serviceAlarms());
+    BENCH("toggleAlarms", toggleAlarms());
+    BENCH("readRegister", readRegister(DS3231_CONTROL));
+    BENCH("writeRegister", writeRegister(DS3231_AGING_OFFSET, readRegister(DS3231_AGING_OFFSET)));
+    BENCH("readBcdRegister", readBcdRegister(DS3231_DATE));
+    BENCH("refreshRegisterCache", refreshRegisterCache());
+  }
+  //Leave both alarms off, as initializeDS3231() does
+  writeRegister(DS3231_CONTROL, readRegister(DS3231_CONTROL) & 0xfc);
+}
+/////////////////////////////////////////////////////////
+// printBusCost(name, cost) - one line of busBenchmark()
+/////////////////////////////////////////////////////////
+void printBusCost(const char *name, BusStats cost) {
+  Serial.print(name); Serial.print(F("\t"));
+  Serial.print(cost.transactions); Serial.print(F("\t"));
+  Serial.print(cost.bytesWritten); Serial.print(F("\t"));
+  Serial.print(cost.bytesRead); Serial.print(F("\t"));
+  Serial.print(cost.starts); Serial.print(F("\t"));
+  Serial.print(cost.stops); Serial.print(F("\t"));
+  Serial.print(busTimeMicros(cost, 100000)); Serial.print(F("\t"));
+  Serial.println(busTimeMicros(cost, 400000));
+}
+#endif
 
 ////////////////////////////////////////////////////////////////////
-// displayTimeDate() - called from setup()
+// displayTimeDate() - called from clockTask()
 // Rewrite this routine to display the time and date on your display
+// Only characters that differ from what's already on screen are 
+// drawn, normally just the last digit or two of the seconds.
+// Strings are built in fixed buffers on the stack - no String objects
 ////////////////////////////////////////////////////////////////////
 void displayTimeDate(Time t, Date d){
-  //show will hold weekday, then date string
-  String show;
-  //disp will hold time string - longest => '12:00:00 PM'
-  char disp[12];  //Time needs 12 chars (including terminating null)
+  DS3231_TRACE_SCOPE(TRACE_DISPLAY);
+  //disp holds each line in turn - longest is the date => 'September 30, 2099'
+  char disp[DATE_CHARS + 1];
  
+  frameGlyphs = 0;
+  framePixels = 0;
   lcd.Set_Text_colour(GREEN);
   lcd.Set_Text_Back_colour(BLACK);
   
-  //Weekday - select the [weekday-1]th string from the array
-  //ex: d.weekday = 1, get string weekdays_l[0]
-  //weekday is 1-based, weekdays_l is 0-based
-  show = String(weekdays_l[d.weekday-1]);
-  lcd.Set_Text_Size(4);
-  lcd.Print_String(show,20,50);
-  //Display Time - using sprintf to create a formatted string, 
-  //allows adding colons, forcing one digit entries to have a leading zero
-  if(twelveHourMode) {
-    sprintf(disp,"%2d:%02d:%02d %s",t.hour12,t.minute,t.second,ampm[t.pm]);
-  }
-  else {
-    sprintf(disp,"%2d:%02d:%02d",t.hour24,t.minute,t.second);
-  }
-  lcd.Set_Text_Size(5); 
-  lcd.Print_String(disp,10,130);
-  //Show Date, passing strings and numbers to String constructor, very handy!
-  show = String(month_l[d.month-1] + " " + d.date + ", " + d.year);
-  lcd.Set_Text_Size(3); 
-  lcd.Print_String(show,20,225);
+  //Weekday - copy the [weekday-1]th name out of flash
+  //ex: d.weekday = 1, get weekdayNames[0]
+  //weekday is 1-based, the names are 0-based
+  drawChangedText(uiName(disp, sizeof(disp), WEEKDAY_L, d.weekday-1), shownWeekday, WEEKDAY_CHARS, 20, 50, 4);
+  //Display Time - formatTime() adds colons, forces one digit entries to have a leading zero
+  drawChangedText(formatTime(disp, sizeof(disp), t, true), shownTime, TIME_CHARS, 10, 130, 5);
+  //Show Date
+  drawChangedText(formatDate(disp, sizeof(disp), d), shownDate, DATE_CHARS, 20, 225, 3);
+  #ifdef DEBUG
+  if(frameGlyphs > 2) { //more than the seconds changed
+    Serial.print(F("displayTimeDate: glyphs: ")); Serial.print(frameGlyphs); Serial.print(F("\tpixels: ")); Serial.println(framePixels);
+  }
+  #endif
+}
+////////////////////////////////////////////////////////////////////
+// drawChangedText(text, shown, width, x, y, size) - called from displayTimeDate()
+// Compares text, padded with spaces to width, against shown (what is on 
+// screen now) and draws only the character cells that differ, then 
+// updates shown. Each cell is 6 x 8 pixels times the text size.
+////////////////////////////////////////////////////////////////////
+void drawChangedText(const char *text, char *shown, uint8_t width, int16_t x, int16_t y, uint8_t size){
+  char cell[2] = {0, 0};
+  uint8_t i;
+  bool ended = false;
+  lcd.Set_Text_Size(size);
+  for(i = 0; i < width; i++) {
+    if(!ended && text[i] == '\0')
+      ended = true;
+    cell[0] = ended ? ' ' : text[i];
+    if(cell[0] == shown[i])
+      continue;
+    lcd.Print_String((const uint8_t *)cell, x + i * 6 * size, y);
+    shown[i] = cell[0];
+    frameGlyphs++;
+    framePixels += 48UL * size * size;
+  }
+}
+////////////////////////////////////////////////////////////////////
+// invalidateTimeDateDisplay() - called from drawButtons()
+// The screen was cleared, so displayTimeDate() must draw everything
+////////////////////////////////////////////////////////////////////
+void invalidateTimeDateDisplay(){
+  memset(shownWeekday, 0, sizeof(shownWeekday));
+  memset(shownTime, 0, sizeof(shownTime));
+  memset(shownDate, 0, sizeof(shownDate));
+}
+////////////////////////////////////////////////////////////////////
+// uiName(buf, size, which, index) - copies a name out of flash
+// @buf - where to put it, size bytes long, always '\0' terminated
+// @which - MONTH_L, MONTH_S, WEEKDAY_L, WEEKDAY_S, ALARM_FREQUENCY or AM_PM
+// @index - 0 based, e.g. January = 0
+// returns buf
+// uiNameCount(which) - how many names there are to choose from
+////////////////////////////////////////////////////////////////////
+char *uiName(char *buf, uint8_t size, uint8_t which, uint8_t index) {
+  const char *const *table = weekdayNames;
+  if(which == MONTH_L || which == MONTH_S)
+    table = monthNames;
+  else if(which == ALARM_FREQUENCY)
+    table = alarmFreqNames;
+  else if(which == AM_PM)
+    table = ampmNames;
+  if(index >= uiNameCount(which))
+    index = 0;
+  if((which == MONTH_S || which == WEEKDAY_S) && size > 4)
+    size = 4;         //short names are the first 3 letters
+  strncpy_P(buf, (const char *)pgm_read_ptr(&table[index]), size - 1);
+  buf[size - 1] = '\0';
+  return buf;
+}
+uint8_t uiNameCount(uint8_t which) {
+  switch(which) {
+    case MONTH_L:
+    case MONTH_S:         return 12;
+    case ALARM_FREQUENCY: return 3;
+    case AM_PM:           return 2;
+  }
+  return 7;
+}
+////////////////////////////////////////////////////////////////////
+// formatTime(buf, size, t, seconds) - "4:05:00 PM" or "16:05:00" per 
+//                                     twelveHourMode, without the
+//                                     seconds if seconds is false
+// formatDate(buf, size, d) - "September 30, 2099"
+// formatAlarm(buf, size, a) - "6:30 AM Every Day", "6:30 AM On Date 15",
+//                             "6:30 AM On Wednesday"
+// Each writes into the caller's buffer, cut short if it doesn't fit,
+// and returns it. TIME_CHARS, DATE_CHARS and ALARM_CHARS + 1 always fit
+////////////////////////////////////////////////////////////////////
+char *formatTime(char *buf, uint8_t size, Time t, bool seconds) {
+  char ap[3];
+  uint8_t n;
+  if(twelveHourMode)
+    n = snprintf_P(buf, size, PSTR("%2d:%02d"), t.hour12, t.minute);
+  else
+    n = snprintf_P(buf, size, PSTR("%2d:%02d"), t.hour24, t.minute);
+  if(seconds && n < size)
+    n += snprintf_P(buf + n, size - n, PSTR(":%02d"), t.second);
+  if(twelveHourMode && n < size)
+    snprintf_P(buf + n, size - n, PSTR(" %s"), uiName(ap, sizeof(ap), AM_PM, t.pm));
+  return buf;
+}
+char *formatDate(char *buf, uint8_t size, Date d) {
+  char month[10];
+  snprintf_P(buf, size, PSTR("%s %d, %d"), uiName(month, sizeof(month), MONTH_L, d.month - 1), d.date, d.year);
+  return buf;
+}
+char *formatAlarm(char *buf, uint8_t size, AlarmSetting a) {
+  char name[11];
+  uint8_t n;
+  formatTime(buf, size, a.t, false);
+  n = strlen(buf);
+  if(buf[0] == ' ') {   //no padding here
+    memmove(buf, buf + 1, n);
+    n--;
+  }
+  if(a.alarm_mask == ALARM1_MATCH_DATE || a.alarm_mask == ALARM2_MATCH_DATE)
+    snprintf_P(buf + n, size - n, PSTR(" %s %d"), uiName(name, sizeof(name), ALARM_FREQUENCY, 1), a.date);
+  else if(a.alarm_mask == ALARM1_MATCH_WEEKDAY || a.alarm_mask == ALARM2_MATCH_WEEKDAY)
+    snprintf_P(buf + n, size - n, PSTR(" On %s"), uiName(name, sizeof(name), WEEKDAY_L, a.weekday - 1));
+  else
+    snprintf_P(buf + n, size - n, PSTR(" %s"), uiName(name, sizeof(name), ALARM_FREQUENCY, 0));
+  return buf;
+}
+////////////////////////////////////////////////////////////////////
+// printFlash(text, x, y) - lcd.Print_String() for a PROGMEM string,
+// e.g. printFlash(PSTR("Hello"), CENTER, 0). Up to 31 characters
+////////////////////////////////////////////////////////////////////
+void printFlash(const char *text, int16_t x, int16_t y) {
+  char buf[32];
+  strncpy_P(buf, text, sizeof(buf) - 1);
+  buf[sizeof(buf) - 1] = '\0';
+  lcd.Print_String((const uint8_t *)buf, x, y);
+}
+////////////////////////////////////////////////////////////////////
+// freeRam() - bytes between the top of the heap and the bottom of
+// the stack: what's left for the stack to grow into. Printed at
+// startup, and once a minute by clockTask(), with DEBUG. To compare
+// two builds, use this or avr-size's .data + .bss
+////////////////////////////////////////////////////////////////////
+int freeRam() {
+  #ifdef __AVR__
+  extern int __heap_start, *__brkval;
+  int top;
+  return (char *)&top - (__brkval ? (char *)__brkval : (char *)&__heap_start);
+  #else
+  return 0;
+  #endif
+}
+///////////////////////////////////////////////////////////////////////////
+// buttonEvent(event, button) - called from touchTask()
+// @event - TOUCH_PRESS, TOUCH_HOLD or TOUCH_RELEASE
+// @button - BTN_... it happened to, on the screen that's showing
+// The up/down steppers step on each press and hold, everything
+// else acts on the press
+///////////////////////////////////////////////////////////////////////////
+void buttonEvent(uint8_t event, uint8_t button) {
+  if(event == TOUCH_RELEASE)
+    return;
+  if(event == TOUCH_HOLD && button != BTN_UP && button != BTN_DOWN)
+    return;
+  switch(screen) {
+    case SCREEN_HOME:   buttonPressed(button);
+                        break;
+    case SCREEN_MODE:   timeModeTouched(button);
+                        break;
+    case SCREEN_NUMBER: numberTouched(button);
+                        break;
+    case SCREEN_AMPM:   amPmTouched(button);
+                        break;
+    case SCREEN_CHOICE: choiceTouched(button);
+                        break;
+    case SCREEN_ALARM:  alarmTouched(button);
+                        break;
+  }
+}
+///////////////////////////////////////////////////////////////////////////
+// buttonPressed(button) - called from touched() on the home screen
+// @button - BTN_... from homeButtons
+///////////////////////////////////////////////////////////////////////////
+void buttonPressed(uint8_t button) {
+  switch(button) {
+    case BTN_SET_TIME:      //Starts the prompts for the time, then the date. enterNewDate()
+                            //writes both to the DS3231 in one transaction when they're done
+                            uiFlow = FLOW_SET_TIME;
+                            uiStep = 0;
+                            enterNewTime(0);
+                            break;
+    case BTN_SET_ALARM_1:   //Starts the prompts for alarm 1. When they're done enterNewAlarm()
+                            //writes it to the DS3231 and turns it on
+                            newAlarmNumber = 1;
+                            uiFlow = FLOW_SET_ALARM;
+                            uiStep = 0;
+                            enterNewAlarm(0);
+                            break;
+    case BTN_SET_ALARM_2:   newAlarmNumber = 2;
+                            uiFlow = FLOW_SET_ALARM;
+                            uiStep = 0;
+                            enterNewAlarm(0);
+                            break;
+    case BTN_ALARM_TOGGLE:  //toggleAlarms() turns interrupt enable flags for Alarm 1 & 2 on and off
+                            //in a cycle (Both off, 1 only, 2 only, both on) and returns the state
+                            //of the flags. showAlarmStatus upates the UI to match the new settings
+                            showAlarmStatus(toggleAlarms());
+                            break;
+    default:                //button was non-zero but not a predefined value - ?!
+                            #ifdef DEBUG
+                            Serial.print(F("buttonPressed: ERROR: Button value returned but not defined - value was: ")); Serial.println(button);
+                            #endif
+                            break;
+  }
+}
+///////////////////////////////////////////////////////////////////////////
+// promptAnswered(answer) - called by each prompt when the user is done
+// @answer - the number, array index, pm or twelveHourMode they chose
+// Passes it on to whichever flow asked, which asks the next question
+///////////////////////////////////////////////////////////////////////////
+void promptAnswered(uint8_t answer) {
+  #ifdef DEBUG
+  Serial.print(F("promptAnswered: answer is: ")); Serial.println(answer);
+  #endif
+  switch(uiFlow) {
+    case FLOW_SET_TIME:  enterNewTime(answer);
+                         break;
+    case FLOW_SET_DATE:  enterNewDate(answer);
+                         break;
+    case FLOW_SET_ALARM: enterNewAlarm(answer);
+                         break;
+    default:             goHome();
+                         break;
+  }
+}
+///////////////////////////////////////////////////////////////////////////
+// goHome() - back to the home screen, redrawn in full, and on to any
+// alarm that went off while the user was in a menu
+///////////////////////////////////////////////////////////////////////////
+void goHome() {
+  uiFlow = FLOW_NONE;
+  screen = SCREEN_HOME;
+  lcd.Fill_Screen(BLACK);
+  drawButtons();
+  runTaskIn(TASK_CLOCK, 0);
+  showPendingAlarm();
 }
 ///////////////////////////////////////////
-// Time enterNewTime() - called from loop()
+// enterNewTime(answer) - started from buttonPressed(),
+// then called by promptAnswered() with each answer
 // Rewrite this routine and those it calls 
 // to match your input/output devices
+// Each step takes the answer to the last question,
+// stores it, and asks the next
 // TODO:
-// 1. Create a Time object
+// 1. Initialize newDateTime.t
 // 2. Get data for each object member
 //  2a) .hour24 (uint8_t)
 //  2b) .hour12 (uint8_t)
 //  2c) .minute (uint8_t)
 //  2d) .second (uint8_t)
 //  2e) .pm (bool)
-// 3. Return the Time object
+// 3. Go on to enterNewDate()
 ///////////////////////////////////////////
-Time enterNewTime(void){
-  // 1. Create a Time object
-  Time newTime;
-  //Initializing values
-  newTime.hour12 = newTime.hour24 = 12;
-  newTime.minute = newTime.second = 0;
-  newTime.pm = false;
-  //Everything's set, could return newTime here. I'll get user input instead.
-
-  //Ask user to set 12/24 hour mode, sets global flag 'twelveHourMode' so no need to pass values
-  set12_24(); 
-  //Set Hours (TODO: 2a and 2b)
-  if(twelveHourMode){
-      //Prompt user for an Hour, number between 1 and 12, starting with 12
-      //Uses helper function => getUserNumber(title, min, max, default)
-      newTime.hour12 = getUserNumber("Set Hour", 1, 12, 12);
-      //Set the 24 hour time member to be the same as the 12 hour value just set by user
-      newTime.hour24 = newTime.hour12; //Add 12 hours later if user picks PM
-  }
-  else { 
-      //We're in 24 hour mode. Get an hour between 0 and 23, set both hour values
-      newTime.hour24 = getUserNumber("Set Hour", 0, 23, 12);
-      newTime.hour12 = newTime.hour24;
-      if(newTime.hour24 > 12){    //i.e. if hour24=15, then set hour12=3 and pm = true;
-        newTime.hour12 -= 12;
-        newTime.pm = true;
-      }
+void enterNewTime(uint8_t answer){
+  Time &newTime = newDateTime.t;
+  switch(uiStep++) {
+    case 0: // 1. Initializing values
+            newTime.hour12 = newTime.hour24 = 12;
+            newTime.minute = newTime.second = 0;
+            newTime.pm = false;
+            //Ask user to set 12/24 hour mode, sets global flag 'twelveHourMode' so no need to pass values
+            promptTimeMode();
+            break;
+    case 1: //Set Hours (TODO: 2a and 2b)
+            if(twelveHourMode)
+              //Prompt user for an Hour, number between 1 and 12, starting with 12
+              //Uses helper function => promptNumber(title, min, max, default)
+              promptNumber(PSTR("Set Hour"), 1, 12, 12);
+            else
+              //We're in 24 hour mode. Get an hour between 0 and 23
+              promptNumber(PSTR("Set Hour"), 0, 23, 12);
+            break;
+    case 2: if(twelveHourMode){
+              newTime.hour12 = answer;
+              //Set the 24 hour time member to be the same as the 12 hour value just set by user
+              newTime.hour24 = newTime.hour12; //Add 12 hours later if user picks PM
+            }
+            else {
+              //Set both hour values
+              newTime.hour24 = answer;
+              newTime.hour12 = newTime.hour24;
+              if(newTime.hour24 > 12){    //i.e. if hour24=15, then set hour12=3 and pm = true;
+                newTime.hour12 -= 12;
+                newTime.pm = true;
+              }
+            }
+            // Set minutes - get number from 0-59, starting with 30 (TODO: 2c)
+            promptNumber(PSTR("Set Minutes"),0,59,30);
+            break;
+    case 3: newTime.minute = answer;
+            // Seconds (TODO: 2d) - I'm forcing to 0, initialied above, no user setting. Done.
+            //Set AM/PM (TODO: 2e)
+            if(twelveHourMode) { //only need to ask in 12 hour mode
+              //Prompt user to choose am (pm=false) or pm (pm=true)
+              promptAmPm();
+              break;
+            }
+            enterNewTime(newTime.pm);   //no question, straight on
+            break;
+    case 4: newTime.pm = answer;
+            //Correct .hour24 if they selected pm=true
+            //i.e.: If they set hour12=4 earlier, then just chose pm=true, hour24 needs to change from 4 to 16.
+            if(twelveHourMode && newTime.pm)
+              newTime.hour24 += 12;
+            // 3. On to the date
+            uiFlow = FLOW_SET_DATE;
+            uiStep = 0;
+            enterNewDate(0);
+            break;
   }
-  // Set minutes - get number from 0-59, starting with 30 (TODO: 2c)
-  newTime.minute = getUserNumber("Set Minutes",0,59,30);
-  
-  // Seconds (TODO: 2d) - I'm forcing to 0, initialied above, no user setting. Done.
-  
-  //Set AM/PM (TODO: 2e)
-  if(twelveHourMode) { //only need to ask in 12 hour mode
-      //Prompt user to choose am (pm=false) or pm (pm=true)
-      newTime.pm = getUserAmPm();
-      //Correct .hour24 if they selected pm=true
-      //i.e.: If they set hour12=4 earlier, then just chose pm=true, hour24 needs to change from 4 to 16.
-      if(newTime.pm)
-        newTime.hour24 += 12;
-  }
-  //Prep the screen for setting the date - next display func to be called
-  lcd.Fill_Screen(WHITE);
-  
-  // 3. Return the Time object
-  return newTime;
 }
  ///////////////////////////////////////////
-// Date enterNewDate() - called from loop()
+// enterNewDate(answer) - called from enterNewTime(),
+// then by promptAnswered() with each answer
 // Rewrite this routine and those it calls 
 // to match your input/output devices
-// 1. Create a Date object
+// 1. Initialize newDateTime.d
 // 2. Get data for each object member
 //  2a) .year (uint16_t)
 //  2b) .month (uint8_t) 1=Jan...12=Dec
 //  2c) .date (uint8_t) 1..31
-//  2d) .weekday (uint8_t) 1=Sun...7=Sat
-// 3. Return the Date object
+//  2d) .weekday (uint8_t) 1=Sun...7=Sat, from weekdayOf()
+// 3. Write time & date to the DS3231, go home
 ///////////////////////////////////////////
-Date enterNewDate(void){
-  // 1. Create a Date object
-  Date newDate;
-  newDate.year = 2020; newDate.month = 4;
-  newDate.date = 1; newDate.weekday = 4;
-  uint8_t tens_ones = 0;
-  
-  //TODO: 2a) Get year - I'm limiting the user input for year to 2000-2099. The DS3231 could go to 2199.
-  tens_ones = getUserNumber("Set Year: 20XX",0,99,20);
-  newDate.year = 2000 + tens_ones;
-  //TODO: 2b) Get month
-  //Prompts user to choose a value from month_l array values (month long names)
-  newDate.month = getUserArrayChoice(MONTH_L) + 1;    //add 1 because of 0 offset of index in array
-
-  //TODO: 2c) Get date
-  //Prompt user for date number. Max number from days_per_month array based on month they just chose
-  newDate.date = getUserNumber("Set Date:",1,days_per_month[newDate.month-1],15);
-  
-  //TODO: 2d) Weekday
-  //We could calculate the weekday - see: https://en.wikipedia.org/wiki/Determination_of_the_day_of_the_week
-  //It's not as fun as it looks, I'll just ask the user for it until I'm feeling industrious enough to 
-  //calculate it myself
-  newDate.weekday = getUserArrayChoice(WEEKDAY_L) + 1;
-  
-  //Prep the screen for going back to home
-  lcd.Fill_Screen(BLACK);
-  drawButtons();
-  
-  //TODO: 3) Return Date object
-  return newDate;
+void enterNewDate(uint8_t answer){
+  Date &newDate = newDateTime.d;
+  switch(uiStep++) {
+    case 0: // 1. Initializing values
+            newDate.year = 2020; newDate.month = 4;
+            newDate.date = 1; newDate.weekday = 4;
+            //TODO: 2a) Get year - I'm limiting the user input for year to 2000-2099. The DS3231 could go to 2199.
+            promptNumber(PSTR("Set Year: 20XX"),0,99,20);
+            break;
+    case 1: newDate.year = 2000 + answer;
+            //TODO: 2b) Get month
+            //Prompts user to choose a value from the monthNames array (month long names)
+            promptChoice(MONTH_L);
+            break;
+    case 2: newDate.month = answer + 1;    //add 1 because of 0 offset of index in array
+            //TODO: 2c) Get date
+            //Prompt user for date number. Max number from daysInMonth() for the year and month they just chose
+            promptNumber(PSTR("Set Date:"),1,daysInMonth(newDate.year,newDate.month),15);
+            break;
+    case 3: newDate.date = answer;
+            //2d) Weekday
+            //No need to ask, it's worked out from the date (setDate()/setDateTime() do the same)
+            newDate.weekday = weekdayOf(newDate.year, newDate.month, newDate.date);
+            //TODO: 3) setDateTime() writes the time and date values to the DS3231 in one transaction
+            setDateTime(newDateTime);
+            goHome();
+            break;
+  }
 }  
 
 ///////////////////////////////////////////
-// set12_24() - called from enterNewTime(), 
-// sets global flag 'twelveHourMode' which
+// promptTimeMode() - called from enterNewTime(), 
+// the answer sets global flag 'twelveHourMode' which
 // is used to determine how time is displayed
 // and how alarm settings are entered
-// Rewrite this routine to set twelveHourMode
-// based on your hardware
+// Rewrite this routine and timeModeTouched() to 
+// set twelveHourMode based on your hardware
 // false = 24 hour mode
 // true = 12 hour mode
 ///////////////////////////////////////////
-void set12_24(void){
+void promptTimeMode(void){
   //Clear screen
   lcd.Fill_Screen(WHITE);
   lcd.Set_Text_colour(RED);
   lcd.Set_Text_Back_colour(WHITE);
   lcd.Set_Text_Size(4);
-  lcd.Print_String("Set Time Mode",CENTER,0);
-  lcd.Set_Text_colour(WHITE);
-  lcd.Set_Text_Back_colour(RED);
-  lcd.Set_Text_Size(3);
-  lcd.Print_String("12 Hour Mode - ex:  4:00 PM",CENTER,100);
-  lcd.Print_String("24 Hour Mode - ex: 16:00",CENTER,210);
-  //Await press - largely LCD library code
-  do {
-      digitalWrite(13, HIGH);
-      TSPoint p = ts.getPoint();
-      digitalWrite(13, LOW);
-      pinMode(XM, OUTPUT);
-      pinMode(YP, OUTPUT);
-      if (p.z > MINPRESSURE && p.z < MAXPRESSURE)
-      {
-        p.x = map(p.x, TS_MINX, TS_MAXX, w,0);
-        p.y = map(p.y, TS_MINY, TS_MAXY, h,0);
-        if(is_pressed(160,13,190,300,p.x,p.y)) { //12 Hour  
-          #ifdef DEBUG
-          Serial.println("Pressed 12 Hour Mode");
-          #endif
-          twelveHourMode = true; 
-          lcd.Fill_Screen(BLACK);
-          return;
-        }
-        else if (is_pressed(325,25,360,290,p.x,p.y)) { //24 Hour  
-          #ifdef DEBUG
-          Serial.println("Pressed 24 Hour Mode");
-          #endif
-          twelveHourMode = false; 
-          lcd.Fill_Screen(BLACK);
-          return;
-        }
-        delay(200); //Debounce delay
-    }
-  }while(1); //loops forever until one of the above is pressed 
-             //and a return statement is encountered. Better
-             //practice would be to timeout at some point
+  printFlash(PSTR("Set Time Mode"),CENTER,0);
+  screen = SCREEN_MODE;
+  drawScreenButtons();
+}
+void timeModeTouched(uint8_t button){
+  twelveHourMode = button == BTN_12_HOUR;
+  #ifdef DEBUG
+  Serial.println(twelveHourMode ? F("Pressed 12 Hour Mode") : F("Pressed 24 Hour Mode"));
+  #endif
+  lcd.Fill_Screen(BLACK);
+  promptAnswered(twelveHourMode);
 }
 /////////////////////////////////////////////////////////
-// uint8_t getUserNumber(title, minNum, maxNum, startNum) 
+// promptNumber(title, minNum, maxNum, startNum) 
 // Helper called from various places to get an hour, minute, date, etc
-// @title is title to display, 
+// @title is title to display, in PROGMEM - PSTR("Set Hour")
 // @minNum is lowest number in the allowed range,
 // @maxNum is highest number in the allowed range, 
-// returns the number selected
+// @startNum is the number shown to begin with
+// numberTouched() passes the number selected to promptAnswered()
 // TODO: Rewrite this match your hardware.
 ////////////////////////////////////////////////////////
-uint8_t getUserNumber(String title, uint8_t minNum, uint8_t maxNum, uint8_t startNum) {
-  uint16_t pixelColor = 0;
-  uint16_t upColor = 0;
-  uint16_t downColor = 0;
-  uint16_t nextColor = 0;
-  uint16_t dispX, dispY;
-  float tYfactor = 0.56471;
-  float tXfactor = 0.43836;
-  uint8_t userNum;
-  bool notDone = true;
-  
+void promptNumber(const char *title, uint8_t minNum, uint8_t maxNum, uint8_t startNum) {
   lcd.Fill_Screen(WHITE);
   lcd.Set_Text_colour(RED);
   lcd.Set_Text_Back_colour(WHITE);
   lcd.Set_Text_Size(4);
-  lcd.Print_String(title,CENTER,0);
+  printFlash(title,CENTER,0);
   lcd.Set_Text_colour(WHITE);
   lcd.Set_Text_Back_colour(RED);
   lcd.Set_Text_Size(5);
 
-  upColor = lcd.Color_To_565(0,255,0);
-  downColor = lcd.Color_To_565(250,0,0);
-  nextColor = lcd.Color_To_565(0,0,255);
   //Display the number to change, starting with startNum
   lcd.Print_Number_Int((long)startNum,220,125,2,' ',10);
-  userNum = startNum;
-  //I'm drawing three triangles, up, down, and next
-  //Each will be a different color. When the user presses
-  //I will check the color of the pixel they pressed
-  //As long as these colors are unique on the screen, I 
-  //will know which button they pressed
-  //Tried this method since the other touch logic uses
-  //rectangular areas only - it works fine
-  lcd.Set_Draw_color(upColor);
-  lcd.Fill_Triangle(210,105,250,55,290,105);
-  lcd.Set_Draw_color(downColor);
-  lcd.Fill_Triangle(210,185,250,235,290,185);
-  lcd.Set_Draw_color(nextColor);
-  lcd.Fill_Triangle(375,120,435,150,375,180);
-
-  do {
-      digitalWrite(13, HIGH);
-      TSPoint p = ts.getPoint();
-      digitalWrite(13, LOW);
-      pinMode(XM, OUTPUT);
-      pinMode(YP, OUTPUT);
-      if (p.z > MINPRESSURE && p.z < MAXPRESSURE){
-        /*****************************************************
-         * Because my display screen is rotated 270 degrees 
-         * and the touchscreen doesn't rotate, I have to translate
-         * touch coordinates to display coordinates. 
-         * Touchscreen X axis is Display Y axis and vice versa
-         * (touch X - lowest touchpoint number) * factor = display Y
-         * (touch Y - lowest touchpoint number) * otherfactor = display X
-         * factor = 1 / (touchpoint axis range / display axis range)
-         ******************************************************/
-        dispX = round((p.y-100)* tYfactor);
-        dispY = round((p.x-180) * tXfactor);
-        pixelColor = lcd.Read_Pixel(dispX,dispY);
-        if(pixelColor == upColor){
-            userNum++;
-            if(userNum > maxNum)
-              userNum = minNum;
-        }
-        else if(pixelColor == downColor){
-            userNum--;
-            if(userNum < minNum || userNum > maxNum)
-              userNum = maxNum;
-        }
-        else if (pixelColor == nextColor) {
-            notDone = false;
-        }
-        lcd.Print_String("  ",220,125);
-        lcd.Print_Number_Int((long)userNum,220,125,2,' ',10);
-      }
-     delay(200);
-  }while(notDone);
-  #ifdef DEBUG
-  Serial.print("getUserNumber: userNum is: "); Serial.println(userNum);
-  #endif
-  return userNum;
+  promptValue = startNum;
+  promptMin = minNum;
+  promptMax = maxNum;
+  //Three triangles, up, down, and next, from stepperButtons.
+  //Holding up or down repeats, faster the longer it's held
+  screen = SCREEN_NUMBER;
+  drawScreenButtons();
+}
+void numberTouched(uint8_t button) {
+  switch(button) {
+    case BTN_UP:    promptValue++;
+                    if(promptValue > promptMax)
+                      promptValue = promptMin;
+                    break;
+    case BTN_DOWN:  promptValue--;
+                    if(promptValue < promptMin || promptValue > promptMax)
+                      promptValue = promptMax;
+                    break;
+    case BTN_NEXT:  promptAnswered(promptValue);
+                    return;
+  }
+  lcd.Set_Text_colour(WHITE);
+  lcd.Set_Text_Back_colour(RED);
+  lcd.Set_Text_Size(5);
+  printFlash(PSTR("  "),220,125);
+  lcd.Print_Number_Int((long)promptValue,220,125,2,' ',10);
 }
 /////////////////////////////////////////////
-// bool getUserAmPm()- Helper gets am/pm user
-// choice. Returns false for am, true for pm,
-// to match the Time.pm class member.
+// promptAmPm()- Helper gets am/pm user
+// choice. amPmTouched() answers false for am,
+// true for pm, to match the Time.pm class member.
 // Called when setting time, alarm
 // TODO: Rewrite this to match your hardware
 /////////////////////////////////////////////
-bool getUserAmPm(void) {
-      bool ampmDone = false; 
-      bool ampm = false;
-      lcd.Fill_Screen(WHITE);
-      lcd.Set_Text_colour(RED);
-      lcd.Set_Text_Back_colour(WHITE);
-      lcd.Set_Text_Size(5);
-      lcd.Print_String("Set AM / PM",CENTER,0);
-      lcd.Set_Text_Size(5);
-      lcd.Set_Text_colour(WHITE);
-      lcd.Set_Text_Back_colour(RED);
-      lcd.Print_String("AM",100,120);
-      lcd.Print_String("PM",325,120);
-      
-      do{  
-          digitalWrite(13, HIGH);
-          TSPoint p = ts.getPoint();
-          digitalWrite(13, LOW);
-          pinMode(XM, OUTPUT);
-          pinMode(YP, OUTPUT);
-          if (p.z > MINPRESSURE && p.z < MAXPRESSURE)
-          {
-            p.x = map(p.x, TS_MINX, TS_MAXX, w,0);
-            p.y = map(p.y, TS_MINY, TS_MAXY, h,0);
-            if(is_pressed(190,215,245,255,p.x,p.y)) { //AM  
-              #ifdef DEBUG
-              Serial.println("getUserAmPm: Chose AM");
-              #endif
-              ampm = false;
-              ampmDone = true;
-            }
-            else if (is_pressed(190,60,245,90,p.x,p.y)) { //PM  
-              #ifdef DEBUG
-              Serial.println("getUserAmPm: Chose PM");
-              #endif
-              ampm = true;
-              ampmDone = true;
-            }
-        }  
-        delay(200);
-      }while(!ampmDone);
-      return ampm;
+void promptAmPm(void) {
+  lcd.Fill_Screen(WHITE);
+  lcd.Set_Text_colour(RED);
+  lcd.Set_Text_Back_colour(WHITE);
+  lcd.Set_Text_Size(5);
+  printFlash(PSTR("Set AM / PM"),CENTER,0);
+  screen = SCREEN_AMPM;
+  drawScreenButtons();
+}
+void amPmTouched(uint8_t button) {
+  #ifdef DEBUG
+  Serial.println(button == BTN_PM ? F("amPmTouched: Chose PM") : F("amPmTouched: Chose AM"));
+  #endif
+  promptAnswered(button == BTN_PM);
 }
 ////////////////////////////////////////////////////////////////////////
-// uint8_t getUserArrayChoice(which)
+// promptChoice(which)
 // called to set Month, Weekday, Alarm Type by names from global arrays
 // @which is from the #defines near the array definitions
-// returns index in that array of user choice
+// choiceTouched() answers with the index in that array of user choice
 // TODO: Rewrite this to match your hardware
-// Note - it's very similar to getUserNumber()
+// Note - it's very similar to promptNumber()
 // so write that, then copy & modify that to get  this
 ///////////////////////////////////////////////////////////////////////
-uint8_t getUserArrayChoice(uint8_t which) {
-  uint16_t pixelColor = 0;
-  uint16_t upColor = 0;
-  uint16_t downColor = 0;
-  uint16_t nextColor = 0;
-  uint16_t dispX, dispY;
-  float tYfactor = 0.56471;
-  float tXfactor = 0.43836;
-  uint8_t userNum = 0;
-  bool notDone = true;
-  
+void promptChoice(uint8_t which) {
+  char name[11];
   lcd.Fill_Screen(WHITE);
   lcd.Set_Text_colour(RED);
   lcd.Set_Text_Back_colour(WHITE);
   lcd.Set_Text_Size(5);
   //Lazily using a generic heading instead of looking up what we're setting
-  lcd.Print_String("Select:",CENTER,0);
+  printFlash(PSTR("Select:"),CENTER,0);
   lcd.Set_Text_colour(WHITE);
   lcd.Set_Text_Back_colour(RED);
   lcd.Set_Text_Size(5);
 
-  upColor = lcd.Color_To_565(0,255,0);
-  downColor = lcd.Color_To_565(250,0,0);
-  nextColor = lcd.Color_To_565(0,0,255);
-  if(which == MONTH_L) {
-    lcd.Print_String(month_l[userNum],80,125);
-  }
-  else if(which == WEEKDAY_L) {
-    lcd.Print_String(weekdays_l[userNum],80,125);
-  }
-  else if(which == ALARM_FREQUENCY) {
-    lcd.Print_String(alarmFreqOptions[userNum],80,125);
-  }
-  lcd.Set_Draw_color(upColor);
-  lcd.Fill_Triangle(210,105,250,55,290,105);
-  lcd.Set_Draw_color(downColor);
-  lcd.Fill_Triangle(210,185,250,235,290,185);
-  lcd.Set_Draw_color(nextColor);
-  lcd.Fill_Triangle(375,120,435,150,375,180);
-
-  do {
-      digitalWrite(13, HIGH);
-      TSPoint p = ts.getPoint();
-      digitalWrite(13, LOW);
-      pinMode(XM, OUTPUT);
-      pinMode(YP, OUTPUT);
-      if (p.z > MINPRESSURE && p.z < MAXPRESSURE){
-        dispX = round((p.y-100)* tYfactor);
-        dispY = round((p.x-180) * tXfactor);
-        pixelColor = lcd.Read_Pixel(dispX,dispY);
-        if(pixelColor == upColor){
-            userNum++;
-            if( (which == MONTH_L && userNum > 11) ||
-                (which == WEEKDAY_L && userNum > 6) ||
-                (which == ALARM_FREQUENCY && userNum > 2))
-              userNum = 0;      
-        }
-        else if(pixelColor == downColor){
-            userNum--;
-            if(which == MONTH_L && userNum > 11)
-              userNum = 11;
-            else if(which == WEEKDAY_L && userNum > 6)
-              userNum = 6;      
-            else if(which == ALARM_FREQUENCY   && userNum > 2)
-              userNum = 2;
-        }
-        else if (pixelColor == nextColor) {
-            notDone = false;
-        }
-        //Overwrite previous value in case new value is shorter or artifacts will remain
-        lcd.Print_String("          ",70,125); //longest value displayed is 10 chars, so 10 spaces
-        if(which == MONTH_L) {
-          lcd.Print_String(month_l[userNum],70,125);
-        }
-        else if(which == WEEKDAY_L) {
-          lcd.Print_String(weekdays_l[userNum],70,125);
-        }
-        else if(which == ALARM_FREQUENCY) {
-          lcd.Print_String(alarmFreqOptions[userNum],70,125);
-        }
-     }//end if pressure  
-     delay(200);
-  }while(notDone);
-  
-  return userNum;
+  promptValue = 0;
+  promptWhich = which;
+  lcd.Print_String((const uint8_t *)uiName(name, sizeof(name), which, promptValue),80,125);
+  screen = SCREEN_CHOICE;
+  drawScreenButtons();
+}
+void choiceTouched(uint8_t button) {
+  char name[11];
+  switch(button) {
+    case BTN_UP:    promptValue++;
+                    if(promptValue >= uiNameCount(promptWhich))
+                      promptValue = 0;      
+                    break;
+    case BTN_DOWN:  promptValue--;
+                    if(promptValue >= uiNameCount(promptWhich))
+                      promptValue = uiNameCount(promptWhich) - 1;
+                    break;
+    case BTN_NEXT:  promptAnswered(promptValue);
+                    return;
+  }
+  lcd.Set_Text_colour(WHITE);
+  lcd.Set_Text_Back_colour(RED);
+  lcd.Set_Text_Size(5);
+  //Overwrite previous value in case new value is shorter or artifacts will remain
+  printFlash(PSTR("          "),70,125); //longest value displayed is 10 chars, so 10 spaces
+  lcd.Print_String((const uint8_t *)uiName(name, sizeof(name), promptWhich, promptValue),70,125);
 }
 /////////////////////////////////////////////////////////
-// enterNewAlarm(alarm_number) - called from loop()
-// Gets alarm settings from user for alarm_number (1 or 2)
+// enterNewAlarm(answer) - started from buttonPressed(),
+// then called by promptAnswered() with each answer
+// Gets alarm settings from user for newAlarmNumber (1 or 2)
 // TODO: Rewrite to match your hardware
-// 1) Create an AlarmSetting object
+// 1) Initialize newAlarm
 // 2) Set all the values of the object
 // 2a).t Time object settings (.hour12, .hour24, .minute, .second, .pm)
 // 2b) .date if alarm type is date, otherwise ignore
 // 2c) .day if alarm type is weekday, otherwise ignore
 // 2d) .alarm_mask to specify alarm number and alarm type (details in comment below)
-// 3) return the AlarmSetting object
+// 3) write it to the DS3231, turn it on, go home
 //    My logic flow:
 //    For alarm 1, set seconds to 01 to avoid collisions
 //    Get hour
@@ -621,201 +1287,254 @@ uint8_t getUserArrayChoice(uint8_t which) {
 //    >if Everyday - we're done
 //    >if Date - enter date
 //    >if Day - enter day
-//    Return
+//    Write it
 ////////////////////////////////////////////////////
-AlarmSetting enterNewAlarm(uint8_t alarm_number) {
+void enterNewAlarm(uint8_t answer) {
   //Class AlarmString has a Time member t, 8-bit vars for numeric date, weekday index, and flags alarm_mask
   //See DS3231_tisc.h for definition
-  AlarmSetting newAlarm;    
-  uint8_t frequency;
-
-  //I'm forcing alarm 1 seconds to = 01, not allowing user to set.
-  //This will avoid possibility of simultaneous alarms since alarm 2 is always at 00 seconds
-  //and in an alarm clock application, the user won't need to set seconds anyway.
-  if(alarm_number == 1)
-    newAlarm.t.second = 1;
-  //get hours - same logic as getting hours in getNewTime()
-  if(twelveHourMode) {
-    newAlarm.t.hour12 = getUserNumber("Set Alarm Hour:",1,12,6);
-    newAlarm.t.hour24 = newAlarm.t.hour12;
-  } else { //24 hour mode
-    newAlarm.t.hour24 = getUserNumber("Set Alarm Hour:",0,23,6);
-    newAlarm.t.hour12 = newAlarm.t.hour24;
-    if(newAlarm.t.hour12 > 12)
-      newAlarm.t.hour12 -= 12;
-  }
-  //get minutes
-  newAlarm.t.minute = getUserNumber("Set Alarm Minutes:",0,59,30);
-
-  //get AM/PM - if displating in 12 hour mode, set alarm in 12 hour mode
-  if(twelveHourMode){
-    newAlarm.t.pm = getUserAmPm();
-    if(newAlarm.t.pm)
-      newAlarm.t.hour24 += 12;
-  }
-  //get frequency
-  frequency = getUserArrayChoice(ALARM_FREQUENCY);    //0=Everyday,1=Date,2=Weekday
-  if(frequency == 0){
-    /************************************************************************************
-    //The DS3231 has several flags for each alarm, and I need to specify which alarm the 
-    //AlarmSetting object is holding data for, so alarm_mask is a collection of flags
-    //allowing all this data to be communicated.
-    *************************************************************************************/
-    //Set register flags for every day - using table format from DS3231 spec, page 12, Table 2
-    //Datasheet: https://datasheets.maximintegrated.com/en/ds/DS3231.pdf
-    //setAlarm function in DS3231_tisc will move these bits around to the proper registers before writing
-    //to the DS3231. The MSB of alarm_mask will be 0=Alarm 1, 1=Alarm 2
-    //                        ____________________________________________________________
-    //alarm_mask for alarm 1: |  0   |  0  |  0  | DY/!DT | A1M4  | A1M3 | A1M2 | A1M1   |
-    // bit position:          |b7/MSB|  b6 | b5  |  b4    |  b3   |  b2  |  b1  | b0/LSB |
-    //alarm_mask for alarm 2: |  1   |  0  |  0  |   0    |DY/!DT | A2M4 | A2M3 | A2M2   |
-    //                        ------------------------------------------------------------
-    if(alarm_number == 1)
-      newAlarm.alarm_mask = 0x08;   //MSB = 0 => Alarm 1, A1M4-A1M1 = b1000 => hours/minutes/seconds
-    else if (alarm_number == 2)
-      newAlarm.alarm_mask = 0x84;   //MSB = 1 => Alarm 2, A2M4-A2M2 = b100 => hours/minutes/seconds
-  } 
-  else if(frequency == 1) { //by date
-    if(alarm_number == 1)
-      newAlarm.alarm_mask = 0x00; //MSB = 0 => Alarm 1, DY/!DT = 0, A1M4-A1M1 = b0000 => by date
-    else if (alarm_number == 2)
-      newAlarm.alarm_mask = 0x80; //MSB = 1 => Alarm 2, DY/!DT = 0, A2M4-A2M2 = b000 => by date
-    
-    //get alarm date, allowing 1-31 because month is unknown, 
-    //starting with tomorrow as it's the most likely answer
-    //NOTE: This is the ONLY direct DS3231 call I'm making from a 
-    //      user I/O routine. All other usages are in loop()
-    uint8_t tomorrow = readBcdRegister(DS3231_DATE) + 1;
-    if(tomorrow > 31) //I don't know what month it is, but 32 is no good for all months
-      tomorrow = 1;
-    newAlarm.date = getUserNumber("Set Alarm Date:",0,31,tomorrow);
-
-    //TODO: Optional: Enhance by allowing user to select date range, or 'all dates until selected end date'
-    //      DS3231 can only hold 1 date, so this program would have to retain user selection 
-    //      and reprogram DS3231 every day to match.
-  }
-  else if(frequency == 2) { //by weekday
-    if(alarm_number == 1)
-      newAlarm.alarm_mask = 0x10; //MSB = 0 => Alarm 1, DY/!DT = 1, A1M4-A1M1 = b0000 => By weekday
-    else if (alarm_number == 2)
-      newAlarm.alarm_mask = 0x88; //MSB = 1 => Alarm 2, DY/!DT = 1, A2M4-A2M2 = b000 => By weekday
-    newAlarm.weekday = getUserArrayChoice(WEEKDAY_L) + 1;
-
-    //TODO: Optional: Enhance by allowing user to select multiple weekdays like Mon-Fri. DS3231 can only
-    //      hold one at a time, so this program would have to keep the user's selections and 
-    //      reprogram the DS3231 every day to match.
-  }
-  //Prep the screen for going back to home
-  lcd.Fill_Screen(BLACK);
-  drawButtons();
+  uint8_t tomorrow;
+  switch(uiStep++) {
+    case 0: newAlarm = AlarmSetting();
+            //Start from what the alarm is set to now - one read, and most changes are small
+            currentAlarm = readAlarm(newAlarmNumber);
+            if(currentAlarm.t.minute > 59 || currentAlarm.t.hour24 > 23) { //never been set, registers are junk
+              currentAlarm.t.hour24 = currentAlarm.t.hour12 = 6;
+              currentAlarm.t.minute = 30;
+            }
+            //I'm forcing alarm 1 seconds to = 01, not allowing user to set.
+            //This will avoid possibility of simultaneous alarms since alarm 2 is always at 00 seconds
+            //and in an alarm clock application, the user won't need to set seconds anyway.
+            if(newAlarmNumber == 1)
+              newAlarm.t.second = 1;
+            //get hours - same logic as getting hours in enterNewTime()
+            if(twelveHourMode)
+              promptNumber(PSTR("Set Alarm Hour:"),1,12,currentAlarm.t.hour12);
+            else
+              promptNumber(PSTR("Set Alarm Hour:"),0,23,currentAlarm.t.hour24);
+            break;
+    case 1: if(twelveHourMode) {
+              newAlarm.t.hour12 = answer;
+              newAlarm.t.hour24 = newAlarm.t.hour12;
+            } else { //24 hour mode
+              newAlarm.t.hour24 = answer;
+              newAlarm.t.hour12 = newAlarm.t.hour24;
+              if(newAlarm.t.hour12 > 12)
+                newAlarm.t.hour12 -= 12;
+            }
+            //get minutes
+            promptNumber(PSTR("Set Alarm Minutes:"),0,59,currentAlarm.t.minute);
+            break;
+    case 2: newAlarm.t.minute = answer;
+            //get AM/PM - if displating in 12 hour mode, set alarm in 12 hour mode
+            if(twelveHourMode){
+              promptAmPm();
+              break;
+            }
+            enterNewAlarm(false);   //no question, straight on
+            break;
+    case 3: if(twelveHourMode) {
+              newAlarm.t.pm = answer;
+              if(newAlarm.t.pm)
+                newAlarm.t.hour24 += 12;
+            }
+            //get frequency
+            promptChoice(ALARM_FREQUENCY);    //0=Everyday,1=Date,2=Weekday
+            break;
+    case 4: if(answer == 0){
+              /************************************************************************************
+              //The DS3231 has several flags for each alarm, and I need to specify which alarm the 
+              //AlarmSetting object is holding data for, so alarm_mask is a collection of flags
+              //allowing all this data to be communicated.
+              *************************************************************************************/
+              //Set register flags for every day - using table format from DS3231 spec, page 12, Table 2
+              //Datasheet: https://datasheets.maximintegrated.com/en/ds/DS3231.pdf
+              //setAlarm function in DS3231_tisc will move these bits around to the proper registers before writing
+              //to the DS3231. The MSB of alarm_mask will be 0=Alarm 1, 1=Alarm 2
+              //                        ____________________________________________________________
+              //alarm_mask for alarm 1: |  0   |  0  |  0  | DY/!DT | A1M4  | A1M3 | A1M2 | A1M1   |
+              // bit position:          |b7/MSB|  b6 | b5  |  b4    |  b3   |  b2  |  b1  | b0/LSB |
+              //alarm_mask for alarm 2: |  1   |  0  |  0  |   0    |DY/!DT | A2M4 | A2M3 | A2M2   |
+              //                        ------------------------------------------------------------
+              if(newAlarmNumber == 1)
+                newAlarm.alarm_mask = ALARM1_MATCH_HOURS;   //MSB = 0 => Alarm 1, A1M4-A1M1 = b1000 => hours/minutes/seconds
+              else if (newAlarmNumber == 2)
+                newAlarm.alarm_mask = ALARM2_MATCH_HOURS;   //MSB = 1 => Alarm 2, A2M4-A2M2 = b100 => hours/minutes/seconds
+              finishNewAlarm();
+            } 
+            else if(answer == 1) { //by date
+              if(newAlarmNumber == 1)
+                newAlarm.alarm_mask = ALARM1_MATCH_DATE; //MSB = 0 => Alarm 1, DY/!DT = 0, A1M4-A1M1 = b0000 => by date
+              else if (newAlarmNumber == 2)
+                newAlarm.alarm_mask = ALARM2_MATCH_DATE; //MSB = 1 => Alarm 2, DY/!DT = 0, A2M4-A2M2 = b000 => by date
+              
+              //get alarm date, allowing 1-31 because month is unknown, 
+              //starting with tomorrow as it's the most likely answer
+              //NOTE: This and readAlarm() above are the ONLY direct DS3231 calls
+              //      I'm making from a user I/O routine. All other usages are in the tasks
+              tomorrow = readBcdRegister(DS3231_DATE) + 1;
+              if(tomorrow > 31) //I don't know what month it is, but 32 is no good for all months
+                tomorrow = 1;
+              if(currentAlarm.date >= 1 && currentAlarm.date <= 31)  //already a date alarm, keep its date
+                tomorrow = currentAlarm.date;
+              promptNumber(PSTR("Set Alarm Date:"),0,31,tomorrow);
+
+              //TODO: Optional: Enhance by allowing user to select date range, or 'all dates until selected end date'
+              //      DS3231 can only hold 1 date, so this program would have to retain user selection 
+              //      and reprogram DS3231 every day to match.
+            }
+            else if(answer == 2) { //by weekday
+              if(newAlarmNumber == 1)
+                newAlarm.alarm_mask = ALARM1_MATCH_WEEKDAY; //MSB = 0 => Alarm 1, DY/!DT = 1, A1M4-A1M1 = b0000 => By weekday
+              else if (newAlarmNumber == 2)
+                newAlarm.alarm_mask = ALARM2_MATCH_WEEKDAY; //MSB = 1 => Alarm 2, DY/!DT = 1, A2M4-A2M2 = b000 => By weekday
+              promptChoice(WEEKDAY_L);
+
+              //TODO: Optional: Enhance by allowing user to select multiple weekdays like Mon-Fri. DS3231 can only
+              //      hold one at a time, so this program would have to keep the user's selections and 
+              //      reprogram the DS3231 every day to match.
+            }
+            break;
+    case 5: if(newAlarm.alarm_mask == ALARM1_MATCH_WEEKDAY || newAlarm.alarm_mask == ALARM2_MATCH_WEEKDAY)
+              newAlarm.weekday = answer + 1;
+            else
+              newAlarm.date = answer;
+            finishNewAlarm();
+            break;
+  }
+}
+/////////////////////////////////////////////////////////
+// finishNewAlarm() - called from enterNewAlarm()
+// setAlarm() writes the alarm values to the DS3231.
+// User has configured alarm settings, so I'll turn on
+// that alarm - goHome() shows the new on/off status
+/////////////////////////////////////////////////////////
+void finishNewAlarm() {
   #ifdef DEBUG
-  Serial.print("enterNewAlarm: New settings for alarm "); Serial.print(alarm_number);Serial.println(":");
-  Serial.print("     alarm_mask: "); Serial.println(newAlarm.alarm_mask,BIN);
-  Serial.print("     weekday: "); Serial.println(newAlarm.weekday);
-  Serial.print("     date: "); Serial.println(newAlarm.date);
-  Serial.print("     t.hour24: "); Serial.println(newAlarm.t.hour24);
-  Serial.print("     t.hour12: "); Serial.println(newAlarm.t.hour12);
-  Serial.print("     t.minute: "); Serial.println(newAlarm.t.minute);
-  Serial.print("     t.second: "); Serial.println(newAlarm.t.second);
-  Serial.print("     t.pm: "); Serial.println(newAlarm.t.pm);
+  Serial.print(F("enterNewAlarm: New settings for alarm ")); Serial.print(newAlarmNumber);Serial.println(F(":"));
+  Serial.print(F("     alarm_mask: ")); Serial.println(newAlarm.alarm_mask,BIN);
+  Serial.print(F("     weekday: ")); Serial.println(newAlarm.weekday);
+  Serial.print(F("     date: ")); Serial.println(newAlarm.date);
+  Serial.print(F("     t.hour24: ")); Serial.println(newAlarm.t.hour24);
+  Serial.print(F("     t.hour12: ")); Serial.println(newAlarm.t.hour12);
+  Serial.print(F("     t.minute: ")); Serial.println(newAlarm.t.minute);
+  Serial.print(F("     t.second: ")); Serial.println(newAlarm.t.second);
+  Serial.print(F("     t.pm: ")); Serial.println(newAlarm.t.pm);
   #endif
-  return newAlarm;
+  setAlarm(newAlarm);
+  turnAlarmOn(newAlarmNumber);
+  goHome();
 }
 
+/////////////////////////////////////////////////////////////////////////////////////
+// tickHandler() - Interrupt Service Routine for the 1 Hz square wave from the DS3231,
+//  registered in setup() with TICK_CLOCK
+//  Counts the tick, and wakes the tasks that check alarms and update the display
+////////////////////////////////////////////////////////////////////////////////////
+void tickHandler(){
+  DS3231_TRACE_SCOPE(TRACE_TICK_ISR);
+  tickClockISR();
+  wakeTask(TASK_ALARMS);
+  wakeTask(TASK_CLOCK);
+}
 /////////////////////////////////////////////////////////////////////////////////////
 // alarmHandler() - Interrupt Service Routine to handle alarm interrupts from DS3231
 //  registered in setup(), called on interrupt
-//  Sets global bool flag 'alarmTripped' which must be monitored and reset from 
-//  the non-interrupt space - i.e. in loop()
+//  Queues a timestamped event in the library's event ring, which alarmTask() drains
+//  with serviceAlarms(events, n), and wakes that task. Nothing else - keep ISRs short
 ////////////////////////////////////////////////////////////////////////////////////
 void alarmHandler(){
-  alarmTripped = true;
+  DS3231_TRACE_SCOPE(TRACE_ALARM_ISR);
+  alarmEventISR();
+  wakeTask(TASK_ALARMS);
 }
 
 /////////////////////////////////////////////////////////////////////////
-// displayAlarm(which) called from loop()
+// showPendingAlarm() - called from alarmTask() and goHome()
+// Shows the lowest numbered alarm that has gone off and not been shown
+/////////////////////////////////////////////////////////////////////////
+void showPendingAlarm(){
+  if(pendingAlarms & 1) {
+    #ifdef DEBUG
+    Serial.println(F("Alarm 1 Tripped"));
+    #endif
+    pendingAlarms &= ~1;
+    displayAlarm(1);
+  }
+  else if(pendingAlarms & 2) {
+    #ifdef DEBUG
+    Serial.println(F("Alarm 2 Tripped"));
+    #endif
+    pendingAlarms &= ~2;
+    displayAlarm(2);
+  }
+}
+/////////////////////////////////////////////////////////////////////////
+// displayAlarm(which) called from showPendingAlarm()
 // Implements action taken when an alarm is reached
 // @which - which alarm was reached
 // TODO: Rewrite for your hardware - buzzer, lights, etc
-// Note: My program flow is to stay in this routine until
-//       the alarm is cancelled by user. If you want to return to 
-//       loop() instead, set your alarm indicators here and return, 
-//       then create a different function to cancel the alarm 
-//       based on whatever user input you're using (i.e. button press)
+// Note: My program flow is to flash the screen (flashTask()) until
+//       the alarm is cancelled by the user in alarmTouched(). The
+//       clock keeps running underneath, it's just not shown
 /////////////////////////////////////////////////////////////////////////
 void displayAlarm(uint8_t which){
-  bool cancelled = false;
-  bool inverted = false;
+  char setting[ALARM_CHARS + 1];
   lcd.Fill_Screen(ORANGE);
   lcd.Set_Text_colour(BLUE);
   lcd.Set_Text_Size(5);
   if(which == 1)
-    lcd.Print_String("ALARM 1",CENTER,1);
+    printFlash(PSTR("ALARM 1"),CENTER,1);
   else if(which == 2)
-    lcd.Print_String("ALARM 2",CENTER,1);
-  lcd.Set_Draw_color(WHITE);
-  lcd.Fill_Round_Rectangle(100,100,380,200,10);
-  lcd.Set_Text_Back_colour(WHITE);
-  lcd.Set_Text_Size(4);
-  lcd.Print_String("Cancel",170,110);
-  lcd.Print_String("Alarm",180,150);
-
-  do {
-    lcd.Invert_Display(inverted);
-    inverted = !inverted;
-    digitalWrite(13, HIGH);
-    TSPoint p = ts.getPoint();
-    digitalWrite(13, LOW);
-    pinMode(XM, OUTPUT);
-    pinMode(YP, OUTPUT);
-    if (p.z > MINPRESSURE && p.z < MAXPRESSURE)
-    {
-      p.x = map(p.x, TS_MINX, TS_MAXX, w,0);
-      p.y = map(p.y, TS_MINY, TS_MAXY, h,0);
-      if(is_pressed(100,100,380,200,p.x,p.y)) { //Cancel Alarm button
-        cancelled = true;
-      }
-    }//end if(pressure)
-    delay(200);
-  }while(!cancelled);
-  lcd.Invert_Display(0);
-  lcd.Fill_Screen(BLACK);
-  drawButtons();
+    printFlash(PSTR("ALARM 2"),CENTER,1);
+  //What it was set for, under the title
+  lcd.Set_Text_Size(2);
+  lcd.Print_String((const uint8_t *)formatAlarm(setting, sizeof(setting), readAlarm(which)),CENTER,60);
+  screen = SCREEN_ALARM;
+  drawScreenButtons();
+  flashInverted = false;
+  runTaskIn(TASK_FLASH, 0);
+}
+void alarmTouched(uint8_t button){
+  if(button == BTN_CANCEL_ALARM) {
+    stopTask(TASK_FLASH);
+    lcd.Invert_Display(0);
+    goHome();
+  }
 }
 
 /////////////////////////////////////////////////////////////////////////////
-// showAlarmStatus(data) - called from loop() and drawButtons()
+// showAlarmStatus(data) - called from buttonPressed() and drawButtons()
 // TODO: Rewrite this for your hardware - indicate which alarm(s) are enabled
 // @data = 0= Both alarms are disabled; 1=Alarm 1 enabled, Alarm 2 disabled;
 //         2=Alarm 1 disbaled, Alarm 2 enabled;  3= Both alarms enabled
 /////////////////////////////////////////////////////////////////////////////
 void showAlarmStatus(uint8_t data){
   #ifdef DEBUG
-  Serial.print("showAlarmStatus: called. Was passed: "); Serial.println(data,BIN);
+  Serial.print(F("showAlarmStatus: called. Was passed: ")); Serial.println(data,BIN);
   #endif
   if(data & 0x01) { //alarm 1 is on
       lcd.Set_Text_Back_colour(RED);
       lcd.Set_Text_colour(WHITE);
       lcd.Set_Text_Size(2);
-      lcd.Print_String(" Alarm 1 On ",20,300);
+      printFlash(PSTR(" Alarm 1 On "),20,300);
   }
   else{ //Alarm 1 is off
       lcd.Set_Text_Back_colour(BLACK);
       lcd.Set_Text_colour(DARKGRAY);
       lcd.Set_Text_Size(2);
-      lcd.Print_String(" Alarm 1 Off",20,300);
+      printFlash(PSTR(" Alarm 1 Off"),20,300);
   }
   if(data & 0x02) { //alarm 2 is on
       lcd.Set_Text_Back_colour(BLUE);
       lcd.Set_Text_colour(WHITE);
       lcd.Set_Text_Size(2);
-      lcd.Print_String(" Alarm 2 On ",200,300);
+      printFlash(PSTR(" Alarm 2 On "),200,300);
   }
   else{ //Alarm 2 is off
     lcd.Set_Text_Back_colour(BLACK);
       lcd.Set_Text_colour(DARKGRAY);
       lcd.Set_Text_Size(2);
-      lcd.Print_String(" Alarm 2 Off",200,300);
+      printFlash(PSTR(" Alarm 2 Off"),200,300);
   }
 }
 ////////////////////////////////////////////////////////////
@@ -831,104 +1550,113 @@ void initializeDisplay() {
   w = lcd.Get_Display_Width();    //setting global h & w variables so they're accesible elsewhere
   h = lcd.Get_Display_Height();
   #ifdef DEBUG
-  Serial.print("initializeDisplay: LCD Model: "); Serial.println(lcd.Read_ID(),HEX);
-  Serial.print("initializeDisplay: Display width: "); Serial.print(w); Serial.print("\tHeight: "); Serial.println(h);
+  Serial.print(F("initializeDisplay: LCD Model: ")); Serial.println(lcd.Read_ID(),HEX);
+  Serial.print(F("initializeDisplay: Display width: ")); Serial.print(w); Serial.print(F("\tHeight: ")); Serial.println(h);
   #endif
   drawButtons();
 }
 ///////////////////////////////////////////////////////////////////////////////
-// drawButtons() - draws menu buttons on LCD - called from initializeDisplay
+// drawButtons() - draws the homeButtons table - called from initializeDisplay
 //                 and when returning to home display. Also updates alarm
 //                 on/off indicators which are on home screen.
 // TODO: Rewrite for your hardware - this makes sure the user can access menu
 //       functions.
 ///////////////////////////////////////////////////////////////////////////////
 void drawButtons(){
-
-  lcd.Set_Text_colour(BLACK);
-  lcd.Set_Text_Size(2); //1=smallest, 5=largest
-  lcd.Set_Draw_color(GREEN);
-  lcd.Fill_Round_Rectangle(400,0,480,80,10);
-  lcd.Set_Text_Back_colour(GREEN);
-  lcd.Print_String("Set",422,15);
-  lcd.Print_String("Time",415,45);
-  
-  lcd.Set_Text_colour(WHITE);
-  lcd.Set_Draw_color(RED);
-  lcd.Fill_Round_Rectangle(400,80,480,160,10);
-  lcd.Set_Text_Back_colour(RED);
-  lcd.Print_String("Set",422,85);
-  lcd.Print_String("Alarm",410,110);
-  lcd.Print_String("1",435,135);
-
-  lcd.Set_Draw_color(BLUE);
-  lcd.Fill_Round_Rectangle(400,160,480,240,10);
-  lcd.Set_Text_colour(WHITE);
-  lcd.Set_Text_Back_colour(BLUE);
-  lcd.Print_String("Set",422,165);
-  lcd.Print_String("Alarm",410,190);
-  lcd.Print_String("2",435,215);
-  
-  lcd.Set_Draw_color(YELLOW);
-  lcd.Fill_Round_Rectangle(400,240,480,320,10);
-  lcd.Set_Text_Back_colour(YELLOW);
-  lcd.Set_Text_colour(BLACK);
-  lcd.Print_String("Alarm",413,255);
-  lcd.Print_String("On/Off",407,285);
-
+  drawScreenButtons();
   showAlarmStatus(getAlarmStatus());
+  //Home screen was just redrawn, time & date need drawing in full
+  invalidateTimeDateDisplay();
+}
+///////////////////////////////////////////////////////////////////////////////////////
+// drawScreenButtons() - draws every button in the current screen's table
+// drawButton(b) - draws one, already copied out of flash, its label centered line by line
+// TODO: Rewrite for your display
+///////////////////////////////////////////////////////////////////////////////////////
+void drawScreenButtons(){
+  ButtonTable table;
+  Button b;
+  memcpy_P(&table, &screenButtons[screen], sizeof(table));
+  for(uint8_t i = 0; i < table.count; i++) {
+    memcpy_P(&b, &table.buttons[i], sizeof(b));
+    drawButton(b);
+  }
+}
+void drawButton(const Button &b){
+  char text[24];
+  char line[24];
+  const char *label = text;
+  uint8_t lines = 1;
+  uint8_t n;
+  int16_t pitch = 8 * b.textSize + 12;      //text is 8 pixels high times its size
+  int16_t y;
+  lcd.Set_Draw_color(b.color);
+  switch(b.shape) {
+    case SHAPE_ROUND_RECT: lcd.Fill_Round_Rectangle(b.x1,b.y1,b.x2,b.y2,10);
+                           break;
+    case SHAPE_UP:         lcd.Fill_Triangle(b.x1,b.y2,(b.x1+b.x2)/2,b.y1,b.x2,b.y2);
+                           return;
+    case SHAPE_DOWN:       lcd.Fill_Triangle(b.x1,b.y1,(b.x1+b.x2)/2,b.y2,b.x2,b.y1);
+                           return;
+    case SHAPE_NEXT:       lcd.Fill_Triangle(b.x1,b.y1,b.x2,(b.y1+b.y2)/2,b.x1,b.y2);
+                           return;
+  }
+  strncpy_P(text, b.label, sizeof(text) - 1);
+  text[sizeof(text) - 1] = '\0';
+  for(n = 0; label[n]; n++)
+    lines += label[n] == '\n';
+  lcd.Set_Text_colour(b.textColor);
+  lcd.Set_Text_Back_colour(b.color);
+  lcd.Set_Text_Size(b.textSize);
+  y = (b.y1 + b.y2 - lines * pitch + 12) / 2;
+  while(*label) {
+    for(n = 0; label[n] && label[n] != '\n' && n < sizeof(line) - 1; n++)
+      line[n] = label[n];
+    line[n] = '\0';
+    //each character is 6 pixels wide times the text size
+    lcd.Print_String((const uint8_t *)line, (b.x1 + b.x2 - n * 6 * b.textSize) / 2, y);
+    label += n;
+    if(*label == '\n')
+      label++;
+    y += pitch;
+  }
+}
+///////////////////////////////////////////////////////////////////////////////////////
+// hitTest(x, y) - which button of the current screen is at x, y (display
+//                 coordinates), BTN_NO_BUTTON if none - called from touchTask()
+///////////////////////////////////////////////////////////////////////////////////////
+uint8_t hitTest(int16_t x, int16_t y){
+  DS3231_TRACE_SCOPE(TRACE_HIT_TEST);
+  ButtonTable table;
+  Button b;
+  memcpy_P(&table, &screenButtons[screen], sizeof(table));
+  for(uint8_t i = 0; i < table.count; i++) {
+    memcpy_P(&b, &table.buttons[i], sizeof(b));
+    if(is_pressed(b.x1, b.y1, b.x2, b.y2, x, y))
+      return b.id;
+  }
+  return BTN_NO_BUTTON;
 }
 ///////////////////////////////////////////////////////////////////////////////////////
-// check_button_press() - checks for pressure on button areas, returns button
-//                        pressed or 0 (BTN_NO_BUTTON) if no button pressed - 
-//                        called in main loop
-// TODO: Rewrite for your hardware - look for user input, return 0 for none or
-//       a value representing the specific input        
+// bool readTouch(p) - called from touchTask()
+// @p - receives the touch, in display coordinates (see TS_LEFT etc.)
+// returns true if the screen is being pressed
+// TODO: Rewrite for your hardware
 ///////////////////////////////////////////////////////////////////////////////////////
-uint8_t check_button_press(){
-  uint8_t button_pressed = BTN_NO_BUTTON;
-  //Adapted "Touchscreen" library code to check for presses on buttons drawn in drawButtons()
+bool readTouch(TSPoint *p){
+  DS3231_TRACE_SCOPE(TRACE_TOUCH_SCAN);
+  int16_t rawX;
   digitalWrite(13, HIGH);
-  TSPoint p = ts.getPoint();
+  *p = ts.getPoint();
   digitalWrite(13, LOW);
+  //The touchscreen shares these pins with the LCD, put them back
   pinMode(XM, OUTPUT);
   pinMode(YP, OUTPUT);
-  if (p.z > MINPRESSURE && p.z < MAXPRESSURE)
-  {
-    p.x = map(p.x, TS_MINX, TS_MAXX, w,0);
-    p.y = map(p.y, TS_MINY, TS_MAXY, h,0);
-    if(is_pressed(0,0,120,50,p.x,p.y)) { //Set Time button
-      #ifdef DEBUG
-      Serial.println("check_button_press: Pressed Set Time");
-      #endif
-      button_pressed = BTN_SET_TIME;
-    }
-    else if(is_pressed(121,00,240,50,p.x,p.y)) { //Set Alarm 1 button
-      #ifdef DEBUG
-      Serial.println("check_button_press: Pressed Set Alarm 1");
-      #endif
-      button_pressed = BTN_SET_ALARM_1;
-    }
-    else if(is_pressed(241,0,360,50,p.x,p.y)){
-      #ifdef DEBUG
-      Serial.println("check_button_press: Pressed Set Alarm 2");
-      #endif
-      button_pressed = BTN_SET_ALARM_2;
-    }
-    else if(is_pressed(361,0,480,50,p.x,p.y)){
-      #ifdef DEBUG
-      Serial.println("check_button_press: Pressed Alarm On/Off");
-      #endif
-      button_pressed = BTN_ALARM_TOGGLE;
-    }
-    #ifdef DEBUG
-    else {  //Pressed outside a button
-      Serial.print("check_button_press: Pressed at X: "); Serial.print(p.x); Serial.print("\tY: "); Serial.print(p.y); Serial.print("\tZ: "); Serial.println(p.z);
-    }
-    #endif
-    delay(200); //Debounce delay
-  }
-  return button_pressed;
+  //Display is rotated, touchscreen isn't - see TS_LEFT
+  rawX = p->x;
+  p->x = map(p->y, TS_LEFT, TS_RIGHT, 0, w);
+  p->y = map(rawX, TS_TOP, TS_BOTTOM, 0, h);
+  return p->z > MINPRESSURE && p->z < MAXPRESSURE;
 }
 ////////////////////////////////////////////////////////////////////////////////////
 // bool is_pressed(x1, y1, x2, y2, pressed_x, pressed_y) 
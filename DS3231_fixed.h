@@ -0,0 +1,93 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  DS3231_fixed.h                                                        ***
+***	 Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#ifndef _DS3231_FIXED_H
+#define _DS3231_FIXED_H
+
+#include "DS3231_tisc.h"
+
+//If your clock only ever runs in one of 12 or 24 hour mode, use these instead of
+//readTime(), setTime() etc. The mode is a template parameter, so the compiler drops
+//the code for the other mode, and there is no 'twelveHourMode' to check at runtime.
+//  typedef DS3231Fixed<HourMode::H24> Clock;
+//  Clock::setDateTime(dt);
+//  Time t = Clock::readTime();
+//The DS3231 must be keeping time in the same mode - Clock::setTime() or
+//Clock::setDateTime() puts it in that mode.
+//Reads are checked as readDateTimeChecked() is, and fill in all the hour fields -
+//the hours register is decoded the mode's way, the other fields worked out from it.
+//(Named DS3231Fixed, not DS3231, so it doesn't clash with the DS3231 driver class)
+
+enum class HourMode : uint8_t { H12, H24 };
+
+template<HourMode MODE>
+class DS3231Fixed {
+	public:
+	//Hours register value for t, bit 7 clear
+	static constexpr uint8_t hourRegister(Time t) {
+		return MODE == HourMode::H12
+			? (uint8_t)(bcdEncode(t.hour12) | 0x40 | (t.pm ? 0x20 : 0))
+			: bcdEncode(t.hour24);
+	}
+	//Decodes registers 0x00-0x02, all of hour24, hour12 and pm
+	static Time decodeTime(const uint8_t *regs) {
+		Time t;
+		t.second = bcdDecode(regs[DS3231_SECONDS]);
+		t.minute = bcdDecode(regs[DS3231_MINUTES]);
+		if(MODE == HourMode::H12) {
+			t.hour12 = bcdDecode(regs[DS3231_HOURS] & 0x1f);
+			t.pm = regs[DS3231_HOURS] & 0x20;
+			t.hour24 = t.hour12 % 12 + (t.pm ? 12 : 0);	//12 AM is hour 0
+		}
+		else {
+			t.hour24 = bcdDecode(regs[DS3231_HOURS] & 0x3f);
+			_setHour12(&t);
+		}
+		return t;
+	}
+	//One checked burst read of 0x00-0x06, as readDateTimeChecked(). If it
+	//fails, the last good time & date - see ds3231LastError()
+	static DateTime readDateTime(void) {
+		uint8_t regs[7];
+		if(_readDateTimeRegisters(&_ds3231, regs) == DS3231_OK) {
+			_ds3231.lastGood.t = decodeTime(regs);
+			_ds3231.lastGood.d.weekday = bcdDecode(regs[DS3231_DAY]);
+			_ds3231.lastGood.d.date = bcdDecode(regs[DS3231_DATE]);
+			_ds3231.lastGood.d.month = bcdDecode(regs[DS3231_CEN_MONTH] & 0x1f);
+			_ds3231.lastGood.d.year = bcdDecode(regs[DS3231_DEC_YEAR]) + ((regs[DS3231_CEN_MONTH] & 0x80) ? 2100 : 2000);
+		}
+		return _ds3231.lastGood;
+	}
+	//The time from readDateTime() - the date comes in the same burst, so
+	//it's checked the same way
+	static Time readTime(void) {
+		return readDateTime().t;
+	}
+	//One write of 0x00-0x02, returns DS3231_OK or DS3231_ERR_...
+	static uint8_t setTime(Time t) {
+		uint8_t regs[3];
+		regs[DS3231_SECONDS] = bcdEncode(t.second);
+		regs[DS3231_MINUTES] = bcdEncode(t.minute);
+		regs[DS3231_HOURS] = hourRegister(t);
+		return _writeClock(&_ds3231, DS3231_SECONDS, regs, 3, JOURNAL_SET_TIME);
+	}
+	//One write of 0x00-0x06, same
+	static uint8_t setDateTime(DateTime dt) {
+		uint8_t regs[7];
+		regs[DS3231_SECONDS] = bcdEncode(dt.t.second);
+		regs[DS3231_MINUTES] = bcdEncode(dt.t.minute);
+		regs[DS3231_HOURS] = hourRegister(dt.t);
+		_dateRegisters(dt.d, &regs[DS3231_DAY]);
+		return _writeClock(&_ds3231, DS3231_SECONDS, regs, 7, JOURNAL_SET_DATETIME);
+	}
+	//One write, and unlike setAlarm() no read of the hours register to find the mode
+	static void setAlarm(AlarmSetting a) {
+		uint8_t regs[4];
+		uint8_t reg = encodeAlarm(a, MODE == HourMode::H12, regs);
+		writeRegisters(reg, regs, reg == DS3231_ALARM1_SECONDS ? 4 : 3);
+	}
+};
+
+#endif
@@ -0,0 +1,261 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  DS3231_journal.cpp                                                    ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#include <stdint.h>   //include standard typdef definitions
+#include <Arduino.h>  //include Arduino core for millis() and micros()
+#include <Wire.h>     //include Arduino serial library for I2C
+#include "DS3231_tisc.h"  //include header for the DS3231 library
+#include "DS3231_trace.h" //DS3231_TRACE_SCOPE(), empty unless DS3231_TRACE is defined
+#include "DS3231_journal.h"  //include header for this file
+
+//The head page, as it will be written: records go straight in here
+uint8_t _journalBlock[JOURNAL_BLOCK_BYTES];
+bool _journalDirty = false;			//_journalBlock has records the EEPROM doesn't
+uint32_t _journalDirtySince;		//millis() of the first of them
+bool _journalWriting = false;		//a write cycle may still be running
+uint32_t _journalWriteStart;		//micros() it started
+JournalStats _journalStats = {false, 0, 0, 0, 0, 0, 0, 0};
+
+/*****************************************************************
+* journalBegin()
+* Call from setup(), after Wire.begin(). Checks the EEPROM answers
+* (allowing it JOURNAL_WRITE_MICROS to finish a write it was in the
+* middle of when the Arduino was reset),
+* finds the newest page by binary search and carries on filling it,
+* then hooks into the library (setJournalHook()) and adds a
+* JOURNAL_START record.
+* @return - false if nothing answered at JOURNAL_ADDR, the journal
+*           stays off
+*****************************************************************/
+bool journalBegin(void) {
+	uint16_t low = 0;
+	uint16_t high = JOURNAL_PAGES - 1;
+	uint16_t mid;
+	uint16_t first;
+	//If the Arduino was reset in the middle of a page write it's still busy, so poll
+	_journalWriting = true;
+	_journalWriteStart = micros();
+	if(!_journalReady())
+		return false;
+	_journalStats.present = true;
+	if(!_journalReadPage(0, _journalBlock)) {
+		//Nothing written yet, start at page 0
+		memset(_journalBlock, 0, sizeof(_journalBlock));
+		_journalStats.head = 0;
+	}
+	else {
+		//Pages 0..head follow on from page 0's sequence, the rest are a lap older or empty
+		first = _journalSequence(_journalBlock);
+		while(low < high) {
+			mid = (low + high + 1) / 2;
+			if(_journalReadPage(mid, _journalBlock) && _journalSequence(_journalBlock) == (uint16_t)(first + mid))
+				low = mid;
+			else
+				high = mid - 1;
+		}
+		_journalReadPage(low, _journalBlock);
+		_journalStats.head = low;
+		if(_journalBlock[2] >= JOURNAL_PAGE_RECORDS)
+			_journalNextPage();
+	}
+	_journalStats.sequence = _journalSequence(_journalBlock);
+	setJournalHook(journalRecord);
+	journalRecord(JOURNAL_START, 0);
+	return true;
+}
+/*****************************************************************
+* journalRecord(event, data)
+* Stamps the record with the DS3231's time - the software clock's
+* if it's running, except after the clock was just set, when that
+* hasn't caught up yet - and adds it to the head page in RAM. A
+* full page is written straight away, anything less waits for
+* journalService() or journalFlush().
+* @event - JOURNAL_..., your own from JOURNAL_USER up
+* @data - whatever goes with it
+*****************************************************************/
+void journalRecord(uint8_t event, uint8_t data) {
+	uint8_t *rec;
+	uint32_t epoch;
+	if(!_journalStats.present)
+		return;
+	if(event >= JOURNAL_SET_TIME && event <= JOURNAL_SET_DATETIME)
+		epoch = dateTimeToEpoch(readDateTime());
+	else
+		epoch = dateTimeToEpoch(currentDateTime());
+	rec = &_journalBlock[3 + _journalBlock[2] * JOURNAL_RECORD_BYTES];
+	rec[0] = event;
+	rec[1] = data;
+	rec[2] = epoch;
+	rec[3] = epoch >> 8;
+	rec[4] = epoch >> 16;
+	rec[5] = epoch >> 24;
+	_journalBlock[2]++;
+	_journalStats.records++;
+	_journalStats.buffered++;
+	if(!_journalDirty)
+		_journalDirtySince = millis();
+	_journalDirty = true;
+	if(_journalBlock[2] == JOURNAL_PAGE_RECORDS) {
+		journalFlush();
+		_journalNextPage();
+	}
+}
+/*****************************************************************
+* journalService()
+* Call from loop(), or every second or so. Writes a part-full head
+* page once its first unwritten record is JOURNAL_FLUSH_MILLIS old,
+* so a power cut loses at most that much. The page is written again
+* as it fills, so it's the only one that takes more than one write
+* per lap.
+*****************************************************************/
+void journalService(void) {
+	if(_journalDirty && millis() - _journalDirtySince >= JOURNAL_FLUSH_MILLIS)
+		journalFlush();
+}
+/*****************************************************************
+* journalFlush()
+* Writes the head page if it has records the EEPROM doesn't. Call
+* before anything that will cut the power.
+* @return - false if the EEPROM didn't take it
+*****************************************************************/
+bool journalFlush(void) {
+	if(!_journalDirty)
+		return true;
+	_journalDirty = false;
+	_journalStats.buffered = 0;
+	if(_journalWritePage(_journalStats.head, _journalBlock))
+		return true;
+	_journalStats.failures++;
+	return false;
+}
+/*****************************************************************
+* journalRead(back, rec)
+* @back - how many records back from the newest, 0 = the newest.
+*         Buffered records count, they're read from RAM
+* @rec - receives it
+* @return - false if there's no record that far back
+*****************************************************************/
+bool journalRead(uint16_t back, JournalRecord *rec) {
+	uint8_t block[JOURNAL_BLOCK_BYTES];
+	const uint8_t *src = _journalBlock;
+	uint16_t pages;
+	uint8_t slot;
+	if(!_journalStats.present)
+		return false;
+	if(back < _journalBlock[2]) {
+		slot = _journalBlock[2] - 1 - back;
+	}
+	else {
+		back -= _journalBlock[2];
+		pages = 1 + back / JOURNAL_PAGE_RECORDS;
+		slot = JOURNAL_PAGE_RECORDS - 1 - back % JOURNAL_PAGE_RECORDS;
+		if(pages >= JOURNAL_PAGES)
+			return false;
+		if(!_journalReadPage((_journalStats.head + JOURNAL_PAGES - pages) % JOURNAL_PAGES, block))
+			return false;
+		if(_journalSequence(block) != (uint16_t)(_journalStats.sequence - pages) || slot >= block[2])
+			return false;		//older than the oldest
+		src = block;
+	}
+	src += 3 + slot * JOURNAL_RECORD_BYTES;
+	rec->event = src[0];
+	rec->data = src[1];
+	rec->epoch = src[2] | ((uint32_t)src[3] << 8) | ((uint32_t)src[4] << 16) | ((uint32_t)src[5] << 24);
+	return true;
+}
+JournalStats getJournalStats(void) {
+	return _journalStats;
+}
+/*****************************************************************
+* _journalNextPage()
+* The head page is full: the next one (round to page 0 after the
+* last) becomes the head, with the next sequence number and no
+* records
+*****************************************************************/
+void _journalNextPage(void) {
+	uint16_t sequence = _journalSequence(_journalBlock) + 1;
+	_journalStats.head = (_journalStats.head + 1) % JOURNAL_PAGES;
+	_journalStats.sequence = sequence;
+	memset(_journalBlock, 0, sizeof(_journalBlock));
+	_journalBlock[0] = sequence;
+	_journalBlock[1] = sequence >> 8;
+}
+uint16_t _journalSequence(const uint8_t *block) {
+	return block[0] | (block[1] << 8);
+}
+/*****************************************************************
+* _journalReady()
+* After a page write the EEPROM doesn't answer its address until
+* the write cycle is done (up to JOURNAL_WRITE_MICROS). Rather than
+* wait that out after every write, this is called before the next
+* access and only waits for what's left of it - usually nothing.
+* @return - false if it never answered
+*****************************************************************/
+bool _journalReady(void) {
+	if(!_journalWriting)
+		return true;
+	do {
+		Wire.beginTransmission(JOURNAL_ADDR);
+		if(Wire.endTransmission() == 0) {
+			_journalWriting = false;
+			return true;
+		}
+		_journalStats.ackPolls++;
+	} while(micros() - _journalWriteStart < JOURNAL_WRITE_MICROS);
+	_journalWriting = false;
+	return false;
+}
+/*****************************************************************
+* _journalReadPage(page, block)
+* @block - receives the JOURNAL_BLOCK_BYTES used of the page
+* @return - true if it read and the check byte adds up
+*****************************************************************/
+bool _journalReadPage(uint16_t page, uint8_t *block) {
+	DS3231_TRACE_SCOPE(TRACE_JOURNAL_READ);
+	uint16_t addr = page * JOURNAL_PAGE_BYTES;
+	uint8_t sum = 0;
+	uint8_t i = 0;
+	if(!_journalReady())
+		return false;
+	Wire.beginTransmission(JOURNAL_ADDR);
+	Wire.write(addr >> 8);			//12 bit address, high byte first
+	Wire.write(addr & 0xff);
+	if(Wire.endTransmission() != 0)
+		return false;
+	Wire.requestFrom(JOURNAL_ADDR, JOURNAL_BLOCK_BYTES);
+	while(i < JOURNAL_BLOCK_BYTES && Wire.available()) {
+		block[i] = Wire.read();
+		sum += block[i++];
+	}
+	return i == JOURNAL_BLOCK_BYTES && sum == 0 && block[2] <= JOURNAL_PAGE_RECORDS;
+}
+/*****************************************************************
+* _journalWritePage(page, block)
+* Fills in block's check byte and writes it to the start of page in
+* one transaction. Returns as soon as the EEPROM has the data - its
+* write cycle runs on while the bus does other things
+* @return - false if the EEPROM didn't ACK it
+*****************************************************************/
+bool _journalWritePage(uint16_t page, uint8_t *block) {
+	DS3231_TRACE_SCOPE(TRACE_JOURNAL_WRITE);
+	uint16_t addr = page * JOURNAL_PAGE_BYTES;
+	uint8_t sum = 0;
+	uint8_t i;
+	for(i = 0; i < JOURNAL_BLOCK_BYTES - 1; i++)
+		sum += block[i];
+	block[JOURNAL_BLOCK_BYTES - 1] = -sum;
+	if(!_journalReady())
+		return false;
+	Wire.beginTransmission(JOURNAL_ADDR);
+	Wire.write(addr >> 8);
+	Wire.write(addr & 0xff);
+	Wire.write(block, JOURNAL_BLOCK_BYTES);
+	if(Wire.endTransmission() != 0)
+		return false;
+	_journalWriting = true;
+	_journalWriteStart = micros();
+	_journalStats.pageWrites++;
+	return true;
+}
@@ -0,0 +1,79 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  DS3231_journal.h                                                      ***
+***	 Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#ifndef _DS3231_JOURNAL_H
+#define _DS3231_JOURNAL_H
+
+#include <Arduino.h>
+#include "DS3231_tisc.h"
+
+//Event journal in the AT24C32 EEPROM most DS3231 modules carry at 0x57. Once
+//journalBegin() has found it, every alarm the library services and every time the
+//clock is set (see setJournalHook()) goes in, stamped with the DS3231's time, and
+//stays there through power loss.
+//
+//The EEPROM is used as a ring of pages, written in order and round again, so every
+//page wears the same. Records collect in RAM and go out a page at a time - one
+//transaction for up to 4 records instead of one per byte - and the EEPROM's write
+//cycle isn't waited out with a delay: the next journal access polls for its ACK,
+//so the bus is free for the DS3231 in the meantime.
+//
+//Page (JOURNAL_BLOCK_BYTES of each 32 byte page are used, 2 address bytes + 28 fit
+//in Wire's 32 byte buffer):
+//  sequence u16 | count u8 | 4 x record | check
+//  record = event u8, data u8, epoch u32 (little endian)
+//  check makes the 28 bytes add up to 0 (mod 256), so erased (0xff) or torn pages
+//  don't count
+//Each page's sequence is one more than the page before it, so at startup the newest
+//page is found by binary search - the first page whose sequence doesn't follow on
+//from page 0's - in 7 reads instead of 128.
+
+#define JOURNAL_ADDR 0x57			//AT24C32 with A0-A2 pulled high, as on most modules
+#ifndef JOURNAL_PAGES
+#define JOURNAL_PAGES 128			//AT24C32: 4096 bytes, must be a power of 2. #define before including to change
+#endif
+#define JOURNAL_PAGE_BYTES 32		//EEPROM page, a write can't cross one
+#define JOURNAL_BLOCK_BYTES 28		//what's used of each page
+#define JOURNAL_PAGE_RECORDS 4
+#define JOURNAL_RECORD_BYTES 6
+#define JOURNAL_WRITE_MICROS 20000UL	//longest EEPROM write cycle to poll through
+#define JOURNAL_FLUSH_MILLIS 5000	//journalService() writes a part-full page once it's had a record this long
+
+//Events - 1-15 are the library's (see JOURNAL_ALARM etc. in DS3231_tisc.h), sketches number theirs from JOURNAL_USER
+#define JOURNAL_START 15			//journalBegin() was called - power up, usually
+#define JOURNAL_USER  16
+
+class JournalRecord {
+	public:
+	uint8_t event;		//JOURNAL_...
+	uint8_t data;		//depends on event
+	uint32_t epoch;		//DS3231 time it happened, Unix time
+};
+
+class JournalStats {
+	public:
+	bool present;			//journalBegin() found the EEPROM
+	uint16_t head;			//page records are going in to
+	uint16_t sequence;		//its sequence number
+	uint8_t buffered;		//records in RAM not written yet
+	uint32_t records;		//records added since journalBegin()
+	uint32_t pageWrites;	//page writes since journalBegin()
+	uint32_t ackPolls;		//times the EEPROM was still busy with the last write
+	uint16_t failures;		//page writes the EEPROM didn't take
+};
+
+//Function prototypes
+bool journalBegin(void);			//Finds the EEPROM and the newest page, starts journaling
+void journalRecord(uint8_t event, uint8_t data);	//Adds a record - the library's hook, sketches can call it too
+void journalService(void);			//Call from loop(), writes a part-full page after JOURNAL_FLUSH_MILLIS
+bool journalFlush(void);			//Writes the buffered records now
+bool journalRead(uint16_t back, JournalRecord *rec);	//back = 0 is the newest record, false past the oldest
+JournalStats getJournalStats(void);
+bool _journalReady(void);			//polls for the ACK that ends a write cycle
+bool _journalReadPage(uint16_t page, uint8_t *block);	//reads a page, true if its check adds up
+bool _journalWritePage(uint16_t page, uint8_t *block);	//fills in the check and writes the page
+uint16_t _journalSequence(const uint8_t *block);
+void _journalNextPage(void);		//moves the head on to an empty block
+#endif
@@ -0,0 +1,358 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  DS3231_multi.cpp                                                      ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#include <stdint.h>   //include standard typdef definitions
+#include <Arduino.h>  //include Arduino core for micros()
+#include <Wire.h>     //include Arduino serial library for I2C
+#include "DS3231_tisc.h"  //include header for the DS3231 library
+#include "DS3231_multi.h"  //include header for this file
+
+DS3231Mux *DS3231Mux::_active = NULL;
+
+/*****************************************************************
+* DS3231Mux(bus, address)
+* @bus - bus the mux is on
+* @address - mux I2C address, TCA9548A_ADDR (0x70) to 0x77
+* Doesn't touch the bus, the first select() writes the mux
+*****************************************************************/
+DS3231Mux::DS3231Mux(DS3231Transport &bus, uint8_t address) {
+	_bus = &bus;
+	_address = address;
+	_selected = MUX_UNKNOWN;
+	switches = 0;
+}
+/*****************************************************************
+* DS3231Mux::select(channel)
+* @channel - 0-7
+* Opens channel and closes the others, with one 1 byte write -
+* or no write at all if channel is already the open one
+* @return - false if the mux didn't ACK
+*****************************************************************/
+bool DS3231Mux::select(uint8_t channel) {
+	uint8_t bit = 1 << (channel & 0x07);
+	if(_active == this && _selected == channel)
+		return true;
+	if(_active != this)
+		deselectActive(_bus);	//another mux's open channel could have a 0x68 on it too
+	switches++;
+	if(_bus->write(_address, bit, NULL, 0)) {
+		_selected = MUX_UNKNOWN;
+		return false;
+	}
+	_selected = channel;
+	_active = this;
+	return true;
+}
+/*****************************************************************
+* DS3231Mux::deselect()
+* Closes all channels
+*****************************************************************/
+void DS3231Mux::deselect(void) {
+	_bus->write(_address, 0, NULL, 0);
+	_selected = MUX_UNKNOWN;
+	if(_active == this)
+		_active = NULL;
+}
+/*****************************************************************
+* DS3231Mux::invalidate()
+* Call if something other than this library wrote the mux
+*****************************************************************/
+void DS3231Mux::invalidate(void) {
+	_selected = MUX_UNKNOWN;
+	if(_active == this)
+		_active = NULL;
+}
+uint8_t DS3231Mux::selected(void) {
+	return _active == this ? _selected : MUX_UNKNOWN;
+}
+DS3231Transport &DS3231Mux::transport(void) {
+	return *_bus;
+}
+/*****************************************************************
+* DS3231Mux::deselectActive(bus)
+* @bus - closes the open channel of whichever mux on this bus
+*        has one, does nothing if none does
+*****************************************************************/
+void DS3231Mux::deselectActive(DS3231Transport *bus) {
+	if(_active && _active->_bus == bus)
+		_active->deselect();
+}
+
+/*****************************************************************
+* DS3231Route::open()
+* Gets the mux(es) out of the way before talking to the clock
+* @return - false if its mux didn't ACK, so the channel isn't open
+*****************************************************************/
+bool DS3231Route::open(void) {
+	if(mux)
+		return mux->select(channel);
+	DS3231Mux::deselectActive(bus);
+	return true;
+}
+/*****************************************************************
+* DS3231Route::write(address, first, buf, len)
+* DS3231Route::read(address, buf, len)
+* See DS3231Transport. If the mux doesn't ACK, the write fails
+* as if the DS3231 hadn't (DS3231_ERR_NACK_ADDRESS) and the read
+* gets nothing
+*****************************************************************/
+uint8_t DS3231Route::write(uint8_t address, uint8_t first, const uint8_t *buf, uint8_t len) {
+	if(!open())
+		return DS3231_ERR_NACK_ADDRESS;
+	return bus->write(address, first, buf, len);
+}
+uint8_t DS3231Route::read(uint8_t address, uint8_t *buf, uint8_t len) {
+	if(!open())
+		return 0;
+	return bus->read(address, buf, len);
+}
+
+/*****************************************************************
+* DS3231() / DS3231(bus, address) / DS3231(mux, channel, address)
+* @bus - bus the DS3231 is on, e.g. DS3231_Wire
+* @mux - mux the DS3231 is behind
+* @channel - mux channel it's on, 0-7
+* @address - DS3231_ADDR unless it's something odd
+* None of them touch the bus. DS3231() is the chip the free
+* functions use, and shares their link: stats, bus health,
+* last good time & date, and setting the time tells the tick
+* clock, register cache, aging controller and journal
+*****************************************************************/
+DS3231::DS3231(void) {
+	_init(&DS3231_Wire, NULL, 0, DS3231_ADDR);
+	_link = &_ds3231;
+}
+DS3231::DS3231(DS3231Transport &bus, uint8_t address) {
+	_init(&bus, NULL, 0, address);
+}
+DS3231::DS3231(DS3231Mux &mux, uint8_t channel, uint8_t address) {
+	_init(&mux.transport(), &mux, channel, address);
+}
+void DS3231::_init(DS3231Transport *bus, DS3231Mux *mux, uint8_t channel, uint8_t address) {
+	_route.bus = bus;
+	_route.mux = mux;
+	_route.channel = channel;
+	_own.bus = &_route;
+	_own.address = address;
+#ifdef DS3231_BUS_STATS
+	_own.stats = BusStats();
+#endif
+	_own.health = BusHealth();
+	_own.lastGood = _ds3231.lastGood;		//2000-01-01, set before any read can have worked
+	_link = &_own;
+	twelveHourMode = false;
+	_polled = false;
+}
+/*****************************************************************
+* DS3231::_use()
+* @return - the clock's link, ready to use. _ds3231 goes straight
+*           to DS3231_Wire, not through the route, so any mux
+*           channel open on Wire is closed first
+*****************************************************************/
+DS3231Link *DS3231::_use(void) {
+	if(_link == &_ds3231)
+		_route.open();
+	return _link;
+}
+uint8_t DS3231::lastError(void) {
+	return _link->health.lastError;
+}
+#ifdef DS3231_BUS_STATS
+BusStats DS3231::getBusStats(void) {
+	return _link->stats;
+}
+#endif
+BusHealth DS3231::getBusHealth(void) {
+	return _link->health;
+}
+/************************************************
+* DS3231::readDateTime()
+* Registers 0x00-0x06 in one burst, checked like
+* readDateTimeChecked(). If that fails (see lastError())
+* it's this clock's last good time & date
+*************************************************/
+DateTime DS3231::readDateTime(void) {
+	DateTime dt;
+	_readDateTimeChecked(_use(), &dt);
+	return dt;
+}
+Time DS3231::readTime(void) {
+	return readDateTime().t;
+}
+Date DS3231::readDate(void) {
+	return readDateTime().d;
+}
+/************************************************
+* DS3231::setTime(t), setDate(d), setDateTime(dt)
+* @t - time to set, stored in 12 or 24 hour mode
+*      according to this clock's twelveHourMode
+* Same single writes as the free functions
+* @return - DS3231_OK or DS3231_ERR_...
+*************************************************/
+uint8_t DS3231::setTime(Time t) {
+	uint8_t regs[3];
+	regs[DS3231_SECONDS] = bcdEncode(t.second);
+	regs[DS3231_MINUTES] = bcdEncode(t.minute);
+	regs[DS3231_HOURS] = _hourRegister(t, twelveHourMode);
+	return _writeClock(_use(), DS3231_SECONDS, regs, 3, JOURNAL_SET_TIME);
+}
+uint8_t DS3231::setDate(Date d) {
+	uint8_t regs[4];
+	_dateRegisters(d, regs);
+	return _writeClock(_use(), DS3231_DAY, regs, 4, JOURNAL_SET_DATE);
+}
+uint8_t DS3231::setDateTime(DateTime dt) {
+	uint8_t regs[7];
+	_dateTimeRegisters(dt, twelveHourMode, regs);
+	return _writeClock(_use(), DS3231_SECONDS, regs, 7, JOURNAL_SET_DATETIME);
+}
+uint32_t DS3231::readEpoch(void) {
+	return dateTimeToEpoch(readDateTime());
+}
+uint8_t DS3231::setEpoch(uint32_t epoch) {
+	return setDateTime(epochToDateTime(epoch));
+}
+/************************************************
+* DS3231::setAlarm(a)
+* @a - see setAlarm(). Reads this clock's hours
+*      register to match its 12/24 hour mode, and
+*      writes nothing if that read fails
+*************************************************/
+void DS3231::setAlarm(AlarmSetting a) {
+	uint8_t regs[4];
+	uint8_t reg;
+	uint8_t hours;
+	if(_readChecked(_use(), DS3231_HOURS, &hours, 1) != DS3231_OK)
+		return;
+	reg = encodeAlarm(a, hours & 0x40, regs);
+	_writeChecked(_link, reg, regs, reg == DS3231_ALARM1_SECONDS ? 4 : 3);
+}
+AlarmSetting DS3231::readAlarm(uint8_t alarm) {
+	uint8_t regs[4] = {0, 0, 0, 0};
+	const AlarmLayout *layout = &_alarmLayout[alarm == 2];
+	readRegisters(layout->firstReg, regs, layout->count);
+	return decodeAlarm(regs, alarm);
+}
+/************************************************
+* DS3231::turnAlarmOn(alarms), turnAlarmOff(alarms)
+* Read-modify-write of CONTROL (and STATUS), so if
+* the read fails nothing is written, see lastError()
+*************************************************/
+void DS3231::turnAlarmOn(uint8_t alarms) {
+	uint8_t regs[2];
+	alarms &= 0x03;
+	if(_readChecked(_use(), DS3231_CONTROL, regs, 2) != DS3231_OK)		//CONTROL and STATUS in one burst
+		return;
+	regs[0] |= alarms;				//enable...
+	regs[1] = (regs[1] | 0x03) & ~alarms;	//...and clear any old flag for them
+	_writeChecked(_link, DS3231_CONTROL, regs, 2);
+}
+void DS3231::turnAlarmOff(uint8_t alarms) {
+	uint8_t control;
+	if(_readChecked(_use(), DS3231_CONTROL, &control, 1) == DS3231_OK)
+		writeRegister(DS3231_CONTROL, control & ~(alarms & 0x03));
+}
+uint8_t DS3231::getAlarmStatus(void) {
+	uint8_t control = 0;		//both off if it can't be read
+	readRegisters(DS3231_CONTROL, &control, 1);
+	return control & 0x03;
+}
+/************************************************
+* DS3231::serviceAlarms()
+* @return - which alarms were tripped (0=none,1,2,3=both),
+*           their flags are cleared. The Alarm 1 hook and
+*           journal are only for the free functions' chip,
+*           so only DS3231() uses them.
+*           0 if STATUS can't be read or the flags can't be
+*           cleared - they're reported when they are
+*************************************************/
+uint8_t DS3231::serviceAlarms(void) {
+	uint8_t status;
+	uint8_t alarms;
+	if(_readChecked(_use(), DS3231_STATUS, &status, 1) != DS3231_OK)
+		return 0;
+	alarms = status & 0x03;
+	if(alarms) {
+		status = (status | 0x03) & ~alarms;		//writing 1 leaves a flag alone
+		if(_writeChecked(_link, DS3231_STATUS, &status, 1) != DS3231_OK)
+			return 0;
+	}
+	return _link == &_ds3231 ? _runAlarm1Hook(alarms) : alarms;
+}
+uint8_t DS3231::readRegister(uint8_t reg) {
+	uint8_t data = 0xff;
+	readRegisters(reg, &data, 1);
+	return data;
+}
+void DS3231::writeRegister(uint8_t reg, uint8_t data) {
+	writeRegisters(reg, &data, 1);
+}
+/************************************************
+* DS3231::readRegisters(reg, buf, len)
+* DS3231::writeRegisters(reg, buf, len)
+* readRegisters()/writeRegisters() for this clock, same
+* retries. lastError() says if they worked
+*************************************************/
+uint8_t DS3231::readRegisters(uint8_t reg, uint8_t *buf, uint8_t len) {
+	return _readChecked(_use(), reg, buf, len) == DS3231_OK ? len : 0;
+}
+void DS3231::writeRegisters(uint8_t reg, const uint8_t *buf, uint8_t len) {
+	_writeChecked(_use(), reg, buf, len);
+}
+/*****************************************************************
+* DS3231::pollAll(clocks, n, readings)
+* @clocks - the clocks to read, any mix of buses and mux channels
+* @n - how many
+* @readings - receives n results, readings[i] from clocks[i]
+* Clocks that can be read without touching a mux go first, then
+* each remaining mux channel is opened once and every clock on it
+* read. Each clock costs one pointer write and one 7 byte burst,
+* more only if it has to be retried.
+* @return - number of clocks that answered
+*****************************************************************/
+uint8_t DS3231::pollAll(DS3231 *const *clocks, uint8_t n, DS3231Reading *readings) {
+	uint8_t i, j;
+	uint8_t answered = 0;
+	for(i = 0; i < n; i++)
+		clocks[i]->_polled = false;
+	for(i = 0; i < n; i++) {		//no mux writes needed for these
+		if(clocks[i]->_reachable())
+			answered += clocks[i]->_pollOne(&readings[i]);
+	}
+	for(i = 0; i < n; i++) {
+		if(clocks[i]->_polled)
+			continue;
+		answered += clocks[i]->_pollOne(&readings[i]);	//opens its channel...
+		for(j = i + 1; j < n; j++) {		//...then everything else on that channel
+			if(!clocks[j]->_polled && clocks[j]->_route.mux == clocks[i]->_route.mux
+				&& clocks[j]->_route.channel == clocks[i]->_route.channel)
+				answered += clocks[j]->_pollOne(&readings[j]);
+		}
+	}
+	return answered;
+}
+/*****************************************************************
+* DS3231::_pollOne(reading)
+* A checked time & date read. If it fails, reading->dt is the
+* clock's last good time & date, never garbage
+* @return - 1 if the clock answered, 0 if not
+*****************************************************************/
+uint8_t DS3231::_pollOne(DS3231Reading *reading) {
+	reading->ok = _readDateTimeChecked(_use(), &reading->dt) == DS3231_OK;
+	reading->micros = micros();
+	_polled = true;
+	return reading->ok;
+}
+/*****************************************************************
+* DS3231::_reachable()
+* @return - true if this clock can be talked to as things are:
+*           its channel is open, or it's not behind a mux and no
+*           mux on its bus has a channel open
+*****************************************************************/
+bool DS3231::_reachable(void) {
+	if(_route.mux)
+		return _route.mux->selected() == _route.channel;
+	return !DS3231Mux::_active || &DS3231Mux::_active->transport() != _route.bus;
+}
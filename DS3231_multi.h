@@ -0,0 +1,143 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  DS3231_multi.h                                                        ***
+***	 Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#ifndef _DS3231_MULTI_H
+#define _DS3231_MULTI_H
+
+#include <Wire.h>
+#include "DS3231_tisc.h"
+
+//The functions in DS3231_tisc.h talk to one DS3231 on Wire. To drive more than one,
+//make a DS3231 object for each. Each one has its own bus, address and 12/24 hour
+//setting, and can sit behind a channel of a TCA9548A I2C mux - all DS3231s have
+//address 0x68, so more than one on a bus needs a mux or separate buses.
+//  DS3231Mux mux(DS3231_Wire);			//TCA9548A on Wire at 0x70
+//  DS3231 rtcA(mux, 0), rtcB(mux, 1);	//one DS3231 on each of channels 0 and 1
+//  DS3231 rtcC(DS3231_Wire1);			//on its own bus, see WireTransport below
+//  DS3231 *clocks[] = {&rtcA, &rtcB, &rtcC};
+//  DS3231Reading readings[3];
+//  DS3231::pollAll(clocks, 3, readings);
+//Every call goes through the same checked reads and writes as the free functions -
+//retries, time & date plausibility and the last good time & date - kept per clock.
+//DS3231() is the free functions' own chip and shares all of that with them.
+
+#define TCA9548A_ADDR 0x70		//with A2-A0 low, up to 0x77
+#define MUX_UNKNOWN   0xff		//DS3231Mux hasn't selected a channel yet
+
+//DS3231Transport (see DS3231_tisc.h) for any object with Wire's beginTransmission()/
+//write()/endTransmission()/requestFrom()/available()/read(), e.g. SoftwareWire. For
+//a TwoWire (Wire1...) use TwoWireTransport, which also knows Wire's timeout
+//  TwoWireTransport DS3231_Wire1(Wire1);
+//  WireTransport<SoftwareWire> softBus(mySoftwareWire);
+//To use a bus that isn't Wire-like at all, e.g. a bit-banged one, implement DS3231Transport
+template<class WIRE>
+class WireTransport : public DS3231Transport {
+	public:
+	WireTransport(WIRE &wire) : _wire(wire) {}
+	uint8_t write(uint8_t address, uint8_t first, const uint8_t *buf, uint8_t len) {
+		_wire.beginTransmission(address);
+		_wire.write(first);
+		if(len)
+			_wire.write(buf, len);
+		return _wire.endTransmission();
+	}
+	uint8_t read(uint8_t address, uint8_t *buf, uint8_t len) {
+		uint8_t i = 0;
+		_wire.requestFrom(address, len);
+		while(i < len && _wire.available())
+			buf[i++] = _wire.read();
+		return i;
+	}
+	private:
+	WIRE &_wire;
+};
+
+//A TCA9548A (or compatible) 8 channel I2C mux. Remembers which channel is open
+//so selecting it again costs nothing. Only one channel is open at a time, and
+//opening one on this mux closes any channel open on another mux on the same bus.
+class DS3231Mux {
+	public:
+	DS3231Mux(DS3231Transport &bus, uint8_t address = TCA9548A_ADDR);
+	bool select(uint8_t channel);	//Opens channel 0-7 (closing the others), false if the mux didn't ACK
+	void deselect(void);			//Closes all channels
+	void invalidate(void);			//Something else wrote the mux, next select() writes it
+	uint8_t selected(void);			//Open channel, MUX_UNKNOWN if none or not known
+	DS3231Transport &transport(void);	//Bus the mux is on
+	uint32_t switches;				//channel changes written to the mux
+	static void deselectActive(DS3231Transport *bus);	//Closes whichever mux on bus has a channel open
+	private:
+	DS3231Transport *_bus;
+	uint8_t _address;
+	uint8_t _selected;
+	static DS3231Mux *_active;		//mux with a channel open, NULL if none
+	friend class DS3231;
+};
+
+//How a DS3231 object gets to its chip: before each transaction its mux channel is
+//opened, or if it isn't behind a mux, any mux channel open on its bus is closed
+class DS3231Route : public DS3231Transport {
+	public:
+	DS3231Transport *bus;
+	DS3231Mux *mux;			//NULL if not behind a mux
+	uint8_t channel;
+	bool open(void);		//false if the mux didn't ACK
+	uint8_t write(uint8_t address, uint8_t first, const uint8_t *buf, uint8_t len);
+	uint8_t read(uint8_t address, uint8_t *buf, uint8_t len);
+};
+
+//One clock's result from DS3231::pollAll()
+class DS3231Reading {
+	public:
+	DateTime dt;			//time & date read, the clock's last good one if !ok
+	uint32_t micros;		//micros() when its burst read finished
+	bool ok;				//false if the clock didn't answer with a real time & date
+};
+
+class DS3231 {
+	public:
+	DS3231(void);		//DS3231_ADDR on the global Wire, same chip as the free functions
+	DS3231(DS3231Transport &bus, uint8_t address = DS3231_ADDR);
+	DS3231(DS3231Mux &mux, uint8_t channel, uint8_t address = DS3231_ADDR);
+	DS3231(const DS3231 &) = delete;	//its link points into it
+	bool twelveHourMode;	//Mode setTime()/setDateTime() store the time in, false by default
+	uint8_t lastError(void);			//DS3231_OK or DS3231_ERR_... from the last read or write
+#ifdef DS3231_BUS_STATS
+	BusStats getBusStats(void);			//Traffic to this clock, mux channel changes not included
+#endif
+	BusHealth getBusHealth(void);		//Latency, retries and failures of calls to this clock
+	DateTime readDateTime(void);		//All time & date registers in one burst, last good one if that fails
+	Time readTime(void);
+	Date readDate(void);
+	uint8_t setTime(Time t);			//One write of 0x00-0x02, returns DS3231_OK or DS3231_ERR_...
+	uint8_t setDate(Date d);			//One write of 0x03-0x06, weekday worked out, same
+	uint8_t setDateTime(DateTime dt);	//One write of 0x00-0x06, same
+	uint32_t readEpoch(void);			//Unix time
+	uint8_t setEpoch(uint32_t epoch);	//Same as setDateTime()
+	void setAlarm(AlarmSetting a);		//Same as the free setAlarm()
+	AlarmSetting readAlarm(uint8_t alarm);	//Alarm 1 or 2 in one burst
+	void turnAlarmOn(uint8_t alarms);	//1=Alarm 1, 2=Alarm 2, 3=both
+	void turnAlarmOff(uint8_t alarms);
+	uint8_t getAlarmStatus(void);		//A1IE and A2IE bits
+	uint8_t serviceAlarms(void);		//Clears and returns the alarm flags, 0 if STATUS couldn't be read
+	uint8_t readRegister(uint8_t reg);
+	void writeRegister(uint8_t reg, uint8_t data);
+	uint8_t readRegisters(uint8_t reg, uint8_t *buf, uint8_t len);	//Returns len, 0 on failure
+	void writeRegisters(uint8_t reg, const uint8_t *buf, uint8_t len);	//len up to 31
+	//Reads n clocks with one burst each, grouped so each mux channel is opened once
+	//at most, clocks on already-open channels first. readings[i] is for clocks[i].
+	//Returns how many answered
+	static uint8_t pollAll(DS3231 *const *clocks, uint8_t n, DS3231Reading *readings);
+	private:
+	DS3231Route _route;		//bus and mux channel
+	DS3231Link _own;		//this clock's link, unless it's the free functions' chip
+	DS3231Link *_link;		//&_own, or &_ds3231 for DS3231()
+	bool _polled;			//pollAll() has read this one already
+	void _init(DS3231Transport *bus, DS3231Mux *mux, uint8_t channel, uint8_t address);
+	DS3231Link *_use(void);	//the link, with the way to the chip cleared
+	bool _reachable(void);	//true if opening the route wouldn't need to write anything
+	uint8_t _pollOne(DS3231Reading *reading);
+};
+
+#endif
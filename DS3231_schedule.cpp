@@ -0,0 +1,323 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  DS3231_schedule.cpp                                                   ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#include <stdint.h>   //include standard typdef definitions
+#include <Arduino.h>  //include Arduino core
+#include "DS3231_tisc.h"  //include header for the DS3231 library
+#include "DS3231_schedule.h"  //include header for this file
+
+/****************************************************************
+* The schedules live in _entries[], indexed by id. The ids that
+* are waiting to fire sit in _heap[], a binary min-heap ordered
+* by _next[id], so the earliest is always _heap[0].
+* _heapPos[id] is where each id is in the heap, so cancelling
+* doesn't have to search for it. Adding, cancelling and firing
+* are all O(log n), finding the next one due is O(1).
+* Times are seconds since 2000-01-01 00:00:00.
+* All of it is static, only reachable through the functions in
+* DS3231_schedule.h.
+****************************************************************/
+#define HEAP_POS_FREE 0xff		//_heapPos[] value for an id not in use
+
+static ScheduleEntry _entries[DS3231_SCHEDULE_SIZE];
+static uint32_t _next[DS3231_SCHEDULE_SIZE];		//when each id next fires
+static uint8_t _heap[DS3231_SCHEDULE_SIZE];		//ids, earliest first
+static uint8_t _heapPos[DS3231_SCHEDULE_SIZE];		//id -> index in _heap[]
+static uint8_t _heapCount = 0;
+static uint8_t _freeIds[DS3231_SCHEDULE_SIZE];	//stack of unused ids
+static uint8_t _freeCount = 0;
+static uint32_t _programmed = 0;		//what's in the Alarm 1 registers now, 0 = nothing
+static ScheduleCallback _scheduleCallback = NULL;
+
+static void _heapPush(uint8_t id);
+static void _heapRemove(uint8_t pos);
+static void _heapSiftUp(uint8_t pos);
+static void _heapSiftDown(uint8_t pos);
+
+/*****************************************************************
+* scheduleBegin(callback)
+* Empties the schedule and takes over Alarm 1. Alarm 1 stays off
+* until a schedule is added.
+* @callback - called with the id of each schedule as it comes due
+*****************************************************************/
+void scheduleBegin(ScheduleCallback callback) {
+	_scheduleCallback = callback;
+	_scheduleClear();
+	turnAlarmOff(1);
+	setAlarm1Hook(_scheduleService);
+}
+/*****************************************************************
+* scheduleEnd()
+* Turns Alarm 1 off and lets serviceAlarms() report it again.
+* Every schedule is dropped, so their ids are free and cancelling
+* one afterwards just returns false
+*****************************************************************/
+void scheduleEnd(void) {
+	setAlarm1Hook(NULL);
+	turnAlarmOff(1);
+	_scheduleClear();
+}
+/*****************************************************************
+* scheduleAdd(e)
+* @e - when to fire, see ScheduleEntry in DS3231_schedule.h
+* @return - id passed to the callback when it fires, SCHEDULE_NONE
+*           if the schedule is full or e will never fire (a one-shot
+*           in the past, or a weekly one with no weekdays set)
+*****************************************************************/
+uint8_t scheduleAdd(ScheduleEntry e) {
+	uint8_t id;
+	uint32_t next;
+	if(!_freeCount)
+		return SCHEDULE_NONE;
+	next = _scheduleNextAfter(&e, _toSeconds(currentDateTime()));
+	if(!next)
+		return SCHEDULE_NONE;
+	id = _freeIds[--_freeCount];
+	_entries[id] = e;
+	_next[id] = next;
+	_heapPush(id);
+	if(_heap[0] == id)		//new earliest
+		_scheduleProgram();
+	return id;
+}
+/*****************************************************************
+* scheduleCancel(id)
+* @id - from scheduleAdd()
+* @return - true if it was removed, false if it wasn't scheduled
+*****************************************************************/
+bool scheduleCancel(uint8_t id) {
+	uint8_t pos;
+	if(id >= DS3231_SCHEDULE_SIZE || _heapPos[id] >= _heapCount)	//HEAP_POS_FREE, or never begun
+		return false;
+	pos = _heapPos[id];
+	_heapRemove(pos);
+	_heapPos[id] = HEAP_POS_FREE;
+	_freeIds[_freeCount++] = id;
+	if(pos == 0)		//it was the one in Alarm 1
+		_scheduleProgram();
+	return true;
+}
+/*****************************************************************
+* scheduleCount()
+* @return - number of schedules waiting to fire
+*****************************************************************/
+uint8_t scheduleCount(void) {
+	return _heapCount;
+}
+/*****************************************************************
+* scheduleNextDue(id, when)
+* @id - receives the id of the earliest schedule
+* @when - receives when it fires
+* @return - false if nothing is scheduled
+*****************************************************************/
+bool scheduleNextDue(uint8_t *id, DateTime *when) {
+	if(!_heapCount)
+		return false;
+	*id = _heap[0];
+	*when = _fromSeconds(_next[_heap[0]]);
+	return true;
+}
+/*****************************************************************
+* scheduleGet(id, e)
+* @id - from scheduleAdd()
+* @e - receives the ScheduleEntry id was added with
+* @return - false if id isn't scheduled (SCHEDULE_NONE, cancelled,
+*           or a one-shot that has fired), e is left alone
+*****************************************************************/
+bool scheduleGet(uint8_t id, ScheduleEntry *e) {
+	if(id >= DS3231_SCHEDULE_SIZE || _heapPos[id] >= _heapCount)	//HEAP_POS_FREE, or never begun
+		return false;
+	*e = _entries[id];
+	return true;
+}
+/*****************************************************************
+* _scheduleService()
+* Alarm 1 hook, runs from serviceAlarms(). Fires everything that's
+* due (the alarm can also trip early - it only matches date, not
+* month - in which case nothing is due and it's just reprogrammed).
+* Repeating schedules go back in the heap before their callback
+* runs, so the callback is free to cancel them or add more.
+*****************************************************************/
+void _scheduleService(void) {
+	uint32_t now;
+	uint32_t next;
+	uint8_t id;
+	uint8_t passes = 0;
+	do {
+		now = _toSeconds(currentDateTime());
+		while(_heapCount && _next[_heap[0]] <= now) {
+			id = _heap[0];
+			_heapRemove(0);
+			next = _scheduleNextAfter(&_entries[id], now);
+			if(next) {
+				_next[id] = next;
+				_heapPush(id);
+			}
+			else {	//one-shot, done with it
+				_heapPos[id] = HEAP_POS_FREE;
+				_freeIds[_freeCount++] = id;
+			}
+			if(_scheduleCallback)
+				_scheduleCallback(id);
+		}
+		_scheduleProgram();
+		//If the callbacks took long enough for the next one to come due, it's
+		//already missed its match in the registers, so go around again
+	} while(_heapCount && _next[_heap[0]] <= _toSeconds(currentDateTime()) && ++passes < 3);
+}
+/*****************************************************************
+* _scheduleClear()
+* Empties the heap and puts every id back on the free stack
+*****************************************************************/
+void _scheduleClear(void) {
+	uint8_t i;
+	_heapCount = 0;
+	_freeCount = 0;
+	for(i = DS3231_SCHEDULE_SIZE; i > 0; i--) {	//so id 0 gets handed out first
+		_heapPos[i - 1] = HEAP_POS_FREE;
+		_freeIds[_freeCount++] = i - 1;
+	}
+	_programmed = 0;
+}
+/*****************************************************************
+* _scheduleProgram()
+* Writes the earliest schedule into the Alarm 1 registers as a
+* date + hours + minutes + seconds match. Skips the write if it's
+* already there, and turns Alarm 1 off when nothing is scheduled.
+*****************************************************************/
+void _scheduleProgram(void) {
+	AlarmSetting a;
+	DateTime dt;
+	if(!_heapCount) {
+		if(_programmed)
+			turnAlarmOff(1);
+		_programmed = 0;
+		return;
+	}
+	if(_next[_heap[0]] == _programmed)
+		return;
+	_programmed = _next[_heap[0]];
+	dt = _fromSeconds(_programmed);
+	a.t = dt.t;
+	a.date = dt.d.date;
+	a.weekday = dt.d.weekday;
+	a.alarm_mask = ALARM1_MATCH_DATE;	//Alarm 1, DY/!DT = 0, A1M4-A1M1 = 0000 => date, hours, minutes and seconds match
+	setAlarm(a);
+	if(!(getAlarmStatus() & 0x01))
+		turnAlarmOn(1);
+}
+/*****************************************************************
+* _scheduleNextAfter(e, now)
+* @e - the schedule
+* @now - seconds since 2000
+* @return - first time after now that e fires, 0 if it never will
+*****************************************************************/
+uint32_t _scheduleNextAfter(ScheduleEntry *e, uint32_t now) {
+	uint32_t timeOfDay;
+	uint32_t today;
+	uint32_t next;
+	uint8_t i;
+	Date d;
+	timeOfDay = e->t.hour24 * 3600UL + e->t.minute * 60UL + e->t.second;
+	today = now / 86400UL;
+	switch(e->kind) {
+		case SCHEDULE_ONCE:
+			next = _daysFromCivil(e->d.year, e->d.month, e->d.date) * 86400UL + timeOfDay;
+			return next > now ? next : 0;
+		case SCHEDULE_DAILY:
+			next = today * 86400UL + timeOfDay;
+			return next > now ? next : next + 86400UL;
+		case SCHEDULE_WEEKLY:
+			for(i = 0; i < 8; i++) {	//8, so today works whether its time has passed or not
+				if(e->weekdays & WEEKDAY_BIT(_civilFromDays(today + i).weekday)) {
+					next = (today + i) * 86400UL + timeOfDay;
+					if(next > now)
+						return next;
+				}
+			}
+			return 0;	//no weekdays set
+		case SCHEDULE_MONTHLY:
+			if(e->d.date < 1 || e->d.date > 31)
+				return 0;
+			d = _civilFromDays(today);
+			for(i = 0; i < 13; i++) {	//the 31st is at most 2 months away, 13 also covers 'this month, too late'
+				if(e->d.date <= daysInMonth(d.year, d.month)) {
+					next = _daysFromCivil(d.year, d.month, e->d.date) * 86400UL + timeOfDay;
+					if(next > now)
+						return next;
+				}
+				if(++d.month > 12) {
+					d.month = 1;
+					d.year++;
+				}
+			}
+			return 0;
+	}
+	return 0;
+}
+/*****************************************************************
+* _toSeconds(dt)
+* @return - seconds from 2000-01-01 00:00:00 to dt
+*****************************************************************/
+uint32_t _toSeconds(DateTime dt) {
+	return dateTimeToEpoch(dt) - DS3231_UNIX_2000;
+}
+/*****************************************************************
+* _fromSeconds(seconds)
+* @return - DateTime that is seconds after 2000-01-01 00:00:00
+*****************************************************************/
+DateTime _fromSeconds(uint32_t seconds) {
+	return epochToDateTime(seconds + DS3231_UNIX_2000);
+}
+
+/*****************************************************************
+* Heap helpers - keep _heapPos[] in step with every move
+*****************************************************************/
+static void _heapPush(uint8_t id) {
+	_heap[_heapCount] = id;
+	_heapPos[id] = _heapCount;
+	_heapSiftUp(_heapCount++);
+}
+static void _heapRemove(uint8_t pos) {
+	uint8_t last;
+	if(pos >= _heapCount)		//not in the heap
+		return;
+	last = _heap[--_heapCount];
+	if(pos == _heapCount)	//it was the last one, nothing to fill in
+		return;
+	_heap[pos] = last;
+	_heapPos[last] = pos;
+	_heapSiftUp(pos);		//the one moved in might be earlier or later than its new neighbours
+	_heapSiftDown(_heapPos[last]);
+}
+static void _heapSiftUp(uint8_t pos) {
+	uint8_t id = _heap[pos];
+	uint8_t parent;
+	while(pos > 0) {
+		parent = (pos - 1) / 2;
+		if(_next[_heap[parent]] <= _next[id])
+			break;
+		_heap[pos] = _heap[parent];
+		_heapPos[_heap[pos]] = pos;
+		pos = parent;
+	}
+	_heap[pos] = id;
+	_heapPos[id] = pos;
+}
+static void _heapSiftDown(uint8_t pos) {
+	uint8_t id = _heap[pos];
+	uint8_t child;
+	while((child = 2 * pos + 1) < _heapCount) {
+		if(child + 1 < _heapCount && _next[_heap[child + 1]] < _next[_heap[child]])
+			child++;		//the earlier of the two children
+		if(_next[id] <= _next[_heap[child]])
+			break;
+		_heap[pos] = _heap[child];
+		_heapPos[_heap[pos]] = pos;
+		pos = child;
+	}
+	_heap[pos] = id;
+	_heapPos[id] = pos;
+}
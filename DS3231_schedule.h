@@ -0,0 +1,60 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  DS3231_schedule.h                                                     ***
+***	 Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#ifndef _DS3231_SCHEDULE_H
+#define _DS3231_SCHEDULE_H
+
+#include "DS3231_tisc.h"
+
+//The DS3231 has two alarms. The scheduler keeps as many as you need in the
+//Arduino and always programs whichever is due first into Alarm 1. When it
+//trips, serviceAlarms() hands it to the scheduler, which calls your callback
+//for each schedule that is due, works out when each repeating one is next
+//due, and programs the new earliest one. Alarm 2 is still yours to use.
+
+//How many schedules can exist at once, #define before including to change
+#ifndef DS3231_SCHEDULE_SIZE
+#define DS3231_SCHEDULE_SIZE 32
+#endif
+
+//ScheduleEntry.kind
+#define SCHEDULE_ONCE     0		//once, at d.year/d.month/d.date t
+#define SCHEDULE_DAILY    1		//every day at t
+#define SCHEDULE_WEEKLY   2		//at t on each weekday set in 'weekdays'
+#define SCHEDULE_MONTHLY  3		//at t on d.date each month, skipping months that are too short
+
+//ScheduleEntry.weekdays, bit 0 = Sunday...bit 6 = Saturday
+#define WEEKDAY_BIT(weekday) (1 << ((weekday) - 1))	//weekday 1=Sun...7=Sat
+#define WEEKDAYS_MON_FRI  0x3e
+#define WEEKDAYS_WEEKEND  0x41
+
+//Returned by scheduleAdd() when it can't add the schedule
+#define SCHEDULE_NONE     0xff
+
+class ScheduleEntry {
+	public:
+	uint8_t kind;		//SCHEDULE_ONCE, _DAILY, _WEEKLY or _MONTHLY
+	Time t;				//hour24, minute and second are used
+	Date d;				//year, month and date for SCHEDULE_ONCE, date for SCHEDULE_MONTHLY
+	uint8_t weekdays;	//WEEKDAY_BIT()s for SCHEDULE_WEEKLY
+};
+
+typedef void (*ScheduleCallback)(uint8_t id);	//id is what scheduleAdd() returned
+
+//Function prototypes
+void scheduleBegin(ScheduleCallback callback);	//Takes over Alarm 1, callback runs for each schedule that comes due
+void scheduleEnd(void);						//Turns Alarm 1 off and gives it back to serviceAlarms()
+uint8_t scheduleAdd(ScheduleEntry e);		//Adds a schedule, returns its id or SCHEDULE_NONE
+bool scheduleCancel(uint8_t id);			//Removes a schedule, returns false if there was no such id
+uint8_t scheduleCount(void);				//How many schedules are waiting
+bool scheduleNextDue(uint8_t *id, DateTime *when); //The schedule programmed into Alarm 1, false if none
+bool scheduleGet(uint8_t id, ScheduleEntry *e);	//The settings a schedule was added with, false if no such id
+uint32_t _scheduleNextAfter(ScheduleEntry *e, uint32_t now); //seconds since 2000 of next firing, 0 = never
+uint32_t _toSeconds(DateTime dt);			//seconds since 2000-01-01 00:00:00
+DateTime _fromSeconds(uint32_t seconds);	//inverse of _toSeconds()
+void _scheduleService(void);				//Alarm 1 hook
+void _scheduleClear(void);					//empties the schedule, frees every id
+void _scheduleProgram(void);				//puts the earliest schedule in Alarm 1
+#endif
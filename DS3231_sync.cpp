@@ -0,0 +1,221 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  DS3231_sync.cpp                                                       ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#include <stdint.h>   //include standard typdef definitions
+#include <Arduino.h>  //include Arduino core for Stream and micros()
+#include "DS3231_tisc.h"  //include header for the DS3231 library
+#include "DS3231_temp.h"  //aging offset controller, for SYNC_MSG_REFERENCE
+#include "DS3231_trace.h" //traceDumpBinary(), for SYNC_MSG_TRACE
+#include "DS3231_sync.h"  //include header for this file
+
+//Frame parser
+#define SYNC_STATE_START   0	//waiting for SYNC_FRAME_START
+#define SYNC_STATE_TYPE    1
+#define SYNC_STATE_LEN     2
+#define SYNC_STATE_PAYLOAD 3
+#define SYNC_STATE_CHECK   4
+uint8_t _syncState = SYNC_STATE_START;
+uint8_t _syncType;
+uint8_t _syncLen;
+uint8_t _syncGot;
+uint8_t _syncSum;
+uint8_t _syncPayload[SYNC_MAX_PAYLOAD];
+
+//Scheduled SET
+bool _syncPending = false;
+uint32_t _syncTarget;			//micros() of the second boundary
+uint8_t _syncRegs[7];			//encoded ahead of time, so the write is all that's left
+uint32_t _syncEpoch;			//what's in _syncRegs
+int32_t _syncLate = 0;
+
+/*****************************************************************
+* syncFromHost(port)
+* Call from loop() as often as you can - how late the frame is
+* noticed is how late the clock is set. Reads whatever bytes have
+* arrived and answers complete frames. After a SET, returns
+* SYNC_WAITING on each call until the second boundary is less than
+* SYNC_SPIN_MICROS away, then spins to it and writes the time.
+* @port - Serial, or any other Stream
+* @return - SYNC_NONE, SYNC_WAITING, SYNC_SET_DONE,
+*           SYNC_QUERY_DONE, SYNC_REFERENCE_DONE, SYNC_TRACE_DONE or
+*           SYNC_BAD_FRAME
+*****************************************************************/
+uint8_t syncFromHost(Stream &port) {
+	int c;
+	uint8_t result;
+	if(_syncPending)
+		return _syncSet(port);	//leave any new bytes where they are until this is done
+	while((c = port.read()) >= 0) {
+		switch(_syncState) {
+			case SYNC_STATE_START:
+				if(c == SYNC_FRAME_START)
+					_syncState = SYNC_STATE_TYPE;
+				break;		//anything else is noise (DEBUG prints etc.), skip it
+			case SYNC_STATE_TYPE:
+				_syncType = c;
+				_syncSum = c;
+				_syncState = SYNC_STATE_LEN;
+				break;
+			case SYNC_STATE_LEN:
+				_syncLen = c;
+				_syncSum += c;
+				_syncGot = 0;
+				_syncState = c > SYNC_MAX_PAYLOAD ? SYNC_STATE_START
+					: c ? SYNC_STATE_PAYLOAD : SYNC_STATE_CHECK;
+				break;
+			case SYNC_STATE_PAYLOAD:
+				_syncPayload[_syncGot++] = c;
+				_syncSum += c;
+				if(_syncGot == _syncLen)
+					_syncState = SYNC_STATE_CHECK;
+				break;
+			case SYNC_STATE_CHECK:
+				_syncState = SYNC_STATE_START;
+				if((uint8_t)(_syncSum + c)) {
+					result = SYNC_BAD_CHECK;
+					_syncReply(port, SYNC_MSG_NAK, &result, 1);
+					return SYNC_BAD_FRAME;
+				}
+				result = _syncHandle(port, micros());
+				return result == SYNC_WAITING ? _syncSet(port) : result;
+		}
+	}
+	return SYNC_NONE;
+}
+/*****************************************************************
+* syncLastLateMicros()
+* @return - how many us after its second boundary the last SET
+*           wrote the seconds register. Also sent to the host
+*****************************************************************/
+int32_t syncLastLateMicros(void) {
+	return _syncLate;
+}
+/*****************************************************************
+* _syncHandle(port, arrived)
+* @arrived - micros() when the check byte was read
+* Acts on the frame in _syncType/_syncPayload
+* @return - SYNC_WAITING for a SET now scheduled, SYNC_QUERY_DONE,
+*           SYNC_REFERENCE_DONE, SYNC_TRACE_DONE, or SYNC_BAD_FRAME
+*           if it sent a NAK
+*****************************************************************/
+uint8_t _syncHandle(Stream &port, uint32_t arrived) {
+	uint8_t reply[SYNC_MAX_PAYLOAD];
+	uint16_t millisPart = _syncPayload[4] | (_syncPayload[5] << 8);
+	uint32_t epoch = _getU32(_syncPayload);
+	AgingStats aging;
+	if((_syncType == SYNC_MSG_SET || _syncType == SYNC_MSG_REFERENCE) && (_syncLen != 6 || millisPart > 999)) {
+		reply[0] = SYNC_BAD_TYPE;
+		_syncReply(port, SYNC_MSG_NAK, reply, 1);
+		return SYNC_BAD_FRAME;
+	}
+	switch(_syncType) {
+		case SYNC_MSG_SET:
+			//Host time is epoch + millisPart now, so the next boundary is epoch + 1
+			//in 1000 - millisPart ms, or epoch right now if millisPart is 0
+			if(millisPart) {
+				epoch++;
+				arrived += (1000UL - millisPart) * 1000UL;
+			}
+			_syncEpoch = epoch;
+			_syncTarget = arrived;
+			_dateTimeRegisters(epochToDateTime(epoch), twelveHourMode, _syncRegs);
+			_syncPending = true;
+			return SYNC_WAITING;
+		case SYNC_MSG_QUERY:
+			epoch = readEpochMillis(&millisPart);
+			_putU32(reply, epoch);
+			reply[4] = millisPart;
+			reply[5] = millisPart >> 8;
+			_syncReply(port, SYNC_MSG_TIME, reply, 6);
+			return SYNC_QUERY_DONE;
+		case SYNC_MSG_REFERENCE:
+			//The millis that went by since the frame arrived are part of the reference
+			millisPart += (micros() - arrived) / 1000;
+			epoch += millisPart / 1000;
+			agingReference(epoch, millisPart % 1000);
+			aging = getAgingStats();
+			_putU32(reply, aging.lastErrorMillis);
+			reply[4] = aging.lastPpmTenths;
+			reply[5] = aging.lastPpmTenths >> 8;
+			reply[6] = aging.offset;
+			_syncReply(port, SYNC_MSG_REFERENCE_DONE, reply, 7);
+			return SYNC_REFERENCE_DONE;
+		#ifdef DS3231_TRACE
+		case SYNC_MSG_TRACE:
+			//The host owns the port, so the sketch's typed commands come this way
+			if(_syncLen != 1 || (_syncPayload[0] != TRACE_CMD_DUMP && _syncPayload[0] != TRACE_CMD_CLEAR))
+				break;
+			if(_syncPayload[0] == TRACE_CMD_CLEAR)
+				traceClear();
+			traceDumpBinary(port);
+			return SYNC_TRACE_DONE;
+		#endif
+	}
+	reply[0] = SYNC_BAD_TYPE;
+	_syncReply(port, SYNC_MSG_NAK, reply, 1);
+	return SYNC_BAD_FRAME;
+}
+/*****************************************************************
+* _syncSet(port)
+* Writes the scheduled SET if the boundary is close, started early
+* by the time the bus takes to get to the seconds register.
+* How late it was is worked out once the write is done: the seconds
+* register was written SYNC_TAIL_BITS before the write finished, so
+* that's measured, not what we meant to do. A retried write is
+* measured from its last try, the one that set the clock.
+* @return - SYNC_WAITING if it's not time yet, SYNC_SET_DONE, or
+*           SYNC_BAD_FRAME (a SYNC_BAD_WRITE NAK) if the write failed
+*****************************************************************/
+uint8_t _syncSet(Stream &port) {
+	uint8_t reply[8];
+	uint8_t result;
+	uint32_t start = _syncTarget - SYNC_LEAD_BITS * 1000000UL / DS3231_SYNC_I2C_HZ;
+	uint32_t done;
+	if((int32_t)(start - micros()) > SYNC_SPIN_MICROS)
+		return SYNC_WAITING;
+	while((int32_t)(start - micros()) > 0)
+		;	//last few hundred us, just spin
+	result = writeRegistersChecked(DS3231_SECONDS, _syncRegs, 7);
+	done = micros();
+	_syncPending = false;
+	_clockWasSet();		//even a failed write may have changed some registers
+	_journalEvent(JOURNAL_SET_DATETIME, result);
+	if(result != DS3231_OK) {
+		reply[0] = SYNC_BAD_WRITE;
+		_syncReply(port, SYNC_MSG_NAK, reply, 1);
+		return SYNC_BAD_FRAME;
+	}
+	//seconds register edge, against the second boundary
+	_syncLate = (int32_t)(done - SYNC_TAIL_BITS * 1000000UL / DS3231_SYNC_I2C_HZ - _syncTarget);
+	_putU32(reply, _syncEpoch);
+	_putU32(&reply[4], _syncLate);
+	_syncReply(port, SYNC_MSG_SET_DONE, reply, 8);
+	return SYNC_SET_DONE;
+}
+/*****************************************************************
+* _syncReply(port, type, payload, len)
+* Sends one frame
+*****************************************************************/
+void _syncReply(Stream &port, uint8_t type, const uint8_t *payload, uint8_t len) {
+	uint8_t sum = type + len;
+	uint8_t i;
+	port.write((uint8_t)SYNC_FRAME_START);
+	port.write(type);
+	port.write(len);
+	for(i = 0; i < len; i++) {
+		port.write(payload[i]);
+		sum += payload[i];
+	}
+	port.write((uint8_t)-sum);
+}
+void _putU32(uint8_t *buf, uint32_t value) {
+	buf[0] = value;
+	buf[1] = value >> 8;
+	buf[2] = value >> 16;
+	buf[3] = value >> 24;
+}
+uint32_t _getU32(const uint8_t *buf) {
+	return buf[0] | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
@@ -0,0 +1,88 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  DS3231_sync.h                                                         ***
+***	 Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#ifndef _DS3231_SYNC_H
+#define _DS3231_SYNC_H
+
+#include <Arduino.h>
+#include "DS3231_tisc.h"
+
+//Sets the DS3231 from a host over a serial port, to a few ms instead of to the second.
+//The host says what time it is as its frame finishes arriving. syncFromHost() waits for
+//the next whole second and writes seconds...year in one transaction right on it. Writing
+//the seconds register restarts the DS3231's countdown chain, so its seconds tick over
+//from then on in step with the host's.
+//
+//Frames, both directions:  0xA5 | type | len | payload (len bytes) | check
+//  check makes type + len + payload + check add up to 0 (mod 256)
+//  multi-byte values are little endian
+//Host -> device
+//  SYNC_MSG_SET        epoch u32, millis u16   set the clock. epoch + millis/1000 is the
+//                                              host's Unix time when the check byte is sent
+//  SYNC_MSG_QUERY      (none)                  ask for the device's time
+//  SYNC_MSG_REFERENCE  epoch u32, millis u16   trusted time for the aging offset controller
+//                                              (DS3231_temp.h), the clock isn't set
+//  SYNC_MSG_TRACE      command u8              TRACE_CMD_DUMP or TRACE_CMD_CLEAR, with
+//                                              DS3231_TRACE (DS3231_trace.h)
+//Device -> host
+//  SYNC_MSG_SET_DONE   epoch u32, late i32     epoch written, and how many us after the
+//                                              second boundary the seconds register was written,
+//                                              measured once the write has finished
+//  SYNC_MSG_TIME       epoch u32, millis u16   DS3231 time as this frame is sent, millis is
+//                                              only exact with the tick clock running
+//  SYNC_MSG_REFERENCE_DONE error i32, ppm i16, offset i8   DS3231 minus reference in ms,
+//                                              drift in 0.1 ppm, aging offset now
+//  SYNC_MSG_TRACE_DATA lost u16, records       traceDumpBinary()'s frames, the records
+//                                              that were in the ring. A clear is answered
+//                                              with an empty one. Longer than SYNC_MAX_PAYLOAD,
+//                                              which only limits what the device receives
+//  SYNC_MSG_NAK        reason u8               SYNC_BAD_... below
+//To measure the residual error after a SET, the host sends a QUERY and compares the
+//reply with its own clock, less half the round trip. host/ds3231_sync does all of
+//this from a Linux PC.
+
+#define SYNC_FRAME_START        0xa5
+#define SYNC_MAX_PAYLOAD        10
+#define SYNC_MSG_SET            0x01
+#define SYNC_MSG_QUERY          0x02
+#define SYNC_MSG_REFERENCE      0x03
+#define SYNC_MSG_TRACE          0x04
+#define SYNC_MSG_SET_DONE       0x81
+#define SYNC_MSG_TIME           0x82
+#define SYNC_MSG_REFERENCE_DONE 0x83
+#define SYNC_MSG_TRACE_DATA     0x84	//TRACE_FRAME_TYPE
+#define SYNC_MSG_NAK            0xff
+//SYNC_MSG_NAK reasons
+#define SYNC_BAD_CHECK          1	//check byte didn't add up
+#define SYNC_BAD_TYPE           2	//unknown type, or wrong length for it (TRACE without DS3231_TRACE too)
+#define SYNC_BAD_WRITE          3	//SET: writing the DS3231 failed, see ds3231LastError()
+
+//syncFromHost() results
+#define SYNC_NONE           0	//nothing finished this call
+#define SYNC_WAITING        1	//a SET is waiting for its second
+#define SYNC_SET_DONE       2	//the clock was just set
+#define SYNC_QUERY_DONE     3	//answered a QUERY
+#define SYNC_REFERENCE_DONE 4	//passed a REFERENCE to the aging controller
+#define SYNC_BAD_FRAME      5	//sent a NAK
+#define SYNC_TRACE_DONE     6	//answered a TRACE
+
+//I2C clock for working out how long before the second to start the write: START,
+//address, register and the seconds byte go out before the seconds register is written
+#ifndef DS3231_SYNC_I2C_HZ
+#define DS3231_SYNC_I2C_HZ 100000UL
+#endif
+#define SYNC_LEAD_BITS   28		//START + 3 x (8 bits + ACK)
+#define SYNC_TAIL_BITS   55		//after the seconds register: 6 x (8 bits + ACK) + STOP
+#define SYNC_SPIN_MICROS 2000	//syncFromHost() only spins for the last 2 ms
+
+//Function prototypes
+uint8_t syncFromHost(Stream &port);		//Call often from loop(), handles frames and does the timed write
+int32_t syncLastLateMicros(void);		//How late the last SET's write was, us
+void _syncReply(Stream &port, uint8_t type, const uint8_t *payload, uint8_t len); //sends a frame
+uint8_t _syncHandle(Stream &port, uint32_t arrived);	//acts on a complete frame, returns a syncFromHost() result
+uint8_t _syncSet(Stream &port);			//does the scheduled write, if it's time
+void _putU32(uint8_t *buf, uint32_t value);	//little endian
+uint32_t _getU32(const uint8_t *buf);
+#endif
@@ -0,0 +1,241 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  DS3231_temp.cpp                                                       ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#include <stdint.h>   //include standard typdef definitions
+#include <Arduino.h>  //include Arduino core for millis()
+#include "DS3231_tisc.h"  //include header for the DS3231 library
+#include "DS3231_temp.h"  //include header for this file
+
+//Conversions
+uint8_t _tempState = TEMP_IDLE;
+uint32_t _tempLastPoll;			//millis() of the last BSY/CONV check
+uint32_t _tempSamplerMillis = 0;	//sampler period, 0 = off
+uint32_t _tempLastSample;			//millis() the sampler last started a conversion
+
+//Statistics - a ring of the last DS3231_TEMP_WINDOW readings, with the sum kept as they come and go
+int16_t _tempWindow[DS3231_TEMP_WINDOW];
+uint8_t _tempNext = 0;			//where the next reading goes
+TemperatureStats _tempStats;
+int32_t _tempSum = 0;
+int32_t _tempEwma;				//EWMA << 8, so the fraction isn't lost
+
+//Aging offset controller
+AgingStats _agingStats = {0, 0, 0, 0, 0};
+bool _agingHaveBase = false;
+uint32_t _agingBaseEpoch;		//reference time of the baseline
+int32_t _agingBaseError;		//DS3231 minus reference then, ms
+uint16_t _agingClockSets;		//_clockSetCount() when the baseline was taken
+
+/*****************************************************************
+* readTemperature()
+* @return - temperature in quarter degrees C from registers 0x11
+*           and 0x12, read together so they're from the same
+*           conversion. The DS3231 converts on its own every 64 s.
+*           TEMP_INVALID if the read failed, ds3231LastError() says why
+*****************************************************************/
+int16_t readTemperature(void) {
+	uint8_t regs[2];
+	if(readRegisters(DS3231_TEMP_MSB, regs, 2) != 2)
+		return TEMP_INVALID;
+	return (int16_t)((regs[0] << 8) | regs[1]) >> 6;	//10 bit two's complement, top of the 16
+}
+/*****************************************************************
+* startTemperatureConversion()
+* Sets CONV and returns - it takes up to 200 ms, temperatureService()
+* picks the result up when it's done. This also updates the
+* crystal trim, so a new aging offset takes effect.
+* @return - false if a conversion is already running (the DS3231
+*           won't start one while BSY is set), or if CONTROL
+*           couldn't be read or written
+*****************************************************************/
+bool startTemperatureConversion(void) {
+	uint8_t regs[2];
+	if(readRegisters(DS3231_CONTROL, regs, 2) != 2)		//CONTROL, STATUS
+		return false;		//don't write back a CONTROL we didn't read
+	if((regs[0] & DS3231_CONV) || (regs[1] & DS3231_BSY))
+		return false;
+	regs[0] |= DS3231_CONV;
+	if(writeRegistersChecked(DS3231_CONTROL, regs, 1) != DS3231_OK)
+		return false;
+	_tempState = TEMP_CONVERTING;
+	_tempLastPoll = millis();
+	return true;
+}
+/*****************************************************************
+* temperatureService()
+* Call from loop(). While a conversion is running it checks CONV
+* and BSY every TEMP_POLL_MILLIS, and when they clear reads the
+* temperature - all in one 5 byte burst of 0x0E-0x12. Starts the
+* sampler's conversions too. A failed read adds nothing to the
+* stats, it's just tried again at the next poll.
+* @return - TEMP_READY once when a new reading has gone into the
+*           stats (get it from getTemperatureStats().last),
+*           otherwise TEMP_CONVERTING or TEMP_IDLE
+*****************************************************************/
+uint8_t temperatureService(void) {
+	uint8_t regs[5];
+	if(_tempState == TEMP_IDLE) {
+		if(_tempSamplerMillis && millis() - _tempLastSample >= _tempSamplerMillis) {
+			_tempLastSample = millis();
+			startTemperatureConversion();	//if the DS3231's own is running, try again next period
+		}
+		return _tempState;
+	}
+	if(millis() - _tempLastPoll < TEMP_POLL_MILLIS)
+		return TEMP_CONVERTING;
+	_tempLastPoll = millis();
+	if(readRegisters(DS3231_CONTROL, regs, 5) != 5)		//CONTROL, STATUS, AGING, TEMP MSB, TEMP LSB
+		return TEMP_CONVERTING;
+	if((regs[0] & DS3231_CONV) || (regs[1] & DS3231_BSY))
+		return TEMP_CONVERTING;
+	addTemperatureSample((int16_t)((regs[3] << 8) | regs[4]) >> 6);
+	_tempState = TEMP_IDLE;
+	return TEMP_READY;
+}
+/*****************************************************************
+* startTemperatureSampler(everySeconds)
+* @everySeconds - how often temperatureService() starts a
+*                 conversion, 0 to stop
+*****************************************************************/
+void startTemperatureSampler(uint16_t everySeconds) {
+	_tempSamplerMillis = everySeconds * 1000UL;
+	_tempLastSample = millis() - _tempSamplerMillis;	//first one right away
+}
+/*****************************************************************
+* addTemperatureSample(quarters)
+* @quarters - reading in quarter degrees C
+* Fixed memory: the window is a ring, the sum is kept as readings
+* come and go, and min/max are a scan of at most DS3231_TEMP_WINDOW
+*****************************************************************/
+void addTemperatureSample(int16_t quarters) {
+	uint8_t i;
+	if(_tempStats.count == DS3231_TEMP_WINDOW)
+		_tempSum -= _tempWindow[_tempNext];		//oldest one drops out
+	else
+		_tempStats.count++;
+	_tempWindow[_tempNext] = quarters;
+	_tempSum += quarters;
+	if(++_tempNext == DS3231_TEMP_WINDOW)
+		_tempNext = 0;
+	if(!_tempStats.samples)
+		_tempEwma = (int32_t)quarters << 8;
+	else
+		_tempEwma += (((int32_t)quarters << 8) - _tempEwma) >> TEMP_EWMA_SHIFT;
+	_tempStats.samples++;
+	_tempStats.last = quarters;
+	_tempStats.min = _tempStats.max = quarters;
+	for(i = 0; i < _tempStats.count; i++) {
+		if(_tempWindow[i] < _tempStats.min)
+			_tempStats.min = _tempWindow[i];
+		if(_tempWindow[i] > _tempStats.max)
+			_tempStats.max = _tempWindow[i];
+	}
+	_tempStats.mean = _tempSum / _tempStats.count;
+	_tempStats.ewma = (_tempEwma + 128) >> 8;
+}
+TemperatureStats getTemperatureStats(void) {
+	return _tempStats;
+}
+void resetTemperatureStats(void) {
+	_tempStats = TemperatureStats();
+	_tempSum = 0;
+	_tempNext = 0;
+}
+
+/*****************************************************************
+* readAgingOffset()
+* @return - aging offset register. + slows the crystal down,
+*           about 0.1 ppm per step at 25 C. If it can't be read
+*           (ds3231LastError() says why), the last one written
+*****************************************************************/
+int8_t readAgingOffset(void) {
+	uint8_t offset;
+	if(readRegistersChecked(DS3231_AGING_OFFSET, &offset, 1) != DS3231_OK)
+		return _agingStats.offset;
+	return (int8_t)offset;
+}
+/*****************************************************************
+* writeAgingOffset(offset)
+* @offset - new aging offset. The DS3231 only applies it at the
+*           next conversion, so this starts one (if its own is
+*           running, that one picks it up). If the write fails,
+*           getAgingStats().offset stays as it was
+*****************************************************************/
+void writeAgingOffset(int8_t offset) {
+	uint8_t data = (uint8_t)offset;
+	if(writeRegistersChecked(DS3231_AGING_OFFSET, &data, 1) != DS3231_OK)
+		return;
+	_agingStats.offset = offset;
+	startTemperatureConversion();
+}
+/*****************************************************************
+* agingReference(epoch, millisPart)
+* Call whenever you have a trusted time, as soon as it arrives.
+* The first call (or the first after the clock is set) is the
+* baseline. Once AGING_MIN_SPAN seconds of reference time have
+* gone by, the DS3231's drift since the baseline is worked out in
+* ppm and the aging offset moved half of the way to cancel it
+* (at most AGING_MAX_STEP), then that becomes the new baseline.
+* Half steps so one noisy reference can't throw it far off.
+* If the DS3231 can't be read the reference is ignored - the time
+* readEpochMillis() falls back to would look like drift.
+* @epoch - trusted Unix time
+* @millisPart - and milliseconds into that second
+* @return - true if the offset was changed
+*****************************************************************/
+bool agingReference(uint32_t epoch, uint16_t millisPart) {
+	uint16_t rtcMillis;
+	uint32_t rtcEpoch;
+	int32_t error;
+	int32_t ppmTenths;
+	int32_t step;
+	int16_t offset;
+	rtcEpoch = readEpochMillis(&rtcMillis);
+	if(ds3231LastError() != DS3231_OK)
+		return false;
+	error = (int32_t)(rtcEpoch - epoch) * 1000 + rtcMillis - millisPart;
+	_agingStats.references++;
+	_agingStats.lastErrorMillis = error;
+	if(!_agingHaveBase || _agingClockSets != _clockSetCount()) {
+		_agingHaveBase = true;
+		_agingClockSets = _clockSetCount();
+		_agingBaseEpoch = epoch;
+		_agingBaseError = error;
+		_agingStats.offset = readAgingOffset();
+		if(ds3231LastError() != DS3231_OK)
+			_agingHaveBase = false;		//no baseline without knowing the offset it's for
+		return false;
+	}
+	if(epoch - _agingBaseEpoch < AGING_MIN_SPAN)
+		return false;
+	//ms of drift per s of reference = ppm/1000, 64 bits so seconds of drift over days can't overflow
+	ppmTenths = (int64_t)(error - _agingBaseError) * 10000 / (int32_t)(epoch - _agingBaseEpoch);
+	_agingStats.lastPpmTenths = ppmTenths > 32767 ? 32767 : ppmTenths < -32768 ? -32768 : ppmTenths;
+	_agingBaseEpoch = epoch;
+	_agingBaseError = error;
+	step = ppmTenths / 2;		//fast => + offset => slower. Clamped at 32 bits, a wild reference can be way past 16
+	if(step > AGING_MAX_STEP)
+		step = AGING_MAX_STEP;
+	if(step < -AGING_MAX_STEP)
+		step = -AGING_MAX_STEP;
+	offset = _agingStats.offset + (int16_t)step;
+	if(offset > 127)
+		offset = 127;
+	if(offset < -128)
+		offset = -128;
+	if(offset == _agingStats.offset)
+		return false;
+	writeAgingOffset(offset);
+	if(_agingStats.offset != offset)
+		return false;		//write failed, the baseline still holds for the old offset
+	_agingStats.adjustments++;
+	return true;
+}
+void agingRestart(void) {
+	_agingHaveBase = false;
+}
+AgingStats getAgingStats(void) {
+	return _agingStats;
+}
@@ -0,0 +1,80 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  DS3231_temp.h                                                         ***
+***	 Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#ifndef _DS3231_TEMP_H
+#define _DS3231_TEMP_H
+
+#include "DS3231_tisc.h"
+
+//The DS3231 measures its own temperature every 64 seconds to trim its crystal. This
+//reads it, can ask for an extra conversion without waiting for it, and keeps running
+//statistics. Temperatures are in quarter degrees C, the DS3231's resolution: 100 = 25.00 C.
+//
+//The aging offset controller compares the DS3231 against a trusted time (from a host,
+//GPS, NTP...) each time you have one, and nudges the aging offset register to pull
+//the crystal back on frequency, so the clock needs setting less often.
+
+//temperatureService() results
+#define TEMP_IDLE        0	//no conversion running
+#define TEMP_CONVERTING  1	//conversion started, not finished
+#define TEMP_READY       2	//conversion finished, new reading in the stats (returned once)
+
+//readTemperature() couldn't read the DS3231, see ds3231LastError(). Readings only go -512..511
+#define TEMP_INVALID -32768
+
+//CONTROL and STATUS bits
+#define DS3231_CONV  0x20	//CONTROL: start a conversion, reads 1 until it's done
+#define DS3231_BSY   0x04	//STATUS: a conversion is running
+
+//How many readings the min/max/mean window covers, #define before including to change
+#ifndef DS3231_TEMP_WINDOW
+#define DS3231_TEMP_WINDOW 16
+#endif
+#define TEMP_POLL_MILLIS  10	//how often temperatureService() checks a running conversion
+#define TEMP_EWMA_SHIFT    3	//EWMA weight of each new reading is 1/2^3
+
+//Seconds of reference time needed before the controller adjusts the aging offset.
+//With the tick clock running the DS3231's time is known to a few ms, so 6 hours
+//gives better than 0.5 ppm. Without it, it's only known to the second - make this
+//a few days, #define before including to change
+#ifndef AGING_MIN_SPAN
+#define AGING_MIN_SPAN 21600UL
+#endif
+#define AGING_MAX_STEP 10		//most the offset moves in one adjustment, ~1 ppm
+
+class TemperatureStats {
+	public:
+	uint8_t count;		//readings in the window, up to DS3231_TEMP_WINDOW
+	int16_t last;		//most recent reading
+	int16_t min;		//lowest in the window
+	int16_t max;		//highest in the window
+	int16_t mean;		//mean of the window
+	int16_t ewma;		//exponentially weighted moving average of every reading
+	uint32_t samples;	//readings taken since the last reset
+};
+
+class AgingStats {
+	public:
+	int8_t offset;			//aging offset register, as last written
+	int16_t lastPpmTenths;	//measured drift, 0.1 ppm, + = DS3231 fast, pinned to int16_t's range
+	int32_t lastErrorMillis;	//DS3231 minus reference at the last reference
+	uint16_t references;	//agingReference() calls
+	uint16_t adjustments;	//times the offset was changed
+};
+
+//Function prototypes
+int16_t readTemperature(void);				//Last conversion's result, one burst read, TEMP_INVALID if it failed
+bool startTemperatureConversion(void);		//Sets CONV, returns at once. False if one is already running or the bus failed
+uint8_t temperatureService(void);			//Call from loop(), returns TEMP_IDLE, _CONVERTING or _READY
+void startTemperatureSampler(uint16_t everySeconds);	//temperatureService() converts every so often, 0 = stop
+void addTemperatureSample(int16_t quarters);	//Adds a reading to the stats
+TemperatureStats getTemperatureStats(void);	//Window min/max/mean, EWMA
+void resetTemperatureStats(void);			//Empties the window
+int8_t readAgingOffset(void);				//Aging offset register, the last one written if it can't be read
+void writeAgingOffset(int8_t offset);		//Writes it and starts a conversion so it takes effect now
+bool agingReference(uint32_t epoch, uint16_t millisPart); //Trusted Unix time now, returns true if it adjusted the offset. Ignored if the DS3231 can't be read
+void agingRestart(void);					//Forget the baseline, start measuring again
+AgingStats getAgingStats(void);				//What the controller has measured and done
+#endif
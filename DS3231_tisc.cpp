@@ -4,8 +4,10 @@
 ***  Visit: https://TechIsSoCool.com for details						   ***
 ******************************************************************************/
 #include <stdint.h>   //include standard typdef definitions
+#include <Arduino.h>  //include Arduino core for noInterrupts()/interrupts()
 #include <Wire.h>     //include Arduino serial library for I2C
 #include "DS3231_tisc.h"  //include header for this file
+#include "DS3231_trace.h" //DS3231_TRACE_SCOPE(), empty unless DS3231_TRACE is defined
 
 /****************************************************************
 * See the header file "DS3231_tisc.h" for class definitions of
@@ -13,151 +15,275 @@
 * with many of these functions. 
 ****************************************************************/
 
+//Register shadow cache, off until useRegisterCache(true) is called
+#define CACHE_CONTROL   0x01	//_cachedControl holds register 0x0E
+#define CACHE_STATUS    0x02	//_cachedStatus holds register 0x0F
+#define CACHE_HOURS     0x04	//_cachedHours holds register 0x02 (we only use the 12/!24 bit)
+bool _cacheEnabled = false;
+uint8_t _cacheValid = 0;		//which of the CACHE_ flags above hold good data
+uint8_t _cachedControl;
+uint8_t _cachedStatus;
+uint8_t _cachedHours;
+RegisterCacheStats _cacheStats = {0, 0};
+
+//Unix times epochToDateTime(epochs, out, n) converts per pass, 36 bytes of stack each
+#ifdef __AVR__
+#define EPOCH_LANES 4
+#else
+#define EPOCH_LANES 64
+#endif
+
+//Software clock driven by the 1 Hz SQW output, see startTickClock()
+#define TICK_ENABLES_UNKNOWN 0xff	//_tickAlarmEnables: read CONTROL next time
+#define TICK_DRIFT_SECONDS 60		//how often tickClockService() checks the seconds register
+volatile uint32_t _tickCount = 0;	//only ever touched by tickClockISR(), except to read it
+uint32_t _ticksApplied = 0;		//how many of those ticks _tickNow includes
+DateTime _tickNow = {{0, 12, 0, 0, false}, {2000, 1, 1, 7}};	//the software clock, 2000-01-01 until it loads
+bool _tickRunning = false;
+bool _tickResyncNeeded = false;		//set when something writes the time registers
+volatile uint32_t _tickEdgeMillis = 0;	//millis() at the last 1 Hz edge
+uint16_t _clockSets = 0;			//times the time or date have been written, see _clockWasSet()
+uint16_t _resyncSeconds;			//how often to reload _tickNow from the chip
+uint16_t _secondsSinceSync;
+uint32_t _lastServicedTick;
+uint32_t _lastDriftTick;			//_ticksApplied at the last drift check or resync
+uint8_t _tickAlarmEnables = TICK_ENABLES_UNKNOWN;	//A1IE/A2IE, kept by _cacheUpdate() so tickClockService() needn't read CONTROL
+TickClockStats _tickStats = {0, 0, 0};
+
+//The DS3231 the free functions talk to: traffic, errors and the last good time & date
+TwoWireTransport DS3231_Wire(Wire);
+#ifdef DS3231_BUS_STATS
+DS3231Link _ds3231 = {&DS3231_Wire, DS3231_ADDR, {0, 0, 0, 0, 0}, {}, {{0, 12, 0, 0, false}, {2000, 1, 1, 7}}};
+#else
+DS3231Link _ds3231 = {&DS3231_Wire, DS3231_ADDR, {}, {{0, 12, 0, 0, false}, {2000, 1, 1, 7}}};
+#endif
+uint32_t _busClockHz = 0;		//0 = whatever Wire.begin() sets
+AlarmHook _alarm1Hook = NULL;	//see setAlarm1Hook()
+JournalHook _journalHook = NULL;	//see setJournalHook()
+
+//Alarm interrupt event ring, see alarmEventISR(). Single producer (the ISR)
+//single consumer (serviceAlarms()), so no locking: only the ISR moves
+//_eventHead and only serviceAlarms() moves _eventTail
+AlarmEvent _events[DS3231_EVENT_QUEUE_SIZE];
+volatile uint8_t _eventHead = 0;
+volatile uint8_t _eventTail = 0;
+volatile uint32_t _eventSequence = 0;	//every interrupt, including ones dropped
+volatile uint16_t _eventOverflows = 0;
+uint8_t _eventCarryFlags = 0;		//flags for events left queued when the caller's array was full
+AlarmEventStats _eventStats = {0, 0, 0, 0};
+#define EVENT_BARRIER() __asm__ __volatile__("" ::: "memory")	//keeps the compiler from moving stores past it
+uint8_t _busGeneration = 0;		//bumped by every transaction, tells the async engine if the pointer moved
+
+//Async transaction queue, see serviceAsync()
+AsyncOp _asyncQueue[DS3231_ASYNC_QUEUE_SIZE];
+uint8_t _asyncHead = 0;		//next op to run
+uint8_t _asyncCount = 0;	//ops in the queue
+uint16_t _asyncNextTicket = 1;
+uint16_t _asyncCompletedTicket = 0;	//tickets finish in order, so this says which are done
+DateTime _asyncDateTime;	//result of the last readDateTimeAsync()
+AsyncStats _asyncStats = {0, 0, 0, 0, 0, 0, 0};
+
 
 /*****************************************************************
 * setTime(Time t) 
 * @t - Time object with time settings to make
 *      handles decimal to BCD conversion where needed
+* Seconds, minutes and hours go out in one auto-incrementing
+* write, so the 1 Hz tick can't land between them
 ******************************************************************/
 void setTime(Time t) {
-	if(twelveHourMode) {
-		t.hour12 = _toBcd(t.hour12 & 0x1f);
-		t.hour12 |= 0x40;	//sets 12 hour bit high	
-		if(t.pm) {
-			t.hour12 |= 0x20;	//sets PM high
+	uint8_t regs[3];
+	regs[0] = _toBcd(t.second);		//0x00
+	regs[1] = _toBcd(t.minute);		//0x01
+	regs[2] = _hourRegister(t, twelveHourMode);	//0x02
+	_writeClock(&_ds3231, DS3231_SECONDS, regs, 3, JOURNAL_SET_TIME);
+}
+/*****************************************************************
+* setDateTime(DateTime dt) 
+* @dt - DateTime object with the time and date settings to make
+* Writes seconds through year (0x00-0x06) in one transaction.
+* Writing the seconds register also restarts the DS3231's
+* countdown chain, so the whole clock starts fresh from here
+******************************************************************/
+void setDateTime(DateTime dt) {
+	uint8_t regs[7];
+	_dateTimeRegisters(dt, twelveHourMode, regs);
+	_writeClock(&_ds3231, DS3231_SECONDS, regs, 7, JOURNAL_SET_DATETIME);
+}
+/************************************************
+* DateTime readDateTime(void) 
+* Reads registers 0x00-0x06 in one transaction. The DS3231
+* auto-increments its register pointer, so one requestFrom()
+* returns seconds through year. All fields come from the same
+* instant, so there is no tearing when the clock rolls over.
+* @return - time & date read from DS3231, converted from BCD to decimal.
+*           If the read fails, the last good one - possibly stale,
+*           ds3231LastError() says whether it is
+*************************************************/
+DateTime readDateTime(void){
+	DateTime dt;
+	readDateTimeChecked(&dt);
+	return dt;
+}
+/************************************************
+* readDateTimeChecked(dt) 
+* @dt - receives the time & date. If the read fails it
+*       gets the last good one instead - never garbage
+* Retries (within DS3231_RETRIES and DS3231_CALL_TIMEOUT_MICROS)
+* both bus errors and reads that aren't a real time & date,
+* e.g. the 0xff a released bus reads as
+* @return - DS3231_OK or DS3231_ERR_...
+*************************************************/
+uint8_t readDateTimeChecked(DateTime *dt){
+	return _readDateTimeChecked(&_ds3231, dt);
+}
+/************************************************
+* _readDateTimeChecked(link, dt) 
+* readDateTimeChecked() for any DS3231, the last good
+* time & date is link's own
+*************************************************/
+uint8_t _readDateTimeChecked(DS3231Link *link, DateTime *dt){
+	uint8_t regs[7];
+	uint8_t result = _readDateTimeRegisters(link, regs);
+	if(result == DS3231_OK)
+		link->lastGood = _decodeDateTime(regs);
+	*dt = link->lastGood;
+	return result;
+}
+/************************************************
+* _readDateTimeRegisters(link, regs) 
+* The checking half of readDateTimeChecked(), for callers
+* that decode the registers themselves
+* @regs - receives registers 0x00-0x06, only good
+*         if DS3231_OK comes back
+* @return - DS3231_OK or DS3231_ERR_...
+*************************************************/
+uint8_t _readDateTimeRegisters(DS3231Link *link, uint8_t *regs){
+	uint8_t result;
+	uint8_t tries = 0;
+	uint32_t start = micros();
+	for(;;) {
+		result = _readChecked(link, DS3231_SECONDS, regs, 7);
+		if(result == DS3231_OK && !_plausibleDateTime(regs)) {
+			link->health.implausible++;
+			result = DS3231_ERR_IMPLAUSIBLE;
+			if(_retryAfter(link, result, start, &tries))
+				continue;
 		}
-		writeRegister(DS3231_HOURS,t.hour12);
+		break;
 	}
-	else {	//24-hour mode
-		t.hour24 = _toBcd(t.hour24);
-		t.hour24 &= 0x3f;	//first two bits low, all else pass through
-		writeRegister(DS3231_HOURS,t.hour24);
+	link->health.lastError = result;
+	return result;
+}
+/************************************************
+* _plausibleDateTime(regs) 
+* @regs - registers 0x00-0x06
+* @return - true if every digit is BCD and every field
+*           in range, date included (for its month)
+*************************************************/
+bool _plausibleDateTime(const uint8_t *regs){
+	uint8_t i;
+	uint8_t hour;
+	uint8_t month;
+	for(i = 0; i < 7; i++) {
+		if((regs[i] & 0x0f) > 9)
+			return false;
+	}
+	if(regs[DS3231_SECONDS] > 0x59 || regs[DS3231_MINUTES] > 0x59)
+		return false;
+	if(regs[DS3231_HOURS] & 0x40) {		//12 hour
+		hour = _fromBcd(regs[DS3231_HOURS] & 0x1f);
+		if(hour < 1 || hour > 12 || (regs[DS3231_HOURS] & 0x80))
+			return false;
 	}
-	writeRegister(DS3231_MINUTES,_toBcd(t.minute));
-	writeRegister(DS3231_SECONDS,_toBcd(t.second));
+	else if(regs[DS3231_HOURS] > 0x23)
+		return false;
+	if(regs[DS3231_DAY] < 1 || regs[DS3231_DAY] > 7)
+		return false;
+	if((regs[DS3231_CEN_MONTH] & 0x60) || regs[DS3231_DEC_YEAR] > 0x99)
+		return false;
+	month = _fromBcd(regs[DS3231_CEN_MONTH] & 0x1f);
+	if(month < 1 || month > 12)
+		return false;
+	return regs[DS3231_DATE] >= 1 && _fromBcd(regs[DS3231_DATE]) <= daysInMonth(
+		_fromBcd(regs[DS3231_DEC_YEAR]) + ((regs[DS3231_CEN_MONTH] & 0x80) ? 2100 : 2000), month);
 }
 /************************************************
-* Time readTime(void) 
-* @return - time read from DS3231, converted from BCD to decimal
+* _decodeDateTime(regs) 
+* @regs - the 7 bytes of registers 0x00-0x06
+* @return - DateTime decoded from them, no bus traffic
 *************************************************/
-Time readTime(void){
-	uint8_t h, m, s;
-	Time timeRet;
-	//Read Hours
-	Wire.beginTransmission(DS3231_ADDR);
-	//Wire.write();
-	Wire.write(DS3231_HOURS);
-	Wire.endTransmission();
-	Wire.requestFrom(DS3231_ADDR,1);
-    h = Wire.read();   
-	//Serial.print("Hours decoded from bcd: "); 
-    //Serial.print(_fromBcd(h));      
- 
-  //Read Minutes
-	Wire.beginTransmission(DS3231_ADDR);
-	//Wire.write(DS3231_WRITE);
-	Wire.write(DS3231_MINUTES);
-	Wire.endTransmission();
-	Wire.requestFrom(DS3231_ADDR,1,false);
-	//Serial.println("Requested minute");
-    m = Wire.read();   
-	//Serial.print("\tMinutes: "); 
-    //Serial.print(_fromBcd(m));      
- 
-	//Read Seconds
-	Wire.beginTransmission(DS3231_ADDR);
-	//Wire.write(DS3231_WRITE);
-	Wire.write(DS3231_SECONDS);
-	Wire.endTransmission();
-	Wire.requestFrom(DS3231_ADDR,1,true);
-	//Serial.println("Requested second");
+DateTime _decodeDateTime(const uint8_t *regs){
+	DS3231_TRACE_SCOPE(TRACE_DECODE);
+	DateTime dt;
+	_decodeHour(regs[DS3231_HOURS], &dt.t);
+	dt.t.minute = _fromBcd(regs[DS3231_MINUTES]);
+	dt.t.second = _fromBcd(regs[DS3231_SECONDS]);
 	
-    s = Wire.read();   
-	//Serial.print("\tSeconds: "); 
-    //Serial.println(_fromBcd(s));    
+	dt.d.weekday = _fromBcd(regs[DS3231_DAY]);
+	dt.d.date = _fromBcd(regs[DS3231_DATE]);
+	dt.d.year = _fromBcd(regs[DS3231_DEC_YEAR]);
+	if (regs[DS3231_CEN_MONTH] & 0x80) 	//Century flag is set, it's 2100!
+		dt.d.year += 2100;
+	else	 //Century flag is clear, it's still the 2000's
+		dt.d.year += 2000;
+	dt.d.month = _fromBcd(regs[DS3231_CEN_MONTH] & 0x1f);	//mask off century bit, two fixed 0's, convert from bcd
+	return dt;
+}
+/************************************************
+* _decodeHour(data, t) 
+* @data - an hours register (time or alarm), the
+*         alarm mask bit is ignored
+* @t - gets hour24, hour12 and pm, whichever mode
+*      the register is in
+*************************************************/
+void _decodeHour(uint8_t data, Time *t){
 	//Hour 0	12/!24	!am/pm/20hour	10hour	hour	hour	hour 	hour
-	if(h & 0x40) {
+	if(data & 0x40) {
 		//12 hour mode
-		timeRet.pm = ((h & 0x20)>>5); //mask !am/pm flag and shift to LSB
-		timeRet.hour12 = _fromBcd(h & 0x1f);
-		timeRet.hour24 = timeRet.hour12;
-		if(timeRet.pm) {
-			timeRet.hour24 += 12;
+		t->pm = ((data & 0x20)>>5); //mask !am/pm flag and shift to LSB
+		t->hour12 = _fromBcd(data & 0x1f);
+		t->hour24 = t->hour12 % 12;	//12 AM is hour 0, 12 PM is hour 12
+		if(t->pm) {
+			t->hour24 += 12;
 		} 
 	}
 	else {	
 		//24 hour mode
-		timeRet.hour24 = _fromBcd(h);
-		timeRet.pm = 0;
-		timeRet.hour12 = timeRet.hour24;
-		if(timeRet.hour24 > 12) {
-			timeRet.hour12 -= 12;
-			timeRet.pm = 1;
-		}
+		t->hour24 = _fromBcd(data & 0x3f);
+		_setHour12(t);
 	}
-	timeRet.minute = _fromBcd(m);
-	timeRet.second = _fromBcd(s);
-	return timeRet;
+}
+/************************************************
+* Time readTime(void) 
+* @return - time read from DS3231, converted from BCD to decimal
+* If you need the date too, call readDateTime() instead
+*************************************************/
+Time readTime(void){
+	return readDateTime().t;
 }
 
 /************************************************
 * setDate(Date d) 
 * sets date registers in DS3231
-* @d - date object with decimal values for year
-*      and date. 1-7 for weekday, and 1-12 for month
+* @d - date object with decimal values for year (2000-2199)
+*      and date, and 1-12 for month. d.weekday is ignored,
+*      the right weekday is worked out from the date
+* Day, date, month and year (0x03-0x06) are written
+* in one transaction
 *************************************************/
 void setDate(Date d){
-	uint8_t regData = 0;
-	//Write tens and ones of year into register 0x06
-	writeRegister(DS3231_DEC_YEAR,_toBcd(d.year-2000));
-	//start building century + 00 + 10month + month
-	regData = _toBcd(d.month);	//convert to bcd 
-	if(d.year >= 2100)
-		regData |= 0x80;	//set the century bit if needed
-	
-	writeRegister(DS3231_CEN_MONTH,regData);	//write century flag + 00 + 10month + 1month
-	writeRegister(DS3231_DATE,_toBcd(d.date));	//write date
-	writeRegister(DS3231_DAY,_toBcd(d.weekday));	//write weekday
+	uint8_t regs[4];
+	_dateRegisters(d, regs);
+	_writeClock(&_ds3231, DS3231_DAY, regs, 4, JOURNAL_SET_DATE);
 }
 /*****************************************************************
 * Date readDate(void) 
 * @return - date read from DS3231, converted from BCD to decimal
+* If you need the time too, call readDateTime() instead
 ******************************************************************/
 Date readDate(void){
-	
-	Date d;
-	
-	//Read Year
-	Wire.beginTransmission(DS3231_ADDR);
-	Wire.write(DS3231_DEC_YEAR);
-	Wire.endTransmission();
-	Wire.requestFrom(DS3231_ADDR,1);
-    d.year = _fromBcd(Wire.read());   
-	//Read Month & Century
-	Wire.beginTransmission(DS3231_ADDR);
-	Wire.write(DS3231_CEN_MONTH);
-	Wire.endTransmission();
-	Wire.requestFrom(DS3231_ADDR,1);
-    d.month = Wire.read();   
-	if (d.month & 0x80) 	//Century flag is set, it's 2100!
-		d.year += 2100;
-	else	 //Century flag is clear, it's still the 2000's
-		d.year += 2000;
-	d.month = _fromBcd(d.month & 0x1f);	//mask off century bit, two fixed 0's, convert from bcd
-	//Read Date
-	Wire.beginTransmission(DS3231_ADDR);
-	Wire.write(DS3231_DATE);
-	Wire.endTransmission();
-	Wire.requestFrom(DS3231_ADDR,1);
-    d.date = _fromBcd(Wire.read());   
-	//Read Weekday
-	Wire.beginTransmission(DS3231_ADDR);
-	Wire.write(DS3231_DAY);
-	Wire.endTransmission();
-	Wire.requestFrom(DS3231_ADDR,1);
-    d.weekday = _fromBcd(Wire.read());   
-	
-	return d;
+	return readDateTime().d;
 }
 /************************************************
 * setAlarm(AlarmSetting a) 
@@ -172,143 +298,303 @@ Date readDate(void){
     //                        ------------------------------------------------------------
 *************************************************/
 void setAlarm(AlarmSetting a){
-	uint8_t data;
-	if(!(a.alarm_mask & 0x80)) { //true is MSB = 0, therefore alarm 1
-		//Start building register 0x07, A1M1 + seconds
-		data = _toBcd(a.t.second);
-		//Set bit A1M1 in data to match A1M1 in alarm_mask
-		if(a.alarm_mask & 0x01)
-			data |= 0x80;
-		writeRegister(DS3231_ALARM1_SECONDS,data);
-		//same for minutes and A1M2 for register 0x08
-		data = _toBcd(a.t.minute);
-		if(a.alarm_mask & 0x02)
-			data |= 0x80;
-		writeRegister(DS3231_ALARM1_MINUTES,data);
-		//For the hours register, we need to know if time is stored in 12 or 24 hour mode.
-		//The alarms sounds when the registers match, so the alarms need to be set
-		//in the same mode as the time. The clock may be displaying either, regardless
-		//of which is stored, so passing that setting here would not have helped
-		data = readRegister(DS3231_HOURS);
-		if(data & 0x40) {  //12 hour mode
-			data = _toBcd(a.t.hour12);
-			data |= 0x40;	//set 12/!24 bit
-			if(a.t.pm)
-				data |= 0x20;	//if pm = 1, set pm flag = 1
-		}
-		else { //24 hour mode
-			data = _toBcd(a.t.hour24);
-		}
-		if(a.alarm_mask & 0x04)
-				data |= 0x80;	//if A1M3 is set in incoming data, set A1M3 in outgoing data
-		writeRegister(DS3231_ALARM1_HOURS,data);
-		//If A1M4 == 1, then it's an everyday alarm and none of the rest of register 0x0A matters
-		if(a.alarm_mask & 0x08) {
-			writeRegister(DS3231_ALARM1_DAY_DATE, 0x80); //Setting A1M4, clearing the rest, they will be ignored
-		}
-		else { 	//Either the day or the date will be set in incoming data, DY/!DT determines how it is interpreted
-			data = 0x00;
-			//leave MSB A1M4 = 0 since it's 0 in alarm_mask
-			//next get the BCD number loaded, then OR in the remaining flag
-			if(a.alarm_mask & 0x10) { //DY/!DT == 1, so it's day
-				data = _toBcd(a.weekday);
-				data |= 0x40;	
-			}
-			else { //date
-				data = _toBcd(a.date);
-				data &= 0xbf;	//sets DY/!DT to 0
-			}
-			writeRegister(DS3231_ALARM1_DAY_DATE, data);
-		}
-		//All Alarm 1 registers are set
-	} //end if (alarm 1)
-	else { //MSB = 1, so alarm 2
-		//Minutes register
-		data = _toBcd(a.t.minute);
-		//Need to OR in A2M2
-		if(a.alarm_mask & 0x01)
-			data |= 0x80;
-		writeRegister(DS3231_ALARM2_MINUTES, data);
-		//Hour register - read 12/24 mode
-		data = readRegister(DS3231_HOURS);
-		if(data & 0x40) {  //12 hour mode
-			data = _toBcd(a.t.hour12);
-			data |= 0x40;	//set 12/!24 bit
-			if(a.t.pm)
-				data |= 0x20;	//if pm = 1, set pm flag = 1
-		}
-		else { //24 hour mode
-			data = _toBcd(a.t.hour24);
-		}
-		if(a.alarm_mask & 0x02)
-				data |= 0x80;	//if A2M3 is set in incoming data, set A2M3 in outgoing data
-		writeRegister(DS3231_ALARM2_HOURS,data);
-		// Day/Date Register: if A2M4 == 1, then everyday & rest of register is 'don't care'.
-		if(a.alarm_mask & 0x04) {
-			writeRegister(DS3231_ALARM2_DAY_DATE, 0x80);
-		}
-		else { //day or date, DY/!DT tells which
-			data = 0x00;
-			if(a.alarm_mask & 0x08) { //day
-				data = _toBcd(a.weekday);
-				data |= 0x40;	//set day flag
-			}
-			else { //date
-				data = _toBcd(a.date);
-				data &= 0xbf;	//sets DY/!DT to 0
-			}
-			writeRegister(DS3231_ALARM2_DAY_DATE, data);
-		}
-		//All Alarm 2 registers are set
-	} //end else alarm 2
+	uint8_t regs[4];
+	uint8_t reg;
+	bool twelve;
+	//For the hours register, we need to know if time is stored in 12 or 24 hour mode.
+	//The alarms sounds when the registers match, so the alarms need to be set
+	//in the same mode as the time. The clock may be displaying either, regardless
+	//of which is stored, so passing that setting here would not have helped
+	if(_isTwelveHourMode(&twelve) != DS3231_OK)
+		return;		//don't guess, ds3231LastError() says why
+	reg = encodeAlarm(a, twelve, regs);
+	//All registers for the alarm in one write
+	writeRegisters(reg, regs, reg == DS3231_ALARM1_SECONDS ? 4 : 3);
+}
+/************************************************
+* readAlarm(alarm) 
+* @alarm - 1 or 2
+* @return - the alarm as it's programmed now, from one
+*           burst read of its registers. See decodeAlarm()
+*           If the read failed (see ds3231LastError()) it's
+*           decoded from zeroed registers
+*************************************************/
+AlarmSetting readAlarm(uint8_t alarm){
+	uint8_t regs[4] = {0, 0, 0, 0};
+	uint8_t i = alarm == 2;
+	readRegisters(_alarmLayout[i].firstReg, regs, _alarmLayout[i].count);
+	return decodeAlarm(regs, alarm);
+}
+/************************************************
+* Alarm register layout. Every alarm register is a
+* field with its AxMn mask bit on top. Alarm 1 has
+* seconds, minutes, hours, day/date; alarm 2 is the
+* same without seconds. In alarm_mask, AxMn for
+* register i is bit i, and DY/!DT is the bit after
+* the last AxMn (see AlarmSetting in DS3231_tisc.h).
+* encodeAlarm() and decodeAlarm() both work from
+* this, so they can't disagree about where things go
+*************************************************/
+#define ALARM_FIELD_SECONDS 0
+#define ALARM_FIELD_MINUTES 1
+#define ALARM_FIELD_HOURS   2
+#define ALARM_FIELD_DAYDATE 3
+const AlarmLayout _alarmLayout[2] = {
+	{DS3231_ALARM1_SECONDS, 4, ALARM_FIELD_SECONDS},	//alarm 1, alarm_mask bit 7 = 0
+	{DS3231_ALARM2_MINUTES, 3, ALARM_FIELD_MINUTES},	//alarm 2, alarm_mask bit 7 = 1
+};
+/************************************************
+* encodeAlarm(a, twelve, regs) 
+* Encodes an AlarmSetting into register values, no bus traffic
+* @a - AlarmSetting, alarm_mask MSB picks alarm 1 or 2
+* @twelve - true if the DS3231 keeps time in 12 hour mode
+* @regs - receives 4 bytes for alarm 1 (0x07-0x0A)
+*         or 3 bytes for alarm 2 (0x0B-0x0D)
+* @return - first register to write them to
+*************************************************/
+uint8_t encodeAlarm(AlarmSetting a, bool twelve, uint8_t *regs){
+	const AlarmLayout *layout = &_alarmLayout[a.alarm_mask >> 7];
+	uint8_t fields[4];
+	uint8_t i;
+	fields[ALARM_FIELD_SECONDS] = _toBcd(a.t.second);
+	fields[ALARM_FIELD_MINUTES] = _toBcd(a.t.minute);
+	fields[ALARM_FIELD_HOURS] = _hourRegister(a.t, twelve);
+	if(a.alarm_mask & (1 << layout->count))		//DY/!DT
+		fields[ALARM_FIELD_DAYDATE] = _toBcd(a.weekday) | 0x40;
+	else
+		fields[ALARM_FIELD_DAYDATE] = _toBcd(a.date);
+	for(i = 0; i < layout->count; i++)
+		regs[i] = fields[layout->firstField + i] | ((a.alarm_mask >> i & 1) << 7);	//AxMn on top
+	if(regs[layout->count - 1] & 0x80)
+		regs[layout->count - 1] = 0x80;		//AxM4 - every day, the day/date is ignored
+	return layout->firstReg;
+}
+/************************************************
+* decodeAlarm(regs, alarm) 
+* Inverse of encodeAlarm(), no bus traffic
+* @regs - 4 bytes from 0x07 for alarm 1, 3 from 0x0B for alarm 2
+* @alarm - 1 or 2
+* @return - the AlarmSetting encodeAlarm() would have made
+*           them from. Time is filled in for both 12 and 24
+*           hours, whichever mode the registers are in. Only
+*           one of date and weekday is filled in, the one the
+*           alarm matches, the other is 0. Fields the alarm
+*           ignores are decoded as they are in the registers
+*************************************************/
+AlarmSetting decodeAlarm(const uint8_t *regs, uint8_t alarm){
+	const AlarmLayout *layout = &_alarmLayout[alarm == 2];
+	AlarmSetting a;
+	uint8_t fields[4] = {0, 0, 0, 0};	//alarm 2 goes off at 00 seconds
+	uint8_t i;
+	a.alarm_mask = alarm == 2 ? 0x80 : 0x00;
+	for(i = 0; i < layout->count; i++) {
+		fields[layout->firstField + i] = regs[i] & 0x7f;
+		a.alarm_mask |= (regs[i] >> 7) << i;	//AxMn
+	}
+	if(!(regs[layout->count - 1] & 0x80) && (fields[ALARM_FIELD_DAYDATE] & 0x40))
+		a.alarm_mask |= 1 << layout->count;		//DY/!DT, only counts if AxM4 is clear
+	a.t.second = _fromBcd(fields[ALARM_FIELD_SECONDS]);
+	a.t.minute = _fromBcd(fields[ALARM_FIELD_MINUTES]);
+	_decodeHour(fields[ALARM_FIELD_HOURS], &a.t);
+	if(fields[ALARM_FIELD_DAYDATE] & 0x40) {
+		a.weekday = _fromBcd(fields[ALARM_FIELD_DAYDATE] & 0x0f);
+		a.date = 0;
+	}
+	else {
+		a.date = _fromBcd(fields[ALARM_FIELD_DAYDATE] & 0x3f);
+		a.weekday = 0;
+	}
+	return a;
 }
 /****************************************************************************
 * turnAlarmOn(alarms)
 * @alarms - alarms to turn on. 1=Alarm 1, 2=Alarm 2, 3=Both Alarms
 * Sets the interrupt enable flag for the requested alarms (A1IE, A2IE)
 * Clears the interrupt flag for requested alarms to avoid immediate interrupt
+* If either register can't be read, CONTROL is left alone (see ds3231LastError())
 *****************************************************************************/
 void turnAlarmOn(uint8_t alarms){
     uint8_t data;
     alarms &= 0x03;
     //Clear interrupt flag for any alarms we are turning on
-    data = readRegister(DS3231_STATUS);
-    //if alarms 1 is set and the DS3231 interrupt flag for alarm 1 is already set, clear it
-    if(alarms & 0x01 && data & 0x01)                                  
-      data &= 0xfe;
-    //same for alarm 2
-    if(alarms & 0x02 && data & 0x02)
-      data &= 0xfd;
-    writeRegister(DS3231_STATUS,data);
+    if(_clearAlarmFlags(alarms) != DS3231_OK)
+      return;
     //Get the alarm interrupt register
-    data = readRegister(DS3231_CONTROL);
+    if(_getControl(&data) != DS3231_OK)
+      return;
     //Set alarm 1 and/or 2 interrupt enable flags by ORing them in
     data |= alarms;
     writeRegister(DS3231_CONTROL,data);
 }
+/****************************************************************************
+* turnAlarmOff(alarms)
+* @alarms - alarms to turn off. 1=Alarm 1, 2=Alarm 2, 3=Both Alarms
+* Clears the interrupt enable flag for the requested alarms (A1IE, A2IE)
+* If CONTROL can't be read it's left alone (see ds3231LastError())
+*****************************************************************************/
+void turnAlarmOff(uint8_t alarms){
+    uint8_t data;
+    if(_getControl(&data) == DS3231_OK)
+      writeRegister(DS3231_CONTROL, data & ~(alarms & 0x03));
+}
 /*********************************************************
 * getAlarmStatus() - returns the state of A1IE and A2IE
 * bits in the DS3231 Control register
 * 0 = both disabled, 1= Alarm 1 interrupts enabled
 * 2= Alarm 2 interrupts enabled, 3= Both alarms enabled
+* 0 also if CONTROL couldn't be read, see ds3231LastError()
 *********************************************************/
 uint8_t getAlarmStatus(){
-	return readRegister(DS3231_CONTROL) & 0x03;
+	uint8_t data;
+	if(_getControl(&data) != DS3231_OK)
+		return 0;
+	return data & 0x03;
 }
 /*****************************************************************
 * uint8_t serviceAlarms() 
 * Determine which alarm(s) are tripped (flag set in Status register)
 * Clear the alarm flags
+* If something took over Alarm 1 with setAlarm1Hook() (the alarm
+* scheduler does), Alarm 1 is handed to it and not returned here
 * returns which alarms were tripped (0=none,1,2,3=both)
+* If STATUS can't be read, or the flags can't be cleared, returns 0
+* and the flags are still there to be found next time
 *******************************************************************/
 uint8_t serviceAlarms() {
   uint8_t data;
-  //Read the flags
-  data = readRegister(DS3231_STATUS);
-  //Clear both alarm flags to clear interrupt
-  writeRegister(DS3231_STATUS,data & 0xfc);
-  return data & 0x03;
-  
+  //Read the flags - always from the chip, it sets them on its own
+  if(readRegistersChecked(DS3231_STATUS, &data, 1) != DS3231_OK)
+    return 0;
+  data &= 0x03;
+  //Clear the alarm flags that were set to clear interrupt. If that fails
+  //they're still set, so report them when they're cleared, not twice
+  if(data && _clearAlarmFlags(data) != DS3231_OK)
+    return 0;
+  return _runAlarm1Hook(data);
+}
+/*****************************************************************
+* alarmEventISR() 
+* Use as the alarm interrupt handler, or call it from yours:
+* "attachInterrupt(digitalPinToInterrupt(ALARM_INTERRUPT_PIN), alarmEventISR, FALLING);"
+* Stamps the event with micros() and a sequence number and pushes
+* it on the event ring. If the ring is full the event is counted
+* as an overflow instead - the sequence numbers will show the gap.
+*****************************************************************/
+void alarmEventISR(void) {
+	uint8_t head = _eventHead;
+	uint8_t next = (head + 1) & (DS3231_EVENT_QUEUE_SIZE - 1);
+	_eventSequence++;
+	if(next == _eventTail) {
+		_eventOverflows++;
+		return;
+	}
+	_events[head].micros = micros();
+	_events[head].sequence = _eventSequence;
+	EVENT_BARRIER();		//event is written before it's published
+	_eventHead = next;
+}
+/*****************************************************************
+* alarmEventsPending() 
+* @return - events the ISR has queued that serviceAlarms() hasn't taken
+*****************************************************************/
+uint8_t alarmEventsPending(void) {
+	return (_eventHead - _eventTail) & (DS3231_EVENT_QUEUE_SIZE - 1);
+}
+/*****************************************************************
+* serviceAlarms(events, maxEvents) 
+* Event version of serviceAlarms() for use with alarmEventISR().
+* Does nothing, and no bus traffic, if no interrupts came in.
+* Otherwise reads and clears the alarm flags once, and copies out
+* every queued event. Each gets those flags in .alarms (the DS3231
+* can only tell us what's set now, not which interrupt set what)
+* and how long it waited in the queue in .latencyMicros.
+* @events - array to receive the events
+* @maxEvents - size of events, any beyond that stay queued
+* @return - number of events copied out
+*****************************************************************/
+uint8_t serviceAlarms(AlarmEvent *events, uint8_t maxEvents) {
+	uint8_t count = 0;
+	uint8_t tail = _eventTail;
+	uint8_t alarms;
+	uint32_t now;
+	if(tail == _eventHead)
+		return 0;
+	alarms = serviceAlarms() | _eventCarryFlags;
+	now = micros();
+	while(count < maxEvents && tail != _eventHead) {
+		EVENT_BARRIER();	//read the event only after seeing it published
+		events[count] = _events[tail];
+		events[count].alarms = alarms;
+		events[count].latencyMicros = now - events[count].micros;
+		_eventStats.lastLatencyMicros = events[count].latencyMicros;
+		if(events[count].latencyMicros > _eventStats.maxLatencyMicros)
+			_eventStats.maxLatencyMicros = events[count].latencyMicros;
+		tail = (tail + 1) & (DS3231_EVENT_QUEUE_SIZE - 1);
+		count++;
+	}
+	EVENT_BARRIER();		//done with the slots before handing them back
+	_eventTail = tail;
+	_eventCarryFlags = (tail != _eventHead) ? alarms : 0;	//flags were cleared, remember them for the rest
+	_eventStats.events += count;
+	return count;
+}
+/*****************************************************************
+* getAlarmEventStats() 
+* @return - events serviced, events dropped because the ring was
+*           full, and interrupt-to-service latency
+*****************************************************************/
+AlarmEventStats getAlarmEventStats(void) {
+	noInterrupts();
+	_eventStats.overflows = _eventOverflows;
+	interrupts();
+	return _eventStats;
+}
+/*****************************************************************
+* setAlarm1Hook(hook) 
+* @hook - function to call whenever serviceAlarms() (or
+*         tickClockService()/serviceAlarmsAsync()) finds Alarm 1
+*         tripped, NULL to hand Alarm 1 back to the caller
+*****************************************************************/
+void setAlarm1Hook(AlarmHook hook) {
+	_alarm1Hook = hook;
+}
+/*****************************************************************
+* setJournalHook(hook) 
+* @hook - function to call with JOURNAL_ALARM whenever alarm flags
+*         are found (before the Alarm 1 hook takes its share), and
+*         with JOURNAL_SET_... after each write of the time or
+*         date. NULL for none. journalBegin() sets it
+*****************************************************************/
+void setJournalHook(JournalHook hook) {
+	_journalHook = hook;
+}
+void _journalEvent(uint8_t event, uint8_t data) {
+	if(_journalHook)
+		_journalHook(event, data);
+}
+/*****************************************************************
+* _runAlarm1Hook(alarms) 
+* @alarms - flags just found and cleared, journaled here since
+*           every way of servicing the alarms ends up here
+* @return - alarms, less Alarm 1 if a hook took it
+*****************************************************************/
+uint8_t _runAlarm1Hook(uint8_t alarms) {
+	if(alarms)
+		_journalEvent(JOURNAL_ALARM, alarms);
+	if(!(alarms & 0x01) || !_alarm1Hook)
+		return alarms;
+	_alarm1Hook();
+	return alarms & 0x02;
+}
+/*****************************************************************
+* currentDateTime() 
+* @return - the time & date from the software clock if
+*           startTickClock() is running, otherwise from readDateTime()
+*****************************************************************/
+DateTime currentDateTime(void) {
+	if(_tickRunning)
+		return tickClockNow();
+	return readDateTime();
 }
 /*******************************************************************
 * toggleAlarms()
@@ -319,13 +605,15 @@ uint8_t serviceAlarms() {
 * >Alarm 1 off, Alarm 2 on
 * >both on
 * Returns the resulting state. 
+* Returns 0 and changes nothing if CONTROL can't be read, see ds3231LastError()
 * Related: You can check the state without changing it by calling getAlarmStatus(). 
 * Related: You can set/clear a specific alarm with turnAlarmOn()
 *********************************************************************/
 uint8_t toggleAlarms() {
   uint8_t data;
   uint8_t current;
-  data = readRegister(DS3231_CONTROL);
+  if(_getControl(&data) != DS3231_OK)
+    return 0;
   current = data & 0x03;
   if(++current > 3)
     current = 0;
@@ -359,15 +647,427 @@ void initializeDS3231(void) {
     // the Alarm 1 and Alarm 2 interrupts until the alarms are turned on
     // These are the default DS3231 settings, but it could easily be in an unknown state
     // since it has battery backup
-    //read existing contents of control register
-  
-    data = readRegister(DS3231_CONTROL);
-  
-    //set the INTCN, A2IE, and A1IE bits, leave all else alone
-    data &= 0xfc; //clear A1IE and A2IE
-    data |= 0x04; //Set INTCN, use SQW/!INT pin as !INT
-    //write the data back to the register
-    writeRegister(DS3231_CONTROL, data);
+    //read existing contents of control register, leave it alone if we can't
+    if(_getControl(&data) == DS3231_OK) {
+      //set the INTCN, A2IE, and A1IE bits, leave all else alone
+      data &= 0xfc; //clear A1IE and A2IE
+      data |= 0x04; //Set INTCN, use SQW/!INT pin as !INT
+      //write the data back to the register
+      writeRegister(DS3231_CONTROL, data);
+    }
+    _clockWasSet();
+}
+
+/*****************************************************************************************
+* startTickClock(resyncMinutes) 
+* Keeps time in software instead of reading the DS3231 every time you want to know it.
+* - Sets RS2/RS1 for a 1 Hz square wave and clears INTCN so it comes out the SQW/!INT pin.
+*   With INTCN clear, alarms no longer pull the pin low, so tickClockService() checks
+*   the alarm flags instead (only when an alarm is enabled, and only once a second)
+* - Loads the software clock from the DS3231
+* - The seconds register increments on the falling edge of the 1 Hz output
+*   >IN YOUR setup() ADD:
+*	>"attachInterrupt(digitalPinToInterrupt(ALARM_INTERRUPT_PIN), tickClockISR, FALLING);"
+*	>OR CALL tickClockISR() FROM YOUR OWN ISR
+* - Then call tickClockService() from loop() and tickClockNow() whenever you need the time
+* @resyncMinutes - reload from the chip this often, 0 to only reload when the drift check fails
+* If CONTROL can't be read the tick clock isn't started, see ds3231LastError()
+*******************************************************************************************/
+void startTickClock(uint8_t resyncMinutes) {
+	uint8_t data;
+	if(_getControl(&data) != DS3231_OK)
+		return;
+	data &= 0xe3;	//clear RS2, RS1 (1 Hz) and INTCN (square wave out)
+	writeRegister(DS3231_CONTROL, data);
+	_resyncSeconds = resyncMinutes * 60;
+	_tickRunning = true;
+	_tickClockResync();
+}
+/*****************************************************************
+* stopTickClock() 
+* Sets INTCN again so the SQW/!INT pin goes back to signalling alarms
+*****************************************************************/
+void stopTickClock(void) {
+	uint8_t data;
+	_tickRunning = false;
+	if(_getControl(&data) == DS3231_OK)
+		writeRegister(DS3231_CONTROL, data | 0x04);
+}
+/*****************************************************************
+* tickClockISR() 
+* Call on each falling edge of the 1 Hz output. Kept to a single
+* increment, all the calendar work happens in tickClockNow()
+*****************************************************************/
+void tickClockISR(void) {
+	_tickCount++;
+	_tickEdgeMillis = millis();
+}
+/*****************************************************************
+* tickClockNow() 
+* @return - the current time & date from the software clock,
+*           no bus traffic. Catches up on any ticks since last call.
+*****************************************************************/
+DateTime tickClockNow(void) {
+	uint32_t count;
+	noInterrupts();		//32 bit read isn't atomic on AVR
+	count = _tickCount;
+	interrupts();
+	while(_ticksApplied != count) {
+		_tickNow = advanceDateTime(_tickNow);
+		_ticksApplied++;
+		_secondsSinceSync++;
+	}
+	return _tickNow;
+}
+/*****************************************************************
+* tickClockService() 
+* Call from loop(). At most once per tick it:
+* - reloads the software clock from the DS3231 if the time was
+*   set, or the resync period is up
+* - otherwise reads just the seconds register if it's been a
+*   minute or more since it last did, and reloads if it doesn't
+*   match (the drift check)
+* - checks and clears the alarm flags if an alarm is enabled. The
+*   enable bits are the library's own copy from its last read or
+*   write of CONTROL, so that's not read every tick -
+*   invalidateRegisterCache() if something else writes it
+* @return - which alarms were tripped (0=none,1,2,3=both), same as serviceAlarms()
+*****************************************************************/
+uint8_t tickClockService(void) {
+	DateTime now;
+	uint8_t control;
+	if(!_tickRunning)
+		return 0;
+	now = tickClockNow();
+	if(_ticksApplied == _lastServicedTick && !_tickResyncNeeded)
+		return 0;	//nothing new since last time
+	_lastServicedTick = _ticksApplied;
+	if(_tickResyncNeeded || (_resyncSeconds && _secondsSinceSync >= _resyncSeconds)) {
+		_tickClockResync();
+	}
+	else if(_ticksApplied - _lastDriftTick >= TICK_DRIFT_SECONDS) {
+		_lastDriftTick = _ticksApplied;
+		_tickStats.driftChecks++;
+		if(readBcdRegister(DS3231_SECONDS) != now.t.second) {
+			_tickStats.driftFailures++;
+			_tickClockResync();
+		}
+	}
+	if(_tickAlarmEnables == TICK_ENABLES_UNKNOWN && _getControl(&control) == DS3231_OK)
+		_tickAlarmEnables = control & 0x03;
+	if(_tickAlarmEnables != TICK_ENABLES_UNKNOWN && _tickAlarmEnables)	//A1IE or A2IE set
+		return serviceAlarms();
+	return 0;
+}
+/*****************************************************************
+* getTickClockStats() 
+* @return - resync count, drift checks made and how many failed
+*****************************************************************/
+TickClockStats getTickClockStats(void) {
+	return _tickStats;
+}
+/*****************************************************************
+* _tickClockResync() 
+* Reloads the software clock from the DS3231. If a tick lands
+* while we're reading, we can't tell if the chip had already
+* counted it, so read again.
+*****************************************************************/
+void _tickClockResync(void) {
+	uint32_t before, after;
+	DateTime dt;
+	uint8_t result;
+	do {
+		noInterrupts();
+		before = _tickCount;
+		interrupts();
+		result = readDateTimeChecked(&dt);
+		noInterrupts();
+		after = _tickCount;
+		interrupts();
+	} while(before != after);
+	if(result != DS3231_OK)
+		return;		//keep ticking on what we had, it's tried again next second
+	_tickNow = dt;
+	_ticksApplied = after;
+	_lastServicedTick = after;
+	_lastDriftTick = after;
+	_secondsSinceSync = 0;
+	_tickResyncNeeded = false;
+	_tickStats.resyncs++;
+}
+/*****************************************************************
+* _writeClock(link, reg, regs, len, event) 
+* Writes time and/or date registers, checked. If link is the free
+* functions' DS3231, the tick clock, aging controller and journal
+* (event, with the result) are told
+* @return - DS3231_OK or DS3231_ERR_...
+*****************************************************************/
+uint8_t _writeClock(DS3231Link *link, uint8_t reg, const uint8_t *regs, uint8_t len, uint8_t event) {
+	uint8_t result = _writeChecked(link, reg, regs, len);
+	if(link == &_ds3231) {
+		_clockWasSet();
+		_journalEvent(event, result);
+	}
+	return result;
+}
+/*****************************************************************
+* _clockWasSet() 
+* Called by everything that writes the time or date registers
+*****************************************************************/
+void _clockWasSet(void) {
+	_tickResyncNeeded = true;
+	_clockSets++;
+}
+/*****************************************************************
+* _clockSetCount() 
+* @return - how many times the time or date has been written. If
+*           it's changed, times read before and after can't be
+*           compared (the aging offset controller uses this)
+*****************************************************************/
+uint16_t _clockSetCount(void) {
+	return _clockSets;
+}
+/*****************************************************************
+* advanceDateTime(dt) 
+* @dt - time & date to move forward
+* @return - dt plus one second, rolling over minutes, hours, days,
+*           months (by month length, with leap years) and years.
+*           Past 2199 it wraps to 2000, same as the century bit.
+*****************************************************************/
+DateTime advanceDateTime(DateTime dt) {
+	if(++dt.t.second < 60)
+		return dt;
+	dt.t.second = 0;
+	if(++dt.t.minute < 60)
+		return dt;
+	dt.t.minute = 0;
+	if(++dt.t.hour24 > 23)
+		dt.t.hour24 = 0;
+	_setHour12(&dt.t);
+	if(dt.t.hour24 != 0)
+		return dt;
+	//Midnight - new day
+	if(++dt.d.weekday > 7)
+		dt.d.weekday = 1;
+	if(++dt.d.date <= daysInMonth(dt.d.year, dt.d.month))
+		return dt;
+	dt.d.date = 1;
+	if(++dt.d.month <= 12)
+		return dt;
+	dt.d.month = 1;
+	if(++dt.d.year > 2199)
+		dt.d.year = 2000;
+	return dt;
+}
+/*****************************************************************
+* daysInMonth(year, month) 
+* @year - 4 digit year
+* @month - 1=Jan...12=Dec
+* @return - number of days in that month, 29 for February in leap years
+*****************************************************************/
+uint8_t daysInMonth(uint16_t year, uint8_t month) {
+	if(month == 2) {
+		if((year % 4 == 0 && year % 100 != 0) || year % 400 == 0)
+			return 29;
+		return 28;
+	}
+	if(month == 4 || month == 6 || month == 9 || month == 11)
+		return 30;
+	return 31;
+}
+/*****************************************************************
+* weekdayOf(year, month, date) 
+* @return - 1=Sun...7=Sat for that date
+*****************************************************************/
+uint8_t weekdayOf(uint16_t year, uint8_t month, uint8_t date) {
+	return (_daysFromCivil(year, month, date) + 6) % 7 + 1;	//2000-01-01 was a Saturday (7)
+}
+/*****************************************************************
+* readEpoch() 
+* @return - current time & date from the DS3231 as Unix time
+*           (seconds since 1970-01-01 00:00:00), one burst read
+*****************************************************************/
+uint32_t readEpoch(void) {
+	return dateTimeToEpoch(readDateTime());
+}
+/*****************************************************************
+* setEpoch(epoch) 
+* @epoch - Unix time to set, 2000-01-01 or later. Earlier than that
+*          sets 2000-01-01 00:00:00, the DS3231 can't go back further
+* Time and date go out in one transaction, weekday worked out
+*****************************************************************/
+void setEpoch(uint32_t epoch) {
+	setDateTime(epochToDateTime(epoch));
+}
+/*****************************************************************
+* readEpochMillis(millisPart) 
+* @millisPart - receives how far into the second it is, 0-999.
+*        Only known while the tick clock is running (from the
+*        last 1 Hz edge), otherwise it's 500 - mid-second, the
+*        best guess there is
+* @return - current Unix time, like readEpoch()
+*****************************************************************/
+uint32_t readEpochMillis(uint16_t *millisPart) {
+	uint32_t count, edge, elapsed, epoch;
+	uint8_t tries = 0;
+	bool edgeMissed;
+	if(!_tickRunning) {
+		*millisPart = 500;
+		return readEpoch();
+	}
+	do {	//if an edge comes during the read, the seconds and phase won't agree, so go again
+		noInterrupts();
+		count = _tickCount;
+		edge = _tickEdgeMillis;
+		interrupts();
+		epoch = readEpoch();
+		elapsed = millis() - edge;
+		noInterrupts();
+		edgeMissed = count != _tickCount;
+		interrupts();
+	} while(edgeMissed && ++tries < 3);
+	*millisPart = elapsed > 999 ? 999 : elapsed;
+	return epoch;
+}
+/*****************************************************************
+* dateTimeToEpoch(dt) 
+* @dt - time & date, uses hour24, not hour12/pm
+* @return - Unix time of dt
+*****************************************************************/
+uint32_t dateTimeToEpoch(DateTime dt) {
+	return DS3231_UNIX_2000 + _daysFromCivil(dt.d.year, dt.d.month, dt.d.date) * 86400UL
+		+ dt.t.hour24 * 3600UL + dt.t.minute * 60U + dt.t.second;
+}
+/*****************************************************************
+* epochToDateTime(epoch) 
+* @epoch - Unix time, earlier than 2000 is taken as 2000-01-01 00:00:00
+* @return - DateTime for it, weekday and hour12/pm filled in
+*****************************************************************/
+DateTime epochToDateTime(uint32_t epoch) {
+	DateTime dt;
+	if(epoch < DS3231_UNIX_2000)
+		epoch = DS3231_UNIX_2000;
+	epoch -= DS3231_UNIX_2000;
+	dt.d = _civilFromDays(epoch / 86400UL);
+	dt.t = _timeFromSeconds(epoch % 86400UL);
+	return dt;
+}
+/*****************************************************************
+* epochToDateTime(epochs, out, n) 
+* @epochs - n Unix times
+* @out - receives the n DateTimes, out[i] from epochs[i]
+* @n - how many
+* For converting logged timestamps in bulk. Same as n calls of
+* epochToDateTime(epoch), done EPOCH_LANES at a time: the times
+* are copied into an array, the calendar math is one pass over
+* whole arrays with no branches or calls - _civilFromDays() and
+* _timeFromSeconds() written out, the ifs as 0/1 arithmetic, so
+* a compiler that vectorizes does it lanes at a time - then the
+* fields are copied out into the DateTimes.
+*****************************************************************/
+void epochToDateTime(const uint32_t *epochs, DateTime *out, uint16_t n) {
+	uint32_t seconds[EPOCH_LANES];
+	uint32_t year[EPOCH_LANES], month[EPOCH_LANES], date[EPOCH_LANES], weekday[EPOCH_LANES];
+	uint32_t hour[EPOCH_LANES], hour12[EPOCH_LANES], minute[EPOCH_LANES], second[EPOCH_LANES];
+	uint32_t day, rest, z, era, doe, yoe, doy, mp;
+	uint16_t base, count, i;
+	for(base = 0; base < n; base += count) {
+		count = n - base < EPOCH_LANES ? n - base : EPOCH_LANES;
+		for(i = 0; i < EPOCH_LANES; i++)	//the last pass's spare lanes convert 2000-01-01
+			seconds[i] = i < count && epochs[base + i] > DS3231_UNIX_2000 ? epochs[base + i] - DS3231_UNIX_2000 : 0;
+		for(i = 0; i < EPOCH_LANES; i++) {
+			day = seconds[i] / 86400UL;
+			rest = seconds[i] - day * 86400UL;
+			z = day + 146037;			//as _civilFromDays()
+			era = z / 146097;
+			doe = z - era * 146097;
+			yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+			doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+			mp = (5 * doy + 2) / 153;
+			date[i] = doy - (153 * mp + 2) / 5 + 1;
+			month[i] = mp + 3 - 12 * (mp >= 10);
+			year[i] = 1600 + yoe + era * 400 + (mp >= 10);
+			weekday[i] = (day + 6) % 7 + 1;
+			hour[i] = rest / 3600;		//as _timeFromSeconds() and _setHour12()
+			rest -= hour[i] * 3600;
+			minute[i] = rest / 60;
+			second[i] = rest - minute[i] * 60;
+			hour12[i] = hour[i] - 12 * (hour[i] >= 12);
+			hour12[i] += 12 * (hour12[i] == 0);
+		}
+		for(i = 0; i < count; i++) {
+			out[base + i].d.year = year[i];
+			out[base + i].d.month = month[i];
+			out[base + i].d.date = date[i];
+			out[base + i].d.weekday = weekday[i];
+			out[base + i].t.hour24 = hour[i];
+			out[base + i].t.hour12 = hour12[i];
+			out[base + i].t.minute = minute[i];
+			out[base + i].t.second = second[i];
+			out[base + i].t.pm = hour[i] >= 12;
+		}
+	}
+}
+/*****************************************************************
+* _daysFromCivil(year, month, date) 
+* @return - days since 2000-01-01 (a Saturday), no loops or tables.
+*           Counts from March so the leap day is the last day of the
+*           'year', then every 4/100/400 year cycle is arithmetic.
+*****************************************************************/
+uint32_t _daysFromCivil(uint16_t year, uint8_t month, uint8_t date) {
+	uint32_t y = year - 1600;	//1600 starts a 400 year cycle, and keeps this unsigned
+	if(month <= 2) {
+		y--;
+		month += 12;		//Jan, Feb are months 13, 14 of the year before
+	}
+	return 365 * y + y / 4 - y / 100 + y / 400 + (153 * (month - 3) + 2) / 5 + date - 1
+		- 146037;			//days from 1600-03-01 to 2000-01-01
+}
+/*****************************************************************
+* _civilFromDays(days) 
+* @days - days since 2000-01-01
+* @return - Date for that day, weekday included. Inverse of _daysFromCivil()
+*****************************************************************/
+Date _civilFromDays(uint32_t days) {
+	Date d;
+	uint32_t z, era, doe, yoe, doy, mp;
+	z = days + 146037;		//days since 1600-03-01
+	era = z / 146097;		//400 year cycles
+	doe = z - era * 146097;	//day of cycle
+	yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;	//year of cycle
+	doy = doe - (365 * yoe + yoe / 4 - yoe / 100);	//day of March-based year
+	mp = (5 * doy + 2) / 153;	//March = 0
+	d.date = doy - (153 * mp + 2) / 5 + 1;
+	d.month = mp < 10 ? mp + 3 : mp - 9;
+	d.year = 1600 + yoe + era * 400 + (d.month <= 2);
+	d.weekday = (days + 6) % 7 + 1;	//2000-01-01 was a Saturday (7)
+	return d;
+}
+/*****************************************************************
+* _timeFromSeconds(seconds) 
+* @seconds - since midnight, 0-86399
+* @return - Time for it, hour12/pm filled in. One 32 bit divide,
+*           the rest fits in 16 bits
+*****************************************************************/
+Time _timeFromSeconds(uint32_t seconds) {
+	Time t;
+	uint16_t rest;
+	t.hour24 = seconds / 3600;
+	rest = seconds - t.hour24 * 3600UL;	//< 3600
+	t.minute = rest / 60;
+	t.second = rest - t.minute * 60;
+	_setHour12(&t);
+	return t;
+}
+/*****************************************************************
+* _setHour12(t) 
+* @t - Time object with hour24 set, fills in hour12 and pm from it
+*****************************************************************/
+void _setHour12(Time *t) {
+	t->pm = t->hour24 >= 12;
+	t->hour12 = t->hour24 % 12;
+	if(t->hour12 == 0)
+		t->hour12 = 12;		//midnight is 12 AM, noon is 12 PM
 }
 
 /************************************************************
@@ -378,11 +1078,7 @@ void initializeDS3231(void) {
 *     converts from register BCD to decimal before returning
 *************************************************************/
 uint8_t readBcdRegister(uint8_t reg){
-  Wire.beginTransmission(DS3231_ADDR);  //Sends start bit, slave address, and write bit, waits for ack from device
-  Wire.write(reg);                  //Sends 8 bits the function was passed, a register address, waits for ack
-  Wire.endTransmission();           //Sends the stop bit to indicate end of write
-  Wire.requestFrom(DS3231_ADDR,1);    //Sends start, slave address, read bit, waits for ack and one byte, then sends stop
-  return _fromBcd(Wire.read());       //reads the received byte from the buffer and returns it to whoever called this function
+  return _fromBcd(readRegister(reg));
 }
 
 /************************************************
@@ -394,10 +1090,7 @@ uint8_t readBcdRegister(uint8_t reg){
 * @return - void
 *************************************************/
 void writeBcdRegister(uint8_t reg, uint8_t data) {
-  Wire.beginTransmission(DS3231_ADDR);  //Sends start bit, slave address, and write bit, waits for ack from device
-  Wire.write(reg);                  //Writes the first passed parameter value to the device, hopefully a register address
-  Wire.write(_toBcd(data));                 //Writes the second passed parameter, the data for that register
-  Wire.endTransmission();             //Completes the transaction by sending stop bit
+  writeRegister(reg, _toBcd(data));
 }
 /************************************************
 * readRegister(reg) 
@@ -406,11 +1099,135 @@ void writeBcdRegister(uint8_t reg, uint8_t data) {
 * @return - data value from requested register
 *************************************************/
 uint8_t readRegister(uint8_t reg){
-  Wire.beginTransmission(DS3231_ADDR);  //Sends start bit, slave address, and write bit, waits for ack from device
-  Wire.write(reg);			            //Sends 8 bits the function was passed, a register address, waits for ack
-  Wire.endTransmission();   		    //Sends the stop bit to indicate end of write
-  Wire.requestFrom(DS3231_ADDR,1);  	//Sends start, slave address, read bit, waits for ack and one byte, then sends stop
-  return Wire.read();      	//reads the received byte from the buffer and returns it to whoever called this function
+  uint8_t data = 0xff;
+  readRegisters(reg, &data, 1);
+  return data;
+}
+
+/************************************************
+* readRegisters(reg, buf, len) 
+* @reg - first register to read, 0x00 to 0x12
+* @buf - receives the register values, must hold len bytes
+* @len - number of consecutive registers to read
+* The DS3231 register pointer auto-increments (wrapping
+* from 0x12 to 0x00), so this is one pointer write and
+* one read of len bytes, no matter how many registers
+* @return - number of bytes actually received
+*************************************************/
+uint8_t readRegisters(uint8_t reg, uint8_t *buf, uint8_t len){
+  return readRegistersChecked(reg, buf, len) == DS3231_OK ? len : 0;
+}
+/************************************************
+* readRegistersChecked(reg, buf, len) 
+* Same as readRegisters(), but each failed try is retried
+* until it works, DS3231_RETRIES retries are used up or
+* DS3231_CALL_TIMEOUT_MICROS has gone by - so a noisy bus
+* costs a bounded time, not a hang or a garbage result.
+* A stuck bus is recovered (see recoverBus()) before retrying.
+* @return - DS3231_OK or the last DS3231_ERR_...
+*************************************************/
+uint8_t readRegistersChecked(uint8_t reg, uint8_t *buf, uint8_t len){
+  return _readChecked(&_ds3231, reg, buf, len);
+}
+/************************************************
+* _readChecked(link, reg, buf, len) 
+* readRegistersChecked() for any DS3231, counted in
+* link's stats and health
+*************************************************/
+uint8_t _readChecked(DS3231Link *link, uint8_t reg, uint8_t *buf, uint8_t len){
+  uint32_t start = micros();
+  uint8_t tries = 0;
+  uint8_t result;
+  do {
+    result = _readOnce(link, reg, buf, len);
+  } while(result != DS3231_OK && _retryAfter(link, result, start, &tries));
+  return _finishCall(link, start, tries, result);
+}
+/************************************************
+* _readOnce(link, reg, buf, len) 
+* One pointer write + burst read, no retries
+*************************************************/
+uint8_t _readOnce(DS3231Link *link, uint8_t reg, uint8_t *buf, uint8_t len){
+  uint8_t result = _setRegisterPointer(link, reg);
+  if(result != DS3231_OK)
+    return result;
+  if(_readFromPointer(link, reg, buf, len) != len)
+    return DS3231_ERR_SHORT_READ;
+  return DS3231_OK;
+}
+/************************************************
+* _setRegisterPointer(link, reg) 
+* First half of readRegisters(): a write of just the
+* register address, which moves the DS3231's pointer
+* @return - DS3231_OK or DS3231_ERR_...
+*************************************************/
+uint8_t _setRegisterPointer(DS3231Link *link, uint8_t reg){
+  DS3231_TRACE_SCOPE(TRACE_I2C_POINTER);
+  uint8_t result = link->bus->write(link->address, reg, NULL, 0);
+  _busGeneration++;
+#ifdef DS3231_BUS_STATS
+  link->stats.transactions++;
+  link->stats.starts++;
+  link->stats.stops++;
+  link->stats.bytesWritten += 2;			//address+W, register
+#endif
+  return result > DS3231_ERR_TIMEOUT ? DS3231_ERR_BUS : result;
+}
+/************************************************
+* _readFromPointer(link, reg, buf, len) 
+* Second half of readRegisters(): reads len bytes from
+* wherever the pointer is. reg must be where
+* _setRegisterPointer() left it, it's only used to
+* keep the register cache up to date
+* @return - number of bytes actually received
+*************************************************/
+uint8_t _readFromPointer(DS3231Link *link, uint8_t reg, uint8_t *buf, uint8_t len){
+  DS3231_TRACE_SCOPE(TRACE_I2C_READ);
+  uint8_t got = link->bus->read(link->address, buf, len);
+  _busGeneration++;
+#ifdef DS3231_BUS_STATS
+  link->stats.transactions++;
+  link->stats.starts++;
+  link->stats.stops++;
+  link->stats.bytesRead += 1 + len;		//address+R is clocked like a written byte, counted here with the read
+#endif
+  if(link == &_ds3231)
+    _cacheUpdate(reg, buf, got);		//anything we just read is the freshest copy there is
+  return got;
+}
+/************************************************
+* TwoWireTransport::write(address, first, buf, len)
+* TwoWireTransport::read(address, buf, len)
+* See DS3231Transport. A read that timed out returns
+* 0, whatever did arrive can't be trusted
+*************************************************/
+uint8_t TwoWireTransport::write(uint8_t address, uint8_t first, const uint8_t *buf, uint8_t len) {
+  uint8_t result;
+  _wire.beginTransmission(address);  //Sends start bit, slave address, and write bit, waits for ack from device
+  _wire.write(first);
+  if(len)
+    _wire.write(buf, len);
+  result = _wire.endTransmission();  //Sends the stop bit to indicate end of write
+  #ifdef WIRE_HAS_TIMEOUT
+  if(_wire.getWireTimeoutFlag()) {
+    _wire.clearWireTimeoutFlag();
+    result = DS3231_ERR_TIMEOUT;
+  }
+  #endif
+  return result;
+}
+uint8_t TwoWireTransport::read(uint8_t address, uint8_t *buf, uint8_t len) {
+  uint8_t i = 0;
+  _wire.requestFrom(address, len);  	//Sends start, slave address, read bit, clocks in len bytes, then sends stop
+  while(i < len && _wire.available())
+    buf[i++] = _wire.read();
+  #ifdef WIRE_HAS_TIMEOUT
+  if(_wire.getWireTimeoutFlag()) {
+    _wire.clearWireTimeoutFlag();
+    return 0;
+  }
+  #endif
+  return i;
 }
 
 /************************************************
@@ -421,20 +1238,769 @@ uint8_t readRegister(uint8_t reg){
 * @return - void
 *************************************************/
 void writeRegister(uint8_t reg, uint8_t data) {
-  Wire.beginTransmission(DS3231_ADDR);  //Sends start bit, slave address, and write bit, waits for ack from device
-  Wire.write(reg);            			//Writes the first passed parameter value to the device, hopefully a register address
-  Wire.write(data);           			//Writes the second passed parameter, the data for that register
-  Wire.endTransmission();         		//Completes the transaction by sending stop bit
+  writeRegisters(reg, &data, 1);
+}
+
+/************************************************
+* writeRegisters(reg, buf, len) 
+* @reg - first register to write, 0x00 to 0x12
+* @buf - values to write, buf[0] goes to reg,
+*        buf[1] to reg+1 and so on
+* @len - number of consecutive registers to write,
+*        at most 31 (Wire's buffer is 32 bytes,
+*        one is used by the register address)
+* One START/address/reg/data.../STOP transaction,
+* relying on the DS3231's register auto-increment.
+* Retried like writeRegistersChecked(), ds3231LastError()
+* says whether it worked
+*************************************************/
+void writeRegisters(uint8_t reg, const uint8_t *buf, uint8_t len) {
+  writeRegistersChecked(reg, buf, len);
+}
+/************************************************
+* writeRegistersChecked(reg, buf, len) 
+* writeRegisters() that reports how it went. Retried
+* the same way as readRegistersChecked() - rewriting
+* the same values is harmless
+* @return - DS3231_OK or the last DS3231_ERR_...
+*************************************************/
+uint8_t writeRegistersChecked(uint8_t reg, const uint8_t *buf, uint8_t len) {
+  return _writeChecked(&_ds3231, reg, buf, len);
+}
+/************************************************
+* _writeChecked(link, reg, buf, len) 
+* writeRegistersChecked() for any DS3231
+*************************************************/
+uint8_t _writeChecked(DS3231Link *link, uint8_t reg, const uint8_t *buf, uint8_t len) {
+  uint32_t start = micros();
+  uint8_t tries = 0;
+  uint8_t result;
+  do {
+    result = _writeOnce(link, reg, buf, len);
+  } while(result != DS3231_OK && _retryAfter(link, result, start, &tries));
+  return _finishCall(link, start, tries, result);
+}
+/************************************************
+* _writeOnce(link, reg, buf, len) 
+* One write transaction, no retries: the register
+* address, then each byte lands in the next register
+*************************************************/
+uint8_t _writeOnce(DS3231Link *link, uint8_t reg, const uint8_t *buf, uint8_t len) {
+  DS3231_TRACE_SCOPE(TRACE_I2C_WRITE);
+  uint8_t result = link->bus->write(link->address, reg, buf, len);
+  if(result > DS3231_ERR_TIMEOUT)
+    result = DS3231_ERR_BUS;
+  _busGeneration++;
+#ifdef DS3231_BUS_STATS
+  link->stats.transactions++;
+  link->stats.starts++;
+  link->stats.stops++;
+  link->stats.bytesWritten += 2 + len;	//address+W, register, data
+#endif
+  if(result == DS3231_OK && link == &_ds3231)
+    _cacheUpdate(reg, buf, len);		//write-through to the shadow copies
+  return result;
+}
+/************************************************
+* _retryAfter(link, result, start, tries) 
+* @result - why the last try failed
+* @start - micros() when the call started
+* @tries - retries used so far, bumped if there's another
+* @return - true to try again. Unsticks Wire first
+*           if a slave is holding SDA down
+*************************************************/
+bool _retryAfter(DS3231Link *link, uint8_t result, uint32_t start, uint8_t *tries) {
+  if(*tries >= DS3231_RETRIES || micros() - start >= DS3231_CALL_TIMEOUT_MICROS)
+    return false;
+  (*tries)++;
+  if(result != DS3231_ERR_IMPLAUSIBLE && link->bus == &DS3231_Wire && _sdaStuck())
+    recoverBus();
+  return true;
+}
+/************************************************
+* _finishCall(link, start, tries, result) 
+* Adds a call to link's histograms
+* @return - result, so callers can return this
+*************************************************/
+uint8_t _finishCall(DS3231Link *link, uint32_t start, uint8_t tries, uint8_t result) {
+  uint32_t elapsed = micros() - start;
+  uint8_t bucket = 0;
+  while(bucket < DS3231_LATENCY_BUCKETS - 1 && elapsed >= (64UL << bucket))
+    bucket++;
+  link->health.latency[bucket]++;
+  if(elapsed > link->health.maxLatencyMicros)
+    link->health.maxLatencyMicros = elapsed;
+  link->health.retries[tries < DS3231_RETRY_BUCKETS ? tries : DS3231_RETRY_BUCKETS - 1]++;
+  if(result != DS3231_OK)
+    link->health.failures++;
+  link->health.lastError = result;
+  return result;
+}
+/************************************************
+* ds3231LastError() 
+* @return - DS3231_OK or DS3231_ERR_... from the last
+*           bus call, for the functions that don't
+*           return it (readTime(), setAlarm() etc.)
+*************************************************/
+uint8_t ds3231LastError(void) {
+  return _ds3231.health.lastError;
+}
+/************************************************
+* setBusTimeout(micros) 
+* @micros - how long one transaction may take before
+*           Wire gives up and resets the TWI hardware.
+*           Needs an Arduino core whose Wire has
+*           setWireTimeout() (AVR 1.8.3 and later) -
+*           without it Wire can hang on a stuck bus
+*************************************************/
+void setBusTimeout(uint32_t micros) {
+  #ifdef WIRE_HAS_TIMEOUT
+  Wire.setWireTimeout(micros, true);
+  #else
+  (void)micros;
+  #endif
+}
+/************************************************
+* setBusClock(hz) 
+* Wire.setClock(hz), remembered so recoverBus() can
+* put it back after restarting Wire
+*************************************************/
+void setBusClock(uint32_t hz) {
+  _busClockHz = hz;
+  Wire.setClock(hz);
+}
+/************************************************
+* _sdaStuck() 
+* @return - true if SDA is low between transactions,
+*           i.e. a slave lost count mid-byte and is
+*           waiting for clocks that will never come
+*************************************************/
+bool _sdaStuck(void) {
+  #if defined(SDA) && defined(SCL)
+  return digitalRead(SDA) == LOW;
+  #else
+  return false;
+  #endif
+}
+/************************************************
+* recoverBus() 
+* Stops Wire and clocks SCL by hand, up to 9 times (a
+* whole byte + ACK), until the slave lets go of SDA,
+* then sends a STOP and restarts Wire.
+* Lines are only ever released (pulled up) or driven low
+* @return - DS3231_OK, or DS3231_ERR_BUS_STUCK if SDA
+*           is still low
+*************************************************/
+uint8_t recoverBus(void) {
+  #if defined(SDA) && defined(SCL)
+  uint8_t i;
+  bool stuck;
+  Wire.end();
+  pinMode(SDA, INPUT_PULLUP);
+  pinMode(SCL, INPUT_PULLUP);
+  for(i = 0; i < 9 && digitalRead(SDA) == LOW; i++) {
+    pinMode(SCL, OUTPUT);		//SCL low
+    digitalWrite(SCL, LOW);
+    delayMicroseconds(5);		//half a 100 kHz clock
+    pinMode(SCL, INPUT_PULLUP);	//SCL released, high
+    delayMicroseconds(5);
+  }
+  stuck = digitalRead(SDA) == LOW;
+  //STOP: SDA goes low to high while SCL is high
+  pinMode(SDA, OUTPUT);
+  digitalWrite(SDA, LOW);
+  delayMicroseconds(5);
+  pinMode(SDA, INPUT_PULLUP);
+  delayMicroseconds(5);
+  Wire.begin();
+  if(_busClockHz)
+    Wire.setClock(_busClockHz);
+  _busGeneration++;		//the DS3231's pointer is anyone's guess now
+  _ds3231.health.recoveries++;
+  return stuck ? DS3231_ERR_BUS_STUCK : DS3231_OK;
+  #else
+  return DS3231_ERR_BUS_STUCK;
+  #endif
+}
+/************************************************
+* getBusHealth() 
+* @return - histograms of how long calls took and how
+*           many retries they needed, and failure counts
+*************************************************/
+BusHealth getBusHealth(void) {
+  return _ds3231.health;
+}
+void resetBusHealth(void) {
+  _ds3231.health = BusHealth();
+}
+
+/*****************************************************************
+* useRegisterCache(enable) 
+* Opt-in shadow copies of CONTROL, STATUS and the 12/!24 bit of
+* the hours register. While enabled, getAlarmStatus() and the
+* read-modify-write in turnAlarmOn(), toggleAlarms() and
+* initializeDS3231() skip the bus read, and setAlarm() skips
+* reading the hours register. Every library read and write of
+* those registers updates the copies.
+* Only enable it if nothing else writes to the DS3231. If
+* something might have, call invalidateRegisterCache().
+* @enable - true to use the cache, false to read every time
+*****************************************************************/
+void useRegisterCache(bool enable) {
+	_cacheEnabled = enable;
+	_cacheValid = 0;
+}
+/*****************************************************************
+* invalidateRegisterCache() 
+* Forgets the shadow copies, the next lookup of each reads the chip.
+* tickClockService() reads CONTROL again too
+*****************************************************************/
+void invalidateRegisterCache(void) {
+	_cacheValid = 0;
+	_tickAlarmEnables = TICK_ENABLES_UNKNOWN;
+}
+/*****************************************************************
+* refreshRegisterCache() 
+* Reloads every shadow copy with one burst read of 0x02-0x0F
+* If the read fails the cache is emptied, so nothing stale is kept
+*****************************************************************/
+void refreshRegisterCache(void) {
+	uint8_t regs[DS3231_STATUS - DS3231_HOURS + 1];
+	if(readRegisters(DS3231_HOURS, regs, sizeof(regs)) != sizeof(regs))
+		_cacheValid = 0;
+}
+/*****************************************************************
+* getRegisterCacheStats() 
+* @return - count of lookups served from the cache (hits) and
+*           lookups that had to read the chip (misses)
+*****************************************************************/
+RegisterCacheStats getRegisterCacheStats(void) {
+	return _cacheStats;
+}
+/*****************************************************************
+* _cacheUpdate(reg, buf, len) 
+* Called with every block of registers read from or written to
+* the DS3231. Copies out any that we shadow, and CONTROL's alarm
+* enables for tickClockService() even with the cache off.
+* The CONV bit clears itself, so it's never kept in the copy.
+*****************************************************************/
+void _cacheUpdate(uint8_t reg, const uint8_t *buf, uint8_t len) {
+	uint8_t i;
+	if(reg <= DS3231_CONTROL && reg + len > DS3231_CONTROL)
+		_tickAlarmEnables = buf[DS3231_CONTROL - reg] & 0x03;	//cache or no cache, see tickClockService()
+	if(!_cacheEnabled)
+		return;
+	for(i = 0; i < len; i++, reg++) {
+		if(reg > DS3231_TEMP_LSB)	//pointer wraps from 0x12 to 0x00
+			reg = DS3231_SECONDS;
+		if(reg == DS3231_CONTROL) {
+			_cachedControl = buf[i] & 0xdf;
+			_cacheValid |= CACHE_CONTROL;
+		}
+		else if(reg == DS3231_STATUS) {
+			_cachedStatus = buf[i];
+			_cacheValid |= CACHE_STATUS;
+		}
+		else if(reg == DS3231_HOURS) {
+			_cachedHours = buf[i];
+			_cacheValid |= CACHE_HOURS;
+		}
+	}
+}
+/*****************************************************************
+* _getControl(control) 
+* @control - gets the CONTROL register, from the cache when we can
+* @return - DS3231_OK, or DS3231_ERR_... when it couldn't be read
+*           and *control is not to be used
+*****************************************************************/
+uint8_t _getControl(uint8_t *control) {
+	if(_cacheEnabled && (_cacheValid & CACHE_CONTROL)) {
+		_cacheStats.hits++;
+		*control = _cachedControl;
+		return DS3231_OK;
+	}
+	_cacheStats.misses++;
+	return readRegistersChecked(DS3231_CONTROL, control, 1);
+}
+/*****************************************************************
+* _isTwelveHourMode(twelve) 
+* @twelve - set true if the DS3231 is keeping time in 12 hour mode
+* @return - DS3231_OK, or DS3231_ERR_... when it couldn't be read
+*           and *twelve is left alone
+*****************************************************************/
+uint8_t _isTwelveHourMode(bool *twelve) {
+	uint8_t hours;
+	uint8_t result;
+	if(_cacheEnabled && (_cacheValid & CACHE_HOURS)) {
+		_cacheStats.hits++;
+		*twelve = _cachedHours & 0x40;
+		return DS3231_OK;
+	}
+	_cacheStats.misses++;
+	result = readRegistersChecked(DS3231_HOURS, &hours, 1);
+	if(result == DS3231_OK)
+		*twelve = hours & 0x40;
+	return result;
+}
+/*****************************************************************
+* _clearAlarmFlags(alarms) 
+* @alarms - 1=clear A1F, 2=clear A2F, 3=clear both
+* A1F and A2F can only be written to 0, writing 1 leaves them as
+* they are, so we write 1 to any flag we are not clearing. The
+* rest of the register comes from the cache, so with the cache
+* this is a single write instead of a read and a write.
+* @return - DS3231_OK, or DS3231_ERR_... from the read (when
+*           nothing is written) or the write
+*****************************************************************/
+uint8_t _clearAlarmFlags(uint8_t alarms) {
+	uint8_t data;
+	uint8_t result;
+	if(_cacheEnabled && (_cacheValid & CACHE_STATUS)) {
+		_cacheStats.hits++;
+		data = _cachedStatus;
+	}
+	else {
+		_cacheStats.misses++;
+		result = readRegistersChecked(DS3231_STATUS, &data, 1);
+		if(result != DS3231_OK)
+			return result;
+	}
+	data |= 0x03;				//leave both alone...
+	data &= ~(alarms & 0x03);	//...except the ones we're clearing
+	return writeRegistersChecked(DS3231_STATUS, &data, 1);
+}
+
+/*****************************************************************
+* Asynchronous transactions
+* Wire blocks for the whole of each transaction, and readDateTime()
+* is two of them. The ...Async() calls below only queue the work.
+* Each call to serviceAsync() from loop() runs one transaction (one
+* bus phase) of the op at the head of the queue, so a busy loop()
+* is never held up by more than one short transaction at a time.
+* When an op completes its callback runs from inside serviceAsync(),
+* or poll asyncDone(ticket). Callbacks may be NULL.
+* A transaction that fails completes its op there and then, with
+* ds3231LastError() saying why: a read hands back the last good
+* time & date, alarm servicing reports 0 and leaves the flags set.
+* Each ...Async() returns a ticket, 0 if the queue was full.
+* It's fine to mix these with the blocking calls - if anything moves
+* the register pointer between the two halves of a read, the pointer
+* is set again.
+*****************************************************************/
+/*****************************************************************
+* readDateTimeAsync(callback) 
+* Queues a burst read of 0x00-0x06. When done, the result goes to
+* callback and is also kept for asyncLastDateTime()
+*****************************************************************/
+uint16_t readDateTimeAsync(DateTimeCallback callback) {
+	AsyncOp *op = _asyncPush(ASYNC_READ_DATETIME, DS3231_SECONDS, 7);
+	if(!op)
+		return 0;
+	op->callback.dateTime = callback;
+	return op->ticket;
+}
+/*****************************************************************
+* setDateTimeAsync(dt, callback) 
+* Queues the same single write setDateTime() makes
+*****************************************************************/
+uint16_t setDateTimeAsync(DateTime dt, WriteCallback callback) {
+	AsyncOp *op = _asyncPush(ASYNC_WRITE, DS3231_SECONDS, 7);
+	if(!op)
+		return 0;
+	_dateTimeRegisters(dt, twelveHourMode, op->buf);
+	op->callback.done = callback;
+	return op->ticket;
+}
+/*****************************************************************
+* setAlarmAsync(a, callback) 
+* Queues the same single write setAlarm() makes. The 12/24 hour
+* mode is looked up when this is called - with the register cache
+* on that's free, otherwise it's one blocking read. If that read
+* fails nothing is queued and it returns 0, see ds3231LastError()
+*****************************************************************/
+uint16_t setAlarmAsync(AlarmSetting a, WriteCallback callback) {
+	uint8_t regs[4];
+	uint8_t reg;
+	bool twelve;
+	AsyncOp *op;
+	if(_isTwelveHourMode(&twelve) != DS3231_OK)
+		return 0;
+	reg = encodeAlarm(a, twelve, regs);
+	op = _asyncPush(ASYNC_WRITE, reg, reg == DS3231_ALARM1_SECONDS ? 4 : 3);
+	if(!op)
+		return 0;
+	memcpy(op->buf, regs, op->len);
+	op->callback.done = callback;
+	return op->ticket;
+}
+/*****************************************************************
+* serviceAlarmsAsync(callback) 
+* Queues what serviceAlarms() does: reads STATUS, and if any alarm
+* flags are set, clears them. callback gets the same 0-3 result
+*****************************************************************/
+uint16_t serviceAlarmsAsync(AlarmCallback callback) {
+	AsyncOp *op = _asyncPush(ASYNC_SERVICE_ALARMS, DS3231_STATUS, 1);
+	if(!op)
+		return 0;
+	op->callback.alarms = callback;
+	return op->ticket;
+}
+/*****************************************************************
+* serviceAsync() 
+* Call from loop(), or as often as you like. Runs at most one
+* I2C transaction for the op at the head of the queue.
+* @return - ops still in the queue
+*****************************************************************/
+uint8_t serviceAsync(void) {
+	AsyncOp *op;
+	uint8_t flags;
+	uint8_t result;
+	if(!_asyncCount)
+		return 0;
+	op = &_asyncQueue[_asyncHead];
+	switch(op->phase) {
+		case ASYNC_PHASE_START:
+			if(op->kind == ASYNC_WRITE) {
+				result = writeRegistersChecked(op->reg, op->buf, op->len);
+				if(op->reg == DS3231_SECONDS) {		//setDateTimeAsync()
+					_clockWasSet();
+					_journalEvent(JOURNAL_SET_DATETIME, result);
+				}
+				if(result != DS3231_OK)
+					_asyncStats.failed++;
+				_asyncFinish(op, 0);
+				break;
+			}
+			//Reads start by moving the pointer
+			result = _setRegisterPointer(&_ds3231, op->reg);
+			if(result != DS3231_OK) {
+				_asyncFail(op, result);
+				break;
+			}
+			op->generation = _busGeneration;
+			op->phase = ASYNC_PHASE_POINTER_SET;
+			break;
+		case ASYNC_PHASE_POINTER_SET:
+			if(op->generation != _busGeneration) {	//someone else used the bus since, pointer may have moved
+				op->phase = ASYNC_PHASE_START;
+				break;
+			}
+			if(_readFromPointer(&_ds3231, op->reg, op->buf, op->len) != op->len) {
+				_asyncFail(op, DS3231_ERR_SHORT_READ);
+				break;
+			}
+			_ds3231.health.lastError = DS3231_OK;
+			if(op->kind == ASYNC_READ_DATETIME) {
+				_asyncDateTime = _decodeDateTime(op->buf);
+				_asyncFinish(op, 0);
+			}
+			else if(op->buf[0] & 0x03) {	//ASYNC_SERVICE_ALARMS, flags to clear
+				op->phase = ASYNC_PHASE_CLEAR_FLAGS;
+			}
+			else {
+				_asyncFinish(op, 0);
+			}
+			break;
+		case ASYNC_PHASE_CLEAR_FLAGS:
+			flags = op->buf[0] & 0x03;
+			op->buf[0] = (op->buf[0] | 0x03) & ~flags;	//0 clears a flag, 1 leaves it alone
+			result = writeRegistersChecked(DS3231_STATUS, op->buf, 1);
+			if(result != DS3231_OK) {
+				_asyncStats.failed++;		//flags are still set, reported next time
+				_asyncFinish(op, 0);
+				break;
+			}
+			_asyncFinish(op, flags);
+			break;
+	}
+	return _asyncCount;
+}
+/*****************************************************************
+* asyncDone(ticket) 
+* @ticket - from one of the ...Async() calls
+* @return - true once that op has completed
+*****************************************************************/
+bool asyncDone(uint16_t ticket) {
+	return (int16_t)(_asyncCompletedTicket - ticket) >= 0;
+}
+/*****************************************************************
+* asyncLastDateTime() 
+* @return - result of the most recent completed readDateTimeAsync()
+*****************************************************************/
+DateTime asyncLastDateTime(void) {
+	return _asyncDateTime;
+}
+/*****************************************************************
+* getAsyncStats() 
+* @return - queue depth now and at worst, how many ops completed or
+*           were refused, and queued-to-completed latency in us
+*****************************************************************/
+AsyncStats getAsyncStats(void) {
+	_asyncStats.depth = _asyncCount;
+	return _asyncStats;
+}
+/*****************************************************************
+* _asyncPush(kind, reg, len) 
+* @return - the new op at the tail of the queue, NULL if it's full
+*****************************************************************/
+AsyncOp *_asyncPush(uint8_t kind, uint8_t reg, uint8_t len) {
+	AsyncOp *op;
+	if(_asyncCount >= DS3231_ASYNC_QUEUE_SIZE) {
+		_asyncStats.refused++;
+		return NULL;
+	}
+	op = &_asyncQueue[(_asyncHead + _asyncCount) % DS3231_ASYNC_QUEUE_SIZE];
+	_asyncCount++;
+	if(_asyncCount > _asyncStats.maxDepth)
+		_asyncStats.maxDepth = _asyncCount;
+	op->kind = kind;
+	op->phase = ASYNC_PHASE_START;
+	op->reg = reg;
+	op->len = len;
+	op->ticket = _asyncNextTicket++;
+	if(!_asyncNextTicket)
+		_asyncNextTicket = 1;	//0 means 'queue full'
+	op->queuedAt = micros();
+	return op;
+}
+/*****************************************************************
+* _asyncFinish(op, result) 
+* Pops the head op, records its latency and runs its callback.
+* The op is copied first so the callback can queue more work.
+*****************************************************************/
+void _asyncFinish(AsyncOp *op, uint8_t result) {
+	AsyncOp done = *op;
+	uint32_t latency = micros() - done.queuedAt;
+	_asyncHead = (_asyncHead + 1) % DS3231_ASYNC_QUEUE_SIZE;
+	_asyncCount--;
+	_asyncCompletedTicket = done.ticket;
+	_asyncStats.completed++;
+	_asyncStats.lastLatencyMicros = latency;
+	if(latency > _asyncStats.maxLatencyMicros)
+		_asyncStats.maxLatencyMicros = latency;
+	if(done.kind == ASYNC_READ_DATETIME) {
+		if(done.callback.dateTime)
+			done.callback.dateTime(_asyncDateTime);
+	}
+	else if(done.kind == ASYNC_SERVICE_ALARMS) {
+		result = _runAlarm1Hook(result);
+		if(done.callback.alarms)
+			done.callback.alarms(result);
+	}
+	else if(done.callback.done) {
+		done.callback.done();
+	}
+}
+/*****************************************************************
+* _asyncFail(op, error) 
+* A read transaction failed: no retry, the op completes with what
+* serviceAsync() says about failures, and ds3231LastError() = error
+*****************************************************************/
+void _asyncFail(AsyncOp *op, uint8_t error) {
+	_asyncStats.failed++;
+	_ds3231.health.failures++;
+	_ds3231.health.lastError = error;
+	if(op->kind == ASYNC_READ_DATETIME)
+		_asyncDateTime = _ds3231.lastGood;
+	_asyncFinish(op, 0);
+}
+
+#ifdef DS3231_BUS_STATS
+/*****************************************************************
+* getBusStats() 
+* @return - I2C traffic to the DS3231 since the last resetBusStats().
+*           Take a copy before and after a call to see what it costs.
+*****************************************************************/
+BusStats getBusStats(void) {
+	return _ds3231.stats;
+}
+/*****************************************************************
+* resetBusStats() 
+* Zeroes the I2C traffic counters
+*****************************************************************/
+void resetBusStats(void) {
+	_ds3231.stats.transactions = 0;
+	_ds3231.stats.bytesWritten = 0;
+	_ds3231.stats.bytesRead = 0;
+	_ds3231.stats.starts = 0;
+	_ds3231.stats.stops = 0;
+}
+/*****************************************************************
+* busTimeMicros(stats, clockHz) 
+* Models how long the traffic in stats held the bus
+* @stats - counters from getBusStats(), or the difference of two
+* @clockHz - SCL frequency, 100000 or 400000 for standard/fast mode
+* @return - microseconds: 9 clocks per byte (8 data + ACK) and
+*           about one clock each for START and STOP. Ignores clock
+*           stretching and the time Wire spends between bytes.
+*****************************************************************/
+uint32_t busTimeMicros(BusStats stats, uint32_t clockHz) {
+	uint32_t clocks;
+	clocks = 9 * (stats.bytesWritten + stats.bytesRead) + stats.starts + stats.stops;
+	return (uint32_t)(((uint64_t)clocks * 1000000UL) / clockHz);
+}
+/*****************************************************************
+* busStatsSince(before) 
+* @before - counters from getBusStats() taken earlier
+* @return - the traffic since then
+*****************************************************************/
+BusStats busStatsSince(BusStats before) {
+	BusStats d;
+	d.transactions = _ds3231.stats.transactions - before.transactions;
+	d.bytesWritten = _ds3231.stats.bytesWritten - before.bytesWritten;
+	d.bytesRead = _ds3231.stats.bytesRead - before.bytesRead;
+	d.starts = _ds3231.stats.starts - before.starts;
+	d.stops = _ds3231.stats.stops - before.stops;
+	return d;
+}
+#endif
+
+/************************************************
+* _hourRegister(t, twelve) 
+* @t - Time object holding hour12/pm and hour24
+* @twelve - true to encode in 12 hour mode
+* @return - value for an hours register (0x02, 0x09, 0x0C)
+*           with the 12/!24 and !AM/PM bits set as needed.
+*           Bit 7 is left clear for the caller (A1M3/A2M3)
+*************************************************/
+uint8_t _hourRegister(Time t, bool twelve) {
+	uint8_t data;
+	if(twelve) {
+		data = _toBcd(t.hour12 & 0x1f);
+		data |= 0x40;	//sets 12 hour bit high	
+		if(t.pm)
+			data |= 0x20;	//sets PM high
+	}
+	else {	//24-hour mode
+		data = _toBcd(t.hour24);
+		data &= 0x3f;	//first two bits low, all else pass through
+	}
+	return data;
+}
+
+/************************************************
+* _dateTimeRegisters(dt, twelve, regs) 
+* @dt - time & date to encode
+* @twelve - true to encode the hour in 12 hour mode
+* @regs - receives 7 bytes for registers 0x00-0x06
+*************************************************/
+void _dateTimeRegisters(DateTime dt, bool twelve, uint8_t *regs) {
+	regs[DS3231_SECONDS] = _toBcd(dt.t.second);
+	regs[DS3231_MINUTES] = _toBcd(dt.t.minute);
+	regs[DS3231_HOURS] = _hourRegister(dt.t, twelve);
+	_dateRegisters(dt.d, &regs[DS3231_DAY]);
+}
+/************************************************
+* _dateRegisters(d, regs) 
+* @d - Date object to encode, the weekday is worked out from the
+*      date rather than taken from d.weekday
+* @regs - receives 4 bytes for registers 0x03-0x06:
+*         day, date, century + month, year
+*************************************************/
+void _dateRegisters(Date d, uint8_t *regs) {
+	regs[0] = weekdayOf(d.year, d.month, d.date);	//0x03 weekday, 1-7 is the same in BCD
+	regs[1] = _toBcd(d.date);			//0x04 date
+	regs[2] = _toBcd(d.month);			//0x05 century + 00 + 10month + 1month
+	if(d.year >= 2100) {
+		regs[2] |= 0x80;	//set the century bit if needed
+		regs[3] = _toBcd(d.year-2100);
+	}
+	else
+		regs[3] = _toBcd(d.year-2000);	//0x06 tens and ones of year
+}
+
+
+/*****************************************************************
+* captureImage() 
+* @return - all 19 registers, 0x00-0x12, from one burst read
+* Everything in it is from the same instant, and it also
+* refreshes the register cache. All zero if the read failed,
+* see ds3231LastError()
+*****************************************************************/
+Ds3231Image captureImage(void) {
+	Ds3231Image image;
+	memset(image.regs, 0, sizeof(image.regs));
+	readRegisters(DS3231_SECONDS, image.regs, DS3231_REGISTER_COUNT);
+	return image;
+}
+/*****************************************************************
+* applyImage(image, mask) 
+* @image - register values to write, e.g. from captureImage()
+*          on a unit that's already set up the way you want
+* @mask - which registers to write, bit n = register n. Use the
+*         IMAGE_... masks, imageDiff() to write only what's
+*         different, or both ORed together. The temperature
+*         registers are read only and always skipped.
+* Each run of consecutive registers in mask is one auto-increment
+* write, so IMAGE_WRITABLE is a single 18 byte transaction.
+* STATUS goes in as-is: 0 in A1F/A2F/OSF clears the flag, 1 leaves
+* it alone. Writing the seconds register restarts the countdown
+* chain, same as setTime().
+* @return - number of write transactions it took
+*****************************************************************/
+uint8_t applyImage(const Ds3231Image &image, uint32_t mask) {
+	uint8_t reg = DS3231_SECONDS;
+	uint8_t start;
+	uint8_t transactions = 0;
+	bool clockSet;
+	mask &= IMAGE_WRITABLE;
+	clockSet = mask & IMAGE_DATETIME;
+	if(clockSet)
+		_clockWasSet();
+	while(mask) {
+		while(!(mask & 1)) {		//skip to the start of the next run
+			mask >>= 1;
+			reg++;
+		}
+		start = reg;
+		while(mask & 1) {			//and find its end
+			mask >>= 1;
+			reg++;
+		}
+		writeRegisters(start, &image.regs[start], reg - start);
+		transactions++;
+	}
+	if(clockSet)
+		_journalEvent(JOURNAL_SET_DATETIME, ds3231LastError());
+	return transactions;
+}
+/*****************************************************************
+* imageDiff(a, b) 
+* @return - applyImage() mask of the writable registers that
+*           aren't the same in a and b
+*****************************************************************/
+uint32_t imageDiff(const Ds3231Image &a, const Ds3231Image &b) {
+	uint32_t mask = 0;
+	uint8_t reg;
+	for(reg = DS3231_SECONDS; reg <= DS3231_AGING_OFFSET; reg++) {
+		if(a.regs[reg] != b.regs[reg])
+			mask |= 1UL << reg;
+	}
+	return mask;
+}
+/*****************************************************************
+* decodeImage(image) 
+* @return - everything in image, decoded. No bus traffic
+*****************************************************************/
+Ds3231ImageInfo decodeImage(const Ds3231Image &image) {
+	Ds3231ImageInfo info;
+	info.dt = _decodeDateTime(image.regs);
+	info.alarm1 = decodeAlarm(&image.regs[DS3231_ALARM1_SECONDS], 1);
+	info.alarm2 = decodeAlarm(&image.regs[DS3231_ALARM2_MINUTES], 2);
+	info.control = image.regs[DS3231_CONTROL];
+	info.status = image.regs[DS3231_STATUS];
+	info.agingOffset = (int8_t)image.regs[DS3231_AGING_OFFSET];
+	//MSB is whole degrees, top 2 bits of LSB are quarters
+	info.temperature = (int16_t)((image.regs[DS3231_TEMP_MSB] << 8) | image.regs[DS3231_TEMP_LSB]) >> 6;
+	return info;
 }
 
 /* _toBcd() */
 uint8_t _toBcd(uint8_t num)
 {
-  uint8_t bcd = ((num / 10) << 4) + (num % 10);
-  return bcd;
+  return bcdEncode(num);
 }
 /* _fromBcd() */
 uint8_t _fromBcd(uint8_t bcd) {
-  uint8_t num = (10*((bcd&0xf0) >>4)) + (bcd & 0x0f);
-  return num;
+  return bcdDecode(bcd);
 }
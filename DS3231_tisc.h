@@ -32,6 +32,29 @@
 #define DS3231_TEMP_MSB     	0x11
 #define DS3231_TEMP_LSB     	0x12
 
+//AlarmSetting.alarm_mask values for each kind of alarm (see the table in AlarmSetting below)
+#define ALARM1_EVERY_SECOND		0x0f	//A1M4-A1M1 = 1111
+#define ALARM1_MATCH_SECONDS	0x0e	//once a minute, when seconds match
+#define ALARM1_MATCH_MINUTES	0x0c	//once an hour, minutes and seconds match
+#define ALARM1_MATCH_HOURS		0x08	//every day, hours, minutes and seconds match
+#define ALARM1_MATCH_DATE		0x00	//date, hours, minutes and seconds match
+#define ALARM1_MATCH_WEEKDAY	0x10	//weekday, hours, minutes and seconds match
+#define ALARM2_EVERY_MINUTE		0x87	//A2M4-A2M2 = 111, at 00 seconds
+#define ALARM2_MATCH_MINUTES	0x86	//once an hour, minutes match
+#define ALARM2_MATCH_HOURS		0x84	//every day, hours and minutes match
+#define ALARM2_MATCH_DATE		0x80	//date, hours and minutes match
+#define ALARM2_MATCH_WEEKDAY	0x88	//weekday, hours and minutes match
+
+//Branch-free BCD codecs for 0-99. No divide: (num * 103) >> 10 == num / 10 for num < 100,
+//and each tens digit adds 6 more in BCD than in binary. constexpr, so constant arguments
+//are folded by the compiler
+constexpr uint8_t bcdEncode(uint8_t num) { return num + 6 * ((num * 103) >> 10); }
+constexpr uint8_t bcdDecode(uint8_t bcd) { return bcd - 6 * (bcd >> 4); }
+
+//Unix time (seconds since 1970-01-01 00:00:00) of 2000-01-01 00:00:00, where the DS3231 starts.
+//readEpoch() and friends work from 2000 until 2106-02-07 06:28:15, where a uint32_t runs out.
+#define DS3231_UNIX_2000	946684800UL
+
 //This flag tells the library whether to store the time in 12-hour or 24-hour format
 //It is used only in setTime(). Using 'extern' means that there MUST be a global bool in your
 //code with the same name. If you do not want to use this, then allow it to be defined 
@@ -59,6 +82,12 @@ class Date {
   uint8_t weekday;  //1=Sun...7=Sat
 };
 
+class DateTime {
+  public:
+  Time t;			//hour12, hour24, minute, second, pm
+  Date d;			//year, month, date, weekday
+};
+
 class AlarmSetting {
 	public:
 	Time t;				//Will hold hour12, hour24, minute, second, and pm for alarm setting
@@ -74,22 +103,321 @@ class AlarmSetting {
 	//Datasheet: https://datasheets.maximintegrated.com/en/ds/DS3231.pdf
 };
 
+class RegisterCacheStats {
+	public:
+	uint32_t hits;		//lookups answered from the shadow copy, no bus traffic
+	uint32_t misses;	//lookups that had to read the DS3231
+};
+class TickClockStats {
+	public:
+	uint32_t resyncs;			//times the software clock was reloaded from the DS3231
+	uint32_t driftChecks;		//once-a-minute seconds register comparisons
+	uint32_t driftFailures;		//comparisons that didn't match and forced a resync
+};
+//I2C traffic counts, see getBusStats(). Every transaction the library makes adds to
+//them, so they're off unless DS3231_BUS_STATS is defined. The library's .cpp files
+//have to see it too, so uncomment it here rather than in your sketch (or pass
+//-DDS3231_BUS_STATS to the compiler for the whole build)
+//#define DS3231_BUS_STATS
+class BusStats {
+	public:
+	uint32_t transactions;	//START...STOP sequences on the bus
+	uint32_t bytesWritten;	//bytes sent by us, including address bytes
+	uint32_t bytesRead;		//bytes sent by the DS3231, plus the address byte that asked for them
+	uint32_t starts;		//START conditions
+	uint32_t stops;			//STOP conditions
+};
+//Results from the ...Checked() calls and ds3231LastError(). 1-5 are Wire.endTransmission()'s
+#define DS3231_OK                0
+#define DS3231_ERR_TOO_LONG      1	//more than Wire's buffer holds
+#define DS3231_ERR_NACK_ADDRESS  2	//nothing answered at DS3231_ADDR
+#define DS3231_ERR_NACK_DATA     3	//DS3231 stopped ACKing mid-write
+#define DS3231_ERR_BUS           4	//lost arbitration, bus error
+#define DS3231_ERR_TIMEOUT       5	//transaction didn't finish in time (needs Wire with setWireTimeout())
+#define DS3231_ERR_SHORT_READ    6	//fewer bytes came back than asked for
+#define DS3231_ERR_IMPLAUSIBLE   7	//read fine, but isn't a real time or date
+#define DS3231_ERR_BUS_STUCK     8	//SDA held low and clocking SCL didn't free it
+
+#ifndef DS3231_RETRIES
+#define DS3231_RETRIES 2				//retries per call after the first try, #define before including to change
+#endif
+#ifndef DS3231_CALL_TIMEOUT_MICROS
+#define DS3231_CALL_TIMEOUT_MICROS 20000UL	//no more retries once a call has taken this long
+#endif
+#define DS3231_LATENCY_BUCKETS 10	//bucket n counts calls under 64 << n us, the last one everything longer
+#define DS3231_RETRY_BUCKETS    4	//calls that took 0, 1, 2, 3 or more retries
+
+class BusHealth {
+	public:
+	uint32_t latency[DS3231_LATENCY_BUCKETS];	//call time histogram, retries included
+	uint32_t retries[DS3231_RETRY_BUCKETS];		//retries-per-call histogram
+	uint32_t maxLatencyMicros;	//slowest call
+	uint32_t failures;			//calls that ran out of retries or time
+	uint32_t implausible;		//time & date reads that made no sense
+	uint32_t recoveries;		//times the bus was unstuck by clocking SCL
+	uint8_t lastError;			//result of the last call, DS3231_OK or DS3231_ERR_...
+};
+
+//Anything that can do an I2C write and read. The free functions use DS3231_Wire, the
+//global Wire; DS3231_multi.h has WireTransport for other TwoWire-like buses
+class DS3231Transport {
+	public:
+	virtual ~DS3231Transport() {}
+	//One START, address+W, first, len bytes of buf, STOP. first is the register for a
+	//DS3231. Returns 0 on success, like endTransmission()
+	virtual uint8_t write(uint8_t address, uint8_t first, const uint8_t *buf, uint8_t len) = 0;
+	//One START, address+R, len bytes, STOP. Returns how many bytes arrived
+	virtual uint8_t read(uint8_t address, uint8_t *buf, uint8_t len) = 0;
+};
+class TwoWire;
+//DS3231Transport for a TwoWire. If Wire has a timeout (WIRE_HAS_TIMEOUT) and it
+//goes off, write() returns DS3231_ERR_TIMEOUT and read() 0
+class TwoWireTransport : public DS3231Transport {
+	public:
+	TwoWireTransport(TwoWire &wire) : _wire(wire) {}
+	uint8_t write(uint8_t address, uint8_t first, const uint8_t *buf, uint8_t len);
+	uint8_t read(uint8_t address, uint8_t *buf, uint8_t len);
+	private:
+	TwoWire &_wire;
+};
+extern TwoWireTransport DS3231_Wire;	//the global Wire
+
+//One DS3231 as the bus calls see it: where it is, and how calls to it have gone.
+//The free functions use _ds3231, DS3231_ADDR on DS3231_Wire. A DS3231 object
+//(DS3231_multi.h) has its own, or shares _ds3231 if it's the same chip
+class DS3231Link {
+	public:
+	DS3231Transport *bus;
+	uint8_t address;
+#ifdef DS3231_BUS_STATS
+	BusStats stats;			//traffic, see getBusStats()
+#endif
+	BusHealth health;		//errors, retries and latency, see getBusHealth()
+	DateTime lastGood;		//what a failed time & date read hands back, 2000-01-01 until one works
+};
+extern DS3231Link _ds3231;
+
+//Async transaction queue - see readDateTimeAsync() and serviceAsync()
+#ifndef DS3231_ASYNC_QUEUE_SIZE
+#define DS3231_ASYNC_QUEUE_SIZE 4	//ops that can be waiting at once, #define before including to change
+#endif
+#define ASYNC_READ_DATETIME		1	//AsyncOp.kind
+#define ASYNC_WRITE				2
+#define ASYNC_SERVICE_ALARMS	3
+#define ASYNC_PHASE_START		0	//AsyncOp.phase - nothing sent yet
+#define ASYNC_PHASE_POINTER_SET	1	//register pointer written, read next
+#define ASYNC_PHASE_CLEAR_FLAGS	2	//serviceAlarmsAsync() read flags, write to clear them next
+typedef void (*DateTimeCallback)(DateTime dt);
+typedef void (*AlarmCallback)(uint8_t alarms);
+typedef void (*WriteCallback)(void);
+typedef void (*AlarmHook)(void);
+typedef void (*JournalHook)(uint8_t event, uint8_t data);
+//Events handed to the journal hook, see setJournalHook() and DS3231_journal.h
+#define JOURNAL_ALARM			1	//data: alarm flags found, 1, 2 or 3
+#define JOURNAL_SET_TIME		2	//data: DS3231_OK or DS3231_ERR_... from the write
+#define JOURNAL_SET_DATE		3	//data: same
+#define JOURNAL_SET_DATETIME	4	//data: same - setDateTime(), setEpoch(), the async, sync and image writes
+
+class AsyncOp {
+	public:
+	uint8_t kind;		//ASYNC_READ_DATETIME, ASYNC_WRITE or ASYNC_SERVICE_ALARMS
+	uint8_t phase;		//ASYNC_PHASE_...
+	uint8_t reg;		//first register
+	uint8_t len;		//registers to read or write
+	uint8_t buf[7];		//data to write, or data read
+	uint8_t generation;	//bus generation when the pointer was set
+	uint16_t ticket;
+	uint32_t queuedAt;	//micros() when queued
+	union {
+		DateTimeCallback dateTime;
+		AlarmCallback alarms;
+		WriteCallback done;
+	} callback;
+};
+
+class AsyncStats {
+	public:
+	uint8_t depth;				//ops in the queue right now
+	uint8_t maxDepth;			//most ops ever queued at once
+	uint32_t completed;			//ops finished
+	uint32_t failed;			//ops that finished with a bus error, see ds3231LastError()
+	uint32_t refused;			//...Async() calls turned away because the queue was full
+	uint32_t lastLatencyMicros;	//queued to completed, most recent op
+	uint32_t maxLatencyMicros;	//queued to completed, worst op
+};
+//Alarm interrupt event ring - see alarmEventISR()
+#ifndef DS3231_EVENT_QUEUE_SIZE
+#define DS3231_EVENT_QUEUE_SIZE 8	//must be a power of 2, holds one less than this
+#endif
+
+class AlarmEvent {
+	public:
+	uint32_t micros;		//micros() when the interrupt came in
+	uint32_t sequence;		//counts every interrupt, a gap means some were dropped
+	uint32_t latencyMicros;	//interrupt to serviceAlarms(), filled in by serviceAlarms()
+	uint8_t alarms;			//alarm flags serviceAlarms() found, 1, 2 or 3
+};
+
+class AlarmEventStats {
+	public:
+	uint32_t events;			//events handed out by serviceAlarms()
+	uint16_t overflows;			//interrupts dropped because the ring was full
+	uint32_t lastLatencyMicros;	//interrupt to service, most recent event
+	uint32_t maxLatencyMicros;	//interrupt to service, worst event
+};
+
+//Where each alarm's registers are, see encodeAlarm()
+class AlarmLayout {
+	public:
+	uint8_t firstReg;	//first register, 0x07 or 0x0B
+	uint8_t count;		//how many registers, 4 or 3
+	uint8_t firstField;	//field in the first register: 0=seconds, 1=minutes
+};
+extern const AlarmLayout _alarmLayout[2];
+
+//Register image - every register 0x00-0x12, see captureImage() and applyImage()
+#define DS3231_REGISTER_COUNT 19
+//applyImage() masks, bit n selects register n
+#define IMAGE_TIME		0x00007UL	//0x00-0x02
+#define IMAGE_DATE		0x00078UL	//0x03-0x06
+#define IMAGE_DATETIME	0x0007fUL	//0x00-0x06
+#define IMAGE_ALARM1	0x00780UL	//0x07-0x0A
+#define IMAGE_ALARM2	0x03800UL	//0x0B-0x0D
+#define IMAGE_CONTROL	0x04000UL	//0x0E
+#define IMAGE_STATUS	0x08000UL	//0x0F
+#define IMAGE_AGING		0x10000UL	//0x10
+#define IMAGE_WRITABLE	0x1ffffUL	//0x00-0x10, the temperature registers are read only
+#define IMAGE_CONFIG	0x1ff80UL	//everything writable but the time and date
+
+class Ds3231Image {
+	public:
+	uint8_t regs[DS3231_REGISTER_COUNT];	//raw register values, regs[n] is register n
+};
+
+class Ds3231ImageInfo {
+	public:
+	DateTime dt;			//time & date
+	AlarmSetting alarm1;	//alarm_mask tells which kind of alarm it is
+	AlarmSetting alarm2;
+	uint8_t control;		//CONTROL register, A1IE/A2IE in bits 0 and 1
+	uint8_t status;			//STATUS register, OSF in bit 7, A1F/A2F in bits 0 and 1
+	int8_t agingOffset;		//aging offset, two's complement
+	int16_t temperature;	//quarter degrees C, 10 bit two's complement
+};
 
 //Function prototypes
+//readDateTime(), readTime() and readDate() never return garbage: if the bus fails they
+//return the last good time & date, which may be stale. Check ds3231LastError() before
+//trusting it, or use readDateTimeChecked()
+DateTime readDateTime(void);			//reads all DS3231 time & date registers in one burst, returns both
 Time readTime(void);					//reads DS3231 time registers, returns values in Time object
 void setTime(Time t);					//takes values from Time object, write them to DS3231 time registers
 Date readDate(void);					//reads DS3231 date registers, returns values in Date object
 void setDate(Date d);					//takes values in Date object, write them to DS3231 date registers
+void setDateTime(DateTime dt);			//writes time and date registers in one transaction
 void setAlarm(AlarmSetting a);			//takes values in AlarmSetting object and configure the cooresponding alarm in DS3231
+AlarmSetting readAlarm(uint8_t alarm);	//reads alarm 1 or 2 back in one burst
+uint8_t encodeAlarm(AlarmSetting a, bool twelve, uint8_t *regs); //AlarmSetting -> register values, returns first register
+AlarmSetting decodeAlarm(const uint8_t *regs, uint8_t alarm); //register values -> AlarmSetting for alarm 1 or 2
 void turnAlarmOn(uint8_t alarms);		//Enables interrupts for the passed alarms
+void turnAlarmOff(uint8_t alarms);		//Disables interrupts for the passed alarms
 uint8_t getAlarmStatus(void);			//returns on/off status of each alarm (A1IE and A2IE bits)
 uint8_t serviceAlarms(void);			//Clears Alarm flags, returns which alarm flags were set
-uint8_t toggleAlarms(void);				//Using A1IE, A2IE, cycles from both off, 1 on, 2 on, both on,...
+void setAlarm1Hook(AlarmHook hook);		//Hands Alarm 1 to hook instead of returning it from serviceAlarms()
+void setJournalHook(JournalHook hook);	//Tells hook about every alarm found and every time the clock is set
+DateTime currentDateTime(void);			//Software clock if running, otherwise readDateTime()
+void alarmEventISR(void);				//Alarm ISR: queues a timestamped event, nothing else
+uint8_t alarmEventsPending(void);		//Events queued by alarmEventISR() not yet serviced
+uint8_t serviceAlarms(AlarmEvent *events, uint8_t maxEvents); //Clears flags, returns every queued event
+AlarmEventStats getAlarmEventStats(void); //Event counts, overflows and latency
+uint8_t toggleAlarms(void);				//Using A1IE, A2IE, cycles from both off, 1 on, 2 on, both on,... 0 if CONTROL couldn't be read
 void initializeDS3231(void);			//Sets time and configures alarm interrupts
 uint8_t readRegister(uint8_t reg);		//Reads from register, returns register value
 void writeRegister(uint8_t reg, uint8_t data); //Writes data to register
+uint8_t readRegisters(uint8_t reg, uint8_t *buf, uint8_t len); //Reads len registers starting at reg, returns len, 0 on failure
+void writeRegisters(uint8_t reg, const uint8_t *buf, uint8_t len); //Writes len registers starting at reg in one transaction
+uint8_t readRegistersChecked(uint8_t reg, uint8_t *buf, uint8_t len); //readRegisters() with retries, returns DS3231_OK or DS3231_ERR_...
+uint8_t writeRegistersChecked(uint8_t reg, const uint8_t *buf, uint8_t len); //writeRegisters() with retries, returns DS3231_OK or DS3231_ERR_...
+uint8_t readDateTimeChecked(DateTime *dt);	//readDateTime() that also rejects impossible times, returns DS3231_OK or DS3231_ERR_...
+uint8_t ds3231LastError(void);			//Result of the last call, for the ones that don't return it
+void setBusTimeout(uint32_t micros);	//Per-transaction timeout, if Wire supports it
+void setBusClock(uint32_t hz);			//Wire.setClock(), remembered for after recoverBus()
+uint8_t recoverBus(void);				//Clocks SCL until a stuck slave lets go of SDA, returns DS3231_OK or DS3231_ERR_BUS_STUCK
+BusHealth getBusHealth(void);			//Latency and retry histograms, failure counts
+void resetBusHealth(void);				//Zeroes them
+void useRegisterCache(bool enable);		//Turns the CONTROL/STATUS/12-24 mode shadow cache on or off
+void invalidateRegisterCache(void);		//Forces the next cached lookup to read the DS3231
+void refreshRegisterCache(void);		//Reloads the shadow cache with one burst read
+RegisterCacheStats getRegisterCacheStats(void); //Returns cache hit/miss counts
+void startTickClock(uint8_t resyncMinutes);	//1 Hz SQW out, keep time in software, resync every resyncMinutes
+void stopTickClock(void);				//SQW/!INT pin back to alarm interrupts
+void tickClockISR(void);				//Call on each falling edge of the 1 Hz SQW
+DateTime tickClockNow(void);			//Current time & date from the software clock, no bus traffic
+uint8_t tickClockService(void);			//Call from loop(), resyncs and checks alarms, returns alarms tripped
+TickClockStats getTickClockStats(void);	//Returns resync and drift check counts
+DateTime advanceDateTime(DateTime dt);	//Returns dt + 1 second with full calendar rollover
+uint8_t daysInMonth(uint16_t year, uint8_t month); //28-31, handles leap years
+uint8_t weekdayOf(uint16_t year, uint8_t month, uint8_t date); //1=Sun...7=Sat
+uint32_t readEpoch(void);				//Reads time & date, returns Unix time
+uint32_t readEpochMillis(uint16_t *millisPart);	//Unix time, plus milliseconds into the second if the tick clock runs
+void setEpoch(uint32_t epoch);			//Sets time & date from Unix time, in one transaction
+uint32_t dateTimeToEpoch(DateTime dt);	//Unix time of dt
+DateTime epochToDateTime(uint32_t epoch);	//DateTime of Unix time, weekday included
+void epochToDateTime(const uint32_t *epochs, DateTime *out, uint16_t n); //Converts n Unix times at once
+uint16_t readDateTimeAsync(DateTimeCallback callback);	//Queues readDateTime(), returns ticket (0 = queue full)
+uint16_t setDateTimeAsync(DateTime dt, WriteCallback callback); //Queues setDateTime(), returns ticket
+uint16_t setAlarmAsync(AlarmSetting a, WriteCallback callback); //Queues setAlarm(), returns ticket
+uint16_t serviceAlarmsAsync(AlarmCallback callback);	//Queues serviceAlarms(), returns ticket
+uint8_t serviceAsync(void);				//Runs one queued I2C transaction, returns ops still queued
+bool asyncDone(uint16_t ticket);		//True once the op with that ticket has completed
+DateTime asyncLastDateTime(void);		//Result of the last completed readDateTimeAsync()
+AsyncStats getAsyncStats(void);			//Queue depth, completions and latency
+Ds3231Image captureImage(void);			//Reads all 19 registers in one burst
+uint8_t applyImage(const Ds3231Image &image, uint32_t mask); //Writes the masked registers, returns transactions used
+uint32_t imageDiff(const Ds3231Image &a, const Ds3231Image &b); //Mask of writable registers that differ
+Ds3231ImageInfo decodeImage(const Ds3231Image &image);	//Decodes an image, no bus traffic
+#ifdef DS3231_BUS_STATS
+BusStats getBusStats(void);				//Returns I2C traffic counts since last reset
+void resetBusStats(void);				//Zeroes the I2C traffic counts
+BusStats busStatsSince(BusStats before);	//Returns traffic since 'before' was taken
+#endif
+uint32_t busTimeMicros(BusStats stats, uint32_t clockHz); //Models bus time in us for stats at clockHz
 uint8_t readBcdRegister(uint8_t reg);    //Reads from register, returns register's BCD value converted to decimal
 void writeBcdRegister(uint8_t reg, uint8_t data); //Writes data to register, pass decimal value, it converts to BCD then writes
+void _cacheUpdate(uint8_t reg, const uint8_t *buf, uint8_t len); //copies shadowed registers out of a read or write
+uint8_t _getControl(uint8_t *control);		//CONTROL register, cached if possible, returns DS3231_OK or DS3231_ERR_...
+uint8_t _isTwelveHourMode(bool *twelve);	//12/!24 bit of hours register, cached if possible, returns DS3231_OK or DS3231_ERR_...
+uint8_t _clearAlarmFlags(uint8_t alarms);	//clears A1F and/or A2F in STATUS, returns DS3231_OK or DS3231_ERR_...
+uint8_t _runAlarm1Hook(uint8_t alarms);	//calls the Alarm 1 hook if set, returns alarms it didn't take
+void _journalEvent(uint8_t event, uint8_t data);	//calls the journal hook if set
+void _tickClockResync(void);		//reloads the software clock from the DS3231
+void _clockWasSet(void);			//call after writing the time or date registers
+uint16_t _clockSetCount(void);		//changes every time the time or date is written
+uint32_t _daysFromCivil(uint16_t year, uint8_t month, uint8_t date); //days since 2000-01-01
+Date _civilFromDays(uint32_t days);	//inverse of _daysFromCivil(), fills weekday too
+Time _timeFromSeconds(uint32_t seconds);	//Time that is seconds after midnight, < 86400
+void _setHour12(Time *t);		//fills hour12 and pm from hour24
+DateTime _decodeDateTime(const uint8_t *regs);	//decodes registers 0x00-0x06
+void _decodeHour(uint8_t data, Time *t);	//decodes an hours register into hour24, hour12 and pm
+uint8_t _readChecked(DS3231Link *link, uint8_t reg, uint8_t *buf, uint8_t len); //readRegistersChecked() on link
+uint8_t _writeChecked(DS3231Link *link, uint8_t reg, const uint8_t *buf, uint8_t len); //writeRegistersChecked() on link
+uint8_t _readDateTimeChecked(DS3231Link *link, DateTime *dt); //readDateTimeChecked() on link
+uint8_t _readDateTimeRegisters(DS3231Link *link, uint8_t *regs); //registers 0x00-0x06, checked and plausible, returns DS3231_OK or DS3231_ERR_...
+uint8_t _writeClock(DS3231Link *link, uint8_t reg, const uint8_t *regs, uint8_t len, uint8_t event); //writes time/date registers, tells the library if link is _ds3231
+uint8_t _setRegisterPointer(DS3231Link *link, uint8_t reg);	//first half of readRegisters(), returns DS3231_OK or DS3231_ERR_...
+uint8_t _readOnce(DS3231Link *link, uint8_t reg, uint8_t *buf, uint8_t len);	//one try at readRegistersChecked()
+uint8_t _writeOnce(DS3231Link *link, uint8_t reg, const uint8_t *buf, uint8_t len);	//one try at writeRegistersChecked()
+bool _retryAfter(DS3231Link *link, uint8_t result, uint32_t start, uint8_t *tries);	//uses up a retry if there's one left
+uint8_t _finishCall(DS3231Link *link, uint32_t start, uint8_t tries, uint8_t result);	//records the call in the histograms
+bool _plausibleDateTime(const uint8_t *regs);	//checks registers 0x00-0x06 are a real time & date
+bool _sdaStuck(void);				//SDA held low with nothing going on
+uint8_t _readFromPointer(DS3231Link *link, uint8_t reg, uint8_t *buf, uint8_t len); //second half of readRegisters()
+AsyncOp *_asyncPush(uint8_t kind, uint8_t reg, uint8_t len);	//adds an op to the async queue
+void _asyncFinish(AsyncOp *op, uint8_t result);	//completes the head op
+void _asyncFail(AsyncOp *op, uint8_t error);	//completes the head op with a DS3231_ERR_...
+uint8_t _hourRegister(Time t, bool twelve);	//encodes hour12/pm or hour24 for an hours register
+void _dateTimeRegisters(DateTime dt, bool twelve, uint8_t *regs); //encodes a DateTime into registers 0x00-0x06
+void _dateRegisters(Date d, uint8_t *regs);		//encodes a Date into registers 0x03-0x06
 uint8_t _toBcd(uint8_t num);    //decimal -> BCD conversion
 uint8_t _fromBcd(uint8_t bcd);  //BCD -> decimal conversion
 #endif
\ No newline at end of file
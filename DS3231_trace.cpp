@@ -0,0 +1,216 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  DS3231_trace.cpp                                                      ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#include <stdint.h>   //include standard typdef definitions
+#include <Arduino.h>  //include Arduino core for Print and noInterrupts()
+#include "DS3231_trace.h"  //include header for this file
+
+#ifdef DS3231_TRACE
+//Ring of the last DS3231_TRACE_SIZE records. Anything can add to it, interrupt
+//handlers included, so every touch is done with interrupts off. On AVR they're
+//put back the way they were, not just turned on, in case that was inside an ISR
+#ifdef __AVR__
+#define TRACE_LOCK()	uint8_t _sreg = SREG; cli()
+#define TRACE_UNLOCK()	SREG = _sreg
+#else
+#define TRACE_LOCK()	noInterrupts()
+#define TRACE_UNLOCK()	interrupts()
+#endif
+TraceRecord _trace[DS3231_TRACE_SIZE];
+uint8_t _traceHead = 0;			//where the next record goes
+uint8_t _traceCount = 0;		//records in the ring
+uint16_t _traceLost = 0;		//records overwritten before they were dumped
+
+/*****************************************************************
+* traceRecord(id, us)
+* Usually called by DS3231_TRACE_SCOPE(id) as it goes out of scope.
+* When the ring is full the oldest record is overwritten, so it
+* always holds the most recent ones.
+* @id - TRACE_... event
+* @us - how long it took
+*****************************************************************/
+void traceRecord(uint8_t id, uint32_t us) {
+	TRACE_LOCK();
+	_trace[_traceHead].id = id;
+	_trace[_traceHead].micros = us > 0xffff ? 0xffff : us;
+	if(++_traceHead == DS3231_TRACE_SIZE)
+		_traceHead = 0;
+	if(_traceCount < DS3231_TRACE_SIZE)
+		_traceCount++;
+	else
+		_traceLost++;
+	TRACE_UNLOCK();
+}
+/*****************************************************************
+* traceDump(port)
+* Prints "trace <records> <lost>" and then the records oldest
+* first, "id:us" eight to a line, taking each out of the ring as it
+* goes - events that happen while it prints are kept for next time.
+* @port - Serial, or any other Print
+*****************************************************************/
+void traceDump(Print &port) {
+	TraceRecord rec;
+	uint8_t n = 0;
+	uint8_t count;
+	uint16_t lost;
+	TRACE_LOCK();
+	count = _traceCount;
+	lost = _traceLost;
+	_traceLost = 0;
+	TRACE_UNLOCK();
+	port.print(F("trace "));
+	port.print(count);
+	port.print(' ');
+	port.println(lost);
+	while(_tracePop(&rec)) {
+		port.print(rec.id);
+		port.print(':');
+		port.print(rec.micros);
+		port.print(++n % 8 ? ' ' : '\n');
+	}
+	if(n % 8)
+		port.println();
+}
+/*****************************************************************
+* traceDumpBinary(port)
+* The records oldest first, 3 bytes each in TRACE_FRAME_TYPE frames
+* (see DS3231_trace.h) - about a third of what traceDump() prints,
+* and what host/ds3231_trace reads. Takes only the records that were
+* there when it started, events while it sends are kept for next time.
+* @port - Serial, or any other Print
+*****************************************************************/
+void traceDumpBinary(Print &port) {
+	TraceRecord rec;
+	uint8_t payload[2 + 3 * TRACE_FRAME_RECORDS];
+	uint8_t count;
+	uint8_t n;
+	uint16_t lost;
+	TRACE_LOCK();
+	count = _traceCount;
+	lost = _traceLost;
+	_traceLost = 0;
+	TRACE_UNLOCK();
+	do {
+		payload[0] = lost;
+		payload[1] = lost >> 8;
+		lost = 0;
+		for(n = 0; n < TRACE_FRAME_RECORDS && count && _tracePop(&rec); n++, count--) {
+			payload[2 + 3 * n] = rec.id;
+			payload[3 + 3 * n] = rec.micros;
+			payload[4 + 3 * n] = rec.micros >> 8;
+		}
+		_traceFrame(port, payload, 2 + 3 * n);
+	} while(n == TRACE_FRAME_RECORDS);
+}
+/*****************************************************************
+* traceSummary(port)
+* A table with a row per event id in the ring: count, min, mean and
+* max in us, then how many fell in each TRACE_BUCKETS bucket. The
+* ring is left as it is.
+* @port - Serial, or any other Print
+*****************************************************************/
+void traceSummary(Print &port) {
+	TraceRecord rec;
+	TraceRecord other;
+	uint16_t hist[TRACE_BUCKETS];
+	uint16_t count;
+	uint16_t min;
+	uint16_t max;
+	uint32_t sum;
+	uint8_t bucket;
+	uint8_t i;
+	uint8_t j;
+	port.print(F("event\tn\tmin\tmean\tmax"));
+	for(bucket = 0; bucket < TRACE_BUCKETS - 1; bucket++) {
+		port.print(F("\t<"));
+		port.print(16U << bucket);
+	}
+	port.println(F("\tmore"));
+	for(i = 0; _tracePeek(i, &rec); i++) {
+		for(j = 0; j < i && _tracePeek(j, &other) && other.id != rec.id; j++)
+			;
+		if(j < i)
+			continue;		//already had a row
+		memset(hist, 0, sizeof(hist));
+		count = 0;
+		sum = 0;
+		min = 0xffff;
+		max = 0;
+		for(j = i; _tracePeek(j, &other); j++) {
+			if(other.id != rec.id)
+				continue;
+			count++;
+			sum += other.micros;
+			if(other.micros < min)
+				min = other.micros;
+			if(other.micros > max)
+				max = other.micros;
+			for(bucket = 0; bucket < TRACE_BUCKETS - 1 && other.micros >= (16U << bucket); bucket++)
+				;
+			hist[bucket]++;
+		}
+		if(_traceName(rec.id))
+			port.print(_traceName(rec.id));
+		else
+			port.print(rec.id);
+		port.print('\t'); port.print(count);
+		port.print('\t'); port.print(min);
+		port.print('\t'); port.print(sum / count);
+		port.print('\t'); port.print(max);
+		for(bucket = 0; bucket < TRACE_BUCKETS; bucket++) {
+			port.print('\t');
+			port.print(hist[bucket]);
+		}
+		port.println();
+	}
+}
+void traceClear(void) {
+	TRACE_LOCK();
+	_traceCount = 0;
+	_traceLost = 0;
+	TRACE_UNLOCK();
+}
+bool _tracePop(TraceRecord *rec) {
+	bool got;
+	TRACE_LOCK();
+	got = _traceCount > 0;
+	if(got)
+		*rec = _trace[(_traceHead + DS3231_TRACE_SIZE - _traceCount--) % DS3231_TRACE_SIZE];
+	TRACE_UNLOCK();
+	return got;
+}
+bool _tracePeek(uint8_t i, TraceRecord *rec) {
+	bool got;
+	TRACE_LOCK();
+	got = i < _traceCount;
+	if(got)
+		*rec = _trace[(_traceHead + DS3231_TRACE_SIZE - _traceCount + i) % DS3231_TRACE_SIZE];
+	TRACE_UNLOCK();
+	return got;
+}
+void _traceFrame(Print &port, const uint8_t *payload, uint8_t len) {
+	uint8_t sum = TRACE_FRAME_TYPE + len;
+	uint8_t i;
+	port.write((uint8_t)TRACE_FRAME_START);
+	port.write((uint8_t)TRACE_FRAME_TYPE);
+	port.write(len);
+	for(i = 0; i < len; i++) {
+		port.write(payload[i]);
+		sum += payload[i];
+	}
+	port.write((uint8_t)-sum);
+}
+const __FlashStringHelper *_traceName(uint8_t id) {
+	switch(id) {
+		case TRACE_I2C_POINTER:	return F("i2c ptr");
+		case TRACE_I2C_READ:	return F("i2c read");
+		case TRACE_I2C_WRITE:	return F("i2c write");
+		case TRACE_DECODE:		return F("decode");
+		case TRACE_JOURNAL_READ:	return F("eeprom read");
+		case TRACE_JOURNAL_WRITE:	return F("eeprom write");
+	}
+	return NULL;
+}
+#endif
@@ -0,0 +1,84 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  DS3231_trace.h                                                        ***
+***	 Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#ifndef _DS3231_TRACE_H
+#define _DS3231_TRACE_H
+
+#include <Arduino.h>
+
+//Hot-path timing. With DS3231_TRACE defined, each I2C transaction the library makes,
+//each time & date decode, and whatever the sketch wraps in DS3231_TRACE_SCOPE(), is
+//timed and put in a ring of the last DS3231_TRACE_SIZE (event id, duration) records.
+//traceDump() prints the records, traceSummary() prints a latency histogram per event.
+//traceDumpBinary() sends them as frames for host/ds3231_trace, which makes finer
+//histograms and percentiles on the PC. Without DS3231_TRACE the macros are empty and
+//none of this is compiled.
+//
+//The library's .cpp files have to see it too, so uncomment it here rather than in
+//your sketch (or pass -DDS3231_TRACE to the compiler for the whole build)
+//#define DS3231_TRACE
+
+//How many records the ring holds, 3 bytes each, up to 255. #define before including to change
+#ifndef DS3231_TRACE_SIZE
+#define DS3231_TRACE_SIZE 64
+#endif
+#define TRACE_BUCKETS 12	//bucket n counts events under 16 << n us, the last one everything longer
+
+//Event ids. The library uses 1-15, sketches number theirs from TRACE_USER
+#define TRACE_I2C_POINTER    1	//register pointer write, first half of a read
+#define TRACE_I2C_READ       2	//burst read from the pointer
+#define TRACE_I2C_WRITE      3	//register write
+#define TRACE_DECODE         4	//BCD registers to DateTime
+#define TRACE_JOURNAL_READ   5	//journal page read from the EEPROM
+#define TRACE_JOURNAL_WRITE  6	//journal page write, not counting the EEPROM's write cycle
+#define TRACE_USER          16
+
+//traceDumpBinary() frames, DS3231_sync.h's framing so the host reads both the same way:
+//  0xA5 | TRACE_FRAME_TYPE | len | lost u16, up to TRACE_FRAME_RECORDS x (id u8, us u16) | check
+//lost (records overwritten before they were dumped) is only in the first frame. The
+//dump ends with the first frame holding fewer than TRACE_FRAME_RECORDS records
+#define TRACE_FRAME_START   0xa5
+#define TRACE_FRAME_TYPE    0x84
+#define TRACE_FRAME_RECORDS 16
+
+//Commands the sketch takes, one byte, typed or from host/ds3231_trace. With SERIAL_SYNC
+//the host sends them in a SYNC_MSG_TRACE frame instead
+#define TRACE_CMD_DUMP      'b'	//traceDumpBinary()
+#define TRACE_CMD_CLEAR     'c'	//traceClear()
+
+class TraceRecord {
+	public:
+	uint8_t id;			//TRACE_... event
+	uint16_t micros;	//how long it took, 65535 if longer
+};
+
+#ifdef DS3231_TRACE
+//Function prototypes
+void traceRecord(uint8_t id, uint32_t us);	//Adds a record, safe from interrupt handlers
+void traceDump(Print &port);			//Prints the records oldest first, then empties the ring
+void traceDumpBinary(Print &port);		//Sends them as TRACE_FRAME_TYPE frames, then empties the ring
+void traceSummary(Print &port);			//Prints count, min, mean, max and a histogram per event id
+void traceClear(void);					//Empties the ring
+bool _tracePop(TraceRecord *rec);		//takes the oldest record out
+bool _tracePeek(uint8_t i, TraceRecord *rec);	//copies the ith oldest, leaves it there
+void _traceFrame(Print &port, const uint8_t *payload, uint8_t len);	//sends one frame
+const __FlashStringHelper *_traceName(uint8_t id);	//library event names, NULL for the sketch's
+
+//Times from where it's declared to the end of the enclosing block
+class TraceScope {
+	public:
+	TraceScope(uint8_t id) : _id(id), _start(micros()) {}
+	~TraceScope() { traceRecord(_id, micros() - _start); }
+	private:
+	uint8_t _id;
+	uint32_t _start;
+};
+#define DS3231_TRACE_SCOPE(id)        TraceScope _traceScope(id)
+#define DS3231_TRACE_RECORD(id, us)   traceRecord(id, us)
+#else
+#define DS3231_TRACE_SCOPE(id)
+#define DS3231_TRACE_RECORD(id, us)
+#endif
+#endif
@@ -0,0 +1,79 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/AT24C32_sim.cpp                                                  ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#include "AT24C32_sim.h"
+
+AT24C32Sim::AT24C32Sim(TwoWire &wire, uint8_t address) : _wire(wire), _address(address) {
+	erase();
+	_pointer = 0;
+	_addressBytes = 0;
+	_writing = false;
+	_present = true;
+	_busyUntil = 0;
+	_writes = 0;
+	_wire.attach(_address, this);
+}
+AT24C32Sim::~AT24C32Sim() {
+	_wire.detach(_address);
+}
+bool AT24C32Sim::i2cStart(bool read) {
+	if(!_present || busy())
+		return false;		//ACK polling ends when this says yes
+	_addressBytes = read ? 2 : 0;
+	_writing = false;
+	memset(_latched, 0, sizeof(_latched));
+	return true;
+}
+/*****************************************************************
+* i2cWrite(data)
+* Two address bytes, then data into the page latch, wrapping at
+* the end of the page
+*****************************************************************/
+bool AT24C32Sim::i2cWrite(uint8_t data) {
+	uint16_t page;
+	if(_addressBytes < 2) {
+		if(_addressBytes++ == 0)
+			_pointer = (data << 8) & (AT24C32_SIM_BYTES - 1);
+		else
+			_pointer |= data;
+		return true;
+	}
+	page = _pointer & ~(AT24C32_SIM_PAGE_BYTES - 1);
+	_latch[_pointer - page] = data;
+	_latched[_pointer - page] = true;
+	_pointer = page | ((_pointer + 1) & (AT24C32_SIM_PAGE_BYTES - 1));
+	_writing = true;
+	return true;
+}
+uint8_t AT24C32Sim::i2cRead(void) {
+	uint8_t data = _mem[_pointer];
+	_pointer = (_pointer + 1) % AT24C32_SIM_BYTES;
+	return data;
+}
+/*****************************************************************
+* i2cStop()
+* Writes what was latched and starts the write cycle
+*****************************************************************/
+void AT24C32Sim::i2cStop(void) {
+	uint16_t page = _pointer & ~(AT24C32_SIM_PAGE_BYTES - 1);
+	uint8_t i;
+	if(!_writing)
+		return;
+	_writing = false;
+	for(i = 0; i < AT24C32_SIM_PAGE_BYTES; i++)
+		if(_latched[i])
+			_mem[page + i] = _latch[i];
+	_busyUntil = hostNanos() + AT24C32_SIM_WRITE_MICROS * 1000ULL;
+	_writes++;
+}
+void AT24C32Sim::erase(void) {
+	memset(_mem, 0xff, sizeof(_mem));
+}
+void AT24C32Sim::setPresent(bool present) {
+	_present = present;
+}
+bool AT24C32Sim::busy(void) {
+	return hostNanos() < _busyUntil;
+}
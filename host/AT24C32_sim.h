@@ -0,0 +1,59 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/AT24C32_sim.h                                                    ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#ifndef _AT24C32_SIM_H
+#define _AT24C32_SIM_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+//The AT24C32 EEPROM on most DS3231 modules, on the host's simulated Wire bus, for the
+//journal test. What the datasheet says it does, as far as the library can tell:
+//  - 4096 bytes, erased (0xff) to start with, a 12 bit address sent high byte first
+//    (the top 4 bits are ignored)
+//  - a write latches bytes into the addressed 32 byte page and wraps round within it,
+//    overwriting what it already sent if it sends more than 32. They're written on
+//    the STOP - just the ones that got there, so a write cut short tears the page
+//  - during the write cycle (AT24C32_SIM_WRITE_MICROS) it doesn't ACK its address,
+//    which is how the master knows it's done
+//  - a write of the address alone sets the address for a read, no write cycle
+//  - reads go on from the address, wrapping from the last byte to the first
+
+#define AT24C32_SIM_BYTES 4096
+#define AT24C32_SIM_PAGE_BYTES 32
+#define AT24C32_SIM_ADDR 0x57				//A0-A2 pulled high, as on most modules
+#define AT24C32_SIM_WRITE_MICROS 10000UL	//tWR, the datasheet's most
+
+class AT24C32Sim : public I2CDevice {
+	public:
+	AT24C32Sim(TwoWire &wire = Wire, uint8_t address = AT24C32_SIM_ADDR);
+	~AT24C32Sim();
+	//I2CDevice
+	bool i2cStart(bool read);
+	bool i2cWrite(uint8_t data);
+	uint8_t i2cRead(void);
+	void i2cStop(void);
+	//Host side, none of these use the bus
+	uint8_t peek(uint16_t addr) { return _mem[addr % AT24C32_SIM_BYTES]; }
+	void poke(uint16_t addr, uint8_t value) { _mem[addr % AT24C32_SIM_BYTES] = value; }
+	void erase(void);						//all 0xff
+	void setPresent(bool present);			//false: NAKs everything, as if not fitted
+	bool busy(void);						//in a write cycle
+	uint32_t writes(void) { return _writes; }	//write cycles since it was made
+	private:
+	TwoWire &_wire;
+	uint8_t _address;
+	uint8_t _mem[AT24C32_SIM_BYTES];
+	uint8_t _latch[AT24C32_SIM_PAGE_BYTES];	//a write's data, by position in the page
+	bool _latched[AT24C32_SIM_PAGE_BYTES];
+	uint16_t _pointer;						//address counter
+	uint8_t _addressBytes;					//of the current write, 0-2
+	bool _writing;							//this transaction is a write with data
+	bool _present;
+	uint64_t _busyUntil;					//host ns the write cycle ends
+	uint32_t _writes;
+};
+
+#endif
@@ -0,0 +1,203 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/Arduino.cpp                                                      ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#include "Arduino.h"
+
+#define HOST_LISTENERS 8
+
+HardwareSerial Serial;
+
+uint64_t _hostNanos = 0;
+HostClockListener *_hostListeners[HOST_LISTENERS];
+bool _hostNotifying = false;		//a listener is running, don't call them again from inside it
+uint8_t _hostPins[HOST_PINS];
+bool _hostPinsSet = false;
+void (*_hostIsr[HOST_PINS])(void);
+int _hostIsrMode[HOST_PINS];
+bool _hostIsrPending[HOST_PINS];
+bool _hostInterrupts = true;
+
+uint64_t hostNanos(void) {
+	return _hostNanos;
+}
+/*****************************************************************
+* hostAdvanceNanos(nanos)
+* Moves simulated time on and lets each listener (the simulated
+* devices) catch up. A listener that reads the time, or drives a
+* pin whose ISR does, moves it on again - that doesn't call the
+* listeners again, they'll hear about it next time.
+*****************************************************************/
+void hostAdvanceNanos(uint64_t nanos) {
+	uint8_t i;
+	_hostNanos += nanos;
+	if(_hostNotifying)
+		return;
+	_hostNotifying = true;
+	for(i = 0; i < HOST_LISTENERS; i++)
+		if(_hostListeners[i])
+			_hostListeners[i]->hostTime(_hostNanos);
+	_hostNotifying = false;
+}
+void hostAdvance(uint32_t us) {
+	hostAdvanceNanos((uint64_t)us * 1000);
+}
+void hostAddListener(HostClockListener *listener) {
+	uint8_t i;
+	for(i = 0; i < HOST_LISTENERS; i++) {
+		if(!_hostListeners[i]) {
+			_hostListeners[i] = listener;
+			return;
+		}
+	}
+	fprintf(stderr, "hostAddListener: more than %d listeners\n", HOST_LISTENERS);
+	abort();
+}
+void hostRemoveListener(HostClockListener *listener) {
+	uint8_t i;
+	for(i = 0; i < HOST_LISTENERS; i++)
+		if(_hostListeners[i] == listener)
+			_hostListeners[i] = NULL;
+}
+
+unsigned long micros(void) {
+	hostAdvanceNanos(HOST_CALL_NANOS);
+	return (uint32_t)(_hostNanos / 1000);		//wraps at 32 bits, as on an AVR
+}
+unsigned long millis(void) {
+	hostAdvanceNanos(HOST_CALL_NANOS);
+	return (uint32_t)(_hostNanos / 1000000);
+}
+void delay(unsigned long ms) {
+	hostAdvanceNanos((uint64_t)ms * 1000000);
+}
+void delayMicroseconds(unsigned int us) {
+	hostAdvance(us);
+}
+
+/*****************************************************************
+* Pins. Everything starts high, as if pulled up
+*****************************************************************/
+void _hostPinsInit(void) {
+	if(!_hostPinsSet) {
+		memset(_hostPins, HIGH, sizeof(_hostPins));
+		_hostPinsSet = true;
+	}
+}
+void pinMode(uint8_t pin, uint8_t mode) {
+	(void)pin;
+	(void)mode;
+}
+int digitalRead(uint8_t pin) {
+	_hostPinsInit();
+	return pin < HOST_PINS ? _hostPins[pin] : LOW;
+}
+void digitalWrite(uint8_t pin, uint8_t level) {
+	hostSetPin(pin, level);
+}
+void attachInterrupt(int interrupt, void (*isr)(void), int mode) {
+	if(interrupt < 0 || interrupt >= HOST_PINS)
+		return;
+	_hostIsr[interrupt] = isr;
+	_hostIsrMode[interrupt] = mode;
+	_hostIsrPending[interrupt] = false;
+}
+void detachInterrupt(int interrupt) {
+	if(interrupt >= 0 && interrupt < HOST_PINS)
+		_hostIsr[interrupt] = NULL;
+}
+void noInterrupts(void) {
+	_hostInterrupts = false;
+}
+/*****************************************************************
+* interrupts()
+* Runs any ISR whose edge came while they were off, as the AVR
+* does with its interrupt flags
+*****************************************************************/
+void interrupts(void) {
+	uint8_t pin;
+	_hostInterrupts = true;
+	for(pin = 0; pin < HOST_PINS; pin++) {
+		if(_hostIsrPending[pin] && _hostIsr[pin]) {
+			_hostIsrPending[pin] = false;
+			_hostInterrupts = false;		//ISRs run with interrupts off
+			_hostIsr[pin]();
+			_hostInterrupts = true;
+		}
+	}
+}
+bool hostInterruptsEnabled(void) {
+	return _hostInterrupts;
+}
+void hostSetPin(uint8_t pin, uint8_t level) {
+	uint8_t was;
+	bool edge;
+	_hostPinsInit();
+	if(pin >= HOST_PINS)
+		return;
+	was = _hostPins[pin];
+	_hostPins[pin] = level;
+	if(!_hostIsr[pin] || was == level)
+		return;
+	edge = _hostIsrMode[pin] == CHANGE
+		|| (_hostIsrMode[pin] == FALLING && level == LOW)
+		|| (_hostIsrMode[pin] == RISING && level == HIGH);
+	if(!edge)
+		return;
+	if(!_hostInterrupts) {
+		_hostIsrPending[pin] = true;
+		return;
+	}
+	_hostInterrupts = false;
+	_hostIsr[pin]();
+	_hostInterrupts = true;
+}
+
+/*****************************************************************
+* Print and Stream
+*****************************************************************/
+size_t Print::write(const uint8_t *buf, size_t size) {
+	size_t n = 0;
+	while(size--)
+		n += write(*buf++);
+	return n;
+}
+size_t Print::print(unsigned long n, int base) {
+	char buf[8 * sizeof(long) + 1];
+	char *p = &buf[sizeof(buf) - 1];
+	if(base < 2)
+		base = 10;
+	*p = '\0';
+	do {
+		*--p = "0123456789ABCDEF"[n % base];
+		n /= base;
+	} while(n);
+	return write(p);
+}
+size_t Print::print(long n, int base) {
+	if(base == 10 && n < 0)
+		return print('-') + print(-(unsigned long)n, 10);
+	return print((unsigned long)n, base);
+}
+size_t Print::print(double n, int digits) {
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%.*f", digits, n);
+	return write(buf);
+}
+size_t Stream::readBytes(uint8_t *buf, size_t len) {
+	size_t n = 0;
+	uint32_t start = millis();
+	while(n < len && millis() - start < _timeout) {
+		int c = read();
+		if(c >= 0)
+			buf[n++] = c;
+	}
+	return n;
+}
+void HardwareSerial::hostInput(const uint8_t *buf, size_t len) {
+	if(_inPos == _inLen)
+		_inPos = _inLen = 0;
+	while(len-- && _inLen < sizeof(_in))
+		_in[_inLen++] = *buf++;
+}
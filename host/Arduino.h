@@ -0,0 +1,147 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/Arduino.h                                                        ***
+***	 Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#ifndef _HOST_ARDUINO_H
+#define _HOST_ARDUINO_H
+
+//Just enough of the Arduino core to build the library on a Linux PC, for the
+//benchmark and tests in this directory. Nothing here is used on an Arduino.
+//
+//Time is simulated. It only moves when something moves it: each micros() or millis()
+//call costs HOST_CALL_NANOS, delay() and delayMicroseconds() add what they're asked to,
+//and Wire (see Wire.h) adds the bus time of every bit it clocks. So a run gives the
+//same answers every time, and a busy-wait on micros() still gets there.
+//
+//Pins are levels in an array. A simulated device drives one with hostSetPin(), which
+//runs an ISR hooked up by attachInterrupt() there and then - or, if interrupts are
+//off, as soon as interrupts() turns them back on.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW  0
+#define INPUT        0
+#define OUTPUT       1
+#define INPUT_PULLUP 2
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+#define HOST_PINS 32
+#define NOT_AN_INTERRUPT -1
+
+//Flash is just memory here
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+#define pgm_read_byte(p)  (*(const uint8_t *)(p))
+#define pgm_read_word(p)  (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define pgm_read_ptr(p)   (*(const void * const *)(p))
+#define memcpy_P  memcpy
+#define strlen_P  strlen
+#define strcpy_P  strcpy
+#define strncpy_P strncpy
+#define strcmp_P  strcmp
+
+#define HOST_CALL_NANOS 1000	//what a micros() or millis() call costs
+
+//Simulated time
+class HostClockListener {
+	public:
+	virtual ~HostClockListener() {}
+	virtual void hostTime(uint64_t nanos) = 0;	//time moved on to nanos
+};
+uint64_t hostNanos(void);					//simulated time since start
+void hostAdvanceNanos(uint64_t nanos);		//moves it on, tells the listeners
+void hostAdvance(uint32_t us);
+void hostAddListener(HostClockListener *listener);
+void hostRemoveListener(HostClockListener *listener);
+
+unsigned long micros(void);
+unsigned long millis(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+//Pins and interrupts
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t level);
+inline int digitalPinToInterrupt(uint8_t pin) { return pin < HOST_PINS ? pin : NOT_AN_INTERRUPT; }
+void attachInterrupt(int interrupt, void (*isr)(void), int mode);
+void detachInterrupt(int interrupt);
+void noInterrupts(void);
+void interrupts(void);
+void hostSetPin(uint8_t pin, uint8_t level);	//a device driving pin, fires its ISR on a matching edge
+bool hostInterruptsEnabled(void);
+
+//Print, Stream and Serial, as in the Arduino core
+class Print {
+	public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t c) = 0;
+	virtual size_t write(const uint8_t *buf, size_t size);
+	size_t write(const char *str) { return str ? write((const uint8_t *)str, strlen(str)) : 0; }
+	size_t write(const char *buf, size_t size) { return write((const uint8_t *)buf, size); }
+	size_t print(const __FlashStringHelper *s) { return write(reinterpret_cast<const char *>(s)); }
+	size_t print(const char *s) { return write(s); }
+	size_t print(char c) { return write((uint8_t)c); }
+	size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+	size_t print(int n, int base = DEC) { return print((long)n, base); }
+	size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+	size_t print(long n, int base = DEC);
+	size_t print(unsigned long n, int base = DEC);
+	size_t print(double n, int digits = 2);
+	size_t println(void) { return write("\r\n"); }
+	template<class T> size_t println(T value) { size_t n = print(value); return n + println(); }
+	template<class T> size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+	virtual void flush(void) {}
+};
+
+class Stream : public Print {
+	public:
+	virtual int available(void) = 0;
+	virtual int read(void) = 0;
+	virtual int peek(void) = 0;
+	void setTimeout(unsigned long ms) { _timeout = ms; }
+	size_t readBytes(uint8_t *buf, size_t len);
+	size_t readBytes(char *buf, size_t len) { return readBytes((uint8_t *)buf, len); }
+	protected:
+	unsigned long _timeout = 1000;
+};
+
+//Serial: writes go to stdout, reads come from what hostInput() queued
+class HardwareSerial : public Stream {
+	public:
+	void begin(unsigned long baud) { (void)baud; }
+	void end(void) {}
+	operator bool() { return true; }
+	size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+	using Print::write;
+	int available(void) { return _inLen - _inPos; }
+	int read(void) { return _inPos < _inLen ? _in[_inPos++] : -1; }
+	int peek(void) { return _inPos < _inLen ? _in[_inPos] : -1; }
+	void hostInput(const uint8_t *buf, size_t len);	//queues bytes for read()
+	private:
+	uint8_t _in[256];
+	size_t _inLen = 0;
+	size_t _inPos = 0;
+};
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,309 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/DS3231_sim.cpp                                                   ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#include "DS3231_sim.h"
+
+bool twelveHourMode = false;	//the sketch's, see DS3231_tisc.h
+
+//Bits of each register that exist, the rest read 0
+static const uint8_t _simMask[DS3231_REGISTER_COUNT] = {
+	0x7f, 0x7f, 0x7f, 0x07, 0x3f, 0x9f, 0xff,	//time & date
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,	//alarms
+	0xff, 0x8f, 0xff, 0xff, 0xc0				//control, status, aging, temperature
+};
+
+static uint8_t _simBcd(uint8_t num) { return ((num / 10) << 4) | (num % 10); }
+static uint8_t _simDec(uint8_t bcd) { return (bcd >> 4) * 10 + (bcd & 0x0f); }
+
+//Hours register (time or alarm) to 0-23, whichever mode it's in
+static uint8_t _simHour24(uint8_t data) {
+	uint8_t hour;
+	if(!(data & 0x40))
+		return _simDec(data & 0x3f);
+	hour = _simDec(data & 0x1f) % 12;
+	return (data & 0x20) ? hour + 12 : hour;
+}
+
+/*****************************************************************
+* DS3231Sim(wire, address)
+* Powers up as the datasheet says: 00:00:00 Monday (day 1)
+* 01/01/00, INTCN and RS2/RS1 set, OSF and EN32kHz set - and
+* attaches itself to wire
+*****************************************************************/
+DS3231Sim::DS3231Sim(TwoWire &wire, uint8_t address) : _wire(wire), _address(address) {
+	memset(_regs, 0, sizeof(_regs));
+	_regs[DS3231_DAY] = 1;
+	_regs[DS3231_DATE] = 1;
+	_regs[DS3231_CEN_MONTH] = 1;
+	_regs[DS3231_CONTROL] = 0x1c;
+	_regs[DS3231_STATUS] = 0x88;
+	_pointer = 0;
+	_pointerNext = false;
+	_present = true;
+	_riseAt = 0;
+	_convDoneAt = 0;
+	_driftPpm = 0;
+	_agingApplied = 0;
+	_temperature = 25 * 4;
+	_pin = -1;
+	_ticks = 0;
+	_conversions = 0;
+	_restartSecond();
+	_snapshot();
+	_wire.attach(_address, this);
+	hostAddListener(this);
+}
+DS3231Sim::~DS3231Sim() {
+	hostRemoveListener(this);
+	_wire.detach(_address);
+}
+bool DS3231Sim::i2cStart(bool read) {
+	if(!_present)
+		return false;
+	hostTime(hostNanos());
+	_snapshot();		//user buffers are synced on every START
+	_pointerNext = !read;
+	return true;
+}
+bool DS3231Sim::i2cWrite(uint8_t data) {
+	hostTime(hostNanos());
+	if(_pointerNext) {
+		_pointer = data % DS3231_REGISTER_COUNT;
+		_pointerNext = false;
+		return true;
+	}
+	switch(_pointer) {
+		case DS3231_SECONDS:
+			_regs[DS3231_SECONDS] = data & _simMask[DS3231_SECONDS];
+			_restartSecond();		//countdown chain reset
+			break;
+		case DS3231_CONTROL:
+			_regs[DS3231_CONTROL] = data;
+			if((data & 0x20) && !(_regs[DS3231_STATUS] & 0x04))
+				_startConversion();
+			break;
+		case DS3231_STATUS:
+			//OSF, A2F and A1F can only be cleared, EN32kHz is read/write, BSY is read only
+			_regs[DS3231_STATUS] = (_regs[DS3231_STATUS] & (data | 0x7c) & ~0x08) | (data & 0x08);
+			break;
+		case DS3231_TEMP_MSB:
+		case DS3231_TEMP_LSB:
+			break;
+		default:
+			_regs[_pointer] = data & _simMask[_pointer];
+	}
+	_pointer = (_pointer + 1) % DS3231_REGISTER_COUNT;
+	_updatePin();
+	return true;
+}
+uint8_t DS3231Sim::i2cRead(void) {
+	uint8_t data;
+	hostTime(hostNanos());
+	data = _pointer <= DS3231_DEC_YEAR ? _snap[_pointer] : _regs[_pointer];
+	_pointer = (_pointer + 1) % DS3231_REGISTER_COUNT;
+	if(_pointer == 0)
+		_snapshot();		//...and when the pointer wraps to 0
+	return data;
+}
+/*****************************************************************
+* hostTime(nanos)
+* Catches up with simulated time: ticks, square wave edges and
+* conversions, in the order they happened
+*****************************************************************/
+void DS3231Sim::hostTime(uint64_t nanos) {
+	double now = (double)nanos;
+	for(;;) {
+		if(_convDoneAt && _convDoneAt <= _nextTick && (!_riseAt || _convDoneAt <= _riseAt) && _convDoneAt <= now) {
+			_conversionDone();
+		}
+		else if(_riseAt && _riseAt <= _nextTick && _riseAt <= now) {
+			_riseAt = 0;
+			_updatePin();
+		}
+		else if(_nextTick <= now) {
+			_tick();
+		}
+		else {
+			break;
+		}
+	}
+}
+uint8_t DS3231Sim::reg(uint8_t n) {
+	hostTime(hostNanos());
+	return _regs[n % DS3231_REGISTER_COUNT];
+}
+void DS3231Sim::poke(uint8_t n, uint8_t value) {
+	_regs[n % DS3231_REGISTER_COUNT] = value;
+	_updatePin();
+}
+void DS3231Sim::setDateTime(uint16_t year, uint8_t month, uint8_t date, uint8_t hour, uint8_t minute, uint8_t second) {
+	static const uint8_t offsets[12] = {0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4};
+	uint16_t y = month < 3 ? year - 1 : year;
+	_regs[DS3231_SECONDS] = _simBcd(second);
+	_regs[DS3231_MINUTES] = _simBcd(minute);
+	_regs[DS3231_HOURS] = _simBcd(hour);
+	_regs[DS3231_DAY] = (y + y / 4 - y / 100 + y / 400 + offsets[month - 1] + date) % 7 + 1;
+	_regs[DS3231_DATE] = _simBcd(date);
+	_regs[DS3231_CEN_MONTH] = _simBcd(month) | (year >= 2100 ? 0x80 : 0);
+	_regs[DS3231_DEC_YEAR] = _simBcd(year % 100);
+	_restartSecond();
+}
+void DS3231Sim::setTemperature(int16_t quarters) {
+	_temperature = quarters;
+}
+void DS3231Sim::setDriftPpm(double ppm) {
+	_driftPpm = ppm;
+}
+double DS3231Sim::ppm(void) {
+	return _driftPpm - DS3231_SIM_PPM_PER_AGING * _agingApplied;
+}
+void DS3231Sim::connectInterruptPin(uint8_t pin) {
+	_pin = pin;
+	_updatePin();
+}
+void DS3231Sim::setPresent(bool present) {
+	_present = present;
+}
+/*****************************************************************
+* _tick()
+* Seconds tick over at _nextTick. BCD all the way, as the chip
+* counts, then the alarms are matched against the new time
+*****************************************************************/
+void DS3231Sim::_tick(void) {
+	uint8_t second = _simDec(_regs[DS3231_SECONDS]) + 1;
+	uint8_t minute;
+	uint8_t hours = _regs[DS3231_HOURS];
+	uint8_t hour;
+	double at = _nextTick;
+	_nextTick += _period();
+	_riseAt = at + _period() / 2;
+	_ticks++;
+	if(second >= 60) {
+		second = 0;
+		minute = _simDec(_regs[DS3231_MINUTES]) + 1;
+		if(minute >= 60) {
+			minute = 0;
+			if(hours & 0x40) {
+				//12 hour: 11 -> 12 flips AM/PM, and it's a new day at 12 AM
+				hour = _simDec(hours & 0x1f);
+				if(hour == 11) {
+					hours = (hours ^ 0x20) & 0x60;
+					hours |= _simBcd(12);
+					if(!(hours & 0x20))
+						_dayOn();
+				}
+				else {
+					hours = (hours & 0x60) | _simBcd(hour == 12 ? 1 : hour + 1);
+				}
+			}
+			else {
+				hour = _simDec(hours & 0x3f) + 1;
+				if(hour >= 24) {
+					hour = 0;
+					_dayOn();
+				}
+				hours = _simBcd(hour);
+			}
+			_regs[DS3231_HOURS] = hours;
+		}
+		_regs[DS3231_MINUTES] = _simBcd(minute);
+	}
+	_regs[DS3231_SECONDS] = _simBcd(second);
+	if(_alarmMatch(DS3231_ALARM1_SECONDS, 4))
+		_regs[DS3231_STATUS] |= 0x01;
+	if(second == 0 && _alarmMatch(DS3231_ALARM2_MINUTES, 3))
+		_regs[DS3231_STATUS] |= 0x02;
+	if(_ticks % DS3231_SIM_AUTO_SECONDS == 0 && !(_regs[DS3231_STATUS] & 0x04))
+		_startConversion();
+	_updatePin();
+}
+void DS3231Sim::_dayOn(void) {
+	static const uint8_t days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+	uint8_t date = _simDec(_regs[DS3231_DATE]) + 1;
+	uint8_t month = _simDec(_regs[DS3231_CEN_MONTH] & 0x1f);
+	uint8_t year = _simDec(_regs[DS3231_DEC_YEAR]);
+	uint8_t century = _regs[DS3231_CEN_MONTH] & 0x80;
+	uint8_t length = days[(month - 1) % 12] + (month == 2 && year % 4 == 0);
+	_regs[DS3231_DAY] = _regs[DS3231_DAY] % 7 + 1;
+	if(date > length) {
+		date = 1;
+		if(++month > 12) {
+			month = 1;
+			if(++year > 99) {
+				year = 0;
+				century ^= 0x80;
+			}
+		}
+	}
+	_regs[DS3231_DATE] = _simBcd(date);
+	_regs[DS3231_CEN_MONTH] = century | _simBcd(month);
+	_regs[DS3231_DEC_YEAR] = _simBcd(year);
+}
+/*****************************************************************
+* _alarmMatch(first, fields)
+* @first - the alarm's first register
+* @fields - 4 for alarm 1 (seconds...day/date), 3 for alarm 2
+* @return - every field whose mask bit is clear matches the time
+*****************************************************************/
+bool DS3231Sim::_alarmMatch(uint8_t first, uint8_t fields) {
+	uint8_t field = 4 - fields;		//0=seconds, 1=minutes, 2=hours, 3=day/date
+	uint8_t data;
+	bool match;
+	for(; field < 4; field++) {
+		data = _regs[first + field - (4 - fields)];
+		if(data & 0x80)
+			continue;		//masked
+		switch(field) {
+			case 0: match = _simDec(data & 0x7f) == _simDec(_regs[DS3231_SECONDS]); break;
+			case 1: match = _simDec(data & 0x7f) == _simDec(_regs[DS3231_MINUTES]); break;
+			case 2: match = _simHour24(data) == _simHour24(_regs[DS3231_HOURS]); break;
+			default:
+				if(data & 0x40)
+					match = (data & 0x0f) == _regs[DS3231_DAY];
+				else
+					match = _simDec(data & 0x3f) == _simDec(_regs[DS3231_DATE]);
+		}
+		if(!match)
+			return false;
+	}
+	return true;
+}
+void DS3231Sim::_restartSecond(void) {
+	_nextTick = (double)hostNanos() + _period();
+	_riseAt = 0;
+	_updatePin();
+}
+void DS3231Sim::_startConversion(void) {
+	_regs[DS3231_STATUS] |= 0x04;
+	_convDoneAt = (double)hostNanos() + DS3231_SIM_CONVERSION_MICROS * 1000.0;
+}
+void DS3231Sim::_conversionDone(void) {
+	_convDoneAt = 0;
+	_conversions++;
+	_regs[DS3231_STATUS] &= ~0x04;
+	_regs[DS3231_CONTROL] &= ~0x20;
+	_regs[DS3231_TEMP_MSB] = (uint8_t)(_temperature >> 2);
+	_regs[DS3231_TEMP_LSB] = (_temperature & 0x03) << 6;
+	_agingApplied = (int8_t)_regs[DS3231_AGING_OFFSET];
+}
+void DS3231Sim::_updatePin(void) {
+	uint8_t control = _regs[DS3231_CONTROL];
+	uint8_t level;
+	if(_pin < 0)
+		return;
+	if(control & 0x04)
+		level = (_regs[DS3231_STATUS] & control & 0x03) ? LOW : HIGH;
+	else if(control & 0x18)
+		level = HIGH;		//1.024/4.096/8.192 kHz, not modelled
+	else
+		level = _riseAt ? LOW : HIGH;
+	hostSetPin(_pin, level);
+}
+void DS3231Sim::_snapshot(void) {
+	memcpy(_snap, _regs, sizeof(_snap));
+}
+double DS3231Sim::_period(void) {
+	return 1e9 / (1 + ppm() * 1e-6);
+}
@@ -0,0 +1,89 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/DS3231_sim.h                                                     ***
+***	 Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#ifndef _DS3231_SIM_H
+#define _DS3231_SIM_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "DS3231_tisc.h"
+
+//A DS3231 on the host's simulated Wire bus, for the benchmark and tests. It does what
+//the datasheet says the chip does, as far as the library can tell:
+//  - registers 0x00-0x12, with a register pointer that auto-increments and wraps from
+//    0x12 to 0x00. Bits that don't exist read 0, the temperature registers and BSY
+//    can't be written, OSF/A2F/A1F can only be cleared
+//  - the time & date read on a START come from a copy taken then, so a burst read
+//    never sees the seconds roll over part way through
+//  - the clock ticks once a simulated second, in BCD, 12 or 24 hour as the hours
+//    register says, with month lengths, leap years (every 4th, 2100 included, as the
+//    chip does) and the century bit. Writing the seconds register restarts the second
+//  - after each tick both alarms are matched with their mask bits and DY/!DT, setting
+//    A1F/A2F. Alarm 2 only matches at 00 seconds
+//  - !INT/SQW: with INTCN set it goes low while an enabled alarm's flag is set, with
+//    INTCN clear it's the 1 Hz square wave, falling as the seconds tick over. Wire it to
+//    a pin with connectInterruptPin() and attachInterrupt() works as on an Arduino.
+//    The other square wave rates aren't modelled, the pin just stays high
+//  - setting CONV starts a temperature conversion, BSY is set until it's done
+//    (DS3231_SIM_CONVERSION_MICROS) and there's one every 64 seconds anyway. The
+//    temperature and aging offset are picked up when a conversion finishes
+//  - the crystal can run fast or slow (setDriftPpm()), and the aging offset pulls it
+//    0.1 ppm per step, positive slower, as it does at room temperature
+
+#define DS3231_SIM_CONVERSION_MICROS 125000UL	//typical tCONV
+#define DS3231_SIM_AUTO_SECONDS 64				//conversion interval with nobody asking
+#define DS3231_SIM_PPM_PER_AGING 0.1
+
+class DS3231Sim : public I2CDevice, public HostClockListener {
+	public:
+	DS3231Sim(TwoWire &wire = Wire, uint8_t address = DS3231_ADDR);
+	~DS3231Sim();
+	//I2CDevice
+	bool i2cStart(bool read);
+	bool i2cWrite(uint8_t data);
+	uint8_t i2cRead(void);
+	//HostClockListener
+	void hostTime(uint64_t nanos);
+	//Host side, none of these use the bus
+	uint8_t reg(uint8_t n);				//register n as the chip has it now
+	void poke(uint8_t n, uint8_t value);	//sets register n as-is, no side effects but the pin
+	void setDateTime(uint16_t year, uint8_t month, uint8_t date, uint8_t hour, uint8_t minute, uint8_t second); //24 hour, restarts the second
+	void setTemperature(int16_t quarters);	//what conversions measure from now on, quarter degrees C
+	void setDriftPpm(double ppm);		//crystal error with aging offset 0, + is fast
+	double ppm(void);					//error now, aging offset included
+	void connectInterruptPin(uint8_t pin);	//!INT/SQW drives pin
+	void setPresent(bool present);		//false: NAKs everything, as if unplugged
+	uint32_t ticks(void) { return _ticks; }
+	uint32_t conversions(void) { return _conversions; }
+	uint64_t nextTickNanos(void) { return (uint64_t)_nextTick; }	//host time the seconds tick over next
+	private:
+	void _tick(void);					//one second on, then alarms
+	void _dayOn(void);
+	bool _alarmMatch(uint8_t first, uint8_t fields);
+	void _restartSecond(void);
+	void _startConversion(void);
+	void _conversionDone(void);
+	void _updatePin(void);
+	void _snapshot(void);
+	double _period(void);				//ns per second, drift included
+	TwoWire &_wire;
+	uint8_t _address;
+	uint8_t _regs[DS3231_REGISTER_COUNT];
+	uint8_t _snap[7];					//time & date as of the last START
+	uint8_t _pointer;
+	bool _pointerNext;					//next byte written is the register pointer
+	bool _present;
+	double _nextTick;					//host ns of the next seconds tick
+	double _riseAt;						//host ns the 1 Hz output goes high again, 0 = it is
+	double _convDoneAt;					//host ns the conversion finishes, 0 = none running
+	double _driftPpm;
+	int8_t _agingApplied;				//aging offset as of the last conversion
+	int16_t _temperature;
+	int _pin;							//-1 = not connected
+	uint32_t _ticks;
+	uint32_t _conversions;
+};
+
+#endif
@@ -0,0 +1,95 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/TCA9548A_sim.cpp                                                 ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#include "TCA9548A_sim.h"
+
+TCA9548ASim::TCA9548ASim(TwoWire &wire, uint8_t address) : _wire(wire), _address(address) {
+	uint8_t a;
+	_talkingCount = 0;
+	_control = 0;			//all channels closed at power up
+	_written = 0;
+	_writing = false;
+	_present = true;
+	_writes = 0;
+	_collisions = 0;
+	for(a = 0; a < WIRE_ADDRESSES; a++) {
+		_ports[a].mux = this;
+		_ports[a].address = a;
+		if(a != _address && !_wire.attached(a))
+			_wire.attach(a, &_ports[a]);
+	}
+	_wire.attach(_address, this);
+}
+TCA9548ASim::~TCA9548ASim() {
+	uint8_t a;
+	for(a = 0; a < WIRE_ADDRESSES; a++)
+		if(_wire.attached(a) == &_ports[a])
+			_wire.detach(a);
+	_wire.detach(_address);
+}
+bool TCA9548ASim::i2cStart(bool read) {
+	_writing = !read;
+	_written = _control;
+	return _present;
+}
+bool TCA9548ASim::i2cWrite(uint8_t data) {
+	_written = data;		//more than one byte, the last one counts
+	return true;
+}
+uint8_t TCA9548ASim::i2cRead(void) {
+	return _control;
+}
+/*****************************************************************
+* i2cStop()
+* A write's channel selection takes effect now
+*****************************************************************/
+void TCA9548ASim::i2cStop(void) {
+	if(!_writing)
+		return;
+	_writing = false;
+	_control = _written;
+	_writes++;
+}
+void TCA9548ASim::setPresent(bool present) {
+	_present = present;
+}
+/*****************************************************************
+* Port::i2cStart(read)
+* START for address: every device there on an open channel
+* gets it, ACK if any of them ACKs
+*****************************************************************/
+bool TCA9548ASim::Port::i2cStart(bool read) {
+	I2CDevice *device;
+	uint8_t c;
+	mux->_talkingCount = 0;
+	for(c = 0; c < TCA9548A_SIM_CHANNELS; c++) {
+		device = mux->_channels[c].attached(address);
+		if((mux->_control >> c & 1) && device && device->i2cStart(read))
+			mux->_talking[mux->_talkingCount++] = device;
+	}
+	if(mux->_talkingCount > 1)
+		mux->_collisions++;
+	return mux->_talkingCount != 0;
+}
+bool TCA9548ASim::Port::i2cWrite(uint8_t data) {
+	bool ack = false;
+	uint8_t i;
+	for(i = 0; i < mux->_talkingCount; i++)
+		ack |= mux->_talking[i]->i2cWrite(data);
+	return ack;
+}
+uint8_t TCA9548ASim::Port::i2cRead(void) {
+	uint8_t data = 0xff;	//nobody driving it, the pull-ups
+	uint8_t i;
+	for(i = 0; i < mux->_talkingCount; i++)
+		data &= mux->_talking[i]->i2cRead();
+	return data;
+}
+void TCA9548ASim::Port::i2cStop(void) {
+	uint8_t i;
+	for(i = 0; i < mux->_talkingCount; i++)
+		mux->_talking[i]->i2cStop();
+	mux->_talkingCount = 0;
+}
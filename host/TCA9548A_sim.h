@@ -0,0 +1,67 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/TCA9548A_sim.h                                                   ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#ifndef _TCA9548A_SIM_H
+#define _TCA9548A_SIM_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+//A TCA9548A 8 channel I2C mux on the host's simulated Wire bus, for the multi-clock
+//test. Each channel is a TwoWire of its own (channel()) that simulated chips attach
+//to as usual - they're never begin()ed or driven, the mux hands them the upstream
+//bus's START, bytes and STOP when their channel is open:
+//  - the control register is one byte, bit n opens channel n. A write changes it on
+//    the STOP, as the datasheet says, and a read gives it back
+//  - it answers for every address on the upstream bus nothing else is attached to when
+//    it's made, passing transactions to that address on each open channel. Devices at
+//    the same address on two open channels both answer - the bytes they send are ANDed,
+//    as on the wire - and that's counted as a collision
+//  - with no channel open, or nothing at the address on the open ones, it's a NAK
+
+#define TCA9548A_SIM_ADDR 0x70			//A0-A2 low
+#define TCA9548A_SIM_CHANNELS 8
+
+class TCA9548ASim : public I2CDevice {
+	public:
+	TCA9548ASim(TwoWire &wire = Wire, uint8_t address = TCA9548A_SIM_ADDR);
+	~TCA9548ASim();
+	//I2CDevice, the control register
+	bool i2cStart(bool read);
+	bool i2cWrite(uint8_t data);
+	uint8_t i2cRead(void);
+	void i2cStop(void);
+	//Host side, none of these use the bus
+	TwoWire &channel(uint8_t n) { return _channels[n % TCA9548A_SIM_CHANNELS]; }
+	uint8_t control(void) { return _control; }		//channels open now
+	void setPresent(bool present);			//false: NAKs its own address, as if unplugged
+	uint32_t writes(void) { return _writes; }		//control register writes since it was made
+	uint32_t collisions(void) { return _collisions; }	//transactions answered on two channels or more
+	private:
+	//Stands in upstream for whatever is at one address on the channels
+	class Port : public I2CDevice {
+		public:
+		TCA9548ASim *mux;
+		uint8_t address;
+		bool i2cStart(bool read);
+		bool i2cWrite(uint8_t data);
+		uint8_t i2cRead(void);
+		void i2cStop(void);
+	};
+	TwoWire &_wire;
+	uint8_t _address;
+	TwoWire _channels[TCA9548A_SIM_CHANNELS];
+	Port _ports[WIRE_ADDRESSES];
+	I2CDevice *_talking[TCA9548A_SIM_CHANNELS];	//devices that ACKed the current START
+	uint8_t _talkingCount;
+	uint8_t _control;
+	uint8_t _written;						//control byte of the current write, till the STOP
+	bool _writing;
+	bool _present;
+	uint32_t _writes;
+	uint32_t _collisions;
+};
+
+#endif
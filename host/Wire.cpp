@@ -0,0 +1,188 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/Wire.cpp                                                         ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#include "Wire.h"
+
+TwoWire Wire;
+
+TwoWire::TwoWire(void) {
+	memset(_devices, 0, sizeof(_devices));
+	resetTraffic();
+	_clockHz = 100000;
+	_clockRemainder = 0;
+	_enabled = false;
+	_timeoutFlag = false;
+	_txLen = 0;
+	_txOverflow = false;
+	_rxLen = 0;
+	_rxPos = 0;
+	_held = NULL;
+	_faultAfter = 0;
+	_faultCount = 0;
+	_faultResult = WIRE_OK;
+}
+void TwoWire::beginTransmission(int address) {
+	_txAddress = address;
+	_txLen = 0;
+	_txOverflow = false;
+}
+size_t TwoWire::write(uint8_t data) {
+	if(_txLen >= BUFFER_LENGTH) {
+		_txOverflow = true;
+		return 0;
+	}
+	_tx[_txLen++] = data;
+	return 1;
+}
+size_t TwoWire::write(const uint8_t *buf, size_t len) {
+	size_t n = 0;
+	while(len--)
+		n += write(*buf++);
+	return n;
+}
+/*****************************************************************
+* endTransmission(sendStop)
+* START, address+W, the buffered bytes, STOP - each handed to the
+* device as it's clocked
+* @return - 0 or 1-5, as Arduino's Wire
+*****************************************************************/
+uint8_t TwoWire::endTransmission(uint8_t sendStop) {
+	I2CDevice *device = _devices[_txAddress & 0x7f];
+	uint8_t fault;
+	uint8_t i;
+	if(!_enabled)
+		return WIRE_OTHER;
+	if(_txOverflow)
+		return WIRE_TOO_LONG;
+	fault = _fault();
+	if(_held && _held != device)
+		_held->i2cStop();
+	_held = NULL;
+	_traffic.transactions++;
+	_traffic.starts++;
+	_traffic.bytesWritten++;
+	_clock(1 + 9);
+	if(fault == WIRE_TIMEOUT || fault == WIRE_OTHER) {
+		_timeoutFlag = fault == WIRE_TIMEOUT;
+		return fault;		//no STOP, Wire gave up on the bus
+	}
+	if(fault == WIRE_NACK_ADDR || !device || !device->i2cStart(false)) {
+		_traffic.nacks++;
+		_stop(NULL);
+		return WIRE_NACK_ADDR;
+	}
+	for(i = 0; i < _txLen; i++) {
+		_traffic.bytesWritten++;
+		_clock(9);
+		if((fault == WIRE_NACK_DATA && i == 0) || (fault == WIRE_SHORT && i == _txLen - 1) || !device->i2cWrite(_tx[i])) {
+			_traffic.nacks++;
+			_stop(device);
+			return WIRE_NACK_DATA;
+		}
+	}
+	if(sendStop)
+		_stop(device);
+	else
+		_held = device;
+	return WIRE_OK;
+}
+/*****************************************************************
+* requestFrom(address, quantity, sendStop)
+* START, address+R, quantity bytes from the device, STOP
+* @return - bytes received, 0 if nothing answered
+*****************************************************************/
+uint8_t TwoWire::requestFrom(int address, int quantity, int sendStop) {
+	I2CDevice *device = _devices[address & 0x7f];
+	uint8_t fault;
+	uint8_t n;
+	_rxLen = 0;
+	_rxPos = 0;
+	if(!_enabled)
+		return 0;
+	if(quantity > BUFFER_LENGTH)
+		quantity = BUFFER_LENGTH;
+	fault = _fault();
+	if(_held && _held != device)
+		_held->i2cStop();
+	_held = NULL;
+	_traffic.transactions++;
+	_traffic.starts++;
+	_traffic.bytesRead++;
+	_clock(1 + 9);
+	if(fault == WIRE_TIMEOUT || fault == WIRE_OTHER) {
+		_timeoutFlag = fault == WIRE_TIMEOUT;
+		return 0;
+	}
+	if(fault == WIRE_NACK_ADDR || fault == WIRE_NACK_DATA || !device || !device->i2cStart(true)) {
+		_traffic.nacks++;
+		_stop(NULL);
+		return 0;
+	}
+	n = fault == WIRE_SHORT ? quantity / 2 : quantity;
+	while(_rxLen < n) {
+		_traffic.bytesRead++;
+		_clock(9);
+		_rx[_rxLen++] = device->i2cRead();
+	}
+	if(sendStop)
+		_stop(device);
+	else
+		_held = device;
+	return _rxLen;
+}
+void TwoWire::setWireTimeout(uint32_t timeout, bool resetWithTimeout) {
+	(void)timeout;
+	(void)resetWithTimeout;
+}
+void TwoWire::attach(uint8_t address, I2CDevice *device) {
+	_devices[address & 0x7f] = device;
+}
+void TwoWire::detach(uint8_t address) {
+	if(_held == _devices[address & 0x7f])
+		_held = NULL;
+	_devices[address & 0x7f] = NULL;
+}
+/*****************************************************************
+* failNext(count, result, after)
+* @count - how many transactions fail, 0 to stop failing them
+* @result - WIRE_NACK_ADDR, _NACK_DATA, _OTHER, _TIMEOUT or _SHORT
+* @after - how many work first, e.g. 1 to fail the read after a
+*          register pointer write
+*****************************************************************/
+void TwoWire::failNext(uint16_t count, uint8_t result, uint16_t after) {
+	_faultCount = count;
+	_faultResult = result;
+	_faultAfter = after;
+}
+void TwoWire::resetTraffic(void) {
+	memset(&_traffic, 0, sizeof(_traffic));
+}
+uint32_t TwoWire::trafficMicros(WireTraffic t, uint32_t hz) {
+	uint64_t clocks = 9ULL * (t.bytesWritten + t.bytesRead) + t.starts + t.stops;
+	return clocks * 1000000 / hz;
+}
+void TwoWire::_clock(uint32_t clocks) {
+	uint64_t total = (uint64_t)clocks * 1000000000ULL + _clockRemainder;
+	uint64_t nanos = total / _clockHz;
+	_clockRemainder = total % _clockHz;
+	_traffic.busNanos += nanos;
+	hostAdvanceNanos(nanos);
+}
+uint8_t TwoWire::_fault(void) {
+	if(!_faultCount)
+		return WIRE_OK;
+	if(_faultAfter) {
+		_faultAfter--;
+		return WIRE_OK;
+	}
+	_faultCount--;
+	return _faultResult;
+}
+void TwoWire::_stop(I2CDevice *device) {
+	_traffic.stops++;
+	_clock(1);
+	if(device)
+		device->i2cStop();
+}
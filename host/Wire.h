@@ -0,0 +1,106 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/Wire.h                                                           ***
+***	 Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#ifndef _HOST_WIRE_H
+#define _HOST_WIRE_H
+
+#include "Arduino.h"
+
+//The Arduino Wire library's TwoWire, with simulated devices on the other end of the bus.
+//A device (an I2CDevice - see DS3231_sim.h) is attached at an address and is handed the
+//transaction a byte at a time, as the real bus would: the START, each byte, the STOP.
+//
+//Every bit is clocked in simulated time at the rate setClock() set, 100 kHz to start
+//with, so micros() moves on as it would on an Arduino: one clock each for START and
+//STOP, 9 (8 data + ACK) per byte. WireTraffic counts what went over the bus, the
+//same way BusStats does, so the two can be checked against each other.
+//
+//failNext() makes transactions fail, for testing what the library does about it.
+
+#define BUFFER_LENGTH 32
+#define WIRE_HAS_TIMEOUT		//setWireTimeout() etc. are here, as in AVR Wire 1.8.3 and later
+#define WIRE_ADDRESSES 128
+
+//Wire.endTransmission() results
+#define WIRE_OK        0
+#define WIRE_TOO_LONG  1
+#define WIRE_NACK_ADDR 2
+#define WIRE_NACK_DATA 3
+#define WIRE_OTHER     4
+#define WIRE_TIMEOUT   5
+#define WIRE_SHORT     0x80	//failNext() only: a read gets half its bytes, a write NAKs its last byte
+
+class I2CDevice {
+	public:
+	virtual ~I2CDevice() {}
+	virtual bool i2cStart(bool read) = 0;		//START + our address, return false to NAK it
+	virtual bool i2cWrite(uint8_t data) = 0;	//a byte from the master, return false to NAK it
+	virtual uint8_t i2cRead(void) = 0;			//a byte for the master
+	virtual void i2cStop(void) {}				//STOP, or a START for someone else
+};
+
+class WireTraffic {
+	public:
+	uint32_t transactions;	//START...STOP sequences
+	uint32_t bytesWritten;	//bytes sent by the master, including address bytes
+	uint32_t bytesRead;		//bytes sent by devices, plus the address byte that asked for them
+	uint32_t starts;		//START conditions
+	uint32_t stops;			//STOP conditions
+	uint32_t nacks;			//transactions a device NAKed
+	uint64_t busNanos;		//time the bus was busy
+};
+
+class TwoWire : public Stream {
+	public:
+	TwoWire(void);
+	void begin(void) { _enabled = true; }
+	void end(void) { _enabled = false; }
+	void setClock(uint32_t hz) { _clockHz = hz; }
+	void beginTransmission(int address);
+	uint8_t endTransmission(uint8_t sendStop = true);
+	uint8_t requestFrom(int address, int quantity, int sendStop = true);
+	size_t write(uint8_t data);
+	size_t write(const uint8_t *buf, size_t len);
+	using Print::write;
+	int available(void) { return _rxLen - _rxPos; }
+	int read(void) { return _rxPos < _rxLen ? _rx[_rxPos++] : -1; }
+	int peek(void) { return _rxPos < _rxLen ? _rx[_rxPos] : -1; }
+	void setWireTimeout(uint32_t timeout = 25000, bool resetWithTimeout = false);
+	bool getWireTimeoutFlag(void) { return _timeoutFlag; }
+	void clearWireTimeoutFlag(void) { _timeoutFlag = false; }
+	//Host side
+	void attach(uint8_t address, I2CDevice *device);
+	void detach(uint8_t address);
+	I2CDevice *attached(uint8_t address) { return _devices[address & 0x7f]; }	//NULL if nothing is
+	void failNext(uint16_t count, uint8_t result = WIRE_NACK_ADDR, uint16_t after = 0);	//after good ones, count fail with result
+	WireTraffic traffic(void) { return _traffic; }
+	void resetTraffic(void);
+	uint32_t clockHz(void) { return _clockHz; }
+	static uint32_t trafficMicros(WireTraffic t, uint32_t hz);	//what t's counts would take at hz
+	private:
+	void _clock(uint32_t clocks);		//moves simulated time on
+	uint8_t _fault(void);				//this transaction's injected failure, WIRE_OK for none
+	void _stop(I2CDevice *device);
+	I2CDevice *_devices[WIRE_ADDRESSES];
+	WireTraffic _traffic;
+	uint32_t _clockHz;
+	uint32_t _clockRemainder;			//fractions of a ns carried between transactions
+	bool _enabled;
+	bool _timeoutFlag;
+	uint8_t _txAddress;
+	uint8_t _tx[BUFFER_LENGTH];
+	uint8_t _txLen;
+	bool _txOverflow;
+	uint8_t _rx[BUFFER_LENGTH];
+	uint8_t _rxLen;
+	uint8_t _rxPos;
+	I2CDevice *_held;					//device a repeated START is still talking to
+	uint16_t _faultAfter;
+	uint16_t _faultCount;
+	uint8_t _faultResult;
+};
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,237 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/bus_benchmark.cpp                                                ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+//Calls every public library function against the simulated DS3231 and prints what
+//each one put on the bus: transactions, bytes each way, START/STOPs and the bus time
+//at 100 kHz and 400 kHz. Runs once with the register cache off and once with it warm.
+//
+//The counts come from the Wire stand-in, which sees every bit. Each row is also
+//checked against the library's own BusStats, and the time the stand-in clocked
+//against busTimeMicros() - the exit status is the number of rows that disagree.
+//  ./bus_benchmark [csv]
+#include <Arduino.h>
+#include <Wire.h>
+#include "DS3231_sim.h"
+#include "DS3231_tisc.h"
+#include "DS3231_temp.h"
+#include "DS3231_schedule.h"
+#include "DS3231_multi.h"
+#include "DS3231_fixed.h"
+
+bool csv = false;
+int mismatches = 0;
+WireTraffic wireBefore;
+BusStats statsBefore;
+uint32_t callbacks;
+
+void benchStart(void) {
+	wireBefore = Wire.traffic();
+	statsBefore = getBusStats();
+}
+/*****************************************************************
+* benchEnd(name)
+* Prints the traffic since benchStart() and checks the library
+* counted the same
+*****************************************************************/
+void benchEnd(const char *name) {
+	WireTraffic w = Wire.traffic();
+	BusStats s = busStatsSince(statsBefore);
+	uint32_t measured;
+	const char *sep = csv ? "," : "\t";
+	bool match;
+	w.transactions -= wireBefore.transactions;
+	w.bytesWritten -= wireBefore.bytesWritten;
+	w.bytesRead -= wireBefore.bytesRead;
+	w.starts -= wireBefore.starts;
+	w.stops -= wireBefore.stops;
+	w.busNanos -= wireBefore.busNanos;
+	measured = (w.busNanos + 500) / 1000;
+	match = s.transactions == w.transactions && s.bytesWritten == w.bytesWritten
+		&& s.bytesRead == w.bytesRead && s.starts == w.starts && s.stops == w.stops
+		&& (measured > busTimeMicros(s, Wire.clockHz()) ? measured - busTimeMicros(s, Wire.clockHz())
+			: busTimeMicros(s, Wire.clockHz()) - measured) <= 1;
+	printf("%-28s%s%u%s%u%s%u%s%u%s%u%s%u%s%u%s\n", name, sep,
+		w.transactions, sep, w.bytesWritten, sep, w.bytesRead, sep, w.starts, sep, w.stops, sep,
+		TwoWire::trafficMicros(w, 100000), sep, TwoWire::trafficMicros(w, 400000),
+		match ? "" : (csv ? ",MISMATCH" : "\tMISMATCH library counted different traffic"));
+	if(!match)
+		mismatches++;
+}
+#define BENCH(name, call) do { benchStart(); call; benchEnd(name); } while(0)
+
+void dateTimeDone(DateTime dt) { (void)dt; callbacks++; }
+void writeDone(void) { callbacks++; }
+void alarmsDone(uint8_t alarms) { (void)alarms; callbacks++; }
+void scheduleDone(uint8_t id) { (void)id; callbacks++; }
+void journalHook(uint8_t event, uint8_t data) { (void)event; (void)data; }
+void alarmHook(void) {}
+//Runs the async queue dry
+void pump(void) {
+	while(serviceAsync())
+		;
+}
+
+int main(int argc, char **argv) {
+	DS3231Sim rtc;
+	DateTime now;
+	AlarmSetting a;
+	AlarmEvent events[4];
+	Ds3231Image image;
+	Ds3231Image other;
+	ScheduleEntry entry;
+	uint8_t regs[7];
+	uint8_t id;
+	uint16_t ms;
+	uint32_t epochs[4] = {0, 86400, 946684800UL, 4102444800UL};
+	DateTime converted[4];
+	uint8_t pass;
+	DS3231 chip;
+	typedef DS3231Fixed<HourMode::H24> Fixed24;
+	csv = argc > 1 && strcmp(argv[1], "csv") == 0;
+	Wire.begin();
+	rtc.setDateTime(2024, 2, 28, 23, 59, 30);
+	a.t.hour12 = a.t.hour24 = 6; a.t.minute = 30; a.t.second = 1; a.t.pm = false;
+	a.date = 1; a.weekday = 1;
+	entry.kind = SCHEDULE_DAILY;
+	entry.t.hour24 = 7; entry.t.minute = 0; entry.t.second = 0;
+	entry.weekdays = 0;
+	for(pass = 0; pass < 2; pass++) {
+		useRegisterCache(pass == 1);
+		if(pass == 1)
+			refreshRegisterCache();		//start warm, so the numbers show steady-state cost
+		printf(csv ? "# register cache %s\n" : "--- register cache %s ---\n", pass ? "ON" : "OFF");
+		printf(csv ? "call,txns,wrote,read,START,STOP,us@100k,us@400k\n"
+			: "call                        \ttxns\twrote\tread\tSTART\tSTOP\tus@100k\tus@400k\n");
+		//Time & date
+		BENCH("readDateTime", now = readDateTime());
+		BENCH("readDateTimeChecked", readDateTimeChecked(&now));
+		BENCH("readTime", readTime());
+		BENCH("readDate", readDate());
+		BENCH("setTime", setTime(now.t));
+		BENCH("setDate", setDate(now.d));
+		BENCH("setDateTime", setDateTime(now));
+		BENCH("currentDateTime", currentDateTime());
+		BENCH("readEpoch", readEpoch());
+		BENCH("readEpochMillis", readEpochMillis(&ms));
+		BENCH("setEpoch", setEpoch(readEpoch()));
+		BENCH("dateTimeToEpoch", dateTimeToEpoch(now));
+		BENCH("epochToDateTime", epochToDateTime(epochs[2]));
+		BENCH("epochToDateTime(batch)", epochToDateTime(epochs, converted, 4));
+		BENCH("advanceDateTime", advanceDateTime(now));
+		BENCH("daysInMonth", daysInMonth(2024, 2));
+		BENCH("weekdayOf", weekdayOf(2024, 2, 29));
+		//Alarms
+		a.alarm_mask = ALARM1_MATCH_HOURS;
+		BENCH("setAlarm(1)", setAlarm(a));
+		a.alarm_mask = ALARM2_MATCH_HOURS;
+		BENCH("setAlarm(2)", setAlarm(a));
+		BENCH("readAlarm(1)", readAlarm(1));
+		BENCH("readAlarm(2)", readAlarm(2));
+		BENCH("encodeAlarm", encodeAlarm(a, false, regs));
+		BENCH("decodeAlarm", decodeAlarm(regs, 2));
+		BENCH("turnAlarmOn", turnAlarmOn(3));
+		BENCH("turnAlarmOff", turnAlarmOff(2));
+		BENCH("getAlarmStatus", getAlarmStatus());
+		BENCH("toggleAlarms", toggleAlarms());
+		BENCH("serviceAlarms", serviceAlarms());
+		BENCH("alarmEventISR", alarmEventISR());
+		BENCH("alarmEventsPending", alarmEventsPending());
+		BENCH("serviceAlarms(events)", serviceAlarms(events, 4));
+		BENCH("getAlarmEventStats", getAlarmEventStats());
+		BENCH("setAlarm1Hook", setAlarm1Hook(alarmHook));
+		setAlarm1Hook(NULL);
+		BENCH("setJournalHook", setJournalHook(journalHook));
+		setJournalHook(NULL);
+		BENCH("initializeDS3231", initializeDS3231());
+		//Registers
+		BENCH("readRegister", readRegister(DS3231_CONTROL));
+		BENCH("writeRegister", writeRegister(DS3231_AGING_OFFSET, 0));
+		BENCH("readRegisters(7)", readRegisters(DS3231_SECONDS, regs, 7));
+		BENCH("writeRegisters(7)", writeRegisters(DS3231_SECONDS, regs, 7));
+		BENCH("readRegistersChecked(7)", readRegistersChecked(DS3231_SECONDS, regs, 7));
+		BENCH("writeRegistersChecked(7)", writeRegistersChecked(DS3231_SECONDS, regs, 7));
+		BENCH("readBcdRegister", readBcdRegister(DS3231_DATE));
+		BENCH("writeBcdRegister", writeBcdRegister(DS3231_ALARM2_MINUTES, 30));
+		BENCH("ds3231LastError", ds3231LastError());
+		BENCH("setBusTimeout", setBusTimeout(25000));
+		BENCH("setBusClock", setBusClock(Wire.clockHz()));
+		BENCH("getBusHealth", getBusHealth());
+		BENCH("resetBusHealth", resetBusHealth());
+		//Register cache
+		BENCH("useRegisterCache", useRegisterCache(pass == 1));
+		BENCH("invalidateRegisterCache", invalidateRegisterCache());
+		BENCH("refreshRegisterCache", refreshRegisterCache());
+		BENCH("getRegisterCacheStats", getRegisterCacheStats());
+		//Tick clock
+		BENCH("startTickClock", startTickClock(60));
+		BENCH("tickClockISR", tickClockISR());
+		BENCH("tickClockNow", tickClockNow());
+		BENCH("tickClockService", tickClockService());
+		BENCH("getTickClockStats", getTickClockStats());
+		BENCH("stopTickClock", stopTickClock());
+		//Async queue - the queueing call, then serviceAsync() until it's done
+		BENCH("readDateTimeAsync", readDateTimeAsync(dateTimeDone); pump());
+		BENCH("setDateTimeAsync", setDateTimeAsync(now, writeDone); pump());
+		a.alarm_mask = ALARM1_MATCH_HOURS;
+		BENCH("setAlarmAsync", setAlarmAsync(a, writeDone); pump());
+		BENCH("serviceAlarmsAsync", serviceAlarmsAsync(alarmsDone); pump());
+		BENCH("serviceAsync(empty)", serviceAsync());
+		BENCH("asyncDone", asyncDone(1));
+		BENCH("asyncLastDateTime", asyncLastDateTime());
+		BENCH("getAsyncStats", getAsyncStats());
+		//Register image
+		BENCH("captureImage", image = captureImage());
+		other = image;
+		other.regs[DS3231_AGING_OFFSET] ^= 1;
+		other.regs[DS3231_ALARM2_MINUTES] ^= 1;
+		BENCH("applyImage(2 changed)", applyImage(other, imageDiff(image, other)));
+		BENCH("applyImage(IMAGE_CONFIG)", applyImage(image, IMAGE_CONFIG));
+		BENCH("imageDiff", imageDiff(image, other));
+		BENCH("decodeImage", decodeImage(image));
+		//Bus stats
+		BENCH("getBusStats", getBusStats());
+		BENCH("busTimeMicros", busTimeMicros(getBusStats(), 400000));
+		//Temperature and aging (DS3231_temp.h)
+		BENCH("readTemperature", readTemperature());
+		BENCH("startTemperatureConversion", startTemperatureConversion());
+		BENCH("temperatureService", temperatureService());
+		delay(200);
+		BENCH("temperatureService(ready)", temperatureService());
+		BENCH("startTemperatureSampler", startTemperatureSampler(0));
+		BENCH("getTemperatureStats", getTemperatureStats());
+		BENCH("resetTemperatureStats", resetTemperatureStats());
+		BENCH("readAgingOffset", readAgingOffset());
+		BENCH("writeAgingOffset", writeAgingOffset(0));
+		BENCH("agingReference", agingReference(readEpoch(), 0));
+		BENCH("agingRestart", agingRestart());
+		BENCH("getAgingStats", getAgingStats());
+		//Scheduler (DS3231_schedule.h)
+		BENCH("scheduleBegin", scheduleBegin(scheduleDone));
+		BENCH("scheduleAdd", id = scheduleAdd(entry));
+		BENCH("scheduleCount", scheduleCount());
+		BENCH("scheduleNextDue", scheduleNextDue(&id, &now));
+		BENCH("scheduleGet", scheduleGet(id, &entry));
+		BENCH("scheduleCancel", scheduleCancel(id));
+		BENCH("scheduleEnd", scheduleEnd());
+		//DS3231 class on the same chip (DS3231_multi.h)
+		BENCH("DS3231::readDateTime", chip.readDateTime());
+		BENCH("DS3231::setDateTime", chip.setDateTime(now));
+		BENCH("DS3231::readAlarm", chip.readAlarm(1));
+		BENCH("DS3231::turnAlarmOn", chip.turnAlarmOn(1));
+		BENCH("DS3231::serviceAlarms", chip.serviceAlarms());
+		chip.turnAlarmOff(3);
+		//Fixed 24 hour mode (DS3231_fixed.h)
+		BENCH("DS3231Fixed::readTime", Fixed24::readTime());
+		BENCH("DS3231Fixed::readDateTime", Fixed24::readDateTime());
+		BENCH("DS3231Fixed::setTime", Fixed24::setTime(now.t));
+		BENCH("DS3231Fixed::setDateTime", Fixed24::setDateTime(now));
+		BENCH("DS3231Fixed::setAlarm", Fixed24::setAlarm(a));
+		//Last, as it takes the bus down and up again
+		BENCH("recoverBus", recoverBus());
+	}
+	if(mismatches)
+		fprintf(stderr, "%d rows where the library's BusStats disagree with the bus\n", mismatches);
+	return mismatches;
+}
@@ -0,0 +1,114 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/codec_benchmark.cpp                                              ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+//The BCD codecs before and after bcdEncode()/bcdDecode(): checks they agree on
+//every value the DS3231 uses, then times each in CPU cycles (the TSC on x86,
+//nanoseconds elsewhere). The host CPU divides by 10 with a multiply anyway, so
+//the gap here is smaller than on an AVR, where '/ 10' and '% 10' are calls into
+//the division routine - it shows the new ones are no slower, not the AVR saving.
+//  ./build/host/codec_benchmark        table
+//  ./build/host/codec_benchmark csv
+//Returns the number of values the two disagree on, so it runs as a test too.
+#include <Arduino.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "DS3231_tisc.h"
+
+#define PASSES 2000		//times round all 100 values
+
+//What _toBcd() and _fromBcd() were
+uint8_t oldEncode(uint8_t num) {
+	uint8_t bcd = ((num / 10) << 4) + (num % 10);
+	return bcd;
+}
+uint8_t oldDecode(uint8_t bcd) {
+	uint8_t num = (10*((bcd&0xf0) >>4)) + (bcd & 0x0f);
+	return num;
+}
+uint8_t newEncode(uint8_t num) { return bcdEncode(num); }
+uint8_t newDecode(uint8_t bcd) { return bcdDecode(bcd); }
+
+uint64_t cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+//Cycles per call of CODEC over inputs, best of 5 runs. A template so the codec
+//is inlined as it would be in the library; the asm keeps the compiler from
+//folding the loop away or hoisting the work out of it
+template<uint8_t (*CODEC)(uint8_t)>
+double timeCodec(const uint8_t *inputs) {
+	double best = 0;
+	uint64_t start;
+	uint64_t taken;
+	uint8_t sink = 0;
+	uint8_t value;
+	int run, pass, i;
+	for(run = 0; run < 5; run++) {
+		start = cycles();
+		for(pass = 0; pass < PASSES; pass++) {
+			for(i = 0; i < 100; i++) {
+				value = inputs[i];
+				__asm__ volatile("" : "+r"(value));
+				sink ^= CODEC(value);
+			}
+		}
+		taken = cycles() - start;
+		if(!run || taken < best)
+			best = taken;
+	}
+	__asm__ volatile("" : : "r"(sink));
+	return best / (PASSES * 100.0);
+}
+
+int main(int argc, char **argv) {
+	bool csv = argc > 1 && !strcmp(argv[1], "csv");
+	uint8_t decimal[100];
+	uint8_t bcd[100];
+	int mismatches = 0;
+	double oldEnc, newEnc, oldDec, newDec;
+	int i;
+	for(i = 0; i < 100; i++) {
+		decimal[i] = i;
+		bcd[i] = oldEncode(i);
+		if(newEncode(i) != bcd[i]) {
+			fprintf(stderr, "encode %d: old 0x%02x new 0x%02x\n", i, bcd[i], newEncode(i));
+			mismatches++;
+		}
+		if(newDecode(bcd[i]) != oldDecode(bcd[i])) {
+			fprintf(stderr, "decode 0x%02x: old %d new %d\n", bcd[i], oldDecode(bcd[i]), newDecode(bcd[i]));
+			mismatches++;
+		}
+	}
+	oldEnc = timeCodec<oldEncode>(decimal);
+	newEnc = timeCodec<newEncode>(decimal);
+	oldDec = timeCodec<oldDecode>(bcd);
+	newDec = timeCodec<newDecode>(bcd);
+	if(csv) {
+		printf("codec,old,new\n");
+		printf("encode,%.2f,%.2f\n", oldEnc, newEnc);
+		printf("decode,%.2f,%.2f\n", oldDec, newDec);
+	}
+	else {
+#if defined(__x86_64__) || defined(__i386__)
+		printf("%-8s %10s %10s   (TSC cycles per call, best of 5)\n", "codec", "old", "new");
+#else
+		printf("%-8s %10s %10s   (ns per call, best of 5)\n", "codec", "old", "new");
+#endif
+		printf("%-8s %10.2f %10.2f\n", "encode", oldEnc, newEnc);
+		printf("%-8s %10.2f %10.2f\n", "decode", oldDec, newDec);
+		printf("%d mismatches over 0-99\n", mismatches);
+	}
+	return mismatches;
+}
@@ -0,0 +1,114 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/ds3231_sync.cpp                                                  ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+//Sets a DS3231 from this computer's clock, through a sketch built with SERIAL_SYNC
+//(see DS3231_sync.h and DS3231AlarmClock.ino). Close the serial monitor first.
+//  ds3231_sync /dev/ttyACM0               set the clock, then measure how far off it is
+//  ds3231_sync /dev/ttyACM0 query         just measure
+//  ds3231_sync /dev/ttyACM0 reference     give the aging offset controller a reference
+//  ds3231_sync /dev/ttyACM0 set 115200    at another baud rate, 9600 (the sketch's) by default
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sync_host.h"
+
+#define REPLY_TIMEOUT_MILLIS 3000	//a SET can wait up to a second for its boundary
+#define RESET_MILLIS         2000	//opening the port resets the Arduino
+
+//Prints a NAK, returns false if it was one
+bool notNak(SyncHostReply *reply) {
+	if(reply->type != SYNC_MSG_NAK)
+		return true;
+	switch(reply->payload[0]) {
+		case SYNC_BAD_CHECK: printf("device NAK: bad check byte\n"); break;
+		case SYNC_BAD_TYPE:  printf("device NAK: bad frame\n"); break;
+		case SYNC_BAD_WRITE: printf("device NAK: writing the DS3231 failed\n"); break;
+		default:             printf("device NAK: reason %u\n", reply->payload[0]); break;
+	}
+	return false;
+}
+
+//SET: the time at the check byte, and how late the device wrote it
+int set(int fd, uint32_t baud) {
+	SyncHostReply reply;
+	if(!syncHostSendTime(fd, SYNC_MSG_SET, syncHostNowMicros() + syncHostFrameMicros(6, baud)))
+		return 1;
+	if(!syncHostReceive(fd, &reply, REPLY_TIMEOUT_MILLIS)) {
+		printf("no reply to SET\n");
+		return 1;
+	}
+	if(!notNak(&reply))
+		return 1;
+	printf("set to %u, seconds register written %d us after the second\n",
+		syncHostU32(reply.payload), syncHostI32(&reply.payload[4]));
+	return 0;
+}
+
+//QUERY: DS3231 minus this computer, taking the reply as sent halfway through the round trip
+int query(int fd) {
+	SyncHostReply reply;
+	uint64_t sent = syncHostNowMicros();
+	int64_t device;
+	if(!syncHostSend(fd, SYNC_MSG_QUERY, NULL, 0))
+		return 1;
+	if(!syncHostReceive(fd, &reply, REPLY_TIMEOUT_MILLIS) || !notNak(&reply)) {
+		printf("no reply to QUERY\n");
+		return 1;
+	}
+	device = syncHostU32(reply.payload) * 1000000LL + (reply.payload[4] | (reply.payload[5] << 8)) * 1000LL;
+	printf("DS3231 %u.%03u, off by %+.1f ms (round trip %.1f ms)\n",
+		syncHostU32(reply.payload), reply.payload[4] | (reply.payload[5] << 8),
+		(device - (int64_t)(sent + reply.micros) / 2) / 1000.0, (reply.micros - sent) / 1000.0);
+	return 0;
+}
+
+//REFERENCE: what the aging offset controller made of it
+int reference(int fd, uint32_t baud) {
+	SyncHostReply reply;
+	if(!syncHostSendTime(fd, SYNC_MSG_REFERENCE, syncHostNowMicros() + syncHostFrameMicros(6, baud)))
+		return 1;
+	if(!syncHostReceive(fd, &reply, REPLY_TIMEOUT_MILLIS) || !notNak(&reply)) {
+		printf("no reply to REFERENCE\n");
+		return 1;
+	}
+	printf("DS3231 is %d ms off, drifting %+.1f ppm, aging offset %d\n", syncHostI32(reply.payload),
+		(int16_t)(reply.payload[4] | (reply.payload[5] << 8)) / 10.0, (int8_t)reply.payload[6]);
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	const char *command = argc > 2 ? argv[2] : "set";
+	uint32_t baud = argc > 3 ? strtoul(argv[3], NULL, 10) : 9600;
+	int fd;
+	int result;
+	if(argc < 2) {
+		fprintf(stderr, "usage: %s PORT [set|query|reference] [BAUD]\n", argv[0]);
+		return 2;
+	}
+	fd = syncHostOpen(argv[1], baud);
+	if(fd < 0) {
+		perror(argv[1]);
+		return 1;
+	}
+	usleep(RESET_MILLIS * 1000);
+	if(!strcmp(command, "set")) {
+		result = set(fd, baud);
+		if(!result) {
+			usleep(500000);		//not on a second boundary, so the millis mean something
+			result = query(fd);
+		}
+	}
+	else if(!strcmp(command, "query"))
+		result = query(fd);
+	else if(!strcmp(command, "reference"))
+		result = reference(fd, baud);
+	else {
+		fprintf(stderr, "unknown command %s\n", command);
+		result = 2;
+	}
+	close(fd);
+	return result;
+}
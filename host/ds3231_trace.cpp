@@ -0,0 +1,73 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/ds3231_trace.cpp                                                 ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+//Reads the timing trace from a sketch built with DS3231_TRACE (see DS3231_trace.h and
+//DS3231AlarmClock.ino), with or without SERIAL_SYNC, and prints latency histograms
+//per event. Close the serial monitor first. Opening the port resets most Arduinos,
+//which empties the trace - run 'stty -F PORT -hupcl' once and it won't after the
+//first time.
+//  ds3231_trace /dev/ttyACM0               dump and print the histograms
+//  ds3231_trace /dev/ttyACM0 clear         start again
+//  ds3231_trace /dev/ttyACM0 dump 115200   at another baud rate, 9600 (the sketch's) by default
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sync_host.h"
+#include "trace_host.h"
+
+#define REPLY_TIMEOUT_MILLIS 3000	//a full ring is about a second at 9600
+#define CLEAR_TIMEOUT_MILLIS 500	//only a SERIAL_SYNC sketch answers a clear
+#define RESET_MILLIS         2000	//in case opening the port reset the Arduino
+
+int dump(int fd) {
+	TraceHostDump trace;
+	if(!traceHostRequest(fd, TRACE_CMD_DUMP))
+		return 1;
+	if(!traceHostReceive(fd, &trace, REPLY_TIMEOUT_MILLIS)) {
+		printf("no trace dump (%u records arrived) - is DS3231_TRACE on?\n", trace.count);
+		return 1;
+	}
+	traceHostPrint(stdout, &trace);
+	return 0;
+}
+
+int clear(int fd) {
+	TraceHostDump trace;
+	if(!traceHostRequest(fd, TRACE_CMD_CLEAR))
+		return 1;
+	if(traceHostReceive(fd, &trace, CLEAR_TIMEOUT_MILLIS))
+		printf("cleared\n");
+	else
+		printf("clear sent\n");		//without SERIAL_SYNC there's no reply
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	const char *command = argc > 2 ? argv[2] : "dump";
+	uint32_t baud = argc > 3 ? strtoul(argv[3], NULL, 10) : 9600;
+	int fd;
+	int result;
+	if(argc < 2) {
+		fprintf(stderr, "usage: %s PORT [dump|clear] [BAUD]\n", argv[0]);
+		return 2;
+	}
+	fd = syncHostOpen(argv[1], baud);
+	if(fd < 0) {
+		perror(argv[1]);
+		return 1;
+	}
+	usleep(RESET_MILLIS * 1000);
+	if(!strcmp(command, "dump"))
+		result = dump(fd);
+	else if(!strcmp(command, "clear"))
+		result = clear(fd);
+	else {
+		fprintf(stderr, "unknown command %s\n", command);
+		result = 2;
+	}
+	close(fd);
+	return result;
+}
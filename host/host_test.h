@@ -0,0 +1,42 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/host_test.h                                                      ***
+***	 Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#ifndef _HOST_TEST_H
+#define _HOST_TEST_H
+
+//Checks for the host tests. Each test is its own program: CHECK()s that fail are
+//printed and counted, and testResult() (return it from main()) is what ctest sees.
+//  int main(void) { ...; CHECK_EQ(readDateTime().d.year, 2100); ...; return testResult(); }
+
+#include <stdio.h>
+
+static int _testChecks = 0;
+static int _testFailures = 0;
+
+#define CHECK(cond) do { \
+	_testChecks++; \
+	if(!(cond)) { \
+		fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+		_testFailures++; \
+	} \
+} while(0)
+
+#define CHECK_EQ(actual, expected) do { \
+	long long _actual = (long long)(actual); \
+	long long _expected = (long long)(expected); \
+	_testChecks++; \
+	if(_actual != _expected) { \
+		fprintf(stderr, "%s:%d: %s is %lld, expected %s = %lld\n", __FILE__, __LINE__, \
+			#actual, _actual, #expected, _expected); \
+		_testFailures++; \
+	} \
+} while(0)
+
+static inline int testResult(void) {
+	printf("%d checks, %d failed\n", _testChecks, _testFailures);
+	return _testFailures ? 1 : 0;
+}
+
+#endif
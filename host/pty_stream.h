@@ -0,0 +1,55 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/pty_stream.h                                                     ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#ifndef _PTY_STREAM_H
+#define _PTY_STREAM_H
+
+//A pty for the tests that talk to the library over a serial port: the device's Serial
+//is a Stream on the master, the computer's side (sync_host.cpp) opens the slave as it
+//would /dev/ttyACM0.
+//  int master = ptyOpen();
+//  int fd = syncHostOpen(ptsname(master), 115200);
+//  PtyStream port(master);
+
+#include <Arduino.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+class PtyStream : public Stream {
+	public:
+	PtyStream(int fd) : _fd(fd), _peeked(-1) {}
+	size_t write(uint8_t c) { return ::write(_fd, &c, 1) == 1 ? 1 : 0; }
+	using Print::write;
+	int available(void) { return peek() < 0 ? 0 : 1; }
+	int read(void) {
+		int c = peek();
+		_peeked = -1;
+		return c;
+	}
+	int peek(void) {
+		uint8_t c;
+		if(_peeked < 0 && ::read(_fd, &c, 1) == 1)
+			_peeked = c;
+		return _peeked;
+	}
+	private:
+	int _fd;
+	int _peeked;
+};
+
+//The master, non-blocking as a Serial is, or -1
+static inline int ptyOpen(void) {
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+	if(master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+		perror("pty");
+		return -1;
+	}
+	fcntl(master, F_SETFL, O_NONBLOCK);
+	return master;
+}
+
+#endif
@@ -0,0 +1,186 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/sync_host.cpp                                                    ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "sync_host.h"
+
+/*****************************************************************
+* syncHostOpen(path, baud)
+* @path - the Arduino's port, e.g. /dev/ttyACM0, or a pty
+* @baud - what Serial.begin() was given
+* Opening the port resets most Arduinos, so give it a couple of
+* seconds before sending anything
+* @return - fd, -1 if it couldn't be opened or set up
+*****************************************************************/
+int syncHostOpen(const char *path, uint32_t baud) {
+	struct termios tio;
+	speed_t speed;
+	int fd;
+	switch(baud) {
+		case 9600:   speed = B9600;   break;
+		case 19200:  speed = B19200;  break;
+		case 38400:  speed = B38400;  break;
+		case 57600:  speed = B57600;  break;
+		case 115200: speed = B115200; break;
+		case 230400: speed = B230400; break;
+		default: return -1;
+	}
+	fd = open(path, O_RDWR | O_NOCTTY);
+	if(fd < 0)
+		return -1;
+	if(tcgetattr(fd, &tio) < 0) {
+		close(fd);
+		return -1;
+	}
+	cfmakeraw(&tio);
+	cfsetispeed(&tio, speed);
+	cfsetospeed(&tio, speed);
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cc[VMIN] = 0;
+	tio.c_cc[VTIME] = 0;
+	if(tcsetattr(fd, TCSANOW, &tio) < 0) {
+		close(fd);
+		return -1;
+	}
+	tcflush(fd, TCIOFLUSH);
+	return fd;
+}
+/*****************************************************************
+* syncHostNowMicros()
+* @return - the computer's Unix time in us. Only as good as its
+*           own sync (NTP, PTP...) - that's what the DS3231 gets
+*****************************************************************/
+uint64_t syncHostNowMicros(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+/*****************************************************************
+* syncHostFrameMicros(len, baud)
+* @return - time on the wire for a frame with len payload bytes,
+*           10 bits (start, 8 data, stop) per byte. SET and
+*           REFERENCE give the time the check byte finishes, so
+*           add this to now when making one
+*****************************************************************/
+uint32_t syncHostFrameMicros(uint8_t len, uint32_t baud) {
+	return (uint32_t)((len + 4) * 10ULL * 1000000ULL / baud);
+}
+/*****************************************************************
+* syncHostSend(fd, type, payload, len)
+* Sends one frame and waits for it to leave the port
+* @return - false if the write failed
+*****************************************************************/
+bool syncHostSend(int fd, uint8_t type, const uint8_t *payload, uint8_t len) {
+	uint8_t frame[SYNC_MAX_PAYLOAD + 4];
+	uint8_t sum = type + len;
+	uint8_t i;
+	ssize_t sent = 0;
+	ssize_t n;
+	if(len > SYNC_MAX_PAYLOAD)
+		return false;
+	frame[0] = SYNC_FRAME_START;
+	frame[1] = type;
+	frame[2] = len;
+	for(i = 0; i < len; i++) {
+		frame[3 + i] = payload[i];
+		sum += payload[i];
+	}
+	frame[3 + len] = (uint8_t)-sum;
+	while(sent < len + 4) {
+		n = write(fd, frame + sent, len + 4 - sent);
+		if(n < 0 && errno != EINTR && errno != EAGAIN)
+			return false;
+		if(n > 0)
+			sent += n;
+	}
+	tcdrain(fd);
+	return true;
+}
+/*****************************************************************
+* syncHostSendTime(fd, type, unixMicros)
+* @type - SYNC_MSG_SET or SYNC_MSG_REFERENCE
+* @unixMicros - Unix time when the check byte will have been sent,
+*               rounded down to the ms the protocol carries
+*****************************************************************/
+bool syncHostSendTime(int fd, uint8_t type, uint64_t unixMicros) {
+	uint8_t payload[6];
+	uint32_t epoch = unixMicros / 1000000ULL;
+	uint16_t millisPart = (unixMicros / 1000ULL) % 1000;
+	payload[0] = epoch;
+	payload[1] = epoch >> 8;
+	payload[2] = epoch >> 16;
+	payload[3] = epoch >> 24;
+	payload[4] = millisPart;
+	payload[5] = millisPart >> 8;
+	return syncHostSend(fd, type, payload, 6);
+}
+/*****************************************************************
+* syncHostReceive(fd, reply, timeoutMillis)
+* Reads until a whole frame with a good check byte arrives. The
+* sketch's own prints (DEBUG etc.) share the port, so anything
+* that isn't a frame is skipped
+* @return - false, and reply->type 0, on timeout
+*****************************************************************/
+bool syncHostReceive(int fd, SyncHostReply *reply, uint32_t timeoutMillis) {
+	uint64_t deadline = syncHostNowMicros() + timeoutMillis * 1000ULL;
+	uint8_t state = 0;		//0 start, 1 type, 2 len, 3 payload, 4 check
+	uint8_t sum = 0;
+	uint8_t got = 0;
+	uint8_t c;
+	struct pollfd pfd;
+	int64_t left;
+	reply->type = 0;
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	for(;;) {
+		left = (int64_t)(deadline - syncHostNowMicros());
+		if(left <= 0)
+			return false;
+		if(poll(&pfd, 1, (int)((left + 999) / 1000)) <= 0)
+			continue;
+		if(read(fd, &c, 1) != 1)
+			continue;
+		switch(state) {
+			case 0:
+				if(c == SYNC_FRAME_START)
+					state = 1;
+				break;
+			case 1:
+				reply->type = c;
+				sum = c;
+				state = 2;
+				break;
+			case 2:
+				reply->len = c;
+				sum += c;
+				got = 0;
+				state = c ? 3 : 4;
+				break;
+			case 3:
+				reply->payload[got++] = c;
+				sum += c;
+				if(got == reply->len)
+					state = 4;
+				break;
+			case 4:
+				reply->micros = syncHostNowMicros();
+				if(!(uint8_t)(sum + c))
+					return true;
+				state = 0;		//bad check, look for the next one
+				break;
+		}
+	}
+}
+int32_t syncHostI32(const uint8_t *buf) {
+	return (int32_t)syncHostU32(buf);
+}
+uint32_t syncHostU32(const uint8_t *buf) {
+	return buf[0] | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
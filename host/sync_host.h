@@ -0,0 +1,36 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/sync_host.h                                                      ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#ifndef _SYNC_HOST_H
+#define _SYNC_HOST_H
+
+//The computer's side of the serial sync protocol in DS3231_sync.h, for Linux.
+//ds3231_sync is the command line tool built on it, test_sync runs it against the
+//simulated DS3231 over a pty.
+//  int fd = syncHostOpen("/dev/ttyACM0", 115200);
+//  SyncHostReply r;
+//  syncHostSendTime(fd, SYNC_MSG_SET, syncHostNowMicros() + syncHostFrameMicros(6, 115200));
+//  syncHostReceive(fd, &r, 3000);		//SYNC_MSG_SET_DONE, or a NAK
+
+#include <stdint.h>
+#include "DS3231_sync.h"
+
+class SyncHostReply {
+	public:
+	uint8_t type;		//SYNC_MSG_..., 0 if nothing valid arrived in time
+	uint8_t len;
+	uint8_t payload[255];	//any length, SYNC_MSG_TRACE_DATA frames are longer than what the device takes
+	uint64_t micros;	//syncHostNowMicros() when the check byte was read
+};
+
+int syncHostOpen(const char *path, uint32_t baud);	//Raw 8N1, returns the fd or -1
+uint64_t syncHostNowMicros(void);					//Unix time in us, CLOCK_REALTIME
+uint32_t syncHostFrameMicros(uint8_t len, uint32_t baud);	//How long a frame with len bytes of payload takes to send
+bool syncHostSend(int fd, uint8_t type, const uint8_t *payload, uint8_t len); //One frame, waits until it's sent
+bool syncHostSendTime(int fd, uint8_t type, uint64_t unixMicros);	//SET or REFERENCE for unixMicros
+bool syncHostReceive(int fd, SyncHostReply *reply, uint32_t timeoutMillis); //Next good frame, skipping anything else
+int32_t syncHostI32(const uint8_t *buf);			//little endian, as the device sends them
+uint32_t syncHostU32(const uint8_t *buf);
+#endif
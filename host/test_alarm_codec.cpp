@@ -0,0 +1,167 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/test_alarm_codec.cpp                                             ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+//encodeAlarm() and decodeAlarm() against each other and against the simulated DS3231:
+//every alarm_mask of both alarms, day and date, 12 and 24 hour registers, every time of
+//day and every date and weekday. What goes in comes back out, the register bits are
+//where the datasheet puts them, and the chip goes off when the unmasked fields match.
+#include <Arduino.h>
+#include <Wire.h>
+#include "DS3231_sim.h"
+#include "DS3231_tisc.h"
+#include "host_test.h"
+
+#define BASE_EPOCH 1715780730UL		//2024-05-15 13:45:30, a Wednesday
+
+Time makeTime(uint8_t hour24, uint8_t minute, uint8_t second) {
+	Time t;
+	t.hour24 = hour24;
+	t.hour12 = hour24 % 12 ? hour24 % 12 : 12;
+	t.pm = hour24 >= 12;
+	t.minute = minute;
+	t.second = second;
+	return t;
+}
+
+//alarm_mask bits: AxMn for register i is bit i, DY/!DT the one above the last
+uint8_t fieldCount(uint8_t mask) { return mask & 0x80 ? 3 : 4; }
+bool everyDay(uint8_t mask) { return mask >> (fieldCount(mask) - 1) & 1; }
+bool dayMatch(uint8_t mask) { return mask >> fieldCount(mask) & 1; }
+
+//What decodeAlarm() should give back for a: the mask, less DY/!DT if AxM4 leaves no
+//day/date register to hold it. Alarm 2 has no seconds
+bool roundTrips(AlarmSetting a, bool twelve) {
+	uint8_t regs[4];
+	uint8_t count = fieldCount(a.alarm_mask);
+	uint8_t i;
+	uint8_t mask = a.alarm_mask;
+	AlarmSetting b;
+	uint8_t first = encodeAlarm(a, twelve, regs);
+	if(first != (count == 4 ? DS3231_ALARM1_SECONDS : DS3231_ALARM2_MINUTES))
+		return false;
+	//The registers: AxMn on top, 12/!24 in the hours, DY/!DT in the day/date
+	for(i = 0; i < count; i++)
+		if((regs[i] >> 7) != (mask >> i & 1))
+			return false;
+	if(((regs[count - 2] & 0x40) != 0) != twelve)
+		return false;
+	if(everyDay(mask) ? regs[count - 1] != 0x80 : ((regs[count - 1] & 0x40) != 0) != dayMatch(mask))
+		return false;
+	b = decodeAlarm(regs, count == 4 ? 1 : 2);
+	if(everyDay(mask))
+		mask &= ~(1 << count);
+	if(b.alarm_mask != mask)
+		return false;
+	if(b.t.hour24 != a.t.hour24 || b.t.hour12 != a.t.hour12 || b.t.pm != a.t.pm)
+		return false;
+	if(b.t.minute != a.t.minute || b.t.second != (count == 4 ? a.t.second : 0))
+		return false;
+	if(everyDay(mask))
+		return b.date == 0 && b.weekday == 0;
+	if(dayMatch(mask))
+		return b.date == 0 && b.weekday == a.weekday;
+	return b.date == a.date && b.weekday == 0;
+}
+
+//Every mask and mode over every time of day (with one date and weekday), then
+//every date and weekday (at one time). Counted, not CHECKed one by one - there
+//are millions
+void testRoundTrip(void) {
+	AlarmSetting a;
+	uint8_t masks[48];
+	uint8_t n = 0;
+	uint8_t m;
+	uint8_t twelve;
+	uint8_t hour;
+	uint8_t minute;
+	uint8_t second;
+	uint8_t day;
+	uint32_t bad;
+	for(m = 0; m < 32; m++)
+		masks[n++] = m;				//alarm 1: DY/!DT, A1M4-A1M1
+	for(m = 0; m < 16; m++)
+		masks[n++] = 0x80 | m;		//alarm 2: DY/!DT, A2M4-A2M2
+	for(m = 0; m < n; m++) {
+		for(twelve = 0; twelve < 2; twelve++) {
+			bad = 0;
+			a.alarm_mask = masks[m];
+			a.date = 15;
+			a.weekday = 4;
+			for(hour = 0; hour < 24; hour++)
+				for(minute = 0; minute < 60; minute++)
+					for(second = 0; second < 60; second++) {
+						a.t = makeTime(hour, minute, second);
+						bad += !roundTrips(a, twelve);
+					}
+			a.t = makeTime(13, 45, 30);
+			for(day = 1; day <= 31; day++) {
+				a.date = day;
+				a.weekday = (day - 1) % 7 + 1;
+				bad += !roundTrips(a, twelve);
+			}
+			if(bad)
+				fprintf(stderr, "alarm_mask 0x%02x, %s hour\n", masks[m], twelve ? "12" : "24");
+			CHECK_EQ(bad, 0);
+		}
+	}
+}
+
+//Ticks the simulated DS3231 into epoch, with the alarm set for BASE_EPOCH, and
+//says whether the alarm's flag went up
+bool firesAt(DS3231Sim &rtc, AlarmSetting a, bool twelve, uint32_t epoch) {
+	uint8_t regs[4];
+	uint8_t first;
+	uint8_t flag = a.alarm_mask & 0x80 ? 0x02 : 0x01;
+	twelveHourMode = twelve;
+	setDateTime(epochToDateTime(epoch - 1));
+	first = encodeAlarm(a, twelve, regs);
+	writeRegisters(first, regs, fieldCount(a.alarm_mask));
+	rtc.poke(DS3231_STATUS, rtc.reg(DS3231_STATUS) & ~0x03);
+	delay(1001);
+	return rtc.reg(DS3231_STATUS) & flag;
+}
+
+//The datasheet's alarm kinds, on the chip: each goes off at BASE_EPOCH (at 00
+//seconds for alarm 2) and, a second, minute, hour or day further on, only if
+//it ignores the field that moved
+void testOnChip(DS3231Sim &rtc) {
+	static const uint8_t kinds[] = {
+		ALARM1_EVERY_SECOND, ALARM1_MATCH_SECONDS, ALARM1_MATCH_MINUTES,
+		ALARM1_MATCH_HOURS, ALARM1_MATCH_DATE, ALARM1_MATCH_WEEKDAY,
+		ALARM2_EVERY_MINUTE, ALARM2_MATCH_MINUTES, ALARM2_MATCH_HOURS,
+		ALARM2_MATCH_DATE, ALARM2_MATCH_WEEKDAY,
+	};
+	static const uint32_t moves[4] = {1, 60, 3600, 86400};	//seconds...day/date
+	DateTime base;
+	AlarmSetting a;
+	uint32_t epoch;
+	uint8_t k;
+	uint8_t twelve;
+	uint8_t field;
+	uint8_t count;
+	for(k = 0; k < sizeof(kinds); k++) {
+		for(twelve = 0; twelve < 2; twelve++) {
+			a.alarm_mask = kinds[k];
+			count = fieldCount(a.alarm_mask);
+			epoch = count == 4 ? BASE_EPOCH : BASE_EPOCH - 30;
+			base = epochToDateTime(epoch);
+			a.t = base.t;
+			a.date = base.d.date;
+			a.weekday = base.d.weekday;
+			CHECK(firesAt(rtc, a, twelve, epoch));
+			for(field = 4 - count; field < 4; field++)
+				CHECK_EQ(firesAt(rtc, a, twelve, epoch + moves[field]), a.alarm_mask >> (field - (4 - count)) & 1);
+		}
+	}
+	twelveHourMode = false;
+}
+
+int main(void) {
+	DS3231Sim rtc;
+	Wire.begin();
+	testRoundTrip();
+	testOnChip(rtc);
+	return testResult();
+}
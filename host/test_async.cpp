@@ -0,0 +1,137 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/test_async.cpp                                                   ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+//The async queue: one transaction per serviceAsync(), alarm flags cleared
+//without touching a flag that came up in between, and a failed transaction
+//completes its op with an error instead of passing on garbage.
+#include <Arduino.h>
+#include <Wire.h>
+#include "DS3231_sim.h"
+#include "DS3231_tisc.h"
+#include "host_test.h"
+
+#define FAIL_CALL (DS3231_RETRIES + 1)
+
+DateTime gotDateTime;
+uint8_t dateTimeCalls;
+void onDateTime(DateTime dt) { gotDateTime = dt; dateTimeCalls++; }
+uint8_t gotAlarms;
+uint8_t alarmCalls;
+void onAlarms(uint8_t alarms) { gotAlarms = alarms; alarmCalls++; }
+
+//Runs serviceAsync() until the queue is empty, returns how many calls it took
+uint8_t drain(void) {
+	uint8_t calls = 0;
+	while(serviceAsync())
+		calls++;
+	return calls;
+}
+
+void testReadDateTime(DS3231Sim &rtc) {
+	uint16_t ticket;
+	rtc.setDateTime(2031, 3, 4, 5, 6, 7);
+	dateTimeCalls = 0;
+	ticket = readDateTimeAsync(onDateTime);
+	CHECK(!asyncDone(ticket));
+	CHECK_EQ(serviceAsync(), 1);		//pointer set
+	CHECK_EQ(serviceAsync(), 0);		//read
+	CHECK(asyncDone(ticket));
+	CHECK_EQ(dateTimeCalls, 1);
+	CHECK_EQ(gotDateTime.d.year, 2031);
+	CHECK_EQ(gotDateTime.t.hour24, 5);
+	CHECK_EQ(ds3231LastError(), DS3231_OK);
+}
+
+void testClearOnlyWhatWasRead(DS3231Sim &rtc) {
+	rtc.poke(DS3231_STATUS, 0x09);		//EN32kHz, A1F
+	alarmCalls = 0;
+	serviceAlarmsAsync(onAlarms);
+	serviceAsync();
+	serviceAsync();						//A1F read...
+	rtc.poke(DS3231_STATUS, 0x0b);		//...then A2F comes up before the clear
+	serviceAsync();
+	CHECK_EQ(alarmCalls, 1);
+	CHECK_EQ(gotAlarms, 1);
+	CHECK_EQ(rtc.reg(DS3231_STATUS), 0x0a);	//A2F still there, EN32kHz untouched
+	serviceAlarmsAsync(onAlarms);
+	drain();
+	CHECK_EQ(gotAlarms, 2);
+	CHECK_EQ(rtc.reg(DS3231_STATUS), 0x08);
+}
+
+void testPointerFails(DS3231Sim &rtc) {
+	AsyncStats before = getAsyncStats();
+	rtc.setDateTime(2031, 3, 4, 5, 6, 7);
+	readDateTime();						//last good time
+	rtc.setDateTime(2044, 1, 1, 0, 0, 0);
+	dateTimeCalls = 0;
+	Wire.resetTraffic();
+	Wire.failNext(1, WIRE_NACK_ADDR);
+	CHECK_EQ(readDateTimeAsync(onDateTime) != 0, true);
+	CHECK_EQ(serviceAsync(), 0);		//completed there and then, no read after it
+	CHECK_EQ(Wire.traffic().transactions, 1);
+	CHECK_EQ(dateTimeCalls, 1);
+	CHECK_EQ(gotDateTime.d.year, 2031);
+	CHECK_EQ(asyncLastDateTime().d.year, 2031);
+	CHECK_EQ(ds3231LastError(), DS3231_ERR_NACK_ADDRESS);
+	CHECK_EQ(getAsyncStats().failed, before.failed + 1);
+	CHECK_EQ(getAsyncStats().completed, before.completed + 1);
+}
+
+void testReadFails(DS3231Sim &rtc) {
+	AsyncStats before = getAsyncStats();
+	rtc.poke(DS3231_STATUS, 0x03);
+	alarmCalls = 0;
+	serviceAlarmsAsync(onAlarms);
+	Wire.failNext(1, WIRE_SHORT, 1);	//pointer fine, read comes up short
+	CHECK_EQ(drain(), 1);
+	CHECK_EQ(alarmCalls, 1);
+	CHECK_EQ(gotAlarms, 0);
+	CHECK_EQ(ds3231LastError(), DS3231_ERR_SHORT_READ);
+	CHECK_EQ(rtc.reg(DS3231_STATUS), 0x03);
+	CHECK_EQ(getAsyncStats().failed, before.failed + 1);
+}
+
+void testClearFails(DS3231Sim &rtc) {
+	AsyncStats before = getAsyncStats();
+	rtc.poke(DS3231_STATUS, 0x03);
+	alarmCalls = 0;
+	serviceAlarmsAsync(onAlarms);
+	Wire.failNext(FAIL_CALL, WIRE_NACK_DATA, 2);
+	drain();
+	CHECK_EQ(alarmCalls, 1);
+	CHECK_EQ(gotAlarms, 0);				//not cleared, so not reported...
+	CHECK_EQ(rtc.reg(DS3231_STATUS), 0x03);
+	CHECK_EQ(getAsyncStats().failed, before.failed + 1);
+	serviceAlarmsAsync(onAlarms);
+	drain();
+	CHECK_EQ(gotAlarms, 3);				//...until they are
+	CHECK_EQ(rtc.reg(DS3231_STATUS), 0x00);
+}
+
+void testWriteFails(DS3231Sim &rtc) {
+	AsyncStats before = getAsyncStats();
+	DateTime dt = {{0, 8, 0, 0, false}, {2050, 6, 7, 0}};
+	rtc.setDateTime(2031, 3, 4, 5, 6, 7);
+	rtc.setPresent(false);
+	setDateTimeAsync(dt, NULL);
+	drain();
+	rtc.setPresent(true);
+	CHECK_EQ(ds3231LastError(), DS3231_ERR_NACK_ADDRESS);
+	CHECK_EQ(getAsyncStats().failed, before.failed + 1);
+	CHECK_EQ(rtc.reg(DS3231_DEC_YEAR), 0x31);
+}
+
+int main(void) {
+	DS3231Sim rtc;
+	Wire.begin();
+	testReadDateTime(rtc);
+	testClearOnlyWhatWasRead(rtc);
+	testPointerFails(rtc);
+	testReadFails(rtc);
+	testClearFails(rtc);
+	testWriteFails(rtc);
+	return testResult();
+}
@@ -0,0 +1,235 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/test_checked_io.cpp                                              ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+//What the read-modify-write calls do when the bus fails: nothing gets written
+//that was made from a failed read, alarms aren't reported (or hooked, or
+//journaled) until their flags are actually cleared, and the buffers handed
+//back are zeroed rather than left as whatever was on the stack.
+#include <Arduino.h>
+#include <Wire.h>
+#include "DS3231_sim.h"
+#include "DS3231_tisc.h"
+#include "DS3231_multi.h"
+#include "DS3231_fixed.h"
+#include "host_test.h"
+
+//Every try of a ...Checked() call fails, retries included
+#define FAIL_CALL (DS3231_RETRIES + 1)
+
+uint8_t hookCalls;
+void countHook(void) { hookCalls++; }
+uint8_t journalCalls;
+void countJournal(uint8_t event, uint8_t data) { (void)event; (void)data; journalCalls++; }
+
+//A1IE on, A2IE off, both flags set
+void armed(DS3231Sim &rtc) {
+	rtc.poke(DS3231_CONTROL, 0x05);
+	rtc.poke(DS3231_STATUS, 0x03);
+	invalidateRegisterCache();
+}
+
+void testControlUntouched(DS3231Sim &rtc) {
+	armed(rtc);
+	rtc.setPresent(false);
+	turnAlarmOn(2);
+	CHECK_EQ(ds3231LastError(), DS3231_ERR_NACK_ADDRESS);
+	turnAlarmOff(1);
+	CHECK_EQ(toggleAlarms(), 0);
+	CHECK_EQ(getAlarmStatus(), 0);
+	startTickClock(0);
+	CHECK_EQ(tickClockService(), 0);	//wasn't started
+	stopTickClock();
+	rtc.setPresent(true);
+	CHECK_EQ(rtc.reg(DS3231_CONTROL), 0x05);
+	CHECK_EQ(rtc.reg(DS3231_STATUS) & 0x03, 0x03);
+	CHECK_EQ(getAlarmStatus(), 1);
+}
+
+void testTurnAlarmOnHalfway(DS3231Sim &rtc) {
+	armed(rtc);
+	//STATUS read (2) and write (1) go through, the CONTROL read doesn't
+	Wire.failNext(FAIL_CALL, WIRE_NACK_ADDR, 3);
+	turnAlarmOn(2);
+	CHECK_EQ(rtc.reg(DS3231_STATUS) & 0x03, 0x01);	//A2F cleared...
+	CHECK_EQ(rtc.reg(DS3231_CONTROL), 0x05);		//...but A2IE not written from a guess
+	turnAlarmOn(2);
+	CHECK_EQ(rtc.reg(DS3231_CONTROL), 0x07);
+}
+
+void testServiceAlarms(DS3231Sim &rtc) {
+	armed(rtc);
+	hookCalls = 0;
+	journalCalls = 0;
+	setAlarm1Hook(countHook);
+	setJournalHook(countJournal);
+	//STATUS can't be read
+	rtc.setPresent(false);
+	CHECK_EQ(serviceAlarms(), 0);
+	rtc.setPresent(true);
+	CHECK_EQ(hookCalls, 0);
+	CHECK_EQ(journalCalls, 0);
+	CHECK_EQ(rtc.reg(DS3231_STATUS) & 0x03, 0x03);
+	//STATUS read, but the flags can't be cleared
+	Wire.failNext(FAIL_CALL, WIRE_NACK_DATA, 2);
+	CHECK_EQ(serviceAlarms(), 0);
+	CHECK_EQ(hookCalls, 0);
+	CHECK_EQ(journalCalls, 0);
+	CHECK_EQ(rtc.reg(DS3231_STATUS) & 0x03, 0x03);
+	//Reported once they're cleared
+	CHECK_EQ(serviceAlarms(), 2);
+	CHECK_EQ(hookCalls, 1);
+	CHECK_EQ(journalCalls, 1);
+	CHECK_EQ(rtc.reg(DS3231_STATUS) & 0x03, 0x00);
+	CHECK_EQ(serviceAlarms(), 0);
+	CHECK_EQ(hookCalls, 1);
+	setAlarm1Hook(NULL);
+	setJournalHook(NULL);
+}
+
+void testSetAlarm(DS3231Sim &rtc) {
+	AlarmSetting a;
+	a.t.hour24 = 6;
+	a.t.hour12 = 6;
+	a.t.pm = false;
+	a.t.minute = 30;
+	a.t.second = 0;
+	a.date = 1;
+	a.weekday = 1;
+	a.alarm_mask = 0x08;		//Alarm 1, hours, minutes and seconds match
+	rtc.poke(DS3231_ALARM1_HOURS, 0x11);
+	invalidateRegisterCache();
+	rtc.setPresent(false);
+	setAlarm(a);
+	CHECK_EQ(setAlarmAsync(a, NULL), 0);
+	rtc.setPresent(true);
+	CHECK_EQ(rtc.reg(DS3231_ALARM1_HOURS), 0x11);
+	setAlarm(a);
+	CHECK_EQ(rtc.reg(DS3231_ALARM1_HOURS), 0x06);
+}
+
+void testCache(DS3231Sim &rtc) {
+	Ds3231Image image;
+	AlarmSetting a;
+	RegisterCacheStats before;
+	useRegisterCache(true);
+	refreshRegisterCache();
+	rtc.setPresent(false);
+	refreshRegisterCache();			//fails, so the cache is emptied
+	image = captureImage();
+	a = readAlarm(1);
+	CHECK_EQ(ds3231LastError(), DS3231_ERR_NACK_ADDRESS);
+	rtc.setPresent(true);
+	for(uint8_t i = 0; i < DS3231_REGISTER_COUNT; i++)
+		CHECK_EQ(image.regs[i], 0);
+	CHECK_EQ(a.t.minute, 0);
+	before = getRegisterCacheStats();
+	getAlarmStatus();
+	CHECK_EQ(getRegisterCacheStats().misses, before.misses + 1);
+	useRegisterCache(false);
+}
+
+//DS3231(), the free functions' chip through the class: same checked calls, same
+//link, and setting the time tells the rest of the library
+void testMulti(DS3231Sim &rtc) {
+	DS3231 clock;
+	DateTime dt;
+	uint8_t data;
+	uint8_t regs[4];
+	uint16_t sets;
+	WireTraffic t;
+	armed(rtc);
+	rtc.setPresent(false);
+	clock.turnAlarmOn(2);
+	CHECK_EQ(clock.lastError(), DS3231_ERR_NACK_ADDRESS);
+	CHECK_EQ(ds3231LastError(), DS3231_ERR_NACK_ADDRESS);
+	clock.turnAlarmOff(1);
+	CHECK_EQ(clock.getAlarmStatus(), 0);
+	CHECK_EQ(clock.serviceAlarms(), 0);
+	CHECK_EQ(clock.readDateTime().d.year, 2000);
+	rtc.setPresent(true);
+	CHECK_EQ(rtc.reg(DS3231_CONTROL), 0x05);
+	CHECK_EQ(rtc.reg(DS3231_STATUS) & 0x03, 0x03);
+	//Pointer write NAKed every try, so no read after any of them
+	Wire.resetTraffic();
+	Wire.failNext(FAIL_CALL, WIRE_NACK_DATA);
+	CHECK_EQ(clock.readRegisters(DS3231_CONTROL, &data, 1), 0);
+	CHECK_EQ(clock.lastError(), DS3231_ERR_NACK_DATA);
+	t = Wire.traffic();
+	CHECK_EQ(t.transactions, FAIL_CALL);
+	//One short read is retried
+	Wire.failNext(1, WIRE_SHORT, 1);
+	CHECK_EQ(clock.readRegisters(DS3231_SECONDS, regs, 4), 4);
+	CHECK_EQ(clock.lastError(), DS3231_OK);
+	CHECK_EQ(clock.getBusHealth().retries[1], getBusHealth().retries[1]);	//one link
+	//Flags read, clearing them fails: reported next time instead
+	Wire.failNext(FAIL_CALL, WIRE_NACK_DATA, 2);
+	CHECK_EQ(clock.serviceAlarms(), 0);
+	CHECK_EQ(clock.lastError(), DS3231_ERR_NACK_DATA);
+	CHECK_EQ(clock.serviceAlarms(), 3);
+	CHECK_EQ(clock.lastError(), DS3231_OK);
+	CHECK_EQ(rtc.reg(DS3231_STATUS) & 0x03, 0x00);
+	//Setting the time: the write's result comes back, and the library hears of it
+	journalCalls = 0;
+	setJournalHook(countJournal);
+	dt = epochToDateTime(1700000000UL);
+	sets = _clockSetCount();
+	rtc.setPresent(false);
+	CHECK_EQ(clock.setDateTime(dt), DS3231_ERR_NACK_ADDRESS);
+	rtc.setPresent(true);
+	CHECK_EQ(clock.setDateTime(dt), DS3231_OK);
+	CHECK_EQ(clock.setTime(dt.t), DS3231_OK);
+	CHECK_EQ(clock.setDate(dt.d), DS3231_OK);
+	CHECK_EQ(_clockSetCount(), sets + 4);
+	CHECK_EQ(journalCalls, 4);
+	setJournalHook(NULL);
+	CHECK_EQ(readEpoch(), 1700000000UL);
+	//A failed read gives the last good time & date, for both
+	rtc.setPresent(false);
+	CHECK_EQ(clock.readEpoch(), 1700000000UL);
+	CHECK_EQ(readEpoch(), 1700000000UL);
+	rtc.setPresent(true);
+}
+
+void testFixed(DS3231Sim &rtc) {
+	typedef DS3231Fixed<HourMode::H24> Clock;
+	DateTime dt;
+	rtc.setDateTime(2042, 7, 9, 13, 14, 15);
+	dt = Clock::readDateTime();
+	CHECK_EQ(ds3231LastError(), DS3231_OK);
+	CHECK_EQ(dt.d.year, 2042);
+	CHECK_EQ(dt.t.hour24, 13);
+	//Gone: the last good time & date, shared with the free functions
+	rtc.setPresent(false);
+	dt = Clock::readDateTime();
+	CHECK_EQ(ds3231LastError(), DS3231_ERR_NACK_ADDRESS);
+	CHECK_EQ(dt.d.year, 2042);
+	CHECK_EQ(dt.d.month, 7);
+	CHECK_EQ(dt.d.date, 9);
+	CHECK_EQ(dt.t.second, 15);
+	CHECK_EQ(Clock::readTime().hour24, 13);
+	CHECK_EQ(Clock::readTime().hour12, 1);
+	rtc.setPresent(true);
+	//Garbage on the bus (every retry): not decoded, the last good one again
+	rtc.poke(DS3231_DATE, 0x45);
+	dt = Clock::readDateTime();
+	CHECK_EQ(ds3231LastError(), DS3231_ERR_IMPLAUSIBLE);
+	CHECK_EQ(dt.d.date, 9);
+	rtc.poke(DS3231_DATE, 0x10);
+	CHECK_EQ(Clock::readDateTime().d.date, 10);
+	CHECK_EQ(readDateTime().d.date, 10);
+}
+
+int main(void) {
+	DS3231Sim rtc;
+	Wire.begin();
+	testControlUntouched(rtc);
+	testTurnAlarmOnHalfway(rtc);
+	testServiceAlarms(rtc);
+	testSetAlarm(rtc);
+	testCache(rtc);
+	testMulti(rtc);
+	testFixed(rtc);
+	return testResult();
+}
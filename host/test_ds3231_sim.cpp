@@ -0,0 +1,241 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/test_ds3231_sim.cpp                                              ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+//The simulated DS3231 itself: if it doesn't behave like the chip, the other tests
+//prove nothing. Raw register reads and writes only, no decoding by the library.
+#include <Arduino.h>
+#include <Wire.h>
+#include "DS3231_sim.h"
+#include "DS3231_tisc.h"
+#include "host_test.h"
+
+#define INT_PIN 2
+
+volatile uint8_t falls;
+void countFall(void) { falls++; }
+
+void testPowerUp(DS3231Sim &rtc) {
+	CHECK_EQ(rtc.reg(DS3231_CONTROL), 0x1c);
+	CHECK_EQ(rtc.reg(DS3231_STATUS), 0x88);
+	CHECK_EQ(rtc.reg(DS3231_DATE), 0x01);
+}
+
+void testAutoIncrement(DS3231Sim &rtc) {
+	uint8_t regs[4];
+	uint8_t year = 0x24;
+	rtc.setTemperature(-9);			//-2.25 C
+	rtc.poke(DS3231_TEMP_MSB, 0xfd);
+	rtc.poke(DS3231_TEMP_LSB, 0x40);
+	rtc.poke(DS3231_SECONDS, 0x42);
+	//0x11 and 0x12, then wraps to 0x00
+	CHECK_EQ(readRegisters(DS3231_TEMP_MSB, regs, 3), 3);
+	CHECK_EQ(regs[0], 0xfd);
+	CHECK_EQ(regs[1], 0x40);
+	CHECK_EQ(regs[2], 0x42);
+	//Writes auto-increment too, and can't touch the temperature
+	writeRegisters(DS3231_DEC_YEAR, &year, 1);
+	CHECK_EQ(rtc.reg(DS3231_DEC_YEAR), 0x24);
+	regs[0] = 0x00;
+	regs[1] = 0x00;
+	writeRegisters(DS3231_TEMP_MSB, regs, 2);
+	CHECK_EQ(rtc.reg(DS3231_TEMP_MSB), 0xfd);
+	//Bits that don't exist read 0
+	regs[0] = 0xff;
+	writeRegisters(DS3231_DAY, regs, 1);
+	CHECK_EQ(rtc.reg(DS3231_DAY), 0x07);
+}
+
+void testStatusBits(DS3231Sim &rtc) {
+	uint8_t data = 0xff;
+	rtc.poke(DS3231_STATUS, 0x80);
+	writeRegisters(DS3231_STATUS, &data, 1);		//can't set OSF/A1F/A2F or BSY
+	CHECK_EQ(rtc.reg(DS3231_STATUS), 0x88);
+	data = 0x00;
+	writeRegisters(DS3231_STATUS, &data, 1);
+	CHECK_EQ(rtc.reg(DS3231_STATUS), 0x00);
+}
+
+//Ticks from y-m-d h:m:s 24 hour for one second, checks the registers after
+void checkTick(DS3231Sim &rtc, uint16_t year, uint8_t month, uint8_t date, uint8_t hour, uint8_t minute, uint8_t second,
+		uint8_t expectDate, uint8_t expectMonthReg, uint8_t expectYear) {
+	rtc.setDateTime(year, month, date, hour, minute, second);
+	delay(1000);
+	CHECK_EQ(rtc.reg(DS3231_DATE), expectDate);
+	CHECK_EQ(rtc.reg(DS3231_CEN_MONTH), expectMonthReg);
+	CHECK_EQ(rtc.reg(DS3231_DEC_YEAR), expectYear);
+}
+
+void testCalendar(DS3231Sim &rtc) {
+	checkTick(rtc, 2024, 2, 28, 23, 59, 59, 0x29, 0x02, 0x24);	//leap year
+	checkTick(rtc, 2023, 2, 28, 23, 59, 59, 0x01, 0x03, 0x23);
+	checkTick(rtc, 2024, 4, 30, 23, 59, 59, 0x01, 0x05, 0x24);
+	checkTick(rtc, 2024, 12, 31, 23, 59, 59, 0x01, 0x01, 0x25);
+	checkTick(rtc, 2099, 12, 31, 23, 59, 59, 0x01, 0x81, 0x00);	//century bit
+	CHECK_EQ(rtc.reg(DS3231_HOURS), 0x00);
+	CHECK_EQ(rtc.reg(DS3231_DAY), 6);		//2100-01-01 is a Friday
+	checkTick(rtc, 2024, 3, 9, 12, 0, 0, 0x09, 0x03, 0x24);		//nothing rolls over
+	CHECK_EQ(rtc.reg(DS3231_SECONDS), 0x01);
+}
+
+void testTwelveHour(DS3231Sim &rtc) {
+	rtc.setDateTime(2024, 3, 9, 0, 59, 59);
+	rtc.poke(DS3231_HOURS, 0x40 | 0x20 | 0x11);	//11 PM
+	delay(1000);
+	CHECK_EQ(rtc.reg(DS3231_HOURS), 0x40 | 0x12);	//12 AM, next day
+	CHECK_EQ(rtc.reg(DS3231_DATE), 0x10);
+	rtc.poke(DS3231_HOURS, 0x40 | 0x11);			//11 AM
+	rtc.poke(DS3231_MINUTES, 0x59);
+	rtc.poke(DS3231_SECONDS, 0x59);
+	delay(1000);
+	CHECK_EQ(rtc.reg(DS3231_HOURS), 0x40 | 0x20 | 0x12);	//12 PM, same day
+	CHECK_EQ(rtc.reg(DS3231_DATE), 0x10);
+	rtc.poke(DS3231_MINUTES, 0x59);
+	rtc.poke(DS3231_SECONDS, 0x59);
+	delay(1000);
+	CHECK_EQ(rtc.reg(DS3231_HOURS), 0x40 | 0x20 | 0x01);	//1 PM
+}
+
+void testSecondRestart(DS3231Sim &rtc) {
+	uint8_t data = 0x10;
+	uint64_t written;
+	writeRegisters(DS3231_SECONDS, &data, 1);
+	written = hostNanos();
+	CHECK(rtc.nextTickNanos() > written + 999000000ULL);
+	CHECK(rtc.nextTickNanos() <= written + 1000000000ULL);
+	delay(999);
+	CHECK_EQ(rtc.reg(DS3231_SECONDS), 0x10);
+	delay(1);
+	CHECK_EQ(rtc.reg(DS3231_SECONDS), 0x11);
+}
+
+void testAlarms(DS3231Sim &rtc) {
+	uint8_t alarm1[4] = {0x05, 0x00, 0x07, 0x80};		//07:00:05 any day
+	uint8_t alarm2[3] = {0x80, 0x80, 0x80};				//every minute
+	uint8_t data;
+	rtc.connectInterruptPin(INT_PIN);
+	attachInterrupt(digitalPinToInterrupt(INT_PIN), countFall, FALLING);
+	falls = 0;
+	rtc.setDateTime(2024, 3, 9, 7, 0, 3);
+	writeRegisters(DS3231_ALARM1_SECONDS, alarm1, 4);
+	writeRegisters(DS3231_ALARM2_MINUTES, alarm2, 3);
+	data = 0x05;		//INTCN, A1IE
+	writeRegisters(DS3231_CONTROL, &data, 1);
+	data = 0;
+	writeRegisters(DS3231_STATUS, &data, 1);
+	delay(1000);
+	CHECK_EQ(rtc.reg(DS3231_STATUS) & 0x03, 0);
+	CHECK_EQ(digitalRead(INT_PIN), HIGH);
+	delay(1000);
+	CHECK_EQ(rtc.reg(DS3231_STATUS) & 0x03, 0x01);
+	CHECK_EQ(digitalRead(INT_PIN), LOW);
+	CHECK_EQ(falls, 1);
+	writeRegisters(DS3231_STATUS, &data, 1);
+	CHECK_EQ(digitalRead(INT_PIN), HIGH);
+	//Alarm 2 every minute: only at 00 seconds, and A2IE is off so the pin stays high
+	delay(54000);
+	CHECK_EQ(rtc.reg(DS3231_STATUS) & 0x03, 0);
+	delay(1000);
+	CHECK_EQ(rtc.reg(DS3231_SECONDS), 0x00);
+	CHECK_EQ(rtc.reg(DS3231_STATUS) & 0x03, 0x02);
+	CHECK_EQ(digitalRead(INT_PIN), HIGH);
+	//Alarm 1 on the weekday: Saturday is 7
+	alarm1[3] = 0x40 | 7;
+	writeRegisters(DS3231_ALARM1_SECONDS, alarm1, 4);
+	rtc.setDateTime(2024, 3, 16, 7, 0, 4);
+	writeRegisters(DS3231_STATUS, &data, 1);
+	delay(1000);
+	CHECK_EQ(rtc.reg(DS3231_STATUS) & 0x01, 0x01);
+	rtc.setDateTime(2024, 3, 17, 7, 0, 4);
+	writeRegisters(DS3231_STATUS, &data, 1);
+	delay(1000);
+	CHECK_EQ(rtc.reg(DS3231_STATUS) & 0x01, 0);
+	//12 hour alarm against a 24 hour clock
+	alarm1[2] = 0x40 | 0x20 | 0x07;		//7 PM
+	alarm1[3] = 0x80;
+	writeRegisters(DS3231_ALARM1_SECONDS, alarm1, 4);
+	rtc.setDateTime(2024, 3, 17, 19, 0, 4);
+	delay(1000);
+	CHECK_EQ(rtc.reg(DS3231_STATUS) & 0x01, 0x01);
+	detachInterrupt(digitalPinToInterrupt(INT_PIN));
+}
+
+void testSquareWave(DS3231Sim &rtc) {
+	uint8_t data = 0x00;		//INTCN clear, 1 Hz
+	rtc.connectInterruptPin(INT_PIN);
+	attachInterrupt(digitalPinToInterrupt(INT_PIN), countFall, FALLING);
+	writeRegisters(DS3231_CONTROL, &data, 1);
+	falls = 0;
+	delay(10000);
+	CHECK_EQ(falls, 10);
+	//Falls as the seconds tick over, not before
+	hostAdvanceNanos(rtc.nextTickNanos() - hostNanos() - 1000);
+	CHECK_EQ(falls, 10);
+	hostAdvanceNanos(2000);
+	CHECK_EQ(falls, 11);
+	CHECK_EQ(digitalRead(INT_PIN), LOW);
+	delay(500);
+	CHECK_EQ(digitalRead(INT_PIN), HIGH);
+	detachInterrupt(digitalPinToInterrupt(INT_PIN));
+	data = 0x1c;
+	writeRegisters(DS3231_CONTROL, &data, 1);
+}
+
+void testConversion(DS3231Sim &rtc) {
+	uint8_t data;
+	uint8_t regs[2];
+	rtc.setTemperature(4 * 31 + 3);		//31.75 C
+	data = rtc.reg(DS3231_CONTROL) | 0x20;
+	writeRegisters(DS3231_CONTROL, &data, 1);
+	CHECK(rtc.reg(DS3231_STATUS) & 0x04);
+	delay(DS3231_SIM_CONVERSION_MICROS / 1000 + 1);
+	CHECK_EQ(rtc.reg(DS3231_STATUS) & 0x04, 0);
+	CHECK_EQ(rtc.reg(DS3231_CONTROL) & 0x20, 0);
+	readRegisters(DS3231_TEMP_MSB, regs, 2);
+	CHECK_EQ(regs[0], 31);
+	CHECK_EQ(regs[1], 0xc0);
+}
+
+void testDrift(DS3231Sim &rtc) {
+	uint32_t ticks;
+	int8_t offset = 50;		//5 ppm slower
+	rtc.setDriftPpm(20);
+	rtc.setDateTime(2024, 3, 9, 12, 0, 0);
+	ticks = rtc.ticks();
+	delay(100000000UL + 500);		//10^5 s: 20 ppm is 2 s more
+	CHECK_EQ(rtc.ticks() - ticks, 100002);
+	writeRegisters(DS3231_AGING_OFFSET, (uint8_t *)&offset, 1);
+	delay(DS3231_SIM_AUTO_SECONDS * 1000UL);	//applied at the next conversion
+	CHECK(fabs(rtc.ppm() - 15) < 1e-9);
+	rtc.setDriftPpm(0);
+	offset = 0;
+	writeRegisters(DS3231_AGING_OFFSET, (uint8_t *)&offset, 1);
+	delay(DS3231_SIM_AUTO_SECONDS * 1000UL);
+}
+
+void testAbsent(DS3231Sim &rtc) {
+	uint8_t regs[2];
+	rtc.setPresent(false);
+	CHECK_EQ(readRegisters(DS3231_SECONDS, regs, 2), 0);
+	CHECK_EQ(ds3231LastError(), DS3231_ERR_NACK_ADDRESS);
+	rtc.setPresent(true);
+	CHECK_EQ(readRegisters(DS3231_SECONDS, regs, 2), 2);
+}
+
+int main(void) {
+	DS3231Sim rtc;
+	Wire.begin();
+	testPowerUp(rtc);
+	testAutoIncrement(rtc);
+	testStatusBits(rtc);
+	testCalendar(rtc);
+	testTwelveHour(rtc);
+	testSecondRestart(rtc);
+	testAlarms(rtc);
+	testSquareWave(rtc);
+	testConversion(rtc);
+	testDrift(rtc);
+	testAbsent(rtc);
+	return testResult();
+}
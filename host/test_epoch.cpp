@@ -0,0 +1,133 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/test_epoch.cpp                                                   ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+//The calendar math against the C library's gmtime(), every day from 2000 to 2199 at a
+//different time of day each: epochToDateTime(), the batch one, dateTimeToEpoch(), and
+//setEpoch()/readEpoch() and setDateTime()/readDateTime() through the simulated DS3231,
+//century bit included. Past 2106-02-07 a uint32_t Unix time runs out, from there on
+//it's days and DateTimes only.
+#include <Arduino.h>
+#include <Wire.h>
+#include <time.h>
+#include "DS3231_sim.h"
+#include "DS3231_tisc.h"
+#include "host_test.h"
+
+#define DAYS 73049UL			//2000-01-01 to 2199-12-31
+#define EPOCH_DAYS 38754UL		//2000-01-01 to 2106-02-07, the last day a uint32_t reaches
+
+DateTime expected[DAYS];
+uint32_t epochs[EPOCH_DAYS];
+DateTime batch[EPOCH_DAYS];
+
+//Seconds into day d, a different time of day each day. The last day stops where a
+//uint32_t does, 06:28:15
+uint32_t timeOfDay(uint32_t day) {
+	return day == EPOCH_DAYS - 1 ? 23295 : day * 7919UL % 86400UL;
+}
+//What gmtime() makes of Unix time t, as a DateTime
+DateTime fromGmtime(time_t t) {
+	struct tm tm;
+	DateTime dt;
+	gmtime_r(&t, &tm);
+	dt.d.year = tm.tm_year + 1900;
+	dt.d.month = tm.tm_mon + 1;
+	dt.d.date = tm.tm_mday;
+	dt.d.weekday = tm.tm_wday + 1;
+	dt.t.hour24 = tm.tm_hour;
+	dt.t.hour12 = tm.tm_hour % 12 ? tm.tm_hour % 12 : 12;
+	dt.t.pm = tm.tm_hour >= 12;
+	dt.t.minute = tm.tm_min;
+	dt.t.second = tm.tm_sec;
+	return dt;
+}
+bool sameDate(Date a, Date b) {
+	return a.year == b.year && a.month == b.month && a.date == b.date && a.weekday == b.weekday;
+}
+bool same(DateTime a, DateTime b) {
+	return sameDate(a.d, b.d) && a.t.hour24 == b.t.hour24 && a.t.hour12 == b.t.hour12
+		&& a.t.pm == b.t.pm && a.t.minute == b.t.minute && a.t.second == b.t.second;
+}
+
+void testGmtime(void) {
+	uint32_t day;
+	uint32_t bad = 0;
+	CHECK_EQ(sizeof(time_t), 8);		//gmtime() has to get past 2106 itself
+	for(day = 0; day < DAYS; day++) {
+		expected[day] = fromGmtime((time_t)DS3231_UNIX_2000 + day * 86400LL + timeOfDay(day));
+		bad += !sameDate(_civilFromDays(day), expected[day].d);
+		bad += _daysFromCivil(expected[day].d.year, expected[day].d.month, expected[day].d.date) != day;
+		bad += weekdayOf(expected[day].d.year, expected[day].d.month, expected[day].d.date) != expected[day].d.weekday;
+		if(day < EPOCH_DAYS) {
+			epochs[day] = DS3231_UNIX_2000 + day * 86400UL + timeOfDay(day);
+			bad += !same(epochToDateTime(epochs[day]), expected[day]);
+			bad += dateTimeToEpoch(expected[day]) != epochs[day];
+		}
+	}
+	CHECK_EQ(bad, 0);
+	CHECK_EQ(epochs[EPOCH_DAYS - 1], 0xffffffffUL);
+	CHECK_EQ(expected[DAYS - 1].d.year, 2199);
+	CHECK_EQ(expected[DAYS - 1].d.month, 12);
+	CHECK_EQ(expected[DAYS - 1].d.date, 31);
+}
+
+//All of them in one call, and in odd sized calls so every pass's spare lanes get used
+void testBatch(void) {
+	static const uint16_t sizes[] = {1, 3, 63, 64, 65, 1000};
+	uint32_t i;
+	uint32_t bad = 0;
+	uint32_t done;
+	uint32_t size;
+	uint8_t s = 0;
+	epochToDateTime(epochs, batch, EPOCH_DAYS);
+	for(i = 0; i < EPOCH_DAYS; i++)
+		bad += !same(batch[i], expected[i]);
+	memset(batch, 0, sizeof(batch));
+	for(done = 0; done < EPOCH_DAYS; done += size) {
+		size = sizes[s++ % (sizeof(sizes) / sizeof(sizes[0]))];
+		if(size > EPOCH_DAYS - done)
+			size = EPOCH_DAYS - done;
+		epochToDateTime(epochs + done, batch + done, size);
+	}
+	for(i = 0; i < EPOCH_DAYS; i++)
+		bad += !same(batch[i], expected[i]);
+	CHECK_EQ(bad, 0);
+	//Before 2000 is 2000-01-01 00:00:00, as epochToDateTime(epoch)
+	epochs[0] = 0;
+	epochs[1] = DS3231_UNIX_2000 - 1;
+	epochToDateTime(epochs, batch, 2);
+	CHECK(same(batch[0], fromGmtime(DS3231_UNIX_2000)));
+	CHECK(same(batch[1], fromGmtime(DS3231_UNIX_2000)));
+	epochs[0] = DS3231_UNIX_2000 + timeOfDay(0);
+	epochs[1] = DS3231_UNIX_2000 + 86400UL + timeOfDay(1);
+}
+
+//Through the chip: Unix time while it lasts, DateTimes after. 2100-2199 is the
+//century bit and 00-99 in the year register
+void testOnChip(DS3231Sim &rtc) {
+	uint32_t day;
+	uint32_t bad = 0;
+	for(day = 0; day < DAYS; day++) {
+		if(day < EPOCH_DAYS) {
+			setEpoch(epochs[day]);
+			bad += readEpoch() != epochs[day];
+		} else
+			setDateTime(expected[day]);
+		bad += !same(readDateTime(), expected[day]);
+		bad += !sameDate(readDate(), expected[day].d);
+		bad += (rtc.reg(DS3231_CEN_MONTH) >> 7) != (expected[day].d.year >= 2100);
+		bad += rtc.reg(DS3231_DEC_YEAR) != bcdEncode(expected[day].d.year % 100);
+	}
+	CHECK_EQ(bad, 0);
+}
+
+int main(void) {
+	DS3231Sim rtc;
+	Wire.begin();
+	testGmtime();
+	testBatch();
+	testOnChip(rtc);
+	return testResult();
+}
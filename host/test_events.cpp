@@ -0,0 +1,162 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/test_events.cpp                                                  ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+//The alarm event ring: alarmEventISR() and serviceAlarms(events, maxEvents). More
+//interrupts than the ring holds between drains are counted as overflows and show up
+//as a gap in the sequence numbers, drains a few at a time carry on round the end of
+//the ring with the flags they found, and each event's latency is interrupt to service.
+#include <Arduino.h>
+#include <Wire.h>
+#include "DS3231_sim.h"
+#include "DS3231_tisc.h"
+#include "host_test.h"
+
+#define INT_PIN 2
+#define RING_HOLDS (DS3231_EVENT_QUEUE_SIZE - 1)
+#define STAMP_MICROS (HOST_CALL_NANOS / 1000)	//the ISR's micros() call
+
+//n interrupts, gapMicros apart
+void fire(uint8_t n, uint32_t gapMicros) {
+	while(n--) {
+		alarmEventISR();
+		delayMicroseconds(gapMicros);
+	}
+}
+
+//No interrupts, nothing to do - not even a bus transaction
+void testNothingQueued(void) {
+	AlarmEvent events[4];
+	uint32_t transactions = Wire.traffic().transactions;
+	CHECK_EQ(alarmEventsPending(), 0);
+	CHECK_EQ(serviceAlarms(events, 4), 0);
+	CHECK_EQ(Wire.traffic().transactions, transactions);
+}
+
+//Latency is from each interrupt to the one moment serviceAlarms() took them all
+void testLatency(DS3231Sim &rtc) {
+	AlarmEvent events[4];
+	AlarmEventStats stats;
+	rtc.poke(DS3231_STATUS, rtc.reg(DS3231_STATUS) | 0x01);
+	fire(1, 5000);
+	fire(1, 2000);
+	CHECK_EQ(alarmEventsPending(), 2);
+	CHECK_EQ(serviceAlarms(events, 4), 2);
+	CHECK_EQ(events[1].sequence, events[0].sequence + 1);
+	CHECK_EQ(events[1].micros - events[0].micros, 5000 + STAMP_MICROS);
+	CHECK_EQ(events[0].latencyMicros - events[1].latencyMicros, 5000 + STAMP_MICROS);
+	CHECK(events[1].latencyMicros >= 2000 && events[1].latencyMicros < 4000);	//+ STATUS read and cleared at 100 kHz
+	CHECK_EQ(events[0].alarms, 0x01);
+	CHECK_EQ(events[1].alarms, 0x01);
+	CHECK_EQ(rtc.reg(DS3231_STATUS) & 0x03, 0);
+	stats = getAlarmEventStats();
+	CHECK_EQ(stats.lastLatencyMicros, events[1].latencyMicros);
+	CHECK(stats.maxLatencyMicros >= events[0].latencyMicros);
+	CHECK_EQ(alarmEventsPending(), 0);
+}
+
+//Three more than the ring holds: the three newest are dropped, counted, and the
+//next event's sequence number jumps by three
+void testOverflow(DS3231Sim &rtc) {
+	AlarmEvent events[DS3231_EVENT_QUEUE_SIZE * 2];
+	uint16_t overflows = getAlarmEventStats().overflows;
+	uint32_t served = getAlarmEventStats().events;
+	uint8_t i;
+	rtc.poke(DS3231_STATUS, rtc.reg(DS3231_STATUS) | 0x02);
+	fire(RING_HOLDS + 3, 100);
+	CHECK_EQ(alarmEventsPending(), RING_HOLDS);
+	CHECK_EQ(getAlarmEventStats().overflows - overflows, 3);
+	CHECK_EQ(serviceAlarms(events, DS3231_EVENT_QUEUE_SIZE * 2), RING_HOLDS);
+	for(i = 1; i < RING_HOLDS; i++) {
+		CHECK_EQ(events[i].sequence, events[0].sequence + i);
+		CHECK_EQ(events[i].micros - events[i - 1].micros, 100 + STAMP_MICROS);
+		CHECK_EQ(events[i].alarms, 0x02);
+	}
+	CHECK_EQ(getAlarmEventStats().events - served, RING_HOLDS);
+	fire(1, 0);
+	CHECK_EQ(serviceAlarms(events + RING_HOLDS, 1), 1);
+	CHECK_EQ(events[RING_HOLDS].sequence - events[RING_HOLDS - 1].sequence, 4);
+	CHECK_EQ(events[RING_HOLDS].alarms, 0);		//flags were cleared by the last drain
+	CHECK_EQ(alarmEventsPending(), 0);
+}
+
+//Drained two at a time, with more coming in part way, round the end of the ring
+//three times over. The flags are read (and cleared) once per batch of interrupts,
+//the events left queued get the same ones, and nothing's lost, repeated or reordered
+void testWrap(DS3231Sim &rtc) {
+	static const uint8_t flags[3] = {0x03, 0x02, 0x01};
+	AlarmEvent events[2];
+	uint32_t transactions;
+	uint32_t first = 0;
+	uint32_t next = 0;
+	uint8_t round;
+	uint8_t got;
+	uint8_t i;
+	for(round = 0; round < 3; round++) {
+		rtc.poke(DS3231_STATUS, (rtc.reg(DS3231_STATUS) & ~0x03) | flags[round]);
+		fire(5, 10);
+		got = serviceAlarms(events, 2);
+		CHECK_EQ(got, 2);
+		if(!first)
+			first = next = events[0].sequence;
+		fire(4, 10);				//come in while 3 are still queued
+		CHECK_EQ(alarmEventsPending(), 7);
+		CHECK_EQ(rtc.reg(DS3231_STATUS) & 0x03, 0);
+		do {
+			for(i = 0; i < got; i++) {
+				CHECK_EQ(events[i].sequence, next++);
+				CHECK_EQ(events[i].alarms, flags[round]);
+			}
+			transactions = Wire.traffic().transactions;
+			got = serviceAlarms(events, 2);
+			CHECK_EQ(Wire.traffic().transactions > transactions, got != 0);	//flags read again, unless there's nothing
+		} while(got);
+		CHECK_EQ(alarmEventsPending(), 0);
+	}
+	CHECK_EQ(next - first, 3 * 9);		//all of them, 27 through a ring of 8
+}
+
+//From the chip: alarm 1 every second, !INT/SQW on the pin, alarmEventISR() on its
+//falling edge. The pin stays low until the flag's cleared, so one event however
+//long it waits, and its latency is how long it waited
+void testOnChip(DS3231Sim &rtc) {
+	AlarmEvent events[4];
+	AlarmSetting a;
+	rtc.connectInterruptPin(INT_PIN);
+	attachInterrupt(digitalPinToInterrupt(INT_PIN), alarmEventISR, FALLING);
+	a.alarm_mask = ALARM1_EVERY_SECOND;
+	a.t.hour24 = 0;
+	a.t.hour12 = 12;
+	a.t.pm = false;
+	a.t.minute = 0;
+	a.t.second = 0;
+	a.date = 1;
+	a.weekday = 1;
+	setAlarm(a);
+	turnAlarmOn(1);
+	serviceAlarms();
+	delay(1000);
+	CHECK_EQ(alarmEventsPending(), 1);
+	delay(3000);
+	CHECK_EQ(alarmEventsPending(), 1);
+	CHECK_EQ(serviceAlarms(events, 4), 1);
+	CHECK_EQ(events[0].alarms, 0x01);
+	CHECK(events[0].latencyMicros >= 3000000UL && events[0].latencyMicros < 4001000UL);
+	delay(1000);
+	CHECK_EQ(serviceAlarms(events, 4), 1);
+	CHECK(events[0].latencyMicros < 1001000UL);
+	turnAlarmOff(1);
+	detachInterrupt(digitalPinToInterrupt(INT_PIN));
+}
+
+int main(void) {
+	DS3231Sim rtc;
+	Wire.begin();
+	testNothingQueued();
+	testLatency(rtc);
+	testOverflow(rtc);
+	testWrap(rtc);
+	testOnChip(rtc);
+	return testResult();
+}
@@ -0,0 +1,115 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/test_fixed.cpp                                                   ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+//DS3231Fixed: each mode writes and reads back the registers the chip uses for
+//it, and its setters tell the rest of the library the clock was set (journal,
+//tick clock) just as setTime()/setDateTime() do.
+#include <Arduino.h>
+#include <Wire.h>
+#include "DS3231_sim.h"
+#include "DS3231_tisc.h"
+#include "DS3231_fixed.h"
+#include "host_test.h"
+
+typedef DS3231Fixed<HourMode::H24> Clock24;
+typedef DS3231Fixed<HourMode::H12> Clock12;
+
+uint8_t journalEvent;
+uint8_t journalData;
+uint8_t journalCalls;
+void onJournal(uint8_t event, uint8_t data) {
+	journalEvent = event;
+	journalData = data;
+	journalCalls++;
+}
+
+DateTime makeDateTime(uint16_t year, uint8_t month, uint8_t date, uint8_t hour24, uint8_t minute, uint8_t second) {
+	DateTime dt;
+	dt.d.year = year;
+	dt.d.month = month;
+	dt.d.date = date;
+	dt.d.weekday = 0;
+	dt.t.hour24 = hour24;
+	dt.t.hour12 = hour24 % 12 ? hour24 % 12 : 12;
+	dt.t.pm = hour24 >= 12;
+	dt.t.minute = minute;
+	dt.t.second = second;
+	return dt;
+}
+
+void testTwentyFour(DS3231Sim &rtc) {
+	DateTime dt;
+	uint16_t sets = _clockSetCount();
+	journalCalls = 0;
+	Clock24::setDateTime(makeDateTime(2107, 12, 31, 23, 59, 58));
+	CHECK_EQ(journalCalls, 1);
+	CHECK_EQ(journalEvent, JOURNAL_SET_DATETIME);
+	CHECK_EQ(journalData, DS3231_OK);
+	CHECK_EQ(_clockSetCount(), (uint16_t)(sets + 1));
+	CHECK_EQ(rtc.reg(DS3231_HOURS), 0x23);
+	CHECK_EQ(rtc.reg(DS3231_CEN_MONTH), 0x92);
+	CHECK_EQ(rtc.reg(DS3231_DAY), weekdayOf(2107, 12, 31));
+	dt = Clock24::readDateTime();
+	CHECK_EQ(dt.d.year, 2107);
+	CHECK_EQ(dt.t.hour24, 23);
+	CHECK_EQ(dt.t.hour12, 11);		//the other mode's fields too
+	CHECK(dt.t.pm);
+	CHECK_EQ(Clock24::readTime().second, 58);
+}
+
+void testTwelve(DS3231Sim &rtc) {
+	Time t;
+	uint16_t sets = _clockSetCount();
+	journalCalls = 0;
+	Clock12::setTime(makeDateTime(2000, 1, 1, 0, 30, 0).t);	//12:30 AM
+	CHECK_EQ(journalCalls, 1);
+	CHECK_EQ(journalEvent, JOURNAL_SET_TIME);
+	CHECK_EQ(_clockSetCount(), (uint16_t)(sets + 1));
+	CHECK_EQ(rtc.reg(DS3231_HOURS), 0x52);		//12 hour, AM, 12
+	t = Clock12::readTime();
+	CHECK_EQ(t.hour12, 12);
+	CHECK(!t.pm);
+	CHECK_EQ(t.hour24, 0);
+	Clock12::setTime(makeDateTime(2000, 1, 1, 13, 0, 0).t);
+	CHECK_EQ(rtc.reg(DS3231_HOURS), 0x61);		//12 hour, PM, 1
+	t = Clock12::readTime();
+	CHECK_EQ(t.hour12, 1);
+	CHECK(t.pm);
+	CHECK_EQ(t.hour24, 13);
+	Clock12::setTime(makeDateTime(2000, 1, 1, 12, 0, 0).t);
+	CHECK_EQ(Clock12::readTime().hour24, 12);	//12 PM is noon
+}
+
+void testTickClockResyncs(void) {
+	DateTime now;
+	startTickClock(0);
+	tickClockService();
+	Clock24::setDateTime(makeDateTime(2040, 6, 15, 8, 0, 0));
+	tickClockService();			//picks up the new time straight away
+	now = tickClockNow();
+	CHECK_EQ(now.d.year, 2040);
+	CHECK_EQ(now.t.hour24, 8);
+	stopTickClock();
+}
+
+void testFailedWrite(DS3231Sim &rtc) {
+	journalCalls = 0;
+	rtc.setPresent(false);
+	CHECK_EQ(Clock24::setDateTime(makeDateTime(2030, 1, 1, 0, 0, 0)), DS3231_ERR_NACK_ADDRESS);
+	rtc.setPresent(true);
+	CHECK_EQ(journalCalls, 1);
+	CHECK_EQ(journalData, DS3231_ERR_NACK_ADDRESS);
+}
+
+int main(void) {
+	DS3231Sim rtc;
+	Wire.begin();
+	setJournalHook(onJournal);
+	testTwentyFour(rtc);
+	testTwelve(rtc);
+	testTickClockResyncs();
+	testFailedWrite(rtc);
+	return testResult();
+}
@@ -0,0 +1,170 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/test_journal.cpp                                                 ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+//The event journal against a simulated AT24C32 beside the simulated DS3231: what
+//the library's hook records, pages written whole and in one transaction, the write
+//cycle polled through rather than waited out, a torn page skipped, and the newest
+//page found again at startup - before and after the ring has gone round.
+#include <Arduino.h>
+#include <Wire.h>
+#include "DS3231_sim.h"
+#include "AT24C32_sim.h"
+#include "DS3231_tisc.h"
+#include "DS3231_journal.h"
+#include "host_test.h"
+
+#define EPOCH 1714564800UL		//2024-05-01 12:00:00, what the DS3231 is set to
+
+//The block of page n adds up to 0
+uint8_t pageSum(AT24C32Sim &eeprom, uint16_t page) {
+	uint8_t sum = 0;
+	uint8_t i;
+	for(i = 0; i < JOURNAL_BLOCK_BYTES; i++)
+		sum += eeprom.peek(page * JOURNAL_PAGE_BYTES + i);
+	return sum;
+}
+
+void checkRecord(uint16_t back, uint8_t event, uint8_t data) {
+	JournalRecord rec;
+	CHECK(journalRead(back, &rec));
+	CHECK_EQ(rec.event, event);
+	CHECK_EQ(rec.data, data);
+}
+
+void testNoEeprom(AT24C32Sim &eeprom) {
+	JournalRecord rec;
+	uint64_t start = hostNanos();
+	eeprom.setPresent(false);
+	CHECK(!journalBegin());
+	CHECK(hostNanos() - start >= JOURNAL_WRITE_MICROS * 1000ULL);	//gave it a write cycle's time
+	CHECK(!getJournalStats().present);
+	journalRecord(JOURNAL_USER, 1);
+	CHECK_EQ(getJournalStats().records, 0);
+	CHECK(!journalRead(0, &rec));
+	eeprom.setPresent(true);
+}
+
+//Erased EEPROM: page 0 fills with what the library hands the hook, and goes out
+//when it's full
+void testFirstPage(DS3231Sim &rtc, AT24C32Sim &eeprom) {
+	JournalRecord rec;
+	DateTime dt;
+	CHECK(journalBegin());
+	CHECK(getJournalStats().present);
+	CHECK_EQ(getJournalStats().head, 0);
+	CHECK_EQ(getJournalStats().buffered, 1);
+	CHECK(journalRead(0, &rec));
+	CHECK_EQ(rec.event, JOURNAL_START);
+	CHECK_EQ(rec.epoch, EPOCH);
+	dt = epochToDateTime(EPOCH + 3600);
+	setDateTime(dt);
+	CHECK(journalRead(0, &rec));
+	CHECK_EQ(rec.event, JOURNAL_SET_DATETIME);
+	CHECK_EQ(rec.data, DS3231_OK);
+	CHECK_EQ(rec.epoch, EPOCH + 3600);
+	rtc.poke(DS3231_STATUS, rtc.reg(DS3231_STATUS) | 0x01);		//A1F
+	CHECK_EQ(serviceAlarms(), 1);
+	checkRecord(0, JOURNAL_ALARM, 1);
+	CHECK_EQ(eeprom.writes(), 0);			//all in RAM so far
+	journalRecord(JOURNAL_USER, 7);			//4th: the page is full
+	CHECK_EQ(eeprom.writes(), 1);
+	CHECK_EQ(getJournalStats().pageWrites, 1);
+	CHECK_EQ(getJournalStats().head, 1);
+	CHECK_EQ(getJournalStats().sequence, 1);
+	CHECK_EQ(getJournalStats().buffered, 0);
+	CHECK_EQ(eeprom.peek(2), 4);			//count
+	CHECK_EQ(pageSum(eeprom, 0), 0);
+	CHECK_EQ(eeprom.peek(JOURNAL_BLOCK_BYTES), 0xff);	//the rest of the page isn't touched
+	checkRecord(0, JOURNAL_USER, 7);
+	checkRecord(1, JOURNAL_ALARM, 1);
+	checkRecord(2, JOURNAL_SET_DATETIME, DS3231_OK);
+	checkRecord(3, JOURNAL_START, 0);
+	CHECK(!journalRead(4, &rec));
+}
+
+//Straight after a write the EEPROM is busy: the next access polls for its ACK
+//instead of waiting the whole cycle out. Part-full pages go out after JOURNAL_FLUSH_MILLIS
+void testWriteCycle(AT24C32Sim &eeprom) {
+	JournalStats before;
+	uint64_t start;
+	journalRecord(JOURNAL_USER, 1);
+	CHECK(journalFlush());
+	CHECK(eeprom.busy());
+	before = getJournalStats();
+	journalRecord(JOURNAL_USER, 2);
+	start = hostNanos();
+	CHECK(journalFlush());				//page 1 again, with both
+	CHECK(getJournalStats().ackPolls > before.ackPolls);
+	CHECK(hostNanos() - start < JOURNAL_WRITE_MICROS * 1000ULL);	//less than a fixed delay would need
+	CHECK_EQ(eeprom.writes(), 3);
+	CHECK_EQ(eeprom.peek(JOURNAL_PAGE_BYTES + 2), 2);
+	journalRecord(JOURNAL_USER, 3);
+	delay(JOURNAL_FLUSH_MILLIS - 1);
+	journalService();
+	CHECK_EQ(eeprom.writes(), 3);
+	delay(1);
+	journalService();
+	CHECK_EQ(eeprom.writes(), 4);
+	CHECK_EQ(eeprom.peek(JOURNAL_PAGE_BYTES + 2), 3);
+	CHECK_EQ(pageSum(eeprom, 1), 0);
+}
+
+//A page write that loses its last byte (the check) leaves a page that doesn't add up.
+//At the next startup the journal carries on after the last good page
+void testTornPage(AT24C32Sim &eeprom) {
+	JournalStats stats;
+	delay(20);
+	Wire.failNext(1, WIRE_SHORT, 3);		//the time stamp's read (2) and the ACK poll get through, the page write doesn't
+	journalRecord(JOURNAL_USER, 4);		//fills page 1
+	CHECK_EQ(getJournalStats().failures, 1);
+	CHECK(pageSum(eeprom, 1) != 0);
+	CHECK(journalBegin());				//power cycle
+	stats = getJournalStats();
+	CHECK_EQ(stats.head, 1);				//page 0 was full, page 1 is torn: start page 1 again
+	CHECK_EQ(stats.sequence, 1);
+	checkRecord(0, JOURNAL_START, 0);
+	checkRecord(1, JOURNAL_USER, 7);		//page 0's newest
+}
+
+//Round the ring more than once, then start up again: the newest page is found by
+//its sequence number, and everything but the head page's lap-old contents is readable
+void testWrap(void) {
+	JournalRecord rec;
+	JournalStats before;
+	JournalStats after;
+	uint16_t total = JOURNAL_PAGES * JOURNAL_PAGE_RECORDS + 3 * JOURNAL_PAGE_RECORDS;
+	uint16_t i;
+	uint16_t readable = (JOURNAL_PAGES - 1) * JOURNAL_PAGE_RECORDS;
+	for(i = getJournalStats().buffered; i < JOURNAL_PAGE_RECORDS; i++)
+		journalRecord(JOURNAL_USER, 0xee);		//fill the head page, so the data below lines up with pages
+	for(i = 0; i < total; i++)
+		journalRecord(JOURNAL_USER + 1, i);
+	before = getJournalStats();
+	CHECK_EQ(before.buffered, 0);
+	CHECK_EQ(before.head, (1 + 1 + total / JOURNAL_PAGE_RECORDS) % JOURNAL_PAGES);
+	checkRecord(0, JOURNAL_USER + 1, (total - 1) & 0xff);
+	checkRecord(readable - 1, JOURNAL_USER + 1, (total - readable) & 0xff);
+	CHECK(!journalRead(readable, &rec));
+	CHECK(journalBegin());				//power cycle
+	after = getJournalStats();
+	CHECK_EQ(after.head, before.head);
+	CHECK_EQ(after.sequence, before.sequence);
+	checkRecord(0, JOURNAL_START, 0);
+	checkRecord(1, JOURNAL_USER + 1, (total - 1) & 0xff);
+	checkRecord(readable, JOURNAL_USER + 1, (total - readable) & 0xff);
+}
+
+int main(void) {
+	DS3231Sim rtc;
+	AT24C32Sim eeprom;
+	Wire.begin();
+	rtc.setDateTime(2024, 5, 1, 12, 0, 0);
+	testNoEeprom(eeprom);
+	testFirstPage(rtc, eeprom);
+	testWriteCycle(eeprom);
+	testTornPage(eeprom);
+	testWrap();
+	return testResult();
+}
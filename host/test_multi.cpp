@@ -0,0 +1,157 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/test_multi.cpp                                                   ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+//DS3231::pollAll() over simulated clocks on two channels of a simulated TCA9548A, one
+//on a bus of its own and one beside the mux: every reading is its own clock's, each
+//channel is opened once at most, and a clock that doesn't answer gives its last good
+//time & date without holding up the rest.
+#include <Arduino.h>
+#include <Wire.h>
+#include "DS3231_sim.h"
+#include "TCA9548A_sim.h"
+#include "DS3231_multi.h"
+#include "host_test.h"
+
+#define CLOCKS 6
+//A second chip on a channel, and the one beside the mux, can't really be DS3231s (they're
+//all 0x68) - these addresses stand in for "something else that answers"
+#define OTHER_ADDR 0x69
+#define BESIDE_ADDR 0x6a
+
+//Everything's made in main(), after Wire
+class Rig {
+	public:
+	Rig(void) : simA0(muxChip.channel(0)), simA1(muxChip.channel(0), OTHER_ADDR),
+		simB0(muxChip.channel(3)), simB1(muxChip.channel(3), OTHER_ADDR),
+		simC(wire1), simD(Wire, BESIDE_ADDR), bus1(wire1), mux(DS3231_Wire),
+		rtcA0(mux, 0), rtcA1(mux, 0, OTHER_ADDR), rtcB0(mux, 3), rtcB1(mux, 3, OTHER_ADDR),
+		rtcC(bus1), rtcD(DS3231_Wire, BESIDE_ADDR) {
+		DS3231Sim *s[CLOCKS] = {&simA0, &simB0, &simC, &simD, &simA1, &simB1};
+		DS3231 *c[CLOCKS] = {&rtcA0, &rtcB0, &rtcC, &rtcD, &rtcA1, &rtcB1};	//channels interleaved
+		memcpy(sims, s, sizeof(sims));
+		memcpy(clocks, c, sizeof(clocks));
+	}
+	TwoWire wire1;
+	TCA9548ASim muxChip;
+	DS3231Sim simA0, simA1, simB0, simB1, simC, simD;
+	TwoWireTransport bus1;
+	DS3231Mux mux;
+	DS3231 rtcA0, rtcA1, rtcB0, rtcB1, rtcC, rtcD;
+	DS3231Sim *sims[CLOCKS];
+	DS3231 *clocks[CLOCKS];		//in an order pollAll() has to sort out
+};
+
+//Sets clock i to a time & date of its own, i days and i hours on from the first's
+void setClocks(Rig &r) {
+	uint8_t i;
+	for(i = 0; i < CLOCKS; i++)
+		r.sims[i]->setDateTime(2024, 5, 10 + i, 8 + i, 30, 15);
+}
+bool isClock(DateTime dt, uint8_t i) {
+	return dt.d.year == 2024 && dt.d.month == 5 && dt.d.date == 10 + i
+		&& dt.t.hour24 == 8 + i && dt.t.minute == 30 && dt.t.second == 15;
+}
+
+//From power up: the clocks beside the mux and on their own bus first, then channel 0
+//once and channel 3 once, whatever order the array has them in
+void testFirstPoll(Rig &r) {
+	DS3231Reading readings[CLOCKS];
+	uint8_t i;
+	setClocks(r);
+	CHECK_EQ(DS3231::pollAll(r.clocks, CLOCKS, readings), CLOCKS);
+	for(i = 0; i < CLOCKS; i++) {
+		CHECK(readings[i].ok);
+		CHECK(isClock(readings[i].dt, i));
+		CHECK_EQ(r.clocks[i]->lastError(), DS3231_OK);
+	}
+	CHECK_EQ(r.mux.switches, 2);
+	CHECK_EQ(r.muxChip.writes(), 2);
+	CHECK_EQ(r.muxChip.collisions(), 0);
+	CHECK_EQ(r.mux.selected(), 3);
+	//rtcC and rtcD were read before any channel was opened, the rest after
+	CHECK(readings[2].micros <= readings[0].micros && readings[3].micros <= readings[0].micros);
+	CHECK(readings[0].micros <= readings[4].micros && readings[4].micros <= readings[1].micros);
+}
+
+//Channel 3 is still open: its clocks are read without a write to the mux, then channel
+//0 is opened, then closed again for the clock beside the mux
+void testOpenChannelFirst(Rig &r) {
+	DS3231Reading readings[CLOCKS];
+	uint32_t switches = r.mux.switches;
+	uint8_t i;
+	setClocks(r);
+	CHECK_EQ(DS3231::pollAll(r.clocks, CLOCKS, readings), CLOCKS);
+	for(i = 0; i < CLOCKS; i++) {
+		CHECK(readings[i].ok);
+		CHECK(isClock(readings[i].dt, i));
+	}
+	CHECK_EQ(r.mux.switches - switches, 1);
+	CHECK_EQ(r.muxChip.writes(), 4);		//channel 0, then all closed for rtcD
+	CHECK_EQ(r.muxChip.collisions(), 0);
+	CHECK_EQ(r.muxChip.control(), 0);
+	CHECK(readings[1].micros <= readings[0].micros && readings[5].micros <= readings[0].micros);
+	//Nothing open, nothing to do: a poll of one channel's clocks opens it once
+	DS3231 *pair[2] = {&r.rtcB1, &r.rtcB0};
+	switches = r.mux.switches;
+	CHECK_EQ(DS3231::pollAll(pair, 2, readings), 2);
+	CHECK(isClock(readings[0].dt, 5) && isClock(readings[1].dt, 1));
+	CHECK_EQ(r.mux.switches - switches, 1);
+}
+
+//A clock that's gone gives its last good time & date, not zeros or the next clock's,
+//and the others are read as usual
+void testMissingClock(Rig &r) {
+	DS3231Reading readings[CLOCKS];
+	uint32_t switches;
+	uint8_t i;
+	setClocks(r);
+	DS3231::pollAll(r.clocks, CLOCKS, readings);
+	r.simA1.setDateTime(2030, 1, 1, 0, 0, 0);		//not read, it's gone
+	r.simA1.setPresent(false);
+	switches = r.mux.switches;
+	CHECK_EQ(DS3231::pollAll(r.clocks, CLOCKS, readings), CLOCKS - 1);
+	for(i = 0; i < CLOCKS; i++) {
+		CHECK_EQ(readings[i].ok, i != 4);
+		CHECK(isClock(readings[i].dt, i));
+	}
+	CHECK_EQ(r.rtcA1.lastError(), DS3231_ERR_NACK_ADDRESS);
+	CHECK_EQ(r.rtcA0.lastError(), DS3231_OK);
+	CHECK(r.mux.switches - switches <= 2);
+	r.simA1.setPresent(true);
+}
+
+//The mux stops answering: clocks on the channel it left open still read, those on
+//the other channel fail at the channel select and keep their last good time & date
+void testMissingMux(Rig &r) {
+	DS3231Reading readings[CLOCKS];
+	DS3231 *pair[2] = {&r.rtcA0, &r.rtcA1};
+	uint8_t i;
+	setClocks(r);
+	DS3231::pollAll(r.clocks, CLOCKS, readings);
+	DS3231::pollAll(pair, 2, readings);		//leaves channel 0 open
+	CHECK_EQ(r.muxChip.control(), 0x01);
+	r.muxChip.setPresent(false);
+	CHECK_EQ(DS3231::pollAll(r.clocks, CLOCKS, readings), CLOCKS - 2);
+	for(i = 0; i < CLOCKS; i++) {
+		CHECK_EQ(readings[i].ok, i != 1 && i != 5);
+		CHECK(isClock(readings[i].dt, i));
+	}
+	CHECK_EQ(r.rtcB0.lastError(), DS3231_ERR_NACK_ADDRESS);
+	CHECK_EQ(r.rtcB1.lastError(), DS3231_ERR_NACK_ADDRESS);
+	CHECK_EQ(r.muxChip.collisions(), 0);
+	r.muxChip.setPresent(true);
+	r.mux.invalidate();
+}
+
+int main(void) {
+	Rig r;
+	Wire.begin();
+	r.wire1.begin();
+	testFirstPoll(r);
+	testOpenChannelFirst(r);
+	testMissingClock(r);
+	testMissingMux(r);
+	return testResult();
+}
@@ -0,0 +1,202 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/test_schedule.cpp                                                ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+//The alarm scheduler, driven by the simulated DS3231's Alarm 1: schedules fire
+//in time order, cancelling reprograms the alarm, weekly/monthly/one-shot work
+//out the right next time, and scheduleEnd() really empties the schedule.
+#include <Arduino.h>
+#include <Wire.h>
+#include "DS3231_sim.h"
+#include "DS3231_tisc.h"
+#include "DS3231_schedule.h"
+#include "host_test.h"
+
+uint8_t fired[16];
+uint8_t firedCount;
+void onSchedule(uint8_t id) {
+	if(firedCount < sizeof(fired))
+		fired[firedCount++] = id;
+}
+
+//Lets the clock run, servicing the alarms once a second like loop() would
+void runSeconds(uint16_t seconds) {
+	while(seconds--) {
+		delay(1000);
+		serviceAlarms();
+	}
+}
+
+ScheduleEntry entry(uint8_t kind, uint8_t hour, uint8_t minute, uint8_t second) {
+	ScheduleEntry e;
+	e.kind = kind;
+	e.t.hour24 = hour;
+	e.t.hour12 = 0;
+	e.t.pm = false;
+	e.t.minute = minute;
+	e.t.second = second;
+	e.d.year = 0;
+	e.d.month = 0;
+	e.d.date = 0;
+	e.d.weekday = 0;
+	e.weekdays = 0;
+	return e;
+}
+
+ScheduleEntry once(uint16_t year, uint8_t month, uint8_t date, uint8_t hour, uint8_t minute, uint8_t second) {
+	ScheduleEntry e = entry(SCHEDULE_ONCE, hour, minute, second);
+	e.d.year = year;
+	e.d.month = month;
+	e.d.date = date;
+	return e;
+}
+
+void testNeverBegun(void) {
+	ScheduleEntry e;
+	CHECK(!scheduleCancel(0));		//nothing to underflow
+	CHECK(!scheduleGet(0, &e));
+	CHECK_EQ(scheduleCount(), 0);
+}
+
+void testOrdering(DS3231Sim &rtc) {
+	uint8_t late, daily, early, id;
+	DateTime when;
+	rtc.setDateTime(2024, 1, 1, 0, 0, 0);
+	scheduleBegin(onSchedule);
+	firedCount = 0;
+	late = scheduleAdd(once(2024, 1, 1, 0, 0, 10));
+	daily = scheduleAdd(entry(SCHEDULE_DAILY, 0, 0, 5));
+	early = scheduleAdd(once(2024, 1, 1, 0, 0, 7));
+	CHECK_EQ(late, 0);
+	CHECK_EQ(scheduleCount(), 3);
+	CHECK(scheduleNextDue(&id, &when));
+	CHECK_EQ(id, daily);
+	CHECK_EQ(rtc.reg(DS3231_ALARM1_SECONDS), 0x05);
+	CHECK_EQ(rtc.reg(DS3231_CONTROL) & 0x01, 0x01);
+	runSeconds(12);
+	CHECK_EQ(firedCount, 3);
+	CHECK_EQ(fired[0], daily);
+	CHECK_EQ(fired[1], early);
+	CHECK_EQ(fired[2], late);
+	//The daily one is back for tomorrow, the one-shots are gone
+	CHECK_EQ(scheduleCount(), 1);
+	CHECK(scheduleNextDue(&id, &when));
+	CHECK_EQ(id, daily);
+	CHECK_EQ(when.d.date, 2);
+	CHECK_EQ(when.t.second, 5);
+	CHECK_EQ(rtc.reg(DS3231_ALARM1_DAY_DATE), 0x02);
+	scheduleEnd();
+}
+
+void testCancel(DS3231Sim &rtc) {
+	uint8_t a, b, c, id;
+	DateTime when;
+	rtc.setDateTime(2024, 1, 1, 12, 0, 0);
+	scheduleBegin(onSchedule);
+	firedCount = 0;
+	a = scheduleAdd(once(2024, 1, 1, 12, 0, 3));
+	b = scheduleAdd(once(2024, 1, 1, 12, 0, 6));
+	c = scheduleAdd(once(2024, 1, 1, 12, 0, 9));
+	CHECK(scheduleCancel(a));		//the one in Alarm 1...
+	CHECK(!scheduleCancel(a));
+	CHECK(!scheduleCancel(DS3231_SCHEDULE_SIZE));
+	CHECK(scheduleNextDue(&id, &when));
+	CHECK_EQ(id, b);
+	CHECK_EQ(rtc.reg(DS3231_ALARM1_SECONDS), 0x06);	//...is replaced by the next
+	CHECK(scheduleCancel(c));
+	runSeconds(10);
+	CHECK_EQ(firedCount, 1);
+	CHECK_EQ(fired[0], b);
+	CHECK_EQ(scheduleCount(), 0);
+	CHECK_EQ(rtc.reg(DS3231_CONTROL) & 0x01, 0x00);	//nothing left, Alarm 1 off
+	CHECK_EQ(scheduleAdd(once(2024, 1, 1, 12, 1, 0)), b);	//freed ids are handed out again, last freed first
+	scheduleEnd();
+}
+
+void testWeeklyAndOnce(DS3231Sim &rtc) {
+	ScheduleEntry e;
+	ScheduleEntry got;
+	uint8_t weekly, monthly, id;
+	DateTime when;
+	rtc.setDateTime(2024, 1, 1, 9, 0, 0);	//a Monday
+	scheduleBegin(onSchedule);
+	firedCount = 0;
+	//Won't ever fire
+	CHECK_EQ(scheduleAdd(once(2023, 12, 31, 9, 0, 0)), SCHEDULE_NONE);
+	CHECK_EQ(scheduleAdd(once(2024, 1, 1, 9, 0, 0)), SCHEDULE_NONE);		//now isn't after now
+	CHECK_EQ(scheduleAdd(entry(SCHEDULE_WEEKLY, 8, 0, 0)), SCHEDULE_NONE);	//no weekdays
+	//Weekends at 08:00 - Saturday the 6th first
+	e = entry(SCHEDULE_WEEKLY, 8, 0, 0);
+	e.weekdays = WEEKDAYS_WEEKEND;
+	weekly = scheduleAdd(e);
+	CHECK(scheduleNextDue(&id, &when));
+	CHECK_EQ(id, weekly);
+	CHECK_EQ(when.d.date, 6);
+	CHECK_EQ(when.t.hour24, 8);
+	//The 31st at 07:00 - not in February, so March
+	rtc.setDateTime(2024, 1, 31, 9, 0, 0);
+	e = entry(SCHEDULE_MONTHLY, 7, 0, 0);
+	e.d.date = 31;
+	monthly = scheduleAdd(e);
+	CHECK(scheduleGet(monthly, &got));
+	CHECK_EQ(got.kind, SCHEDULE_MONTHLY);
+	CHECK_EQ(got.d.date, 31);
+	CHECK(!scheduleGet(SCHEDULE_NONE, &got));
+	scheduleCancel(weekly);
+	CHECK(!scheduleGet(weekly, &got));
+	CHECK_EQ(got.kind, SCHEDULE_MONTHLY);		//left alone
+	CHECK(scheduleNextDue(&id, &when));
+	CHECK_EQ(when.d.month, 3);
+	CHECK_EQ(when.d.date, 31);
+	scheduleCancel(monthly);
+	//A weekend firing, then on to Sunday
+	rtc.setDateTime(2024, 1, 6, 7, 59, 58);
+	e = entry(SCHEDULE_WEEKLY, 8, 0, 0);
+	e.weekdays = WEEKDAYS_WEEKEND;
+	weekly = scheduleAdd(e);
+	runSeconds(3);
+	CHECK_EQ(firedCount, 1);
+	CHECK_EQ(fired[0], weekly);
+	CHECK(scheduleNextDue(&id, &when));
+	CHECK_EQ(when.d.date, 7);
+	CHECK_EQ(when.d.weekday, 1);
+	scheduleEnd();
+}
+
+void testEndThenCancel(DS3231Sim &rtc) {
+	uint8_t a, b;
+	rtc.setDateTime(2024, 1, 1, 0, 0, 0);
+	scheduleBegin(onSchedule);
+	a = scheduleAdd(once(2024, 1, 1, 0, 0, 3));
+	b = scheduleAdd(entry(SCHEDULE_DAILY, 6, 0, 0));
+	scheduleEnd();
+	CHECK_EQ(scheduleCount(), 0);
+	CHECK(!scheduleCancel(a));
+	CHECK(!scheduleCancel(b));
+	CHECK_EQ(scheduleCount(), 0);
+	CHECK_EQ(rtc.reg(DS3231_CONTROL) & 0x01, 0x00);
+	//Alarm 1 is the caller's again
+	turnAlarmOn(1);
+	firedCount = 0;
+	delay(3000);
+	CHECK_EQ(serviceAlarms() & 0x01, 0x01);
+	CHECK_EQ(firedCount, 0);
+	turnAlarmOff(1);
+	//and the next scheduleBegin() starts from scratch
+	scheduleBegin(onSchedule);
+	CHECK_EQ(scheduleAdd(once(2024, 1, 1, 1, 0, 0)), 0);
+	CHECK_EQ(scheduleCount(), 1);
+	scheduleEnd();
+}
+
+int main(void) {
+	DS3231Sim rtc;
+	Wire.begin();
+	testNeverBegun();
+	testOrdering(rtc);
+	testCancel(rtc);
+	testWeeklyAndOnce(rtc);
+	testEndThenCancel(rtc);
+	return testResult();
+}
@@ -0,0 +1,131 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/test_sync.cpp                                                    ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+//Serial sync over a pty loopback: the computer's side (sync_host.cpp, what
+//ds3231_sync uses) on the pty's slave, syncFromHost() on its master, setting the
+//simulated DS3231. The time the SET carries is made up, the device runs on the
+//simulated clock, so the seconds edge can be checked to the us.
+#include <Arduino.h>
+#include <Wire.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "DS3231_sim.h"
+#include "DS3231_tisc.h"
+#include "DS3231_sync.h"
+#include "sync_host.h"
+#include "pty_stream.h"
+#include "host_test.h"
+
+#define EPOCH 1700000000UL		//2023-11-14 22:13:20
+
+//Runs syncFromHost() like loop() would, stepUs apart, until it finishes something
+uint8_t device(Stream &port, uint32_t stepUs) {
+	uint8_t result;
+	while((result = syncFromHost(port)) == SYNC_NONE || result == SYNC_WAITING)
+		hostAdvance(stepUs);
+	return result;
+}
+
+//SET at millisPart, the device loop stepUs apart. Checks where the DS3231's
+//seconds edge landed against the boundary, and that the device reported that
+void checkSet(DS3231Sim &rtc, int fd, Stream &port, uint16_t millisPart, uint32_t stepUs,
+		int32_t minLate, int32_t maxLate) {
+	SyncHostReply reply;
+	uint64_t target;
+	int64_t edge;
+	syncHostSendTime(fd, SYNC_MSG_SET, EPOCH * 1000000ULL + millisPart * 1000ULL);
+	target = hostNanos() + (1000 - millisPart) * 1000000ULL;
+	CHECK_EQ(device(port, stepUs), SYNC_SET_DONE);
+	edge = (int64_t)(rtc.nextTickNanos() - 1000000000ULL - target) / 1000;
+	CHECK(syncHostReceive(fd, &reply, 1000));
+	CHECK_EQ(reply.type, SYNC_MSG_SET_DONE);
+	CHECK_EQ(syncHostU32(reply.payload), EPOCH + 1);
+	CHECK(edge >= minLate && edge <= maxLate);
+	CHECK(llabs(syncHostI32(&reply.payload[4]) - edge) <= 10);	//micros() calls cost 1 us each here
+	CHECK_EQ(syncLastLateMicros(), syncHostI32(&reply.payload[4]));
+	CHECK_EQ(readEpoch(), EPOCH + 1);
+}
+
+void testSet(DS3231Sim &rtc, int fd, Stream &port) {
+	//loop() keeping up: on the boundary
+	checkSet(rtc, fd, port, 250, 500, -20, 20);
+	//loop() busy through the boundary: late, and says by how much
+	checkSet(rtc, fd, port, 900, 150000, 40000, 160000);
+	//first try at the write NAKed: the retry is what set the clock, and what's reported
+	Wire.failNext(1, WIRE_NACK_DATA);
+	checkSet(rtc, fd, port, 500, 500, 100, 100000);
+}
+
+void testQuery(DS3231Sim &rtc, int fd, Stream &port) {
+	SyncHostReply reply;
+	(void)rtc;
+	syncHostSend(fd, SYNC_MSG_QUERY, NULL, 0);
+	CHECK_EQ(device(port, 1000), SYNC_QUERY_DONE);
+	CHECK(syncHostReceive(fd, &reply, 1000));
+	CHECK_EQ(reply.type, SYNC_MSG_TIME);
+	CHECK_EQ(syncHostU32(reply.payload), EPOCH + 1);
+}
+
+void testReference(DS3231Sim &rtc, int fd, Stream &port) {
+	SyncHostReply reply;
+	uint8_t bad[6] = {0, 0, 0, 0, 0xdc, 0x05};		//1500 ms
+	(void)rtc;
+	syncHostSend(fd, SYNC_MSG_REFERENCE, bad, 6);
+	CHECK_EQ(device(port, 1000), SYNC_BAD_FRAME);
+	CHECK(syncHostReceive(fd, &reply, 1000));
+	CHECK_EQ(reply.type, SYNC_MSG_NAK);
+	CHECK_EQ(reply.payload[0], SYNC_BAD_TYPE);
+	syncHostSendTime(fd, SYNC_MSG_REFERENCE, (EPOCH + 1) * 1000000ULL);
+	CHECK_EQ(device(port, 1000), SYNC_REFERENCE_DONE);
+	CHECK(syncHostReceive(fd, &reply, 1000));
+	CHECK_EQ(reply.type, SYNC_MSG_REFERENCE_DONE);
+	CHECK_EQ(reply.len, 7);
+}
+
+void testBadFrames(DS3231Sim &rtc, int fd, Stream &port) {
+	SyncHostReply reply;
+	uint8_t corrupt[] = {SYNC_FRAME_START, SYNC_MSG_QUERY, 0, 0x00};
+	CHECK_EQ(::write(fd, corrupt, sizeof(corrupt)), (ssize_t)sizeof(corrupt));
+	CHECK_EQ(device(port, 1000), SYNC_BAD_FRAME);
+	CHECK(syncHostReceive(fd, &reply, 1000));
+	CHECK_EQ(reply.type, SYNC_MSG_NAK);
+	CHECK_EQ(reply.payload[0], SYNC_BAD_CHECK);
+	syncHostSend(fd, 0x42, NULL, 0);
+	CHECK_EQ(device(port, 1000), SYNC_BAD_FRAME);
+	CHECK(syncHostReceive(fd, &reply, 1000));
+	CHECK_EQ(reply.payload[0], SYNC_BAD_TYPE);
+	//The DS3231 doesn't answer the SET's write
+	syncHostSendTime(fd, SYNC_MSG_SET, EPOCH * 1000000ULL + 500000);
+	rtc.setPresent(false);
+	CHECK_EQ(device(port, 1000), SYNC_BAD_FRAME);
+	rtc.setPresent(true);
+	CHECK(syncHostReceive(fd, &reply, 1000));
+	CHECK_EQ(reply.type, SYNC_MSG_NAK);
+	CHECK_EQ(reply.payload[0], SYNC_BAD_WRITE);
+}
+
+int main(void) {
+	DS3231Sim rtc;
+	int master;
+	int fd;
+	Wire.begin();
+	rtc.setDateTime(2001, 1, 1, 0, 0, 0);
+	master = ptyOpen();
+	if(master < 0)
+		return 1;
+	fd = syncHostOpen(ptsname(master), 115200);
+	if(fd < 0) {
+		perror(ptsname(master));
+		return 1;
+	}
+	PtyStream port(master);
+	testSet(rtc, fd, port);
+	testQuery(rtc, fd, port);
+	testReference(rtc, fd, port);
+	testBadFrames(rtc, fd, port);
+	close(fd);
+	close(master);
+	return testResult();
+}
@@ -0,0 +1,194 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/test_temp.cpp                                                    ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+//Temperature readings and the aging offset controller against the simulated
+//DS3231: conversions are picked up when BSY clears, reads that fail add nothing
+//to the stats, and with the crystal made to run fast the controller walks the
+//aging offset until it's back on frequency - ignoring references it can't read
+//the DS3231 for.
+#include <Arduino.h>
+#include <Wire.h>
+#include <stdlib.h>
+#include "DS3231_sim.h"
+#include "DS3231_tisc.h"
+#include "DS3231_temp.h"
+#include "host_test.h"
+
+#define FAIL_CALL (DS3231_RETRIES + 1)	//transactions a checked call makes before it gives up
+#define INT_PIN 2
+#define EPOCH 1704067200UL			//2024-01-01 00:00:00, what the sim is set to
+#define ROUND_MILLIS (AGING_MIN_SPAN * 1000UL)
+
+uint64_t startNanos;				//host time the sim was set to EPOCH
+
+//The trusted reference: host time is exact, the DS3231 isn't
+bool reference(void) {
+	uint64_t ms = (hostNanos() - startNanos) / 1000000ULL;
+	return agingReference(EPOCH + ms / 1000, ms % 1000);
+}
+
+//ms of simulated time. An ISR sees the time at the end of a delay(), so the last
+//second goes by 1 ms at a time, as loop() would, to get tickClockISR()'s edge right
+void run(uint32_t ms) {
+	uint16_t i;
+	delay(ms - 1000);
+	for(i = 0; i < 1000; i++)
+		delay(1);
+}
+
+//temperatureService() like loop() would, until it's done
+uint8_t serviceUntilDone(void) {
+	uint8_t result;
+	uint16_t polls = 0;
+	while((result = temperatureService()) == TEMP_CONVERTING && ++polls < 1000)
+		delay(1);
+	return result;
+}
+
+void testConversion(DS3231Sim &rtc) {
+	uint32_t samples = getTemperatureStats().samples;
+	uint32_t conversions = rtc.conversions();
+	rtc.setTemperature(-9);			//-2.25 C
+	CHECK(startTemperatureConversion());
+	CHECK(!startTemperatureConversion());	//one's running
+	CHECK_EQ(temperatureService(), TEMP_CONVERTING);
+	CHECK_EQ(serviceUntilDone(), TEMP_READY);
+	CHECK_EQ(temperatureService(), TEMP_IDLE);
+	CHECK_EQ(rtc.conversions(), conversions + 1);
+	CHECK_EQ(getTemperatureStats().samples, samples + 1);
+	CHECK_EQ(getTemperatureStats().last, -9);
+	CHECK_EQ(readTemperature(), -9);
+}
+
+void testReadFailures(DS3231Sim &rtc) {
+	uint32_t samples;
+	rtc.setTemperature(100);
+	//readTemperature(): nothing read, nothing made up
+	rtc.setPresent(false);
+	CHECK_EQ(readTemperature(), TEMP_INVALID);
+	CHECK_EQ(ds3231LastError(), DS3231_ERR_NACK_ADDRESS);
+	rtc.setPresent(true);
+	//CONTROL not read: not written back either
+	Wire.failNext(FAIL_CALL, WIRE_SHORT);
+	CHECK(!startTemperatureConversion());
+	CHECK_EQ(rtc.reg(DS3231_CONTROL) & DS3231_CONV, 0);
+	CHECK_EQ(temperatureService(), TEMP_IDLE);
+	//The poll fails: no sample, tried again at the next one
+	samples = getTemperatureStats().samples;
+	CHECK(startTemperatureConversion());
+	delay(200);
+	Wire.failNext(FAIL_CALL);
+	CHECK_EQ(temperatureService(), TEMP_CONVERTING);
+	CHECK_EQ(getTemperatureStats().samples, samples);
+	delay(TEMP_POLL_MILLIS);
+	CHECK_EQ(temperatureService(), TEMP_READY);
+	CHECK_EQ(getTemperatureStats().samples, samples + 1);
+	CHECK_EQ(getTemperatureStats().last, 100);
+}
+
+//+5 ppm crystal: each AGING_MIN_SPAN the controller measures the drift and moves
+//the offset half the way, AGING_MAX_STEP at most
+void testAgingController(DS3231Sim &rtc) {
+	AgingStats stats;
+	uint8_t round;
+	rtc.setDriftPpm(5.0);
+	CHECK(!reference());				//baseline
+	CHECK_EQ(getAgingStats().offset, 0);
+	CHECK_EQ(getAgingStats().references, 1);
+	run(ROUND_MILLIS);
+	CHECK(reference());
+	stats = getAgingStats();
+	CHECK(abs(stats.lastPpmTenths - 50) <= 1);
+	CHECK(abs(stats.lastErrorMillis - 108) <= 2);	//5 ppm of 6 hours
+	CHECK_EQ(stats.offset, AGING_MAX_STEP);
+	CHECK_EQ(stats.adjustments, 1);
+	CHECK_EQ((int8_t)rtc.reg(DS3231_AGING_OFFSET), AGING_MAX_STEP);
+	delay(200);						//the conversion it started applies it
+	CHECK(rtc.ppm() < 4.01 && rtc.ppm() > 3.99);
+	for(round = 0; round < 8; round++) {
+		run(ROUND_MILLIS);
+		reference();
+	}
+	stats = getAgingStats();
+	CHECK(abs(stats.lastPpmTenths) <= 3);
+	CHECK(stats.offset >= 45 && stats.offset <= 55);
+	CHECK_EQ((int8_t)rtc.reg(DS3231_AGING_OFFSET), stats.offset);
+	CHECK(rtc.ppm() < 0.5 && rtc.ppm() > -0.5);
+}
+
+//References the DS3231 can't be read for, or whose offset can't be written,
+//change nothing
+void testAgingFailures(DS3231Sim &rtc) {
+	AgingStats before;
+	AgingStats after;
+	rtc.setDriftPpm(-3.0);			//the crystal's changed, the offset has work to do
+	run(ROUND_MILLIS);
+	before = getAgingStats();
+	rtc.setPresent(false);
+	CHECK(!reference());
+	rtc.setPresent(true);
+	after = getAgingStats();
+	CHECK_EQ(after.references, before.references);
+	CHECK_EQ(after.lastErrorMillis, before.lastErrorMillis);
+	CHECK_EQ(after.offset, before.offset);
+	//The time's read, the offset write NAKs every try
+	Wire.failNext(FAIL_CALL, WIRE_NACK_ADDR, 2);
+	CHECK(!reference());
+	after = getAgingStats();
+	CHECK_EQ(after.references, before.references + 1);
+	CHECK_EQ(after.adjustments, before.adjustments);
+	CHECK_EQ(after.offset, before.offset);
+	CHECK_EQ((int8_t)rtc.reg(DS3231_AGING_OFFSET), before.offset);
+	//Next time round it goes through
+	run(ROUND_MILLIS);
+	CHECK(reference());
+	after = getAgingStats();
+	CHECK(after.lastPpmTenths < 0);
+	CHECK_EQ(after.offset, before.offset - AGING_MAX_STEP);
+	CHECK_EQ((int8_t)rtc.reg(DS3231_AGING_OFFSET), after.offset);
+	//No baseline from a failed read either: after a restart, the first good one is it
+	agingRestart();
+	rtc.setPresent(false);
+	CHECK(!reference());
+	rtc.setPresent(true);
+	run(ROUND_MILLIS);
+	before = getAgingStats();
+	CHECK(!reference());				//baseline, not an adjustment
+	CHECK_EQ(getAgingStats().adjustments, before.adjustments);
+}
+
+//A reference that's minutes out, a bad NTP answer say, is thousands of ppm: still
+//AGING_MAX_STEP the right way, not wrapped round to the wrong one
+void testAgingWildReference(void) {
+	uint64_t ms;
+	int16_t offset;
+	agingRestart();
+	reference();						//baseline
+	offset = getAgingStats().offset;
+	run(ROUND_MILLIS + 200000UL);		//long enough with the 173 s off
+	ms = (hostNanos() - startNanos) / 1000000ULL;
+	CHECK(agingReference(EPOCH + ms / 1000 - 173, ms % 1000));	//the DS3231 looks 173 s fast
+	CHECK_EQ(getAgingStats().lastPpmTenths, 32767);	//~80000, pinned - half of it is past int16_t too
+	CHECK_EQ(getAgingStats().offset, offset + AGING_MAX_STEP);
+}
+
+int main(void) {
+	DS3231Sim rtc;
+	Wire.begin();
+	rtc.setDateTime(2024, 1, 1, 0, 0, 0);
+	startNanos = hostNanos();
+	testConversion(rtc);
+	testReadFailures(rtc);
+	//The tick clock gives the DS3231's time to the ms, which the controller needs
+	rtc.connectInterruptPin(INT_PIN);
+	attachInterrupt(digitalPinToInterrupt(INT_PIN), tickClockISR, FALLING);
+	startTickClock(0);
+	run(1100);						//an edge to measure from
+	testAgingController(rtc);
+	testAgingFailures(rtc);
+	testAgingWildReference();
+	stopTickClock();
+	return testResult();
+}
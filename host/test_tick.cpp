@@ -0,0 +1,183 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/test_tick.cpp                                                    ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+//The tick clock against the simulated DS3231's 1 Hz output: tickClockISR() on the
+//square wave's falling edges, the software clock carried over month, year and
+//century ends on its own (no resync) and agreeing with the chip's registers.
+#include <Arduino.h>
+#include <Wire.h>
+#include "DS3231_sim.h"
+#include "DS3231_tisc.h"
+#include "host_test.h"
+
+#define INT_PIN 2
+
+DateTime makeDateTime(uint16_t year, uint8_t month, uint8_t date, uint8_t hour24, uint8_t minute, uint8_t second) {
+	DateTime dt;
+	dt.d.year = year;
+	dt.d.month = month;
+	dt.d.date = date;
+	dt.d.weekday = weekdayOf(year, month, date);
+	dt.t.hour24 = hour24;
+	dt.t.hour12 = hour24 % 12 ? hour24 % 12 : 12;
+	dt.t.pm = hour24 >= 12;
+	dt.t.minute = minute;
+	dt.t.second = second;
+	return dt;
+}
+
+//Software clock and the DS3231 agree, field by field
+void checkSame(DateTime soft, DateTime chip) {
+	CHECK_EQ(soft.d.year, chip.d.year);
+	CHECK_EQ(soft.d.month, chip.d.month);
+	CHECK_EQ(soft.d.date, chip.d.date);
+	CHECK_EQ(soft.d.weekday, chip.d.weekday);
+	CHECK_EQ(soft.t.hour24, chip.t.hour24);
+	CHECK_EQ(soft.t.minute, chip.t.minute);
+	CHECK_EQ(soft.t.second, chip.t.second);
+}
+
+//Set 2 s before midnight at the end of year/month/date, tick over it, and
+//expect next (and its weekday) from the software clock alone
+void checkMidnight(DS3231Sim &rtc, uint16_t year, uint8_t month, uint8_t date, DateTime next) {
+	DateTime now;
+	uint16_t resyncs;
+	uint32_t ticks;
+	setDateTime(makeDateTime(year, month, date, 23, 59, 58));
+	tickClockService();				//picks the new time up
+	resyncs = getTickClockStats().resyncs;
+	ticks = rtc.ticks();
+	delay(2500);
+	CHECK_EQ(rtc.ticks(), ticks + 2);
+	now = tickClockNow();
+	CHECK_EQ(now.d.year, next.d.year);
+	CHECK_EQ(now.d.month, next.d.month);
+	CHECK_EQ(now.d.date, next.d.date);
+	CHECK_EQ(now.d.weekday, next.d.weekday);
+	CHECK_EQ(now.t.hour24, 0);
+	CHECK_EQ(now.t.minute, 0);
+	CHECK_EQ(now.t.second, 0);
+	checkSame(now, readDateTime());
+	tickClockService();
+	CHECK_EQ(getTickClockStats().resyncs, resyncs);	//worked out, not read back
+}
+
+void testMonths(DS3231Sim &rtc) {
+	checkMidnight(rtc, 2024, 1, 31, makeDateTime(2024, 2, 1, 0, 0, 0));
+	checkMidnight(rtc, 2024, 4, 30, makeDateTime(2024, 5, 1, 0, 0, 0));
+	checkMidnight(rtc, 2023, 2, 28, makeDateTime(2023, 3, 1, 0, 0, 0));
+	checkMidnight(rtc, 2024, 2, 28, makeDateTime(2024, 2, 29, 0, 0, 0));	//leap year
+	checkMidnight(rtc, 2024, 2, 29, makeDateTime(2024, 3, 1, 0, 0, 0));
+}
+
+void testYears(DS3231Sim &rtc) {
+	checkMidnight(rtc, 2023, 12, 31, makeDateTime(2024, 1, 1, 0, 0, 0));
+	checkMidnight(rtc, 2099, 12, 31, makeDateTime(2100, 1, 1, 0, 0, 0));	//century bit
+	CHECK_EQ(rtc.reg(DS3231_CEN_MONTH), 0x81);
+	CHECK_EQ(rtc.reg(DS3231_DEC_YEAR), 0x00);
+}
+
+//Two months of ticks in day-long steps, through a leap day, with no resync: the
+//software clock has to count every one of them
+void testLongRun(DS3231Sim &rtc) {
+	uint16_t resyncs;
+	uint8_t day;
+	setDateTime(makeDateTime(2023, 12, 31, 12, 0, 0));
+	tickClockService();
+	resyncs = getTickClockStats().resyncs;
+	for(day = 0; day < 62; day++) {
+		delay(86400000UL);
+		checkSame(tickClockNow(), readDateTime());
+	}
+	CHECK_EQ(tickClockNow().d.month, 3);
+	CHECK_EQ(tickClockNow().d.date, 2);
+	tickClockService();
+	CHECK_EQ(getTickClockStats().resyncs, resyncs);
+	(void)rtc;
+}
+
+//tickClockService() from a loop() that only gets round every 7 s: a drift check
+//every minute or so all the same, and one that finds the chip's seconds moved
+//reloads the software clock
+void testDriftCheck(DS3231Sim &rtc) {
+	TickClockStats before = getTickClockStats();
+	TickClockStats after;
+	uint8_t i;
+	setDateTime(makeDateTime(2024, 6, 1, 12, 0, 0));
+	tickClockService();
+	for(i = 0; i < 28; i++) {		//3 minutes and a bit
+		delay(7000);
+		tickClockService();
+	}
+	after = getTickClockStats();
+	CHECK_EQ(after.driftChecks - before.driftChecks, 3);
+	CHECK_EQ(after.driftFailures, before.driftFailures);
+	rtc.poke(DS3231_SECONDS, bcdEncode((tickClockNow().t.second + 5) % 60));
+	for(i = 0; i < 9; i++) {
+		delay(7000);
+		tickClockService();
+	}
+	after = getTickClockStats();
+	CHECK_EQ(after.driftFailures - before.driftFailures, 1);
+	CHECK_EQ(after.resyncs - before.resyncs, 2);	//the setDateTime() and the failure
+	checkSame(tickClockNow(), readDateTime());
+}
+
+//No CONTROL read each tick: the alarm enables come from the library's own writes
+void testAlarmsWithoutControlReads(DS3231Sim &rtc) {
+	AlarmSetting a;
+	uint32_t transactions;
+	uint32_t checks;
+	uint8_t alarms = 0;
+	uint8_t i;
+	a.alarm_mask = ALARM1_EVERY_SECOND;
+	a.t = makeDateTime(2024, 1, 1, 0, 0, 0).t;
+	a.date = 1;
+	a.weekday = 1;
+	setAlarm(a);
+	turnAlarmOff(3);
+	delay(1000);
+	tickClockService();
+	for(i = 0; i < 70; i++) {		//alarms off: no traffic but the drift check
+		delay(1000);
+		transactions = Wire.traffic().transactions;
+		checks = getTickClockStats().driftChecks;
+		tickClockService();
+		if(getTickClockStats().driftChecks == checks)
+			CHECK_EQ(Wire.traffic().transactions, transactions);
+	}
+	turnAlarmOn(1);
+	for(i = 0; i < 3; i++) {
+		delay(1000);
+		alarms |= tickClockService();
+	}
+	CHECK_EQ(alarms, 0x01);
+	turnAlarmOff(1);
+	//Written behind the library's back: after invalidateRegisterCache() it's read again
+	rtc.poke(DS3231_CONTROL, rtc.reg(DS3231_CONTROL) | 0x01);
+	invalidateRegisterCache();
+	delay(1000);
+	alarms = tickClockService();
+	delay(1000);
+	alarms |= tickClockService();
+	CHECK_EQ(alarms, 0x01);
+	turnAlarmOff(1);
+}
+
+int main(void) {
+	DS3231Sim rtc;
+	Wire.begin();
+	rtc.setDateTime(2024, 1, 1, 0, 0, 0);
+	rtc.connectInterruptPin(INT_PIN);
+	attachInterrupt(digitalPinToInterrupt(INT_PIN), tickClockISR, FALLING);
+	startTickClock(0);				//no periodic resync, so every rollover is the software's
+	testMonths(rtc);
+	testYears(rtc);
+	testLongRun(rtc);
+	testDriftCheck(rtc);
+	testAlarmsWithoutControlReads(rtc);
+	stopTickClock();
+	return testResult();
+}
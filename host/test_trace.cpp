@@ -0,0 +1,157 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/test_trace.cpp                                                   ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+//The trace's binary dump over a pty loopback, built with DS3231_TRACE: traceDumpBinary()
+//on the pty's master, what ds3231_trace uses (trace_host.cpp) on its slave. Sent as it
+//is, and asked for through syncFromHost() as a SERIAL_SYNC sketch would.
+#include <Arduino.h>
+#include <Wire.h>
+#include <string.h>
+#include <unistd.h>
+#include "DS3231_sim.h"
+#include "DS3231_tisc.h"
+#include "DS3231_sync.h"
+#include "DS3231_trace.h"
+#include "sync_host.h"
+#include "trace_host.h"
+#include "pty_stream.h"
+#include "host_test.h"
+
+#define TIMEOUT_MILLIS 1000
+
+TraceHostDump dump;
+TraceHostEvent events[256];
+
+//Runs syncFromHost() like loop() would until it finishes something
+uint8_t device(Stream &port) {
+	uint8_t result;
+	uint16_t tries = 0;
+	while((result = syncFromHost(port)) == SYNC_NONE && ++tries < 1000)
+		usleep(100);		//the pty's a real one, give it real time
+	return result;
+}
+
+const TraceHostEvent *findEvent(uint8_t n, uint8_t id) {
+	uint8_t i;
+	for(i = 0; i < n; i++)
+		if(events[i].id == id)
+			return &events[i];
+	return NULL;
+}
+
+//Known durations, more than the ring holds: the oldest are lost, the rest arrive in order
+void testDump(int fd, Stream &port) {
+	const TraceHostEvent *read;
+	uint8_t n;
+	uint16_t i;
+	traceClear();
+	for(i = 0; i < DS3231_TRACE_SIZE + 10; i++)
+		traceRecord(i % 2 ? TRACE_I2C_READ : TRACE_USER, i % 2 ? 100 + i : 70000);
+	traceDumpBinary(port);
+	CHECK(traceHostReceive(fd, &dump, TIMEOUT_MILLIS));
+	CHECK_EQ(dump.lost, 10);
+	CHECK_EQ(dump.count, DS3231_TRACE_SIZE);
+	CHECK_EQ(dump.records[0].id, TRACE_USER);			//record 10 is the oldest left
+	CHECK_EQ(dump.records[0].micros, 0xffff);			//saturated
+	CHECK_EQ(dump.records[1].id, TRACE_I2C_READ);
+	CHECK_EQ(dump.records[1].micros, 111);
+	CHECK_EQ(dump.records[DS3231_TRACE_SIZE - 1].micros, 100 + DS3231_TRACE_SIZE + 9);
+	CHECK(!_tracePeek(0, NULL));						//emptied
+	n = traceHostEvents(&dump, events);
+	CHECK_EQ(n, 2);
+	read = findEvent(n, TRACE_I2C_READ);
+	CHECK(read != NULL);
+	if(read) {
+		CHECK_EQ(read->count, DS3231_TRACE_SIZE / 2);
+		CHECK_EQ(read->min, 111);
+		CHECK_EQ(read->max, 100 + DS3231_TRACE_SIZE + 9);
+		CHECK_EQ(read->p50, 111 + 2 * (DS3231_TRACE_SIZE / 4 - 1));
+		CHECK_EQ(read->hist[traceHostBucket(111)], (128 - 111 + 1) / 2);	//111, 113...127
+		CHECK_EQ(read->hist[traceHostBucket(128)], DS3231_TRACE_SIZE / 2 - (128 - 111 + 1) / 2);
+	}
+	CHECK_EQ(findEvent(n, TRACE_USER)->hist[TRACE_HOST_BUCKETS - 1], DS3231_TRACE_SIZE / 2);
+	//Nothing new: one empty frame
+	traceDumpBinary(port);
+	CHECK(traceHostReceive(fd, &dump, TIMEOUT_MILLIS));
+	CHECK_EQ(dump.count, 0);
+	CHECK_EQ(dump.lost, 0);
+	//A whole number of frames: an empty one after them says that's all
+	for(i = 0; i < TRACE_FRAME_RECORDS; i++)
+		traceRecord(TRACE_DECODE, i);
+	traceDumpBinary(port);
+	CHECK(traceHostReceive(fd, &dump, TIMEOUT_MILLIS));
+	CHECK_EQ(dump.count, TRACE_FRAME_RECORDS);
+}
+
+//The bucket edges, and what the table and histograms look like
+void testBuckets(void) {
+	char *text;
+	size_t size;
+	FILE *out;
+	CHECK_EQ(traceHostBucket(0), 0);
+	CHECK_EQ(traceHostBucket(1), 0);
+	CHECK_EQ(traceHostBucket(2), 1);
+	CHECK_EQ(traceHostBucket(3), 1);
+	CHECK_EQ(traceHostBucket(4), 2);
+	CHECK_EQ(traceHostBucket(0xfffe), TRACE_HOST_BUCKETS - 2);
+	CHECK_EQ(traceHostBucket(0xffff), TRACE_HOST_BUCKETS - 1);
+	out = open_memstream(&text, &size);
+	traceHostPrint(out, &dump);
+	fclose(out);
+	CHECK(strstr(text, "decode") != NULL);
+	CHECK(strstr(text, "8 -    15  ") != NULL);
+	free(text);
+}
+
+//Through syncFromHost(): a SERIAL_SYNC sketch's port belongs to the host
+void testSync(int fd, Stream &port) {
+	SyncHostReply reply;
+	uint8_t n;
+	traceClear();
+	readDateTime();			//the library's own events
+	CHECK(traceHostRequest(fd, TRACE_CMD_DUMP));
+	CHECK_EQ(device(port), SYNC_TRACE_DONE);
+	CHECK(traceHostReceive(fd, &dump, TIMEOUT_MILLIS));
+	n = traceHostEvents(&dump, events);
+	CHECK(findEvent(n, TRACE_I2C_POINTER) != NULL);
+	CHECK(findEvent(n, TRACE_I2C_READ) != NULL);
+	CHECK(findEvent(n, TRACE_DECODE) != NULL);
+	//Clear is answered with an empty dump
+	traceRecord(TRACE_USER, 5);
+	CHECK(traceHostRequest(fd, TRACE_CMD_CLEAR));
+	CHECK_EQ(device(port), SYNC_TRACE_DONE);
+	CHECK(traceHostReceive(fd, &dump, TIMEOUT_MILLIS));
+	CHECK_EQ(dump.count, 0);
+	CHECK(!_tracePeek(0, NULL));
+	//Anything else is NAKed
+	CHECK(traceHostRequest(fd, 'x'));
+	CHECK_EQ(device(port), SYNC_BAD_FRAME);
+	CHECK(syncHostReceive(fd, &reply, TIMEOUT_MILLIS));
+	CHECK_EQ(reply.type, SYNC_MSG_NAK);
+	CHECK_EQ(reply.payload[0], SYNC_BAD_TYPE);
+}
+
+int main(void) {
+	DS3231Sim rtc;
+	int master;
+	int fd;
+	Wire.begin();
+	rtc.setDateTime(2001, 1, 1, 0, 0, 0);
+	master = ptyOpen();
+	if(master < 0)
+		return 1;
+	fd = syncHostOpen(ptsname(master), 115200);
+	if(fd < 0) {
+		perror(ptsname(master));
+		return 1;
+	}
+	PtyStream port(master);
+	testDump(fd, port);
+	testBuckets();
+	testSync(fd, port);
+	close(fd);
+	close(master);
+	return testResult();
+}
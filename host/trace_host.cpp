@@ -0,0 +1,191 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/trace_host.cpp                                                   ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "sync_host.h"
+#include "trace_host.h"
+
+#define BAR_WIDTH 40		//characters for the biggest bucket
+
+/*****************************************************************
+* traceHostRequest(fd, command)
+* Sends command as a SYNC_MSG_TRACE frame. A sketch with SERIAL_SYNC
+* takes it as that; one without reads the frame a byte at a time,
+* and only the command byte means anything to traceCommand() - the
+* start, type, length and check bytes of a TRACE_CMD_DUMP or
+* TRACE_CMD_CLEAR frame never match a command
+* @return - false if the write failed
+*****************************************************************/
+bool traceHostRequest(int fd, uint8_t command) {
+	return syncHostSend(fd, SYNC_MSG_TRACE, &command, 1);
+}
+/*****************************************************************
+* traceHostAdd(dump, payload, len)
+* @payload - a TRACE_FRAME_TYPE frame's payload: lost u16, then
+*            (id u8, us u16) records
+* Records past TRACE_HOST_MAX are counted as lost
+* @return - true if it was the dump's last frame
+*****************************************************************/
+bool traceHostAdd(TraceHostDump *dump, const uint8_t *payload, uint8_t len) {
+	uint8_t n;
+	uint8_t i;
+	if(len < 2)
+		return true;		//not one of ours, don't wait for more
+	n = (len - 2) / 3;
+	dump->lost += payload[0] | (payload[1] << 8);
+	for(i = 0; i < n; i++) {
+		if(dump->count == TRACE_HOST_MAX) {
+			dump->lost++;
+			continue;
+		}
+		dump->records[dump->count].id = payload[2 + 3 * i];
+		dump->records[dump->count].micros = payload[3 + 3 * i] | (payload[4 + 3 * i] << 8);
+		dump->count++;
+	}
+	return n < TRACE_FRAME_RECORDS;
+}
+/*****************************************************************
+* traceHostReceive(fd, dump, timeoutMillis)
+* Collects TRACE_FRAME_TYPE frames until the short one that ends
+* the dump, skipping anything else the sketch prints
+* @timeoutMillis - for each frame
+* @return - false if the dump didn't finish in time, dump has what
+*           did arrive
+*****************************************************************/
+bool traceHostReceive(int fd, TraceHostDump *dump, uint32_t timeoutMillis) {
+	SyncHostReply reply;
+	dump->lost = 0;
+	dump->count = 0;
+	for(;;) {
+		if(!syncHostReceive(fd, &reply, timeoutMillis))
+			return false;
+		if(reply.type == TRACE_FRAME_TYPE && traceHostAdd(dump, reply.payload, reply.len))
+			return true;
+	}
+}
+int _compareU16(const void *a, const void *b) {
+	return (int)*(const uint16_t *)a - (int)*(const uint16_t *)b;
+}
+/*****************************************************************
+* traceHostEvents(dump, events)
+* @events - room for 256, one per id
+* Percentiles are nearest rank: p90 is the smallest duration at
+* least 90% of the events took no longer than
+* @return - how many events[] were filled in
+*****************************************************************/
+uint8_t traceHostEvents(const TraceHostDump *dump, TraceHostEvent *events) {
+	uint16_t took[TRACE_HOST_MAX];
+	uint8_t n = 0;
+	uint16_t i;
+	uint16_t j;
+	uint16_t count;
+	double sum;
+	for(i = 0; i < dump->count; i++) {
+		for(j = 0; j < i && dump->records[j].id != dump->records[i].id; j++)
+			;
+		if(j < i)
+			continue;		//already done
+		memset(&events[n], 0, sizeof(events[n]));
+		events[n].id = dump->records[i].id;
+		count = 0;
+		sum = 0;
+		for(j = i; j < dump->count; j++) {
+			if(dump->records[j].id != events[n].id)
+				continue;
+			took[count++] = dump->records[j].micros;
+			sum += dump->records[j].micros;
+			events[n].hist[traceHostBucket(dump->records[j].micros)]++;
+		}
+		qsort(took, count, sizeof(took[0]), _compareU16);
+		events[n].count = count;
+		events[n].min = took[0];
+		events[n].max = took[count - 1];
+		events[n].p50 = took[(count * 50 + 99) / 100 - 1];
+		events[n].p90 = took[(count * 90 + 99) / 100 - 1];
+		events[n].p99 = took[(count * 99 + 99) / 100 - 1];
+		events[n].mean = sum / count;
+		n++;
+	}
+	return n;
+}
+uint8_t traceHostBucket(uint16_t us) {
+	uint8_t bucket = 0;
+	if(us == 0xffff)
+		return TRACE_HOST_BUCKETS - 1;		//saturated, could be any length
+	while(us >= (2U << bucket))
+		bucket++;
+	return bucket;
+}
+/*****************************************************************
+* traceHostName(id)
+* What _traceName() calls them on the device
+*****************************************************************/
+const char *traceHostName(uint8_t id) {
+	switch(id) {
+		case TRACE_I2C_POINTER:		return "i2c ptr";
+		case TRACE_I2C_READ:		return "i2c read";
+		case TRACE_I2C_WRITE:		return "i2c write";
+		case TRACE_DECODE:			return "decode";
+		case TRACE_JOURNAL_READ:	return "eeprom read";
+		case TRACE_JOURNAL_WRITE:	return "eeprom write";
+	}
+	return NULL;
+}
+void _printName(FILE *out, uint8_t id) {
+	char name[16];
+	if(traceHostName(id))
+		snprintf(name, sizeof(name), "%s", traceHostName(id));
+	else if(id >= TRACE_USER)
+		snprintf(name, sizeof(name), "user+%u", id - TRACE_USER);
+	else
+		snprintf(name, sizeof(name), "%u", id);
+	fprintf(out, "%-14s", name);
+}
+/*****************************************************************
+* traceHostPrint(out, dump)
+* A row per event - count, min, percentiles, max and mean in us -
+* then each event's histogram, from its first non-empty bucket to
+* its last, as bars
+*****************************************************************/
+void traceHostPrint(FILE *out, const TraceHostDump *dump) {
+	TraceHostEvent events[256];
+	uint8_t n = traceHostEvents(dump, events);
+	uint8_t i;
+	uint8_t b;
+	uint8_t first;
+	uint8_t last;
+	uint16_t most;
+	uint16_t top;
+	fprintf(out, "%u records, %u lost before the dump\n", dump->count, dump->lost);
+	if(!n)
+		return;
+	fprintf(out, "%-14s %6s %6s %6s %6s %6s %6s %8s  (us)\n", "event", "n", "min", "p50", "p90", "p99", "max", "mean");
+	for(i = 0; i < n; i++) {
+		_printName(out, events[i].id);
+		fprintf(out, " %6u %6u %6u %6u %6u %6u %8.1f\n", events[i].count, events[i].min, events[i].p50,
+			events[i].p90, events[i].p99, events[i].max, events[i].mean);
+	}
+	for(i = 0; i < n; i++) {
+		fprintf(out, "\n");
+		_printName(out, events[i].id);
+		fprintf(out, "\n");
+		first = traceHostBucket(events[i].min);
+		last = traceHostBucket(events[i].max);
+		most = 0;
+		for(b = first; b <= last; b++)
+			if(events[i].hist[b] > most)
+				most = events[i].hist[b];
+		for(b = first; b <= last; b++) {
+			top = b == TRACE_HOST_BUCKETS - 2 ? 0xfffe : (2U << b) - 1;	//0xffff is the next one
+			if(b == TRACE_HOST_BUCKETS - 1)
+				fprintf(out, "  %13s  ", ">= 65535");
+			else
+				fprintf(out, "  %5u - %5u  ", b ? 1U << b : 0, top);
+			fprintf(out, "%-*.*s %u\n", BAR_WIDTH, (events[i].hist[b] * BAR_WIDTH + most - 1) / most,
+				"########################################", events[i].hist[b]);
+		}
+	}
+}
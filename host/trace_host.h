@@ -0,0 +1,54 @@
+/*****************************************************************************
+***  TechIsSoCool.com DS3231 Real-Time Clock Module Interface for Arduino  ***
+***  host/trace_host.h                                                     ***
+***  Visit: https://TechIsSoCool.com for details						   ***
+******************************************************************************/
+#ifndef _TRACE_HOST_H
+#define _TRACE_HOST_H
+
+//The computer's side of traceDumpBinary() (DS3231_trace.h), for Linux: asks the sketch
+//for a dump, collects its frames and works out per event latency histograms and
+//percentiles - finer than traceSummary() can afford on the device. ds3231_trace is the
+//command line tool built on it, test_trace runs it against the library over a pty.
+//  int fd = syncHostOpen("/dev/ttyACM0", 9600);
+//  TraceHostDump dump;
+//  traceHostRequest(fd, TRACE_CMD_DUMP);
+//  if(traceHostReceive(fd, &dump, 3000))
+//    traceHostPrint(stdout, &dump);
+
+#include <stdint.h>
+#include <stdio.h>
+#include "DS3231_trace.h"
+
+#define TRACE_HOST_MAX     255	//records in one dump, DS3231_TRACE_SIZE can't be more
+#define TRACE_HOST_BUCKETS 17	//bucket 0 is 0-1 us, bucket n 2^n to 2^(n+1)-1, the last 65535 (or longer)
+
+class TraceHostDump {
+	public:
+	uint16_t lost;		//records overwritten on the device before it was dumped
+	uint16_t count;		//records in records[]
+	TraceRecord records[TRACE_HOST_MAX];	//oldest first
+};
+
+class TraceHostEvent {
+	public:
+	uint8_t id;			//TRACE_... event
+	uint16_t count;
+	uint16_t min;		//us
+	uint16_t p50;
+	uint16_t p90;
+	uint16_t p99;
+	uint16_t max;
+	double mean;
+	uint16_t hist[TRACE_HOST_BUCKETS];
+};
+
+//Function prototypes
+bool traceHostRequest(int fd, uint8_t command);	//TRACE_CMD_..., in a SYNC_MSG_TRACE frame, which works with SERIAL_SYNC or without
+bool traceHostAdd(TraceHostDump *dump, const uint8_t *payload, uint8_t len); //Adds one frame's records, true if it was the last
+bool traceHostReceive(int fd, TraceHostDump *dump, uint32_t timeoutMillis);	//A whole dump, false on timeout
+uint8_t traceHostEvents(const TraceHostDump *dump, TraceHostEvent *events);	//Stats per event id, in the order they first appear. events has room for 256
+uint8_t traceHostBucket(uint16_t us);			//Which histogram bucket us goes in
+const char *traceHostName(uint8_t id);			//library events' names, NULL for the sketch's
+void traceHostPrint(FILE *out, const TraceHostDump *dump);	//Table, then a histogram per event
+#endif